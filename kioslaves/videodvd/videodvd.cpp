@@ -18,6 +18,7 @@
 #include <config-k3b.h>
 #include "k3bdevicemanager.h"
 #include "k3bdevice.h"
+#include "k3bworkerpool.h"
 #include "videodvd_export.h"
 #include "videodvd_i18n.h"
 
@@ -26,14 +27,95 @@
 #include <QDebug>
 #include <QBitArray>
 #include <QLoggingCategory>
+#include <QSemaphore>
 
 #include <stdlib.h>
 
 namespace
 {
     const int CMD_MIMETYPE = 70; // Should be declared in KIOCore/KIO/Global, but it's missing. Why?
+
+    // sessions are dropped after this many seconds without a request
+    const int s_sessionTimeout = 30;
+
+    // the size of the transfers when copying a file
+    const int s_readAheadSize = 4*1024*1024;
+
+    /**
+     * The primary volume descriptor is compared to detect a medium change
+     * without parsing the file system again.
+     */
+    QByteArray readPrimaryDescriptor( K3b::Device::Device* dev )
+    {
+        QByteArray pvd( 2048, '\0' );
+        if( !dev->read10( reinterpret_cast<unsigned char*>( pvd.data() ), pvd.size(), 16, 1 ) )
+            pvd.clear();
+        return pvd;
+    }
+
+
+    /**
+     * Reads the next block of a file in the worker pool while the
+     * previous one is sent to the application.
+     */
+    class BlockReader : public K3b::WorkerPool::Task
+    {
+    public:
+        BlockReader()
+            : file( 0 ),
+              pos( 0 ),
+              result( 0 ),
+              buffer( s_readAheadSize, Qt::Uninitialized ),
+              done( 1 ) {
+        }
+
+        void start( const K3b::Iso9660File* f, unsigned int p ) {
+            done.acquire();
+            file = f;
+            pos = p;
+            K3b::WorkerPool::instance()->submit( this );
+        }
+
+        int wait() {
+            done.acquire();
+            done.release();
+            return result;
+        }
+
+        void run() {
+            result = file->read( pos, buffer.data(), buffer.size() );
+            done.release();
+        }
+
+        const K3b::Iso9660File* file;
+        unsigned int pos;
+        int result;
+        QByteArray buffer;
+
+        // available while no read is running
+        QSemaphore done;
+    };
 } // namespace
 
+
+class kio_videodvdProtocol::Session
+{
+public:
+    Session()
+        : device( 0 ),
+          iso( 0 ) {
+    }
+
+    ~Session() {
+        delete iso;
+    }
+
+    K3b::Device::Device* device;
+    K3b::Iso9660* iso;
+    QString volumeId;
+    QByteArray primaryDescriptor;
+};
+
 using namespace KIO;
 
 Q_DECLARE_LOGGING_CATEGORY(KIO_VIDEODVD)
@@ -75,7 +157,10 @@ K3b::Device::DeviceManager* kio_videodvdProtocol::s_deviceManager = 0;
 int kio_videodvdProtocol::s_instanceCnt = 0;
 
 kio_videodvdProtocol::kio_videodvdProtocol(const QByteArray &pool_socket, const QByteArray &app_socket)
-    : SlaveBase("kio_videodvd", pool_socket, app_socket)
+    : SlaveBase("kio_videodvd", pool_socket, app_socket),
+      m_openSession( 0 ),
+      m_openFile( 0 ),
+      m_openPosition( 0 )
 {
     qDebug() << "kio_videodvdProtocol::kio_videodvdProtocol()";
     if( !s_deviceManager )
@@ -91,6 +176,7 @@ kio_videodvdProtocol::kio_videodvdProtocol(const QByteArray &pool_socket, const
 kio_videodvdProtocol::~kio_videodvdProtocol()
 {
     qDebug() << "kio_videodvdProtocol::~kio_videodvdProtocol()";
+    closeSessions();
     s_instanceCnt--;
     if( s_instanceCnt == 0 )
     {
@@ -130,74 +216,151 @@ KIO::UDSEntry kio_videodvdProtocol::createUDSEntry( const K3b::Iso9660Entry* e )
 }
 
 
-// FIXME: remember the iso instance for quicker something and search for the videodvd
-//        in the available devices.
-K3b::Iso9660* kio_videodvdProtocol::openIso( const QUrl& url, QString& plainIsoPath )
+kio_videodvdProtocol::Session* kio_videodvdProtocol::sessionForDevice( K3b::Device::Device* dev )
+{
+    const QByteArray pvd = readPrimaryDescriptor( dev );
+
+    for( int i = 0; i < m_sessions.count(); ++i ) {
+        Session* session = m_sessions[i];
+        if( session->device == dev ) {
+            if( !pvd.isEmpty() && pvd == session->primaryDescriptor )
+                return session;
+
+            // the medium changed
+            if( session == m_openSession ) {
+                m_openSession = 0;
+                m_openFile = 0;
+            }
+            delete m_sessions.takeAt( i );
+            break;
+        }
+    }
+
+    if( pvd.isEmpty() )
+        return 0;
+
+    K3b::Device::DiskInfo di = dev->diskInfo();
+
+    // we search for a DVD with a single track.
+    // this time let K3b::Iso9660 decide if we need dvdcss or not
+    // FIXME: check for encryption and libdvdcss and report an error
+    if( K3b::Device::isDvdMedia( di.mediaType() ) && di.numTracks() == 1 ) {
+        K3b::Iso9660* iso = new K3b::Iso9660( dev );
+        iso->setPlainIso9660( true );
+        if( iso->open() && iso->firstIsoDirEntry()->entry( "VIDEO_TS" ) != 0 ) {
+            Session* session = new Session();
+            session->device = dev;
+            session->iso = iso;
+            session->volumeId = iso->primaryDescriptor().volumeId;
+            session->primaryDescriptor = pvd;
+            m_sessions.append( session );
+            return session;
+        }
+        delete iso;
+    }
+
+    return 0;
+}
+
+
+kio_videodvdProtocol::Session* kio_videodvdProtocol::openSession( const QUrl& url, QString& plainIsoPath )
 {
     // get the volume id from the url
     QString volumeId = url.path().section( '/', 1, 1 );
 
     qDebug() << "(kio_videodvdProtocol) searching for Video dvd: " << volumeId;
 
+    // drop the sessions once we are idle
+    setTimeoutSpecialCommand( s_sessionTimeout );
 
-    // now search the devices for this volume id
-    // FIXME: use the cache created in listVideoDVDs
+    // now search the devices for this volume id, preferring
+    // the ones we already know
+    Session* found = 0;
     QList<K3b::Device::Device *> items(s_deviceManager->dvdReader());
     for( QList<K3b::Device::Device *>::const_iterator it = items.constBegin();
          it != items.constEnd(); ++it ) {
-        K3b::Device::Device* dev = *it;
-        K3b::Device::DiskInfo di = dev->diskInfo();
-
-        // we search for a DVD with a single track.
-        // this time let K3b::Iso9660 decide if we need dvdcss or not
-        // FIXME: check for encryption and libdvdcss and report an error
-        if( K3b::Device::isDvdMedia( di.mediaType() ) && di.numTracks() == 1 ) {
-            K3b::Iso9660* iso = new K3b::Iso9660( dev );
-            iso->setPlainIso9660( true );
-            if( iso->open() /*&& iso->primaryDescriptor().volumeId == volumeId*/ ) {
-                plainIsoPath = url.path().section( '/', 2, -1 ) + '/';
-                qDebug() << "(kio_videodvdProtocol) using iso path: " << plainIsoPath;
-                return iso;
+        if( Session* session = sessionForDevice( *it ) ) {
+            if( session->volumeId == volumeId ) {
+                found = session;
+                break;
+            }
+            // like before we accept any Video DVD if there is none with the volume id
+            else if( !found ) {
+                found = session;
             }
-            delete iso;
         }
     }
 
+    if( found ) {
+        plainIsoPath = url.path().section( '/', 2, -1 ) + '/';
+        qDebug() << "(kio_videodvdProtocol) using iso path: " << plainIsoPath;
+        return found;
+    }
+
     error( ERR_SLAVE_DEFINED, i18n("No Video DVD found") );
     return 0;
 }
 
 
+void kio_videodvdProtocol::closeSessions()
+{
+    qDeleteAll( m_sessions );
+    m_sessions.clear();
+    m_openSession = 0;
+    m_openFile = 0;
+}
+
+
+void kio_videodvdProtocol::special( const QByteArray& )
+{
+    // the idle timeout, see openSession()
+    if( !m_openFile ) {
+        qDebug() << "(kio_videodvdProtocol) closing" << m_sessions.count() << "idle sessions";
+        closeSessions();
+    }
+    else {
+        setTimeoutSpecialCommand( s_sessionTimeout );
+    }
+}
+
+
 void kio_videodvdProtocol::get(const QUrl& url )
 {
     qDebug() << "kio_videodvd::get(const QUrl& url)";
 
     QString isoPath;
-    if( K3b::Iso9660* iso = openIso( url, isoPath ) )
+    if( Session* session = openSession( url, isoPath ) )
     {
-        const K3b::Iso9660Entry* e = iso->firstIsoDirEntry()->entry( isoPath );
+        const K3b::Iso9660Entry* e = session->iso->firstIsoDirEntry()->entry( isoPath );
         if( e && e->isFile() )
         {
             const K3b::Iso9660File* file = static_cast<const K3b::Iso9660File*>( e );
             totalSize( file->size() );
-            QByteArray buffer( 10*2048, '\n' );
+
+            //
+            // Read the next block while sending the current one
+            //
+            BlockReader readers[2];
+            int current = 0;
             int read = 0;
-            int cnt = 0;
             KIO::filesize_t totalRead = 0;
-            while( (read = file->read( totalRead, buffer.data(), buffer.size() )) > 0 )
+            readers[current].start( file, 0 );
+            while( (read = readers[current].wait()) > 0 )
             {
-                buffer.resize( read );
-                data(buffer);
-                ++cnt;
+                if( totalRead + read < file->size() )
+                    readers[1-current].start( file, totalRead + read );
+                else
+                    readers[1-current].result = 0;
+
+                data( QByteArray::fromRawData( readers[current].buffer.constData(), read ) );
                 totalRead += read;
-                if( cnt == 10 )
-                {
-                    cnt = 0;
-                    processedSize( totalRead );
-                }
+                processedSize( totalRead );
+
+                current = 1-current;
             }
 
-            delete iso;
+            // make sure no read is running anymore
+            readers[1-current].wait();
 
             data(QByteArray()); // empty array means we're done sending the data
 
@@ -212,6 +375,78 @@ void kio_videodvdProtocol::get(const QUrl& url )
 }
 
 
+void kio_videodvdProtocol::open( const QUrl& url, QIODevice::OpenMode mode )
+{
+    if( mode & (QIODevice::WriteOnly|QIODevice::Append|QIODevice::Truncate) ) {
+        error( ERR_CANNOT_OPEN_FOR_WRITING, url.path() );
+        return;
+    }
+
+    QString isoPath;
+    if( Session* session = openSession( url, isoPath ) ) {
+        const K3b::Iso9660Entry* e = session->iso->firstIsoDirEntry()->entry( isoPath );
+        if( e && e->isFile() ) {
+            m_openSession = session;
+            m_openFile = static_cast<const K3b::Iso9660File*>( e );
+            m_openPosition = 0;
+
+            if( e->name().endsWith( ".VOB" ) )
+                mimeType( "video/mpeg" );
+            else
+                mimeType( "application/octet-stream" );
+            totalSize( m_openFile->size() );
+            position( 0 );
+            opened();
+        }
+        else {
+            error( ERR_DOES_NOT_EXIST, url.path() );
+        }
+    }
+}
+
+
+void kio_videodvdProtocol::read( KIO::filesize_t size )
+{
+    if( !m_openFile ) {
+        error( ERR_COULD_NOT_READ, QString() );
+        return;
+    }
+
+    // the application decides about the size, we only limit it to something sane
+    QByteArray buffer( int( qMin( size, KIO::filesize_t( s_readAheadSize ) ) ), Qt::Uninitialized );
+    const int read = m_openFile->read( m_openPosition, buffer.data(), buffer.size() );
+    if( read < 0 ) {
+        error( ERR_COULD_NOT_READ, m_openFile->name() );
+        return;
+    }
+
+    buffer.resize( read );
+    m_openPosition += read;
+    data( buffer );
+}
+
+
+void kio_videodvdProtocol::seek( KIO::filesize_t offset )
+{
+    if( !m_openFile || offset > m_openFile->size() ) {
+        error( ERR_COULD_NOT_SEEK, m_openFile ? m_openFile->name() : QString() );
+        return;
+    }
+
+    m_openPosition = offset;
+    position( offset );
+}
+
+
+void kio_videodvdProtocol::close()
+{
+    m_openSession = 0;
+    m_openFile = 0;
+    m_openPosition = 0;
+    finished();
+}
+
+
 void kio_videodvdProtocol::listDir( const QUrl& url )
 {
     if( isRootDirectory( url ) ) {
@@ -222,9 +457,8 @@ void kio_videodvdProtocol::listDir( const QUrl& url )
     }
     else {
         QString isoPath;
-        K3b::Iso9660* iso = openIso( url, isoPath );
-        if( iso ) {
-            const K3b::Iso9660Directory* mainDir = iso->firstIsoDirEntry();
+        if( Session* session = openSession( url, isoPath ) ) {
+            const K3b::Iso9660Directory* mainDir = session->iso->firstIsoDirEntry();
             const K3b::Iso9660Entry* e = mainDir->entry( isoPath );
             if( e ) {
                 if( e->isDirectory() ) {
@@ -245,9 +479,6 @@ void kio_videodvdProtocol::listDir( const QUrl& url )
             else {
                 error( ERR_CANNOT_ENTER_DIRECTORY, url.path() );
             }
-
-            // for testing we always do the whole thing
-            delete iso;
         }
     }
 }
@@ -257,37 +488,29 @@ void kio_videodvdProtocol::listVideoDVDs()
 {
     UDSEntryList udsl;
 
+    setTimeoutSpecialCommand( s_sessionTimeout );
+
     QList<K3b::Device::Device *> items(s_deviceManager->dvdReader());
     for( QList<K3b::Device::Device *>::const_iterator it = items.constBegin();
          it != items.constEnd(); ++it ) {
-        K3b::Device::Device* dev = *it;
-        K3b::Device::DiskInfo di = dev->diskInfo();
-
-        // we search for a DVD with a single track.
-        if( K3b::Device::isDvdMedia( di.mediaType() ) && di.numTracks() == 1 ) {
-            //
-            // now do a quick check for VideoDVD.
-            // - no dvdcss for speed
-            // - only a check for the VIDEO_TS dir
-            //
-            K3b::Iso9660 iso( new K3b::Iso9660DeviceBackend(dev) );
-            iso.setPlainIso9660( true );
-            if( iso.open() && iso.firstIsoDirEntry()->entry( "VIDEO_TS" ) != 0 ) {
-                // FIXME: cache the entry for speedup
-
-                UDSEntry uds;
-                uds.insert( KIO::UDSEntry::UDS_NAME,iso.primaryDescriptor().volumeId );
-                uds.insert( KIO::UDSEntry::UDS_FILE_TYPE, S_IFDIR );
-                uds.insert( KIO::UDSEntry::UDS_MIME_TYPE, "inode/directory" );
-                uds.insert( KIO::UDSEntry::UDS_ICON_NAME, "media-optical-video" );
-                uds.insert( KIO::UDSEntry::UDS_SIZE, iso.primaryDescriptor().volumeSetSize );
-
-                udsl.append( uds );
-                listEntries( udsl );
-            }
+        //
+        // The sessions are reused by the following requests for the
+        // contents of the discs
+        //
+        if( Session* session = sessionForDevice( *it ) ) {
+            UDSEntry uds;
+            uds.insert( KIO::UDSEntry::UDS_NAME, session->volumeId );
+            uds.insert( KIO::UDSEntry::UDS_FILE_TYPE, S_IFDIR );
+            uds.insert( KIO::UDSEntry::UDS_MIME_TYPE, "inode/directory" );
+            uds.insert( KIO::UDSEntry::UDS_ICON_NAME, "media-optical-video" );
+            uds.insert( KIO::UDSEntry::UDS_SIZE, session->iso->primaryDescriptor().volumeSetSize );
+
+            udsl.append( uds );
         }
     }
 
+    listEntries( udsl );
+
     if( !udsl.isEmpty() ) {
         finished();
     }
@@ -316,17 +539,14 @@ void kio_videodvdProtocol::stat( const QUrl& url )
     }
     else {
         QString isoPath;
-        K3b::Iso9660* iso = openIso( url, isoPath );
-        if( iso ) {
-            const K3b::Iso9660Entry* e = iso->firstIsoDirEntry()->entry( isoPath );
+        if( Session* session = openSession( url, isoPath ) ) {
+            const K3b::Iso9660Entry* e = session->iso->firstIsoDirEntry()->entry( isoPath );
             if( e ) {
                 statEntry( createUDSEntry( e ) );
                 finished();
             }
             else
                 error( ERR_DOES_NOT_EXIST, url.path() );
-
-            delete iso;
         }
     }
 }
@@ -345,9 +565,8 @@ void kio_videodvdProtocol::mimetype( const QUrl& url )
     }
 
     QString isoPath;
-    K3b::Iso9660* iso = openIso( url, isoPath );
-    if( iso ) {
-        const K3b::Iso9660Entry* e = iso->firstIsoDirEntry()->entry( isoPath );
+    if( Session* session = openSession( url, isoPath ) ) {
+        const K3b::Iso9660Entry* e = session->iso->firstIsoDirEntry()->entry( isoPath );
         if( e ) {
             if( e->isDirectory() ) {
                 KIO::SlaveBase::mimeType( "inode/directory" );
@@ -372,6 +591,5 @@ void kio_videodvdProtocol::mimetype( const QUrl& url )
                     error( ERR_SLAVE_DEFINED, i18n("Read error.") );
             }
         }
-        delete iso;
     }
 }
@@ -16,6 +16,7 @@
 #ifndef _videodvd_H_
 #define _videodvd_H_
 
+#include <QList>
 #include <QString>
 
 #include "k3biso9660.h"
@@ -42,11 +43,34 @@ public:
     void get(const QUrl& url);
     void listDir(const QUrl& url);
 
+    void open(const QUrl& url, QIODevice::OpenMode mode);
+    void read(KIO::filesize_t size);
+    void seek(KIO::filesize_t offset);
+    void close();
+
+    void special(const QByteArray& data);
+
 private:
-    K3b::Iso9660* openIso( const QUrl&, QString& plainIsoPath );
+    /**
+     * An opened Video DVD. Sessions are kept between requests and only
+     * dropped once the medium changed or the slave was idle for a while.
+     */
+    class Session;
+
+    Session* openSession( const QUrl&, QString& plainIsoPath );
+    Session* sessionForDevice( K3b::Device::Device* dev );
+    void closeSessions();
+
     KIO::UDSEntry createUDSEntry( const K3b::Iso9660Entry* e ) const;
     void listVideoDVDs();
 
+    QList<Session*> m_sessions;
+
+    // the file opened via open()
+    Session* m_openSession;
+    const K3b::Iso9660File* m_openFile;
+    KIO::filesize_t m_openPosition;
+
     static K3b::Device::DeviceManager* s_deviceManager;
     static int s_instanceCnt;
 };
@@ -17,6 +17,7 @@
 #include "k3bcore.h"
 #include "k3bjob.h"
 #include "k3bmediacache.h"
+#include "k3bjobqueue.h"
 
 #include "k3bdevicemanager.h"
 #include "k3bexternalbinmanager.h"
@@ -97,7 +98,8 @@ public:
           deviceManager(0),
           externalBinManager(0),
           pluginManager(0),
-          globalSettings(0) {
+          globalSettings(0),
+          jobQueue(0) {
     }
 
     K3b::Version version;
@@ -106,6 +108,7 @@ public:
     K3b::ExternalBinManager* externalBinManager;
     K3b::PluginManager* pluginManager;
     K3b::GlobalSettings* globalSettings;
+    K3b::JobQueue* jobQueue;
 
     QList<K3b::Job*> runningJobs;
     QList<K3b::Device::Device*> blockedDevices;
@@ -160,6 +163,17 @@ K3b::MediaCache* K3b::Core::mediaCache() const
 }
 
 
+K3b::JobQueue* K3b::Core::jobQueue() const
+{
+    if( !d->jobQueue ) {
+        // the queue loads the saved entries but only starts scheduling
+        // once JobQueue::start() is called
+        d->jobQueue = new K3b::JobQueue( const_cast<Core*>( this ) );
+    }
+    return d->jobQueue;
+}
+
+
 K3b::Device::DeviceManager* K3b::Core::deviceManager() const
 {
     if( !d->deviceManager ) {
@@ -40,6 +40,7 @@ namespace K3b {
     class GlobalSettings;
     class PluginManager;
     class MediaCache;
+    class JobQueue;
 
     namespace Device {
         class DeviceManager;
@@ -84,6 +85,11 @@ namespace K3b {
 
         MediaCache* mediaCache() const;
 
+        /**
+         * The queue for unattended jobs. Created on first use.
+         */
+        JobQueue* jobQueue() const;
+
         Device::DeviceManager* deviceManager() const;
 
         /**
@@ -93,7 +99,7 @@ namespace K3b {
          * cdrecord, cdrdao, growisofs, mkisofs, dvd+rw-format, readcd
          *
          * If you need other programs you have to add them manually like this:
-         * <pre>externalBinManager()->addProgram( new NormalizeProgram() );</pre>
+         * <pre>externalBinManager()->addProgram( new MovixProgram() );</pre>
          */
         ExternalBinManager* externalBinManager() const;
         PluginManager* pluginManager() const;
@@ -385,18 +385,36 @@ QString K3b::TranscodeProgram::versionIdentifier( const ExternalBin& /*bin*/ ) c
 }
 
 
-bool K3b::TranscodeProgram::scanFeatures( ExternalBin& bin ) const
+QString K3b::TranscodeProgram::modInfoPath( const ExternalBin& bin ) const
+{
+    return buildProgramPath( QFileInfo( bin.path() ).absolutePath(), QLatin1String( "tcmodinfo" ) );
+}
+
+
+bool K3b::TranscodeProgram::queryModulePath( const ExternalBin& bin, QString& modPath ) const
 {
-    //
-    // Check features
-    //
-    QString modInfoBin = buildProgramPath( QFileInfo( bin.path() ).absolutePath(), QLatin1String( "tcmodinfo" ) );
     Process modp;
     modp.setOutputChannelMode( KProcess::MergedChannels );
-    modp << modInfoBin << "-p";
+    modp << modInfoPath( bin ) << "-p";
 
     if( !modp.execute() ) {
-        QString modPath = QString::fromLocal8Bit( modp.readAll() ).simplified();
+        modPath = QString::fromLocal8Bit( modp.readAll() ).simplified();
+        return true;
+    }
+    else {
+        qDebug() << "Failed to start" << modp.program();
+        return false;
+    }
+}
+
+
+bool K3b::TranscodeProgram::scanFeatures( ExternalBin& bin ) const
+{
+    //
+    // Check features
+    //
+    QString modPath;
+    if( queryModulePath( bin, modPath ) ) {
         QDir modDir( modPath );
         if( !modDir.entryList( QStringList() << "*export_xvid*", QDir::Files ).isEmpty() )
             bin.addFeature( "xvid" );
@@ -410,27 +428,34 @@ bool K3b::TranscodeProgram::scanFeatures( ExternalBin& bin ) const
         return true;
     }
     else {
-        qDebug() << "Failed to start" << modp.program();
         return false;
     }
 }
 
 
-K3b::VcdbuilderProgram::VcdbuilderProgram( const QString& p )
-    : K3b::SimpleExternalProgram( p )
+QStringList K3b::TranscodeProgram::cacheDependencies( const ExternalBin& bin ) const
 {
+    QStringList deps;
+    deps << modInfoPath( bin );
+
+    // adding or removing a module changes the mtime of the directory
+    QString modPath;
+    if( queryModulePath( bin, modPath ) && !modPath.isEmpty() )
+        deps << modPath;
+
+    return deps;
 }
 
 
-QString K3b::VcdbuilderProgram::versionIdentifier( const ExternalBin& /*bin*/ ) const
+K3b::VcdbuilderProgram::VcdbuilderProgram( const QString& p )
+    : K3b::SimpleExternalProgram( p )
 {
-    return QLatin1String( "GNU VCDImager" );
 }
 
 
-K3b::NormalizeProgram::NormalizeProgram()
-    : K3b::SimpleExternalProgram( "normalize" )
+QString K3b::VcdbuilderProgram::versionIdentifier( const ExternalBin& /*bin*/ ) const
 {
+    return QLatin1String( "GNU VCDImager" );
 }
 
 
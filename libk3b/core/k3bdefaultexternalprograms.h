@@ -106,6 +106,16 @@ namespace K3b {
     protected:
         virtual QString versionIdentifier( const ExternalBin& bin ) const;
         virtual bool scanFeatures( ExternalBin& bin ) const;
+
+        /**
+         * The features depend on the modules installed, so tcmodinfo
+         * and the module directory are part of the cache key.
+         */
+        virtual QStringList cacheDependencies( const ExternalBin& bin ) const;
+
+    private:
+        QString modInfoPath( const ExternalBin& bin ) const;
+        bool queryModulePath( const ExternalBin& bin, QString& modPath ) const;
     };
 
 
@@ -119,13 +129,6 @@ namespace K3b {
     };
 
 
-    class LIBK3B_EXPORT NormalizeProgram : public SimpleExternalProgram
-    {
-    public:
-        NormalizeProgram();
-    };
-
-
     class LIBK3B_EXPORT GrowisofsProgram : public SimpleExternalProgram
     {
     public:
@@ -16,13 +16,21 @@
 #include "k3bexternalbinmanager.h"
 #include "k3bglobals.h"
 
+#include <KConfigCore/KConfig>
 #include <KConfigCore/KConfigGroup>
 #include <KCoreAddons/KProcess>
 
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
 #include <QtGlobal>
 #include <QRegExp>
 
@@ -31,6 +39,7 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <grp.h>
+#include <errno.h>
 #endif
 
 
@@ -41,6 +50,258 @@ namespace {
     }
 
     const int EXECUTE_TIMEOUT = 5000; // in seconds
+
+    const char s_binCacheFile[] = "k3bexternalbins";
+
+    // getgrgid() is not reentrant and the programs are scanned in parallel
+    QString groupName( gid_t gid )
+    {
+        long size = ::sysconf( _SC_GETGR_R_SIZE_MAX );
+        if( size <= 0 )
+            size = 1024;
+
+        QByteArray buffer( size, 0 );
+        struct group grp;
+        struct group* result = 0;
+        int err = 0;
+        while( ( err = ::getgrgid_r( gid, &grp, buffer.data(), buffer.size(), &result ) ) == ERANGE )
+            buffer.resize( buffer.size()*2 );
+
+        if( err != 0 || !result )
+            return QString();
+        return QString::fromLocal8Bit( result->gr_name );
+    }
+
+    /**
+     * Version, copyright and features of the bins found by
+     * SimpleExternalProgram. An entry is only used as long as the
+     * file it was created from has not been touched. ctime is part
+     * of the key since a chmod or chown does not change the mtime
+     * but may change the "suidroot" feature. The same goes for the
+     * additional files the features depend on, like the module
+     * directory of transcode.
+     */
+    class BinCache
+    {
+    public:
+        struct Entry
+        {
+            Entry() : inode( 0 ), mtime( 0 ), ctime( 0 ), size( 0 ) {}
+
+            bool sameFile( const Entry& other ) const {
+                return( inode == other.inode &&
+                        mtime == other.mtime &&
+                        ctime == other.ctime &&
+                        size == other.size );
+            }
+
+            qint64 inode;
+            qint64 mtime;
+            qint64 ctime;
+            qint64 size;
+
+            // the paths of the additional files with their stamps
+            QStringList dependencies;
+            QStringList dependencyStamps;
+
+            QString needGroup;
+            QString version;
+            QString copyright;
+            QStringList features;
+        };
+
+        BinCache()
+            : hits( 0 ),
+              misses( 0 ),
+              loaded( false ),
+              dirty( false ) {
+        }
+
+        void load();
+        void save();
+        void clear();
+
+        bool restore( K3b::ExternalBin& bin );
+        void store( const K3b::ExternalBin& bin, const QStringList& dependencies );
+
+        int hits;
+        int misses;
+
+    private:
+        static bool statFile( const QString& path, Entry& entry );
+        static QString fileStamp( const QString& path );
+
+        QMutex mutex;
+        QHash<QString, Entry> entries;
+        // the paths seen during the current search, all others are dropped on save
+        QSet<QString> used;
+        bool loaded;
+        bool dirty;
+    };
+
+    Q_GLOBAL_STATIC( BinCache, s_binCache )
+
+
+    bool BinCache::statFile( const QString& path, Entry& entry )
+    {
+#ifndef Q_OS_WIN32
+        struct stat st;
+        if( ::stat( QFile::encodeName( path ), &st ) != 0 )
+            return false;
+        entry.inode = st.st_ino;
+        entry.mtime = st.st_mtime;
+        entry.ctime = st.st_ctime;
+        entry.size = st.st_size;
+        return true;
+#else
+        Q_UNUSED( path );
+        Q_UNUSED( entry );
+        return false;
+#endif
+    }
+
+
+    // an empty stamp for missing files so their appearance invalidates the entry
+    QString BinCache::fileStamp( const QString& path )
+    {
+        Entry e;
+        if( !statFile( path, e ) )
+            return QString();
+        return QString::fromLatin1( "%1:%2:%3:%4" ).arg( e.inode ).arg( e.mtime ).arg( e.ctime ).arg( e.size );
+    }
+
+
+    void BinCache::load()
+    {
+        QMutexLocker locker( &mutex );
+
+        used.clear();
+        hits = misses = 0;
+
+        if( loaded )
+            return;
+        loaded = true;
+
+        KConfig c( QLatin1String( s_binCacheFile ), KConfig::SimpleConfig, QStandardPaths::GenericCacheLocation );
+        Q_FOREACH( const QString& path, c.groupList() ) {
+            KConfigGroup grp = c.group( path );
+            Entry e;
+            e.inode = grp.readEntry( "inode", qint64( 0 ) );
+            e.mtime = grp.readEntry( "mtime", qint64( 0 ) );
+            e.ctime = grp.readEntry( "ctime", qint64( 0 ) );
+            e.size = grp.readEntry( "size", qint64( 0 ) );
+            e.dependencies = grp.readEntry( "dependencies", QStringList() );
+            e.dependencyStamps = grp.readEntry( "dependencyStamps", QStringList() );
+            e.needGroup = grp.readEntry( "needGroup", QString() );
+            e.version = grp.readEntry( "version", QString() );
+            e.copyright = grp.readEntry( "copyright", QString() );
+            e.features = grp.readEntry( "features", QStringList() );
+            if( K3b::Version( e.version ).isValid() )
+                entries.insert( path, e );
+        }
+    }
+
+
+    void BinCache::save()
+    {
+        QMutexLocker locker( &mutex );
+
+        // forget the bins which have not been found anymore
+        for( QHash<QString, Entry>::iterator it = entries.begin(); it != entries.end(); ) {
+            if( used.contains( it.key() ) ) {
+                ++it;
+            }
+            else {
+                it = entries.erase( it );
+                dirty = true;
+            }
+        }
+
+        if( !dirty )
+            return;
+        dirty = false;
+
+        KConfig c( QLatin1String( s_binCacheFile ), KConfig::SimpleConfig, QStandardPaths::GenericCacheLocation );
+        Q_FOREACH( const QString& path, c.groupList() ) {
+            c.deleteGroup( path );
+        }
+        for( QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it ) {
+            KConfigGroup grp = c.group( it.key() );
+            grp.writeEntry( "inode", it->inode );
+            grp.writeEntry( "mtime", it->mtime );
+            grp.writeEntry( "ctime", it->ctime );
+            grp.writeEntry( "size", it->size );
+            grp.writeEntry( "dependencies", it->dependencies );
+            grp.writeEntry( "dependencyStamps", it->dependencyStamps );
+            grp.writeEntry( "needGroup", it->needGroup );
+            grp.writeEntry( "version", it->version );
+            grp.writeEntry( "copyright", it->copyright );
+            grp.writeEntry( "features", it->features );
+        }
+        c.sync();
+    }
+
+
+    void BinCache::clear()
+    {
+        QMutexLocker locker( &mutex );
+        if( !entries.isEmpty() )
+            dirty = true;
+        entries.clear();
+    }
+
+
+    bool BinCache::restore( K3b::ExternalBin& bin )
+    {
+        Entry current;
+        if( !statFile( bin.path(), current ) )
+            return false;
+
+        QMutexLocker locker( &mutex );
+        used.insert( bin.path() );
+
+        QHash<QString, Entry>::const_iterator it = entries.constFind( bin.path() );
+        bool valid = ( it != entries.constEnd() && it->sameFile( current ) &&
+                       it->dependencies.count() == it->dependencyStamps.count() );
+        for( int i = 0; valid && i < it->dependencies.count(); ++i )
+            valid = ( fileStamp( it->dependencies[i] ) == it->dependencyStamps[i] );
+        if( !valid ) {
+            ++misses;
+            return false;
+        }
+
+        ++hits;
+        bin.setNeedGroup( it->needGroup );
+        bin.setVersion( it->version );
+        bin.setCopyright( it->copyright );
+        Q_FOREACH( const QString& f, it->features ) {
+            bin.addFeature( f );
+        }
+        return true;
+    }
+
+
+    void BinCache::store( const K3b::ExternalBin& bin, const QStringList& dependencies )
+    {
+        Entry e;
+        if( !statFile( bin.path(), e ) )
+            return;
+
+        e.dependencies = dependencies;
+        Q_FOREACH( const QString& path, dependencies ) {
+            e.dependencyStamps.append( fileStamp( path ) );
+        }
+
+        e.needGroup = bin.needGroup();
+        e.version = bin.version().toString();
+        e.copyright = bin.copyright();
+        e.features = bin.features();
+
+        QMutexLocker locker( &mutex );
+        entries.insert( bin.path(), e );
+        used.insert( bin.path() );
+        dirty = true;
+    }
 }
 
 
@@ -347,9 +608,14 @@ bool K3b::SimpleExternalProgram::scan( const QString& p )
     if ( QFile::exists( path ) ) {
         K3b::ExternalBin* bin = new ExternalBin( *this, path );
 
-        if ( ( !scanVersion( *bin ) || !scanFeatures( *bin ) ) && bin->needGroup().isEmpty() )  {
-            delete bin;
-            return false;
+        if( !s_binCache->restore( *bin ) ) {
+            if( scanVersion( *bin ) && scanFeatures( *bin ) ) {
+                s_binCache->store( *bin, cacheDependencies( *bin ) );
+            }
+            else if( bin->needGroup().isEmpty() ) {
+                delete bin;
+                return false;
+            }
         }
 
         addBin( bin );
@@ -374,7 +640,7 @@ bool K3b::SimpleExternalProgram::scanVersion( ExternalBin& bin ) const
             // K3b::SystemProblemDialog::checkSystem work
             struct stat st;
             if( !::stat( QFile::encodeName(bin.path()), &st ) ) {
-                QString group( getgrgid( st.st_gid )->gr_name );
+                QString group = groupName( st.st_gid );
                 qDebug() << "Should be member of \"" << group << "\"";
                 bin.setNeedGroup( group.isEmpty() ? "N/A" : group );
             } else
@@ -470,6 +736,12 @@ QString K3b::SimpleExternalProgram::versionIdentifier( const ExternalBin& /*bin*
 }
 
 
+QStringList K3b::SimpleExternalProgram::cacheDependencies( const ExternalBin& /*bin*/ ) const
+{
+    return QStringList();
+}
+
+
 // ///////////////////////////////////////////////////////////
 //
 // K3BEXTERNALBINMANAGER
@@ -492,6 +764,31 @@ public:
 QString K3b::ExternalBinManager::Private::noPath = "";
 
 
+/**
+ * Scans the search path for one program. The programs are
+ * independent of each other and are scanned concurrently.
+ */
+class K3b::ExternalBinManager::ScanThread : public QThread
+{
+public:
+    ScanThread( ExternalProgram* program, const QStringList& paths )
+        : m_program( program ),
+          m_paths( paths ) {
+    }
+
+protected:
+    void run() override {
+        Q_FOREACH( const QString& path, m_paths ) {
+            m_program->scan( path );
+        }
+    }
+
+private:
+    ExternalProgram* m_program;
+    QStringList m_paths;
+};
+
+
 K3b::ExternalBinManager::ExternalBinManager( QObject* parent )
     : QObject( parent ),
       d( new Private )
@@ -611,7 +908,7 @@ void K3b::ExternalBinManager::clear()
 }
 
 
-void K3b::ExternalBinManager::search()
+void K3b::ExternalBinManager::search( bool useCache )
 {
     if( d->searchPath.isEmpty() )
         loadDefaultSearchPath();
@@ -638,11 +935,28 @@ void K3b::ExternalBinManager::search()
             paths.append(p);
     }
 
-    Q_FOREACH( const QString& path, paths ) {
-        Q_FOREACH( K3b::ExternalProgram* program, d->programs ) {
-            program->scan( path );
-        }
+    QElapsedTimer timer;
+    timer.start();
+
+    s_binCache->load();
+    if( !useCache )
+        s_binCache->clear();
+
+    QList<ScanThread*> threads;
+    Q_FOREACH( K3b::ExternalProgram* program, d->programs ) {
+        ScanThread* thread = new ScanThread( program, paths );
+        thread->start();
+        threads.append( thread );
+    }
+    Q_FOREACH( ScanThread* thread, threads ) {
+        thread->wait();
+        delete thread;
     }
+
+    qDebug() << "(K3b::ExternalBinManager) search took" << timer.elapsed() << "ms,"
+             << s_binCache->hits << "bins from cache," << s_binCache->misses << "scanned.";
+
+    s_binCache->save();
 }
 
 
@@ -184,6 +184,14 @@ namespace K3b {
          */
         virtual QString versionIdentifier( const ExternalBin& bin ) const;
 
+        /**
+         * The files and directories besides the program itself which the
+         * features of \p bin depend on. The cached version and features are
+         * only used as long as none of them changed. Called after a successful
+         * scan. The default implementation returns an empty list.
+         */
+        virtual QStringList cacheDependencies( const ExternalBin& bin ) const;
+
     private:
         class Private;
         Private* const d;
@@ -198,7 +206,16 @@ namespace K3b {
         explicit ExternalBinManager( QObject* parent = 0 );
         ~ExternalBinManager();
 
-        void search();
+        /**
+         * Search the search path and $PATH for all programs. The programs
+         * are scanned concurrently.
+         *
+         * The version and features of the bins handled by SimpleExternalProgram
+         * are cached across sessions and only determined again if the binary
+         * changed. Set \p useCache to false to run all the programs again,
+         * for example if a program's plugins have been changed.
+         */
+        void search( bool useCache = true );
 
         /**
          * read config and add changes to current map.
@@ -233,6 +250,8 @@ namespace K3b {
     private:
         class Private;
         Private* const d;
+
+        class ScanThread;
     };
 }
 
@@ -48,6 +48,8 @@ K3b::Job::Job( K3b::JobHandler* handler, QObject* parent )
     d->canceled = false;
     d->active = false;
 
+    qRegisterMetaType<K3b::TelemetrySample>();
+
     connect( this, SIGNAL(canceled()),
              this, SLOT(slotCanceled()) );
 }
@@ -281,12 +283,17 @@ void K3b::Job::slotNewSubTask( const QString& str )
 void K3b::Job::registerSubJob( K3b::Job* job )
 {
     d->runningSubJobs.append( job );
+    connect( job, SIGNAL(telemetry(K3b::TelemetrySample)),
+             this, SIGNAL(telemetry(K3b::TelemetrySample)),
+             Qt::UniqueConnection );
 }
 
 
 void K3b::Job::unregisterSubJob( K3b::Job* job )
 {
     d->runningSubJobs.removeOne( job );
+    disconnect( job, SIGNAL(telemetry(K3b::TelemetrySample)),
+                this, SIGNAL(telemetry(K3b::TelemetrySample)) );
 }
 
 
@@ -21,6 +21,7 @@
 #include "k3bdevicetypes.h"
 #include "k3bglobals.h"
 #include "k3bjobhandler.h"
+#include "k3bjobtelemetry.h"
 
 #include <QObject>
 #include <QString>
@@ -211,6 +212,14 @@ namespace K3b {
         void debuggingOutput(const QString&, const QString&);
         void nextTrack( int track, int numTracks );
 
+        /**
+         * Structured progress information like fifo and drive buffer fill levels.
+         * Telemetry of running sub jobs is forwarded automatically.
+         *
+         * \see JobTelemetry
+         */
+        void telemetry( const K3b::TelemetrySample& sample );
+
         void canceled();
 
         /**
@@ -0,0 +1,327 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bjobtelemetry.h"
+#include "k3bjob.h"
+#include "k3bdevicehandler.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+
+namespace {
+    // the drive buffer is polled only if nobody reported it for this long
+    const qint64 s_deviceBufferTimeout = 2000;
+
+    void addJsonValue( QJsonObject& o, const char* name, qint64 value )
+    {
+        if( value >= 0 )
+            o.insert( QLatin1String( name ), double( value ) );
+    }
+
+    QByteArray csvValue( qint64 value )
+    {
+        return value >= 0 ? QByteArray::number( value ) : QByteArray();
+    }
+}
+
+
+K3b::TelemetrySample::TelemetrySample()
+    : timestamp( -1 ),
+      bytesWritten( -1 ),
+      fifoFill( -1 ),
+      deviceBufferFill( -1 ),
+      writeSpeed( -1 ),
+      burnfreeEvents( -1 ),
+      inputStallTime( -1 ),
+      device( 0 )
+{
+}
+
+
+void K3b::TelemetrySample::merge( const TelemetrySample& other )
+{
+    if( other.timestamp >= 0 )
+        timestamp = other.timestamp;
+    if( other.bytesWritten >= 0 )
+        bytesWritten = other.bytesWritten;
+    if( other.fifoFill >= 0 )
+        fifoFill = other.fifoFill;
+    if( other.deviceBufferFill >= 0 )
+        deviceBufferFill = other.deviceBufferFill;
+    if( other.writeSpeed >= 0 )
+        writeSpeed = other.writeSpeed;
+    if( other.burnfreeEvents >= 0 )
+        burnfreeEvents = other.burnfreeEvents;
+    if( other.inputStallTime >= 0 )
+        inputStallTime = other.inputStallTime;
+    if( other.device )
+        device = other.device;
+}
+
+
+
+class K3b::JobTelemetry::Private
+{
+public:
+    Private()
+        : job( 0 ),
+          pollDevice( 0 ),
+          pollHandler( 0 ),
+          lastDeviceBufferReport( -1 ),
+          hasData( false ) {
+    }
+
+    Job* job;
+    // the device announced by the writer, its buffer is polled if it does not report it
+    Device::Device* pollDevice;
+
+    // the running buffer capacity query
+    Device::DeviceHandler* pollHandler;
+
+    QElapsedTimer clock;
+    QTimer timer;
+
+    // the merged state of all samples received so far
+    TelemetrySample current;
+    QList<TelemetrySample> timeline;
+
+    qint64 lastDeviceBufferReport;
+    bool hasData;
+};
+
+
+K3b::JobTelemetry::JobTelemetry( QObject* parent )
+    : QObject( parent ),
+      d( new Private() )
+{
+    d->timer.setInterval( 1000 );
+    connect( &d->timer, SIGNAL(timeout()), this, SLOT(slotTick()) );
+}
+
+
+K3b::JobTelemetry::~JobTelemetry()
+{
+    delete d;
+}
+
+
+void K3b::JobTelemetry::setJob( Job* job )
+{
+    if( d->job )
+        disconnect( d->job, 0, this, 0 );
+
+    d->job = job;
+    clear();
+
+    if( job ) {
+        connect( job, SIGNAL(telemetry(K3b::TelemetrySample)),
+                 this, SLOT(addSample(K3b::TelemetrySample)) );
+        connect( job, SIGNAL(started()), this, SLOT(slotStarted()) );
+        connect( job, SIGNAL(finished(bool)), this, SLOT(slotFinished()) );
+        if( job->active() )
+            slotStarted();
+    }
+}
+
+
+bool K3b::JobTelemetry::hasData() const
+{
+    return d->hasData;
+}
+
+
+QList<K3b::TelemetrySample> K3b::JobTelemetry::samples() const
+{
+    return d->timeline;
+}
+
+
+int K3b::JobTelemetry::minimumFifoFill() const
+{
+    int m = -1;
+    Q_FOREACH( const TelemetrySample& s, d->timeline ) {
+        if( s.fifoFill >= 0 && ( m < 0 || s.fifoFill < m ) )
+            m = s.fifoFill;
+    }
+    return m;
+}
+
+
+int K3b::JobTelemetry::minimumDeviceBufferFill() const
+{
+    int m = -1;
+    Q_FOREACH( const TelemetrySample& s, d->timeline ) {
+        if( s.deviceBufferFill >= 0 && ( m < 0 || s.deviceBufferFill < m ) )
+            m = s.deviceBufferFill;
+    }
+    return m;
+}
+
+
+void K3b::JobTelemetry::clear()
+{
+    d->timer.stop();
+    d->timeline.clear();
+    d->current = TelemetrySample();
+    d->lastDeviceBufferReport = -1;
+    d->hasData = false;
+    d->clock.invalidate();
+
+    // a query of the previous run must not end up in this one
+    if( d->pollHandler )
+        disconnect( d->pollHandler, 0, this, 0 );
+    d->pollHandler = 0;
+    d->pollDevice = 0;
+}
+
+
+void K3b::JobTelemetry::addSample( const K3b::TelemetrySample& sample )
+{
+    if( !d->clock.isValid() )
+        d->clock.start();
+
+    const qint64 now = d->clock.elapsed();
+
+    if( sample.deviceBufferFill >= 0 )
+        d->lastDeviceBufferReport = now;
+    if( sample.device )
+        d->pollDevice = sample.device;
+
+    d->current.merge( sample );
+    d->current.timestamp = now;
+    d->hasData = true;
+}
+
+
+void K3b::JobTelemetry::slotStarted()
+{
+    clear();
+    d->clock.start();
+    d->timer.start();
+}
+
+
+void K3b::JobTelemetry::slotFinished()
+{
+    // record the final state
+    slotTick();
+    d->timer.stop();
+}
+
+
+void K3b::JobTelemetry::slotTick()
+{
+    if( !d->clock.isValid() )
+        return;
+
+    const qint64 now = d->clock.elapsed();
+
+    TelemetrySample s( d->current );
+    s.timestamp = now;
+    d->timeline.append( s );
+
+    if( d->pollDevice &&
+        !d->pollHandler &&
+        ( d->lastDeviceBufferReport < 0 || now - d->lastDeviceBufferReport > s_deviceBufferTimeout ) ) {
+        d->pollHandler = Device::sendCommand( Device::DeviceHandler::CommandBufferCapacity, d->pollDevice );
+        connect( d->pollHandler,
+                 SIGNAL(finished(K3b::Device::DeviceHandler*)),
+                 this,
+                 SLOT(slotBufferCapacityDone(K3b::Device::DeviceHandler*)) );
+    }
+}
+
+
+void K3b::JobTelemetry::slotBufferCapacityDone( K3b::Device::DeviceHandler* dh )
+{
+    d->pollHandler = 0;
+
+    if( dh->success() && dh->bufferCapacity() > 0 ) {
+        // do not touch lastDeviceBufferReport, we want to keep polling
+        d->current.deviceBufferFill = 100 * ( dh->bufferCapacity() - dh->availableBufferCapacity() ) / dh->bufferCapacity();
+    }
+    else {
+        qDebug() << "(K3b::JobTelemetry) unable to read drive buffer capacity. Stopping polling.";
+        d->pollDevice = 0;
+    }
+}
+
+
+QByteArray K3b::JobTelemetry::toCsv() const
+{
+    QByteArray csv( "time_ms,bytes_written,fifo_percent,device_buffer_percent,speed_kbs,burnfree_events,input_stall_ms\n" );
+    Q_FOREACH( const TelemetrySample& s, d->timeline ) {
+        csv += csvValue( s.timestamp ) + ','
+               + csvValue( s.bytesWritten ) + ','
+               + csvValue( s.fifoFill ) + ','
+               + csvValue( s.deviceBufferFill ) + ','
+               + csvValue( s.writeSpeed ) + ','
+               + csvValue( s.burnfreeEvents ) + ','
+               + csvValue( s.inputStallTime ) + '\n';
+    }
+    return csv;
+}
+
+
+QByteArray K3b::JobTelemetry::toJson() const
+{
+    QJsonArray samples;
+    Q_FOREACH( const TelemetrySample& s, d->timeline ) {
+        QJsonObject o;
+        addJsonValue( o, "time", s.timestamp );
+        addJsonValue( o, "bytesWritten", s.bytesWritten );
+        addJsonValue( o, "fifo", s.fifoFill );
+        addJsonValue( o, "deviceBuffer", s.deviceBufferFill );
+        addJsonValue( o, "speed", s.writeSpeed );
+        addJsonValue( o, "burnfreeEvents", s.burnfreeEvents );
+        addJsonValue( o, "inputStall", s.inputStallTime );
+        samples.append( o );
+    }
+
+    QJsonObject summary;
+    addJsonValue( summary, "minimumFifo", minimumFifoFill() );
+    addJsonValue( summary, "minimumDeviceBuffer", minimumDeviceBufferFill() );
+    if( !d->timeline.isEmpty() ) {
+        const TelemetrySample& last = d->timeline.last();
+        addJsonValue( summary, "duration", last.timestamp );
+        addJsonValue( summary, "bytesWritten", last.bytesWritten );
+        addJsonValue( summary, "burnfreeEvents", last.burnfreeEvents );
+        addJsonValue( summary, "inputStall", last.inputStallTime );
+    }
+
+    QJsonObject root;
+    if( d->job )
+        root.insert( QLatin1String( "job" ), d->job->jobDescription() );
+    root.insert( QLatin1String( "summary" ), summary );
+    root.insert( QLatin1String( "samples" ), samples );
+
+    return QJsonDocument( root ).toJson();
+}
+
+
+bool K3b::JobTelemetry::save( const QString& filename ) const
+{
+    QFile f( filename );
+    if( !f.open( QIODevice::WriteOnly|QIODevice::Truncate ) ) {
+        qDebug() << "(K3b::JobTelemetry) could not open" << filename;
+        return false;
+    }
+
+    const QByteArray data = filename.endsWith( QLatin1String( ".json" ), Qt::CaseInsensitive ) ? toJson() : toCsv();
+    return f.write( data ) == data.size();
+}
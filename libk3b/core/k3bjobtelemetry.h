@@ -0,0 +1,168 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_JOB_TELEMETRY_H_
+#define _K3B_JOB_TELEMETRY_H_
+
+#include "k3b_export.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+
+namespace K3b {
+    namespace Device {
+        class Device;
+        class DeviceHandler;
+    }
+
+    class Job;
+
+    /**
+     * One structured measurement reported by a job through the
+     * Job::telemetry() signal.
+     *
+     * Every field is optional. Fields a job does not know about are
+     * left at -1 and are carried forward from earlier samples by
+     * JobTelemetry.
+     */
+    class LIBK3B_EXPORT TelemetrySample
+    {
+    public:
+        TelemetrySample();
+
+        /**
+         * Milliseconds since the start of the recorded run. Set by
+         * JobTelemetry, jobs do not need to fill it in.
+         */
+        qint64 timestamp;
+
+        /**
+         * Overall number of bytes written to the medium so far.
+         */
+        qint64 bytesWritten;
+
+        /**
+         * Software fifo fill level in percent (cdrecord fifo, cdrdao buffer,
+         * growisofs ring buffer).
+         */
+        int fifoFill;
+
+        /**
+         * Drive buffer fill level in percent.
+         */
+        int deviceBufferFill;
+
+        /**
+         * Current writing speed in KB/s.
+         */
+        int writeSpeed;
+
+        /**
+         * Number of times the drive engaged its buffer underrun protection.
+         */
+        int burnfreeEvents;
+
+        /**
+         * Accumulated time in milliseconds the writer had to wait for input data,
+         * i.e. its fifo was empty.
+         */
+        qint64 inputStallTime;
+
+        /**
+         * The device being written to. Announced by the writers when they
+         * start so JobTelemetry can poll its buffer. 0 if not set.
+         */
+        Device::Device* device;
+
+        /**
+         * Merge all valid fields of @p other into this sample.
+         */
+        void merge( const TelemetrySample& other );
+    };
+
+
+    /**
+     * Records the telemetry of a job into a timeline with one sample
+     * per second which can be exported as CSV or JSON.
+     *
+     * Telemetry emitted by sub jobs is forwarded to the parent job
+     * automatically, thus it is enough to record the toplevel job.
+     *
+     * If the writer does not report the drive buffer fill level itself
+     * JobTelemetry queries it via Device::readBufferCapacity() on the
+     * device the writer announced.
+     */
+    class LIBK3B_EXPORT JobTelemetry : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit JobTelemetry( QObject* parent = 0 );
+        ~JobTelemetry();
+
+        /**
+         * Start recording @p job. Recording starts with the job's started()
+         * signal and stops with its finished() signal.
+         */
+        void setJob( Job* job );
+
+        /**
+         * \return true if the job reported any telemetry since recording started.
+         */
+        bool hasData() const;
+
+        /**
+         * The recorded timeline, one sample per second.
+         */
+        QList<TelemetrySample> samples() const;
+
+        /**
+         * Lowest recorded fifo fill level or -1 if none was reported.
+         */
+        int minimumFifoFill() const;
+
+        /**
+         * Lowest recorded drive buffer fill level or -1 if none was reported.
+         */
+        int minimumDeviceBufferFill() const;
+
+        QByteArray toCsv() const;
+        QByteArray toJson() const;
+
+        /**
+         * Save the timeline to @p filename. The format is chosen based
+         * on the suffix: JSON for ".json", CSV otherwise.
+         */
+        bool save( const QString& filename ) const;
+
+    public Q_SLOTS:
+        void clear();
+        void addSample( const K3b::TelemetrySample& sample );
+
+    private Q_SLOTS:
+        void slotStarted();
+        void slotFinished();
+        void slotTick();
+        void slotBufferCapacityDone( K3b::Device::DeviceHandler* );
+
+    private:
+        class Private;
+        Private* const d;
+    };
+}
+
+Q_DECLARE_METATYPE( K3b::TelemetrySample )
+
+#endif
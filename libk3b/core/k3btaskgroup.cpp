@@ -0,0 +1,145 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3btaskgroup.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
+
+class K3b::TaskGroup::Private
+{
+public:
+    Private()
+        : pool( 0 ),
+          running( 0 ) {
+    }
+
+    WorkerPool* pool;
+
+    QMutex mutex;
+    QWaitCondition taskDone;
+
+    // submitted and not finished yet
+    QList<Task*> tasks;
+
+    // tasks which ran and wait for takeFinished()
+    QList<Task*> finishedTasks;
+    int running;
+};
+
+
+K3b::TaskGroup::Task::Task()
+    : m_group( 0 )
+{
+}
+
+
+K3b::TaskGroup::Task::~Task()
+{
+}
+
+
+bool K3b::TaskGroup::Task::isCanceled() const
+{
+    return m_canceled.load();
+}
+
+
+void K3b::TaskGroup::Task::run()
+{
+    runTask();
+    m_group->finished( this );
+}
+
+
+K3b::TaskGroup::TaskGroup( WorkerPool* pool, QObject* parent )
+    : QObject( parent ),
+      d( new Private() )
+{
+    d->pool = pool ? pool : WorkerPool::instance();
+}
+
+
+K3b::TaskGroup::~TaskGroup()
+{
+    QMutexLocker locker( &d->mutex );
+    Q_FOREACH( Task* task, d->tasks ) {
+        if( d->pool->cancel( task ) ) {
+            --d->running;
+            delete task;
+        }
+        else {
+            task->m_canceled.store( 1 );
+        }
+    }
+    while( d->running > 0 )
+        d->taskDone.wait( &d->mutex );
+
+    qDeleteAll( d->finishedTasks );
+    locker.unlock();
+
+    delete d;
+}
+
+
+void K3b::TaskGroup::submit( Task* task, WorkerPool::Priority priority )
+{
+    task->m_group = this;
+
+    d->mutex.lock();
+    d->tasks.append( task );
+    ++d->running;
+    d->mutex.unlock();
+
+    d->pool->submit( task, priority );
+}
+
+
+bool K3b::TaskGroup::cancel( Task* task )
+{
+    QMutexLocker locker( &d->mutex );
+    if( !d->tasks.contains( task ) )
+        return false;
+
+    if( d->pool->cancel( task ) ) {
+        d->tasks.removeOne( task );
+        --d->running;
+        delete task;
+        return true;
+    }
+    else {
+        task->m_canceled.store( 1 );
+        return false;
+    }
+}
+
+
+QList<K3b::TaskGroup::Task*> K3b::TaskGroup::takeFinished()
+{
+    QMutexLocker locker( &d->mutex );
+    QList<Task*> finished = d->finishedTasks;
+    d->finishedTasks.clear();
+    return finished;
+}
+
+
+void K3b::TaskGroup::finished( Task* task )
+{
+    QMutexLocker locker( &d->mutex );
+    d->tasks.removeOne( task );
+    d->finishedTasks.append( task );
+    --d->running;
+    d->taskDone.wakeAll();
+    QMetaObject::invokeMethod( this, "taskFinished", Qt::QueuedConnection );
+}
@@ -0,0 +1,105 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_TASK_GROUP_H_
+#define _K3B_TASK_GROUP_H_
+
+#include "k3b_export.h"
+#include "k3bworkerpool.h"
+
+#include <QAtomicInt>
+#include <QList>
+#include <QObject>
+
+
+namespace K3b {
+    /**
+     * Runs tasks on the WorkerPool and hands them back to the thread
+     * the group lives in once they are done.
+     *
+     * For every finished task taskFinished() is emitted via a queued
+     * connection. The receiver collects the tasks with takeFinished()
+     * and deletes them.
+     *
+     * Destroying the group cancels the tasks which have not been handed
+     * back yet and waits for the running ones.
+     */
+    class LIBK3B_EXPORT TaskGroup : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        class LIBK3B_EXPORT Task : public WorkerPool::Task
+        {
+        public:
+            Task();
+            ~Task();
+
+            /**
+             * Set by TaskGroup::cancel(). Long running tasks should poll it.
+             */
+            bool isCanceled() const;
+
+        protected:
+            /**
+             * Does the actual work in the worker thread.
+             */
+            virtual void runTask() = 0;
+
+        private:
+            void run();
+
+            TaskGroup* m_group;
+            QAtomicInt m_canceled;
+
+            friend class TaskGroup;
+        };
+
+        /**
+         * \param pool The pool to run the tasks in. 0 means WorkerPool::instance().
+         */
+        explicit TaskGroup( WorkerPool* pool = 0, QObject* parent = 0 );
+        ~TaskGroup();
+
+        /**
+         * The group takes ownership of \p task until it is returned by takeFinished().
+         */
+        void submit( Task* task, WorkerPool::Priority priority = WorkerPool::Interactive );
+
+        /**
+         * Deletes \p task if it has not been started yet. Otherwise the task is
+         * flagged as canceled and handed back once it returns.
+         *
+         * \return true if the task has been deleted.
+         */
+        bool cancel( Task* task );
+
+        /**
+         * The tasks which have finished since the last call. The caller takes
+         * ownership of them.
+         */
+        QList<Task*> takeFinished();
+
+    Q_SIGNALS:
+        void taskFinished();
+
+    private:
+        void finished( Task* task );
+
+        class Private;
+        Private* const d;
+
+        Q_DISABLE_COPY( TaskGroup )
+    };
+}
+
+#endif
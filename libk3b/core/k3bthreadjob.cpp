@@ -13,42 +13,85 @@
  */
 
 #include "k3bthreadjob.h"
-#include "k3bthread.h"
 #include "k3bprogressinfoevent.h"
 #include "k3bthreadjobcommunicationevent.h"
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSharedPointer>
-#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
 
 
 class K3b::ThreadJob::Private
 {
 public:
-    Private()
-        : thread( 0 ),
+    class Task : public WorkerPool::Task
+    {
+    public:
+        Task( ThreadJob* job )
+            : m_job( job ) {
+        }
+
+        void run() {
+            // default to false in case we need to terminate
+            m_job->d->success = false;
+            m_job->d->success = m_job->run();
+            done();
+        }
+
+        void terminated() {
+            m_job->d->success = false;
+            done();
+        }
+
+    private:
+        void done() {
+            // the job may be deleted as soon as the waiters have been woken up
+            QMetaObject::invokeMethod( m_job, "slotThreadFinished", Qt::QueuedConnection );
+            QMutexLocker locker( &m_job->d->mutex );
+            m_job->d->taskDone = true;
+            m_job->d->doneCondition.wakeAll();
+        }
+
+        ThreadJob* m_job;
+    };
+
+    Private( ThreadJob* job )
+        : task( job ),
+          priority( WorkerPool::Interactive ),
           running( false ),
-          canceled( false ) {
+          canceled( false ),
+          success( false ),
+          taskDone( true ) {
     }
-    K3b::Thread* thread;
+
+    Task task;
+    WorkerPool::Priority priority;
     bool running;
     bool canceled;
+    bool success;
+
+    bool taskDone;
+    QMutex mutex;
+    QWaitCondition doneCondition;
 };
 
 
 K3b::ThreadJob::ThreadJob( K3b::JobHandler* jh, QObject* parent )
     : K3b::Job( jh, parent ),
-      d( new Private )
+      d( new Private( this ) )
 {
-    d->thread = new K3b::Thread( this );
-    connect( d->thread, SIGNAL(finished()),
-             this, SLOT(slotThreadFinished()) );
 }
 
 
 K3b::ThreadJob::~ThreadJob()
 {
+    // run() must not access a deleted job
+    if( !wait( 0 ) && !WorkerPool::instance()->cancel( &d->task ) )
+        wait();
     delete d;
 }
 
@@ -59,13 +102,26 @@ bool K3b::ThreadJob::active() const
 }
 
 
+void K3b::ThreadJob::setPriority( WorkerPool::Priority priority )
+{
+    d->priority = priority;
+}
+
+
+K3b::WorkerPool::Priority K3b::ThreadJob::priority() const
+{
+    return d->priority;
+}
+
+
 void K3b::ThreadJob::start()
 {
     if( !d->running ) {
         d->canceled = false;
         d->running = true;
+        d->taskDone = false;
         jobStarted();
-        d->thread->start();
+        WorkerPool::instance()->submit( &d->task, d->priority );
     }
     else {
         qDebug() << "(K3b::ThreadJob) thread not finished yet.";
@@ -78,14 +134,31 @@ void K3b::ThreadJob::slotThreadFinished()
     d->running = false;
     if( canceled() )
         emit canceled();
-    jobFinished( d->thread->success() );
+    jobFinished( d->success );
 }
 
 
 void K3b::ThreadJob::cancel()
 {
     d->canceled = true;
-    d->thread->ensureDone();
+
+    // a job which did not start yet does not need to be stopped
+    if( WorkerPool::instance()->cancel( &d->task ) ) {
+        d->success = false;
+        d->taskDone = true;
+        QMetaObject::invokeMethod( this, "slotThreadFinished", Qt::QueuedConnection );
+    }
+    else {
+        // we wait for 5 seconds before we terminate the thread
+        QTimer::singleShot( 5000, this, SLOT(slotEnsureDoneTimeout()) );
+    }
+}
+
+
+void K3b::ThreadJob::slotEnsureDoneTimeout()
+{
+    if( !wait( 0 ) )
+        WorkerPool::instance()->terminate( &d->task );
 }
 
 
@@ -108,6 +181,7 @@ K3b::Device::MediaType K3b::ThreadJob::waitForMedium( K3b::Device::Device* devic
                                                                                                message );
     QSharedPointer<K3b::ThreadJobCommunicationEvent::Data> data( event->data() );
     QCoreApplication::postEvent( this, event );
+    WorkerPool::BlockingSection blocking;
     data->wait();
     return (Device::MediaType)data->intResult();
 }
@@ -124,6 +198,7 @@ bool K3b::ThreadJob::questionYesNo( const QString& text,
                                                                                                buttonNo );
     QSharedPointer<K3b::ThreadJobCommunicationEvent::Data> data( event->data() );
     QCoreApplication::postEvent( this, event );
+    WorkerPool::BlockingSection blocking;
     data->wait();
     return data->boolResult();
 }
@@ -136,6 +211,7 @@ void K3b::ThreadJob::blockingInformation( const QString& text,
                                                                                                      caption );
     QSharedPointer<K3b::ThreadJobCommunicationEvent::Data> data( event->data() );
     QCoreApplication::postEvent( this, event );
+    WorkerPool::BlockingSection blocking;
     data->wait();
 }
 
@@ -173,7 +249,12 @@ void K3b::ThreadJob::customEvent( QEvent* e )
 
 bool K3b::ThreadJob::wait( unsigned long time )
 {
-    return d->thread->wait( time );
+    QMutexLocker locker( &d->mutex );
+    while( !d->taskDone ) {
+        if( !d->doneCondition.wait( &d->mutex, time ) )
+            return false;
+    }
+    return true;
 }
 
 
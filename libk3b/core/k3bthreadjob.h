@@ -17,18 +17,19 @@
 #define _K3B_THREAD_JOB_H_
 
 #include "k3bjob.h"
+#include "k3bworkerpool.h"
 #include "k3b_export.h"
 #include <climits>
 
 
 namespace K3b {
 
-    class Thread;
-
     /**
      * A Job that runs in a different thread. Instead of reimplementing
      * start() reimplement run() to perform all operations in a different
      * thread. Otherwise usage is the same as Job.
+     *
+     * The jobs run in the threads of WorkerPool::instance().
      */
     class LIBK3B_EXPORT ThreadJob : public Job
     {
@@ -71,11 +72,22 @@ namespace K3b {
 
 
         /**
-         * Call QThread::wait() on job's thread
+         * Waits until run() returned.
+         *
+         * \return false if the job did not finish within \p time milliseconds.
          * \see QThread::wait()
          */
         bool wait( unsigned long time = ULONG_MAX );
 
+        /**
+         * The priority class of the job in the WorkerPool. Jobs which
+         * feed a burning process use WorkerPool::Realtime, jobs which
+         * run alongside the user's work WorkerPool::Background.
+         * Defaults to WorkerPool::Interactive.
+         */
+        void setPriority( WorkerPool::Priority priority );
+        WorkerPool::Priority priority() const;
+
     public Q_SLOTS:
         /**
          * Starts the job in a different thread. Emits the started()
@@ -120,14 +132,13 @@ namespace K3b {
          * housekeeping.
          */
         void slotThreadFinished();
+        void slotEnsureDoneTimeout();
 
     private:
         void customEvent( QEvent* );
 
         class Private;
         Private* const d;
-
-        friend class Thread;
     };
 }
 
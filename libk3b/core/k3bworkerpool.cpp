@@ -0,0 +1,480 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bworkerpool.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+
+namespace {
+    const int s_numPriorities = 3;
+
+    struct Item
+    {
+        K3b::WorkerPool::Task* task;
+        qint64 queuedAt;
+    };
+
+    Q_GLOBAL_STATIC( K3b::WorkerPool, s_instance )
+}
+
+
+class K3b::WorkerPool::Private
+{
+public:
+    Private()
+        : maxWorkers( 4 ),
+          expiryTimeout( 30000 ),
+          idleWorkers( 0 ),
+          busyWorkers( 0 ),
+          blockedWorkers( 0 ),
+          stopping( false ),
+          completed( 0 ),
+          stolen( 0 ),
+          saturated( 0 ) {
+        for( int i = 0; i < s_numPriorities; ++i ) {
+            latencySum[i] = 0;
+            latencyCount[i] = 0;
+            maxLatency[i] = 0;
+        }
+        clock.start();
+    }
+
+    /**
+     * Needs to be called with the mutex locked.
+     * \return true if a task was found.
+     */
+    bool takeTask( Worker* worker, Item& item, int& priority );
+
+    bool hasWork() const;
+
+    /**
+     * Start another worker if there is work and room for one.
+     * Needs to be called with the mutex locked.
+     */
+    void startWorkerIfNeeded( WorkerPool* pool, bool ignoreBound = false );
+
+    /**
+     * Deletes the workers which exited. Must be called without the mutex locked.
+     */
+    void reapWorkers();
+
+    int maxWorkers;
+    int expiryTimeout;
+
+    QList<Item> queues[s_numPriorities];
+    QList<Worker*> workers;
+    QList<Worker*> exitedWorkers;
+    int idleWorkers;
+    int busyWorkers;
+    int blockedWorkers;
+    bool stopping;
+
+    quint64 completed;
+    quint64 stolen;
+    quint64 saturated;
+    qint64 latencySum[s_numPriorities];
+    quint64 latencyCount[s_numPriorities];
+    qint64 maxLatency[s_numPriorities];
+    QElapsedTimer clock;
+
+    mutable QMutex mutex;
+    QWaitCondition workCondition;
+    QWaitCondition doneCondition;
+};
+
+
+class K3b::WorkerPool::Worker : public QThread
+{
+public:
+    explicit Worker( WorkerPool* pool )
+        : current( 0 ),
+          blocked( 0 ),
+          killed( false ),
+          m_pool( pool ) {
+    }
+
+    WorkerPool* pool() const { return m_pool; }
+
+    // tasks submitted from this worker
+    QList<Item> local[s_numPriorities];
+
+    Task* current;
+    int blocked;
+    bool killed;
+
+protected:
+    void run();
+
+private:
+    WorkerPool* m_pool;
+};
+
+
+void K3b::WorkerPool::Worker::run()
+{
+    Private* d = m_pool->d;
+
+    // never terminate while holding the pool lock
+    setTerminationEnabled( false );
+    QMutexLocker locker( &d->mutex );
+
+    while( !killed ) {
+        Item item;
+        int priority = 0;
+        if( d->takeTask( this, item, priority ) ) {
+            const qint64 latency = d->clock.elapsed() - item.queuedAt;
+            d->latencySum[priority] += latency;
+            ++d->latencyCount[priority];
+            d->maxLatency[priority] = qMax( d->maxLatency[priority], latency );
+
+            current = item.task;
+            ++d->busyWorkers;
+
+            locker.unlock();
+            setTerminationEnabled( true );
+
+            item.task->run();
+
+            setTerminationEnabled( false );
+            locker.relock();
+
+            current = 0;
+            --d->busyWorkers;
+            ++d->completed;
+            d->doneCondition.wakeAll();
+            continue;
+        }
+
+        if( d->stopping )
+            break;
+
+        ++d->idleWorkers;
+        const bool woken = d->workCondition.wait( &d->mutex, d->expiryTimeout );
+        --d->idleWorkers;
+
+        if( !woken && !d->hasWork() && local[0].isEmpty() && local[1].isEmpty() && local[2].isEmpty() )
+            break;
+    }
+
+    // hand over what has been submitted to us
+    if( d->workers.removeAll( this ) ) {
+        for( int i = 0; i < s_numPriorities; ++i )
+            d->queues[i] += local[i];
+        d->exitedWorkers.append( this );
+    }
+    if( d->hasWork() )
+        d->workCondition.wakeOne();
+    d->doneCondition.wakeAll();
+}
+
+
+bool K3b::WorkerPool::Private::takeTask( Worker* worker, Item& item, int& priority )
+{
+    for( priority = 0; priority < s_numPriorities; ++priority ) {
+        // own tasks first, the newest one is most likely still in the cache
+        if( !worker->local[priority].isEmpty() ) {
+            item = worker->local[priority].takeLast();
+            return true;
+        }
+
+        if( !queues[priority].isEmpty() ) {
+            item = queues[priority].takeFirst();
+            return true;
+        }
+
+        // steal the oldest task of another worker
+        Q_FOREACH( Worker* other, workers ) {
+            if( other != worker && !other->local[priority].isEmpty() ) {
+                item = other->local[priority].takeFirst();
+                ++stolen;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+bool K3b::WorkerPool::Private::hasWork() const
+{
+    for( int i = 0; i < s_numPriorities; ++i ) {
+        if( !queues[i].isEmpty() )
+            return true;
+        Q_FOREACH( Worker* worker, workers )
+            if( !worker->local[i].isEmpty() )
+                return true;
+    }
+    return false;
+}
+
+
+void K3b::WorkerPool::Private::startWorkerIfNeeded( WorkerPool* pool, bool ignoreBound )
+{
+    if( idleWorkers > 0 ) {
+        workCondition.wakeOne();
+        return;
+    }
+
+    ++saturated;
+
+    // blocked workers do not count against the bound
+    if( ignoreBound || workers.count() - blockedWorkers < maxWorkers ) {
+        Worker* worker = new Worker( pool );
+        workers.append( worker );
+        worker->start();
+    }
+}
+
+
+void K3b::WorkerPool::Private::reapWorkers()
+{
+    mutex.lock();
+    QList<Worker*> exited = exitedWorkers;
+    exitedWorkers.clear();
+    mutex.unlock();
+
+    Q_FOREACH( Worker* worker, exited ) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+
+
+K3b::WorkerPool::Task::~Task()
+{
+}
+
+
+void K3b::WorkerPool::Task::terminated()
+{
+}
+
+
+
+K3b::WorkerPool::BlockingSection::BlockingSection()
+{
+    if( Worker* worker = dynamic_cast<Worker*>( QThread::currentThread() ) ) {
+        Private* d = worker->pool()->d;
+        QMutexLocker locker( &d->mutex );
+        ++worker->blocked;
+        ++d->blockedWorkers;
+        if( d->hasWork() )
+            d->startWorkerIfNeeded( worker->pool() );
+    }
+}
+
+
+K3b::WorkerPool::BlockingSection::~BlockingSection()
+{
+    if( Worker* worker = dynamic_cast<Worker*>( QThread::currentThread() ) ) {
+        Private* d = worker->pool()->d;
+        QMutexLocker locker( &d->mutex );
+        --worker->blocked;
+        --d->blockedWorkers;
+    }
+}
+
+
+
+K3b::WorkerPool::WorkerPool( int maxWorkers )
+    : d( new Private() )
+{
+    if( maxWorkers <= 0 )
+        maxWorkers = qMax( 4, 2*QThread::idealThreadCount() );
+    d->maxWorkers = maxWorkers;
+}
+
+
+K3b::WorkerPool::~WorkerPool()
+{
+    waitForDone();
+    delete d;
+}
+
+
+K3b::WorkerPool* K3b::WorkerPool::instance()
+{
+    return s_instance;
+}
+
+
+void K3b::WorkerPool::setMaxWorkers( int max )
+{
+    QMutexLocker locker( &d->mutex );
+    d->maxWorkers = qMax( 1, max );
+}
+
+
+int K3b::WorkerPool::maxWorkers() const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->maxWorkers;
+}
+
+
+void K3b::WorkerPool::setExpiryTimeout( int msecs )
+{
+    QMutexLocker locker( &d->mutex );
+    d->expiryTimeout = msecs;
+}
+
+
+int K3b::WorkerPool::expiryTimeout() const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->expiryTimeout;
+}
+
+
+void K3b::WorkerPool::submit( Task* task, Priority priority )
+{
+    d->reapWorkers();
+
+    QMutexLocker locker( &d->mutex );
+
+    Item item;
+    item.task = task;
+    item.queuedAt = d->clock.elapsed();
+
+    Worker* worker = dynamic_cast<Worker*>( QThread::currentThread() );
+    if( worker && worker->pool() == this && !worker->killed )
+        worker->local[priority].append( item );
+    else
+        d->queues[priority].append( item );
+
+    d->startWorkerIfNeeded( this, priority == Realtime );
+}
+
+
+bool K3b::WorkerPool::cancel( Task* task )
+{
+    QMutexLocker locker( &d->mutex );
+    for( int i = 0; i < s_numPriorities; ++i ) {
+        for( int j = 0; j < d->queues[i].count(); ++j ) {
+            if( d->queues[i][j].task == task ) {
+                d->queues[i].removeAt( j );
+                return true;
+            }
+        }
+        Q_FOREACH( Worker* worker, d->workers ) {
+            for( int j = 0; j < worker->local[i].count(); ++j ) {
+                if( worker->local[i][j].task == task ) {
+                    worker->local[i].removeAt( j );
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+
+bool K3b::WorkerPool::terminate( Task* task )
+{
+    d->mutex.lock();
+
+    Worker* worker = 0;
+    Q_FOREACH( Worker* w, d->workers ) {
+        if( w->current == task ) {
+            worker = w;
+            break;
+        }
+    }
+
+    if( !worker ) {
+        d->mutex.unlock();
+        return false;
+    }
+
+    qDebug() << "(K3b::WorkerPool) terminating worker" << worker;
+
+    // the worker exits instead of picking up another task in case it
+    // finishes the task before being terminated
+    worker->killed = true;
+    d->workers.removeAll( worker );
+    for( int i = 0; i < s_numPriorities; ++i ) {
+        d->queues[i] += worker->local[i];
+        worker->local[i].clear();
+    }
+    d->mutex.unlock();
+
+    worker->terminate();
+    worker->wait();
+
+    d->mutex.lock();
+    const bool wasRunning = ( worker->current == task );
+    if( wasRunning ) {
+        --d->busyWorkers;
+        d->blockedWorkers -= worker->blocked;
+    }
+    if( d->hasWork() )
+        d->startWorkerIfNeeded( this );
+    d->doneCondition.wakeAll();
+    d->mutex.unlock();
+
+    delete worker;
+
+    if( wasRunning )
+        task->terminated();
+
+    return wasRunning;
+}
+
+
+void K3b::WorkerPool::waitForDone()
+{
+    d->mutex.lock();
+    d->stopping = true;
+    d->workCondition.wakeAll();
+    while( !d->workers.isEmpty() ) {
+        d->doneCondition.wait( &d->mutex );
+        d->workCondition.wakeAll();
+    }
+    d->stopping = false;
+    d->mutex.unlock();
+
+    d->reapWorkers();
+}
+
+
+K3b::WorkerPool::Statistics K3b::WorkerPool::statistics() const
+{
+    QMutexLocker locker( &d->mutex );
+
+    Statistics s;
+    s.workers = d->workers.count();
+    s.busyWorkers = d->busyWorkers;
+    s.blockedWorkers = d->blockedWorkers;
+    s.maxWorkers = d->maxWorkers;
+    s.completed = d->completed;
+    s.stolen = d->stolen;
+    s.saturated = d->saturated;
+    for( int i = 0; i < s_numPriorities; ++i ) {
+        s.queued[i] = d->queues[i].count();
+        Q_FOREACH( Worker* worker, d->workers )
+            s.queued[i] += worker->local[i].count();
+        s.averageLatency[i] = d->latencyCount[i] > 0
+                              ? double( d->latencySum[i] ) / double( d->latencyCount[i] )
+                              : 0.0;
+        s.maxLatency[i] = d->maxLatency[i];
+    }
+    return s;
+}
@@ -0,0 +1,159 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_WORKER_POOL_H_
+#define _K3B_WORKER_POOL_H_
+
+#include "k3b_export.h"
+
+#include <QtGlobal>
+
+
+namespace K3b {
+    /**
+     * The threads all ThreadJobs run in.
+     *
+     * The pool keeps up to maxWorkers() threads around instead of creating
+     * one thread per job. Idle threads exit after expiryTimeout().
+     *
+     * Tasks are started in the order of their priority class. A task
+     * submitted from a worker is put into the worker's own queue and
+     * picked up by the worker itself once it is done. Idle workers steal
+     * from the others.
+     *
+     * Realtime tasks feed a burning process and never wait in the queue:
+     * if no worker is idle the pool exceeds its bound for them.
+     *
+     * A task which waits for the GUI thread should do so inside a
+     * BlockingSection. The pool then starts a replacement worker to
+     * prevent a deadlock in case the GUI thread waits for a queued task.
+     */
+    class LIBK3B_EXPORT WorkerPool
+    {
+    public:
+        enum Priority {
+            Realtime = 0,
+            Interactive = 1,
+            Background = 2
+        };
+
+        class LIBK3B_EXPORT Task
+        {
+        public:
+            virtual ~Task();
+
+            virtual void run() = 0;
+
+            /**
+             * Called from the thread calling terminate() if the worker
+             * running this task was terminated.
+             */
+            virtual void terminated();
+        };
+
+        class LIBK3B_EXPORT BlockingSection
+        {
+        public:
+            BlockingSection();
+            ~BlockingSection();
+
+        private:
+            Q_DISABLE_COPY( BlockingSection )
+        };
+
+        struct Statistics
+        {
+            int workers;
+            int busyWorkers;
+            int blockedWorkers;
+            int maxWorkers;
+
+            /**
+             * Number of tasks waiting per priority class.
+             */
+            int queued[3];
+
+            quint64 completed;
+            quint64 stolen;
+
+            /**
+             * Number of submitted tasks which found no idle worker.
+             */
+            quint64 saturated;
+
+            /**
+             * Time in milliseconds tasks spent in the queue per priority class.
+             */
+            double averageLatency[3];
+            qint64 maxLatency[3];
+        };
+
+        /**
+         * \param maxWorkers The default (0) is twice the number of cores
+         *        but at least 4 since most of the jobs wait for devices.
+         */
+        explicit WorkerPool( int maxWorkers = 0 );
+
+        /**
+         * Waits for all tasks to finish.
+         */
+        ~WorkerPool();
+
+        /**
+         * The pool used by ThreadJob.
+         */
+        static WorkerPool* instance();
+
+        void setMaxWorkers( int max );
+        int maxWorkers() const;
+
+        void setExpiryTimeout( int msecs );
+        int expiryTimeout() const;
+
+        /**
+         * The pool does not take ownership of \p task. The task must
+         * not be submitted again before it has finished.
+         */
+        void submit( Task* task, Priority priority = Interactive );
+
+        /**
+         * Removes \p task from the queue.
+         *
+         * \return false if the task is not queued, i.e. it has been started already.
+         */
+        bool cancel( Task* task );
+
+        /**
+         * Terminates the worker running \p task.
+         * Use with care, see QThread::terminate().
+         *
+         * \return false if \p task is not running.
+         */
+        bool terminate( Task* task );
+
+        /**
+         * Waits until all tasks are done.
+         */
+        void waitForDone();
+
+        Statistics statistics() const;
+
+    private:
+        class Worker;
+        class Private;
+        Private* const d;
+
+        Q_DISABLE_COPY( WorkerPool )
+    };
+}
+
+#endif
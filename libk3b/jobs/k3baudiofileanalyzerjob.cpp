@@ -27,6 +27,7 @@ K3b::AudioFileAnalyzerJob::AudioFileAnalyzerJob( K3b::JobHandler* hdl, QObject*
       d( new Private() )
 {
     d->decoder = 0;
+    setPriority( WorkerPool::Background );
 }
 
 
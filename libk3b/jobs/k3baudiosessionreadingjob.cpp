@@ -14,7 +14,6 @@
 
 #include "k3baudiosessionreadingjob.h"
 
-#include "k3bthread.h"
 #include "k3btoc.h"
 #include "k3bcdparanoialib.h"
 #include "k3bwavefilewriter.h"
@@ -68,6 +67,8 @@ K3b::AudioSessionReadingJob::AudioSessionReadingJob( K3b::JobHandler* jh, QObjec
     : K3b::ThreadJob( jh, parent ),
       d( new Private() )
 {
+    // may feed the writer when copying on-the-fly
+    setPriority( WorkerPool::Realtime );
 }
 
 
@@ -0,0 +1,591 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bbroadcastwritingjob.h"
+#include "k3bverificationjob.h"
+#include "k3bmetawriter.h"
+
+#include "k3bdevice.h"
+#include "k3bdevicehandler.h"
+#include "k3bglobals.h"
+#include "k3bcore.h"
+#include "k3bfanoutpipe.h"
+#include "k3bfilesplitter.h"
+#include "k3bglobalsettings.h"
+#include "k3btoc.h"
+#include "k3btrack.h"
+#include "k3b_i18n.h"
+
+#include <KIOCore/KIO/Global>
+
+#include <QDebug>
+#include <QFile>
+#include <QStringList>
+
+
+namespace {
+    QString deviceName( K3b::Device::Device* dev )
+    {
+        return dev->vendor() + ' ' + dev->description();
+    }
+}
+
+
+class K3b::BroadcastWritingJob::Private
+{
+public:
+    struct Target
+    {
+        Target( Device::Device* dev )
+            : device( dev ),
+              writer( 0 ),
+              verifyJob( 0 ),
+              sink( -1 ),
+              writePercent( 0 ),
+              verifyPercent( 0 ),
+              written( false ),
+              done( false ),
+              success( false ) {
+        }
+
+        ~Target() {
+            delete writer;
+            delete verifyJob;
+        }
+
+        Device::Device* device;
+        MetaWriter* writer;
+        VerificationJob* verifyJob;
+        int sink;
+        int writePercent;
+        int verifyPercent;
+
+        // true once the writer finished successfully
+        bool written;
+        bool done;
+        bool success;
+    };
+
+    Private()
+        : source( 0 ),
+          speed( 0 ),
+          writingMode( K3b::WritingModeAuto ),
+          simulate( false ),
+          noFix( false ),
+          dataMode( K3b::DataModeAuto ),
+          verifyData( false ),
+          pipe( 0 ),
+          pipeFinished( false ),
+          canceled( false ),
+          finished( true ) {
+    }
+
+    ~Private() {
+        qDeleteAll( targets );
+    }
+
+    Target* targetForWriter( QObject* writer ) const {
+        Q_FOREACH( Target* t, targets )
+            if( t->writer == writer )
+                return t;
+        return 0;
+    }
+
+    Target* targetForVerifyJob( QObject* job ) const {
+        Q_FOREACH( Target* t, targets )
+            if( t->verifyJob == job )
+                return t;
+        return 0;
+    }
+
+    Device::MediaTypes wantedMediaTypes() const {
+        if( writingMode == K3b::WritingModeTao || writingMode == K3b::WritingModeRaw )
+            return Device::MEDIA_WRITABLE_CD;
+        else if( writingMode == K3b::WritingModeRestrictedOverwrite )
+            return Device::MEDIA_DVD_PLUS_RW | Device::MEDIA_DVD_RW_OVWR;
+        // very rough test, see Iso9660ImageWritingJob
+        else if( length.mode1Bytes() > 900ULL*1024ULL*1024ULL )
+            return Device::MEDIA_WRITABLE_DVD | Device::MEDIA_WRITABLE_BD;
+        else
+            return Device::MEDIA_WRITABLE;
+    }
+
+    QString imagePath;
+    QIODevice* source;
+    Msf length;
+
+    QList<Device::Device*> devices;
+    int speed;
+    WritingMode writingMode;
+    bool simulate;
+    bool noFix;
+    int dataMode;
+    bool verifyData;
+
+    FileSplitter imageFile;
+    FanOutPipe* pipe;
+    bool pipeFinished;
+
+    QList<Target*> targets;
+
+    bool canceled;
+    bool finished;
+};
+
+
+K3b::BroadcastWritingJob::BroadcastWritingJob( K3b::JobHandler* hdl, QObject* parent )
+    : K3b::BurnJob( hdl, parent ),
+      d( new Private() )
+{
+}
+
+
+K3b::BroadcastWritingJob::~BroadcastWritingJob()
+{
+    // stop the threads before the writers go away
+    delete d->pipe;
+    delete d;
+}
+
+
+K3b::Device::Device* K3b::BroadcastWritingJob::writer() const
+{
+    return d->devices.isEmpty() ? 0 : d->devices.first();
+}
+
+
+QList<K3b::Device::Device*> K3b::BroadcastWritingJob::burnDevices() const
+{
+    return d->devices;
+}
+
+
+int K3b::BroadcastWritingJob::succeededDevices() const
+{
+    int succeeded = 0;
+    Q_FOREACH( Private::Target* t, d->targets ) {
+        if( t->success )
+            ++succeeded;
+    }
+    return succeeded;
+}
+
+
+void K3b::BroadcastWritingJob::setImagePath( const QString& path )
+{
+    d->imagePath = path;
+    d->source = 0;
+}
+
+
+void K3b::BroadcastWritingJob::setSource( QIODevice* dev, const K3b::Msf& length )
+{
+    d->source = dev;
+    d->length = length;
+    d->imagePath.clear();
+}
+
+
+void K3b::BroadcastWritingJob::setBurnDevices( const QList<K3b::Device::Device*>& devs )
+{
+    d->devices = devs;
+}
+
+
+void K3b::BroadcastWritingJob::setSpeed( int s )
+{
+    d->speed = s;
+}
+
+
+void K3b::BroadcastWritingJob::setWritingMode( K3b::WritingMode mode )
+{
+    d->writingMode = mode;
+}
+
+
+void K3b::BroadcastWritingJob::setSimulate( bool b )
+{
+    d->simulate = b;
+}
+
+
+void K3b::BroadcastWritingJob::setNoFix( bool b )
+{
+    d->noFix = b;
+}
+
+
+void K3b::BroadcastWritingJob::setDataMode( int m )
+{
+    d->dataMode = m;
+}
+
+
+void K3b::BroadcastWritingJob::setVerifyData( bool b )
+{
+    d->verifyData = b;
+}
+
+
+void K3b::BroadcastWritingJob::start()
+{
+    jobStarted();
+
+    d->canceled = d->finished = false;
+    qDeleteAll( d->targets );
+    d->targets.clear();
+    delete d->pipe;
+    d->pipe = 0;
+    d->pipeFinished = false;
+
+    if( d->simulate )
+        d->verifyData = false;
+
+    emit newTask( i18n("Preparing data") );
+
+    if( d->devices.isEmpty() ) {
+        emit infoMessage( i18n("No burn device selected."), K3b::Job::MessageError );
+        d->finished = true;
+        jobFinished( false );
+        return;
+    }
+
+    if( !d->source ) {
+        if( !QFile::exists( d->imagePath ) ) {
+            emit infoMessage( i18n("Could not find image %1", d->imagePath), K3b::Job::MessageError );
+            d->finished = true;
+            jobFinished( false );
+            return;
+        }
+        d->length = K3b::imageFilesize( QUrl::fromLocalFile( d->imagePath ) )/2048;
+
+        d->imageFile.close();
+        d->imageFile.setName( d->imagePath );
+        if( !d->imageFile.open( QIODevice::ReadOnly ) ) {
+            emit infoMessage( i18n("Could not open file %1", d->imagePath), K3b::Job::MessageError );
+            d->finished = true;
+            jobFinished( false );
+            return;
+        }
+    }
+
+    //
+    // All media have to be in place before we start since the data is only read once
+    //
+    Q_FOREACH( Device::Device* dev, d->devices ) {
+        emit newSubTask( i18n("Waiting for medium in %1", deviceName( dev )) );
+        if( waitForMedium( dev, K3b::Device::STATE_EMPTY, d->wantedMediaTypes(), d->length ) == Device::MEDIA_UNKNOWN ) {
+            if( d->finished )
+                return;
+            d->finished = true;
+            emit canceled();
+            jobFinished( false );
+            return;
+        }
+        d->targets.append( new Private::Target( dev ) );
+    }
+
+    d->pipe = new FanOutPipe( this );
+    connect( d->pipe, SIGNAL(sinkFailed(int)), this, SLOT(slotSinkFailed(int)) );
+    connect( d->pipe, SIGNAL(finished()), this, SLOT(slotPipeFinished()) );
+
+    if( d->source ) {
+        d->pipe->readFrom( d->source );
+    }
+    else {
+        d->pipe->readFrom( &d->imageFile, true );
+    }
+
+    Device::Toc toc;
+    toc << Device::Track( 0, d->length - 1,
+                          Device::Track::TYPE_DATA,
+                          ( d->dataMode == K3b::DataModeAuto && d->noFix ) ||
+                          d->dataMode == K3b::DataMode2
+                          ? Device::Track::XA_FORM2
+                          : Device::Track::MODE1 );
+
+    Q_FOREACH( Private::Target* t, d->targets ) {
+        t->writer = new MetaWriter( t->device, this );
+        t->writer->setWritingMode( d->writingMode );
+        t->writer->setWritingApp( writingApp() );
+        t->writer->setSimulate( d->simulate );
+        t->writer->setBurnSpeed( d->speed );
+        t->writer->setMultiSession( d->noFix );
+        t->writer->setSessionToWrite( toc );
+
+        connect( t->writer, SIGNAL(infoMessage(QString,int)), this, SLOT(slotWriterInfoMessage(QString,int)) );
+        connect( t->writer, SIGNAL(percent(int)), this, SLOT(slotWriterPercent(int)) );
+        connect( t->writer, SIGNAL(finished(bool)), this, SLOT(slotWriterFinished(bool)) );
+        connect( t->writer, SIGNAL(debuggingOutput(QString,QString)),
+                 this, SIGNAL(debuggingOutput(QString,QString)) );
+
+        t->writer->start();
+
+        // a writer which failed to start has no device to write to
+        if( !t->writer->active() || !t->writer->ioDevice() ) {
+            if( t->writer->active() )
+                t->writer->cancel();
+            t->done = true;
+            continue;
+        }
+
+        // growisofs needs stdin to be closed in order to exit gracefully
+        t->sink = d->pipe->addSink( t->writer->ioDevice(), t->writer->usedWritingApp() == K3b::WritingAppGrowisofs );
+    }
+
+    // all writers failed, the last one already finished the job
+    if( d->finished )
+        return;
+
+    if( d->pipe->numSinks() == 0 ) {
+        // some writer is still shutting down
+        d->pipeFinished = true;
+        checkFinished();
+        return;
+    }
+
+    emit newTask( i18np("Writing image", "Writing image to %1 devices", d->targets.count()) );
+    emit burning( true );
+
+    if( !d->pipe->open() ) {
+        emit infoMessage( i18n("Could not open the source."), K3b::Job::MessageError );
+        // nothing will be pumped, do not wait for the pipe to finish
+        d->pipeFinished = true;
+        cancel();
+    }
+}
+
+
+void K3b::BroadcastWritingJob::cancel()
+{
+    if( d->finished )
+        return;
+
+    d->canceled = true;
+
+    Q_FOREACH( Private::Target* t, d->targets ) {
+        if( t->done )
+            continue;
+        if( t->sink >= 0 )
+            d->pipe->dropSink( t->sink );
+        if( t->verifyJob && t->verifyJob->active() )
+            t->verifyJob->cancel();
+        else if( t->writer && t->writer->active() )
+            t->writer->cancel();
+        else
+            t->done = true;
+    }
+
+    checkFinished();
+}
+
+
+void K3b::BroadcastWritingJob::slotWriterInfoMessage( const QString& message, int type )
+{
+    if( Private::Target* t = d->targetForWriter( sender() ) )
+        emit infoMessage( deviceName( t->device ) + ": " + message, type );
+}
+
+
+void K3b::BroadcastWritingJob::slotWriterPercent( int p )
+{
+    if( Private::Target* t = d->targetForWriter( sender() ) )
+        t->writePercent = p;
+
+    updateProgress();
+    emit bufferStatus( d->pipe->bufferFill() );
+}
+
+
+void K3b::BroadcastWritingJob::slotWriterFinished( bool success )
+{
+    Private::Target* t = d->targetForWriter( sender() );
+    if( !t )
+        return;
+
+    if( !success || d->canceled ) {
+        // the others keep going
+        d->pipe->dropSink( t->sink );
+        if( !d->canceled )
+            emit infoMessage( i18n("Writing to %1 failed.", deviceName( t->device )), K3b::Job::MessageError );
+        t->done = true;
+    }
+    else {
+        t->written = true;
+        t->writePercent = 100;
+        if( d->verifyData ) {
+            // the checksum is known once the pipe finished
+            if( d->pipeFinished )
+                startVerification( d->targets.indexOf( t ) );
+        }
+        else {
+            t->success = true;
+            t->done = true;
+        }
+    }
+
+    updateProgress();
+    checkFinished();
+}
+
+
+void K3b::BroadcastWritingJob::slotSinkFailed( int sink )
+{
+    Q_FOREACH( Private::Target* t, d->targets ) {
+        if( t->sink == sink && t->writer->active() ) {
+            emit infoMessage( i18n("Could not write to %1.", deviceName( t->device )), K3b::Job::MessageError );
+            t->writer->cancel();
+        }
+    }
+}
+
+
+void K3b::BroadcastWritingJob::slotPipeFinished()
+{
+    d->pipeFinished = true;
+
+    if( d->pipe->readError() )
+        emit infoMessage( i18n("Error while reading the source."), K3b::Job::MessageError );
+
+    if( !d->canceled ) {
+        for( int i = 0; i < d->targets.count(); ++i ) {
+            Private::Target* t = d->targets[i];
+            if( t->written && !t->done && !t->verifyJob )
+                startVerification( i );
+        }
+    }
+
+    checkFinished();
+}
+
+
+void K3b::BroadcastWritingJob::startVerification( int target )
+{
+    Private::Target* t = d->targets[target];
+
+    t->verifyJob = new VerificationJob( this, this );
+    connect( t->verifyJob, SIGNAL(infoMessage(QString,int)), this, SLOT(slotVerificationInfoMessage(QString,int)) );
+    connect( t->verifyJob, SIGNAL(percent(int)), this, SLOT(slotVerificationPercent(int)) );
+    connect( t->verifyJob, SIGNAL(finished(bool)), this, SLOT(slotVerificationFinished(bool)) );
+    connect( t->verifyJob, SIGNAL(debuggingOutput(QString,QString)),
+             this, SIGNAL(debuggingOutput(QString,QString)) );
+
+    t->verifyJob->setDevice( t->device );
+    t->verifyJob->clear();
+    t->verifyJob->addTrack( 1, d->pipe->checksum(), d->length );
+
+    emit newSubTask( i18n("Verifying written data on %1", deviceName( t->device )) );
+
+    t->verifyJob->start();
+}
+
+
+void K3b::BroadcastWritingJob::slotVerificationInfoMessage( const QString& message, int type )
+{
+    if( Private::Target* t = d->targetForVerifyJob( sender() ) )
+        emit infoMessage( deviceName( t->device ) + ": " + message, type );
+}
+
+
+void K3b::BroadcastWritingJob::slotVerificationPercent( int p )
+{
+    if( Private::Target* t = d->targetForVerifyJob( sender() ) )
+        t->verifyPercent = p;
+
+    updateProgress();
+}
+
+
+void K3b::BroadcastWritingJob::slotVerificationFinished( bool success )
+{
+    Private::Target* t = d->targetForVerifyJob( sender() );
+    if( !t )
+        return;
+
+    t->verifyPercent = 100;
+    t->success = success && !d->canceled;
+    t->done = true;
+
+    updateProgress();
+    checkFinished();
+}
+
+
+void K3b::BroadcastWritingJob::updateProgress()
+{
+    // failed targets count as done
+    int overall = 0;
+    int slowest = 100;
+    Q_FOREACH( Private::Target* t, d->targets ) {
+        int p = 100;
+        if( !t->done || t->success ) {
+            if( d->verifyData )
+                p = ( t->writePercent + t->verifyPercent ) / 2;
+            else
+                p = t->writePercent;
+        }
+        overall += p;
+        if( !t->written && !t->done )
+            slowest = qMin( slowest, t->writePercent );
+    }
+
+    if( !d->targets.isEmpty() )
+        emit percent( overall / d->targets.count() );
+    emit subPercent( slowest );
+}
+
+
+void K3b::BroadcastWritingJob::checkFinished()
+{
+    if( d->finished )
+        return;
+
+    Q_FOREACH( Private::Target* t, d->targets ) {
+        if( !t->done )
+            return;
+    }
+
+    // wait for the threads
+    if( d->pipe && d->pipe->numSinks() > 0 && !d->pipeFinished )
+        return;
+
+    emit burning( false );
+
+    int succeeded = 0;
+    Q_FOREACH( Private::Target* t, d->targets ) {
+        if( t->success ) {
+            ++succeeded;
+            emit infoMessage( i18n("%1: Successfully written.", deviceName( t->device )), K3b::Job::MessageSuccess );
+        }
+        else if( !d->canceled ) {
+            emit infoMessage( i18n("%1: Writing failed.", deviceName( t->device )), K3b::Job::MessageError );
+        }
+
+        if( k3bcore->globalSettings()->ejectMedia() )
+            K3b::Device::eject( t->device );
+    }
+
+    qDebug() << "(K3b::BroadcastWritingJob)" << succeeded << "of" << d->targets.count() << "devices succeeded.";
+
+    d->finished = true;
+
+    if( d->canceled ) {
+        emit canceled();
+        jobFinished( false );
+    }
+    else {
+        jobFinished( succeeded == d->targets.count() && !d->pipe->readError() );
+    }
+}
+
+#include "moc_k3bbroadcastwritingjob.cpp"
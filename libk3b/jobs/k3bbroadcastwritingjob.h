@@ -0,0 +1,106 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_BROADCAST_WRITING_JOB_H_
+#define _K3B_BROADCAST_WRITING_JOB_H_
+
+#include "k3bjob.h"
+#include "k3bmsf.h"
+#include "k3b_export.h"
+
+#include <QList>
+
+class QIODevice;
+
+namespace K3b {
+    namespace Device {
+        class Device;
+    }
+
+    /**
+     * Writes one data track to several devices at the same time.
+     *
+     * The source is read once and handed to one writer per device through
+     * a FanOutPipe. The slowest drive sets the pace, the faster ones rely
+     * on their buffer underrun protection. Each device is verified on its
+     * own and a failing device does not stop the others.
+     */
+    class LIBK3B_EXPORT BroadcastWritingJob : public BurnJob
+    {
+        Q_OBJECT
+
+    public:
+        explicit BroadcastWritingJob( JobHandler*, QObject* parent = 0 );
+        ~BroadcastWritingJob();
+
+        /**
+         * \return The first of the burn devices.
+         */
+        Device::Device* writer() const;
+
+        QList<Device::Device*> burnDevices() const;
+
+        /**
+         * The number of devices written (and verified) successfully
+         * in the last run.
+         */
+        int succeededDevices() const;
+
+        virtual QString jobDescription() const;
+        virtual QString jobDetails() const;
+        virtual QString jobSource() const;
+        virtual QString jobTarget() const;
+
+    public Q_SLOTS:
+        void cancel();
+        void start();
+
+        void setImagePath( const QString& path );
+
+        /**
+         * Write the data read from \p dev instead of an image file,
+         * for example the output of an on-the-fly image creation.
+         * The device is not closed by the job.
+         *
+         * \param length The length of the data in sectors of 2048 bytes.
+         */
+        void setSource( QIODevice* dev, const K3b::Msf& length );
+
+        void setBurnDevices( const QList<K3b::Device::Device*>& devs );
+        void setSpeed( int s );
+        void setWritingMode( K3b::WritingMode mode );
+        void setSimulate( bool b );
+        void setNoFix( bool b );
+        void setDataMode( int m );
+        void setVerifyData( bool b );
+
+    private Q_SLOTS:
+        void slotWriterInfoMessage( const QString&, int );
+        void slotWriterPercent( int );
+        void slotWriterFinished( bool );
+        void slotVerificationInfoMessage( const QString&, int );
+        void slotVerificationPercent( int );
+        void slotVerificationFinished( bool );
+        void slotSinkFailed( int );
+        void slotPipeFinished();
+
+    private:
+        void startVerification( int target );
+        void updateProgress();
+        void checkFinished();
+
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
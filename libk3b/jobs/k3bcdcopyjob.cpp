@@ -16,6 +16,7 @@
 
 #include "k3bcdcopyjob.h"
 #include "k3baudiosessionreadingjob.h"
+#include "k3bbroadcastwritingjob.h"
 
 #include "k3bexternalbinmanager.h"
 #include "k3bdevice.h"
@@ -65,6 +66,8 @@ public:
           audioSessionReader(0),
           cdrecordWriter(0),
           infFileWriter(0),
+          broadcastJob(0),
+          broadcastFailed(false),
           cddb(0) {
     }
 
@@ -89,6 +92,11 @@ public:
     K3b::CdrecordWriter* cdrecordWriter;
     K3b::InfFileWriter* infFileWriter;
 
+    // writes to all devices at once if there are additional writers
+    K3b::BroadcastWritingJob* broadcastJob;
+    // one of the copy sets failed on some device
+    bool broadcastFailed;
+
     bool audioReaderRunning;
     bool dataReaderRunning;
     bool writerRunning;
@@ -293,6 +301,22 @@ void K3b::CdCopyJob::slotDiskInfoReady( K3b::Device::DeviceHandler* dh )
         }
 
 
+        //
+        // Several writers at once are fed from a single data image
+        //
+        if( !m_additionalWriters.isEmpty() && !m_onlyCreateImages ) {
+            if( d->toc.contentType() != K3b::Device::DATA || d->numSessions > 1 ) {
+                emit infoMessage( i18n("Writing to several devices at once is only supported for single session data CDs."), MessageWarning );
+                m_additionalWriters.clear();
+            }
+            else if( m_onTheFly ) {
+                emit infoMessage( i18n("Writing to several devices at once requires an image."), MessageWarning );
+                emit infoMessage( i18n("Disabling on-the-fly writing."), MessageInfo );
+                m_onTheFly = false;
+            }
+        }
+
+
         //
         // We already create the temp filenames here since we need them to check the free space
         //
@@ -380,11 +404,13 @@ void K3b::CdCopyJob::searchCdText()
 void K3b::CdCopyJob::slotCdTextReady( K3b::Device::DeviceHandler* dh )
 {
     if( dh->success() ) {
-        if( K3b::Device::CdText::checkCrc( dh->cdTextRaw() ) ) {
-            K3b::Device::CdText cdt( dh->cdTextRaw() );
+        // some drives do not return the CRCs
+        QByteArray cdTextRaw = dh->cdTextRaw();
+        if( K3b::Device::CdText::repairCrc( cdTextRaw ) == 0 ) {
+            K3b::Device::CdText cdt( cdTextRaw );
             emit infoMessage( i18n("Found CD-Text (%1 - %2).",cdt.performer(),cdt.title()), MessageSuccess );
             d->haveCdText = true;
-            d->cdTextRaw = dh->cdTextRaw();
+            d->cdTextRaw = cdTextRaw;
         }
         else {
             emit infoMessage( i18n("Found corrupted CD-Text. Ignoring it."), MessageWarning );
@@ -463,6 +489,7 @@ void K3b::CdCopyJob::startCopy()
 {
     d->currentWrittenSession = d->currentReadSession = 1;
     d->doneCopies = 0;
+    d->broadcastFailed = false;
 
     if ( d->haveCdText && d->haveCddb ) {
         K3b::Device::CdText cdt( d->cdTextRaw );
@@ -503,7 +530,10 @@ void K3b::CdCopyJob::cancel()
         // if we are writing onthefly the reader won't be able to write
         // anymore and will finish unsuccessfully, too
         //
-        d->cdrecordWriter->cancel();
+        if( d->broadcastJob && d->broadcastJob->active() )
+            d->broadcastJob->cancel();
+        else
+            d->cdrecordWriter->cancel();
     }
     else if( d->audioReaderRunning )
         d->audioSessionReader->cancel();
@@ -999,7 +1029,10 @@ void K3b::CdCopyJob::slotSessionReaderFinished( bool success )
                         }
                     }
 
-                    if( !writeNextSession() ) {
+                    if( !m_additionalWriters.isEmpty() ) {
+                        startBroadcastWriting();
+                    }
+                    else if( !writeNextSession() ) {
                         // nothing is running here...
                         finishJob( d->canceled, d->error );
                     }
@@ -1094,6 +1127,77 @@ void K3b::CdCopyJob::slotWriterFinished( bool success )
 }
 
 
+void K3b::CdCopyJob::startBroadcastWriting()
+{
+    if( !d->broadcastJob ) {
+        d->broadcastJob = new K3b::BroadcastWritingJob( this, this );
+        connect( d->broadcastJob, SIGNAL(infoMessage(QString,int)), this, SIGNAL(infoMessage(QString,int)) );
+        connect( d->broadcastJob, SIGNAL(newTask(QString)), this, SIGNAL(newSubTask(QString)) );
+        connect( d->broadcastJob, SIGNAL(newSubTask(QString)), this, SIGNAL(newSubTask(QString)) );
+        connect( d->broadcastJob, SIGNAL(percent(int)), this, SLOT(slotBroadcastProgress(int)) );
+        connect( d->broadcastJob, SIGNAL(subPercent(int)), this, SIGNAL(subPercent(int)) );
+        connect( d->broadcastJob, SIGNAL(bufferStatus(int)), this, SIGNAL(bufferStatus(int)) );
+        connect( d->broadcastJob, SIGNAL(burning(bool)), this, SIGNAL(burning(bool)) );
+        connect( d->broadcastJob, SIGNAL(finished(bool)), this, SLOT(slotBroadcastFinished(bool)) );
+        connect( d->broadcastJob, SIGNAL(debuggingOutput(QString,QString)),
+                 this, SIGNAL(debuggingOutput(QString,QString)) );
+    }
+
+    const K3b::Device::Track& track = d->toc.first();
+    const bool mode2 = ( track.mode() == K3b::Device::Track::XA_FORM1 ||
+                         track.mode() == K3b::Device::Track::XA_FORM2 );
+
+    d->broadcastJob->setBurnDevices( QList<K3b::Device::Device*>() << m_writerDevice << m_additionalWriters );
+    d->broadcastJob->setImagePath( d->imageNames.first() );
+    d->broadcastJob->setSpeed( m_speed );
+    d->broadcastJob->setWritingMode( m_writingMode );
+    d->broadcastJob->setWritingApp( writingApp() );
+    d->broadcastJob->setSimulate( m_simulate );
+    d->broadcastJob->setNoFix( d->doNotCloseLastSession );
+    d->broadcastJob->setDataMode( mode2 ? K3b::DataMode2 : K3b::DataMode1 );
+
+    if( m_copies > 1 )
+        emit newTask( i18n("Writing Copy %1",d->doneCopies+1) );
+    else
+        emit newTask( i18n("Writing Copy") );
+
+    d->writerRunning = true;
+    d->broadcastJob->start();
+}
+
+
+void K3b::CdCopyJob::slotBroadcastProgress( int p )
+{
+    int bigParts = ( m_simulate ? 1 : m_copies ) + 1;
+    emit percent( 100*(d->doneCopies+1)/bigParts + p/bigParts );
+}
+
+
+void K3b::CdCopyJob::slotBroadcastFinished( bool success )
+{
+    d->writerRunning = false;
+
+    if( !success )
+        d->broadcastFailed = true;
+
+    // a failed device does not stop the others from writing the remaining copies
+    if( !d->canceled && !m_simulate && d->broadcastJob->succeededDevices() > 0 && ++d->doneCopies < m_copies ) {
+        // make room for the next set of media
+        if( !k3bcore->globalSettings()->ejectMedia() ) {
+            Q_FOREACH( K3b::Device::Device* dev, d->broadcastJob->burnDevices() ) {
+                if( !K3b::eject( dev ) )
+                    blockingInformation( i18n("K3b was unable to eject the written disk. Please do so manually.") );
+            }
+        }
+
+        startBroadcastWriting();
+    }
+    else {
+        finishJob( d->canceled, d->broadcastFailed && !d->canceled );
+    }
+}
+
+
 void K3b::CdCopyJob::slotMediaReloadedForNextSession( K3b::Device::DeviceHandler* dh )
 {
     if( !dh->success() )
@@ -1226,9 +1330,15 @@ QString K3b::CdCopyJob::jobDescription() const
 
 QString K3b::CdCopyJob::jobDetails() const
 {
-    return i18np("Creating 1 copy",
-                 "Creating %1 copies",
-                 (m_simulate||m_onlyCreateImages) ? 1 : m_copies );
+    const int copies = (m_simulate||m_onlyCreateImages) ? 1 : m_copies;
+    if( !m_onlyCreateImages && !m_additionalWriters.isEmpty() )
+        return i18np("Creating 1 copy on %2 devices",
+                     "Creating %1 copies on %2 devices",
+                     copies, m_additionalWriters.count()+1 );
+    else
+        return i18np("Creating 1 copy",
+                     "Creating %1 copies",
+                     copies );
 }
 
 
@@ -23,6 +23,8 @@
 
 #include <KCddb/Kcddb>
 
+#include <QList>
+
 namespace K3b {
     namespace Device {
         class Device;
@@ -73,6 +75,14 @@ namespace K3b {
         void setCopyCdText( bool b ) { m_copyCdText = b; }
         void setNoCorrection( bool b ) { m_noCorrection = b; }
 
+        /**
+         * Write every copy to these devices at the same time as to the
+         * writer device. Only single session data CDs can be written this
+         * way and an image is needed, on-the-fly copying is disabled if
+         * any are set.
+         */
+        void setAdditionalWriterDevices( const QList<K3b::Device::Device*>& devs ) { m_additionalWriters = devs; }
+
     private Q_SLOTS:
         void slotDiskInfoReady( K3b::Device::DeviceHandler* );
         void slotCdTextReady( K3b::Device::DeviceHandler* );
@@ -86,9 +96,12 @@ namespace K3b {
         void slotReaderSubProgress( int p );
         void slotWriterProgress( int p );
         void slotReaderProcessedSize( int p, int pp );
+        void slotBroadcastProgress( int p );
+        void slotBroadcastFinished( bool success );
 
     private:
         void startCopy();
+        void startBroadcastWriting();
         void searchCdText();
         void queryCddb();
         bool writeNextSession();
@@ -99,6 +112,7 @@ namespace K3b {
 
         Device::Device* m_writerDevice;
         Device::Device* m_readerDevice;
+        QList<Device::Device*> m_additionalWriters;
         bool m_simulate;
         int m_speed;
         int m_paranoiaMode;
@@ -15,7 +15,7 @@
 
 #include "k3bclonejob.h"
 
-#include "k3breadcdreader.h"
+#include "k3bclonereader.h"
 #include "k3bcdrecordwriter.h"
 #include "k3bexternalbinmanager.h"
 #include "k3bdevice.h"
@@ -48,7 +48,7 @@ K3b::CloneJob::CloneJob( K3b::JobHandler* hdl, QObject* parent )
       m_writerDevice(0),
       m_readerDevice(0),
       m_writerJob(0),
-      m_readcdReader(0),
+      m_cloneReader(0),
       m_removeImageFiles(false),
       m_canceled(false),
       m_running(false),
@@ -80,21 +80,23 @@ void K3b::CloneJob::start()
     // TODO: check the cd size and warn the user if not enough space
 
     //
-    // We first check if cdrecord has clone support
-    // The readcdReader will check the same for readcd
+    // We first check if cdrecord has clone support.
+    // Reading is done by K3b itself.
     //
-    const K3b::ExternalBin* cdrecordBin = k3bcore->externalBinManager()->binObject( "cdrecord" );
-    if( !cdrecordBin ) {
-        emit infoMessage( i18n("Could not find %1 executable.",QString("cdrecord")), MessageError );
-        jobFinished(false);
-        m_running = false;
-        return;
-    }
-    else if( !cdrecordBin->hasFeature( "clone" ) ) {
-        emit infoMessage( i18n("Cdrecord version %1 does not have cloning support.",cdrecordBin->version()), MessageError );
-        jobFinished(false);
-        m_running = false;
-        return;
+    if( !m_onlyCreateImage ) {
+        const K3b::ExternalBin* cdrecordBin = k3bcore->externalBinManager()->binObject( "cdrecord" );
+        if( !cdrecordBin ) {
+            emit infoMessage( i18n("Could not find %1 executable.",QString("cdrecord")), MessageError );
+            jobFinished(false);
+            m_running = false;
+            return;
+        }
+        else if( !cdrecordBin->hasFeature( "clone" ) ) {
+            emit infoMessage( i18n("Cdrecord version %1 does not have cloning support.",cdrecordBin->version()), MessageError );
+            jobFinished(false);
+            m_running = false;
+            return;
+        }
     }
 
     if( (!m_onlyCreateImage && !writer()) ||
@@ -143,31 +145,29 @@ void K3b::CloneJob::start()
 
         emit newTask( i18n("Reading clone image") );
 
-        m_readcdReader->start();
+        m_cloneReader->start();
     }
 }
 
 
 void K3b::CloneJob::prepareReader()
 {
-    if( !m_readcdReader ) {
-        m_readcdReader = new K3b::ReadcdReader( this, this );
-        connect( m_readcdReader, SIGNAL(percent(int)), this, SLOT(slotReadingPercent(int)) );
-        connect( m_readcdReader, SIGNAL(percent(int)), this, SIGNAL(subPercent(int)) );
-        connect( m_readcdReader, SIGNAL(processedSize(int,int)), this, SIGNAL(processedSubSize(int,int)) );
-        connect( m_readcdReader, SIGNAL(finished(bool)), this, SLOT(slotReadingFinished(bool)) );
-        connect( m_readcdReader, SIGNAL(infoMessage(QString,int)), this, SIGNAL(infoMessage(QString,int)) );
-        connect( m_readcdReader, SIGNAL(newTask(QString)), this, SIGNAL(newSubTask(QString)) );
-        connect( m_readcdReader, SIGNAL(debuggingOutput(QString,QString)),
+    if( !m_cloneReader ) {
+        m_cloneReader = new K3b::CloneReader( this, this );
+        connect( m_cloneReader, SIGNAL(percent(int)), this, SLOT(slotReadingPercent(int)) );
+        connect( m_cloneReader, SIGNAL(percent(int)), this, SIGNAL(subPercent(int)) );
+        connect( m_cloneReader, SIGNAL(processedSize(int,int)), this, SIGNAL(processedSubSize(int,int)) );
+        connect( m_cloneReader, SIGNAL(finished(bool)), this, SLOT(slotReadingFinished(bool)) );
+        connect( m_cloneReader, SIGNAL(infoMessage(QString,int)), this, SIGNAL(infoMessage(QString,int)) );
+        connect( m_cloneReader, SIGNAL(newTask(QString)), this, SIGNAL(newSubTask(QString)) );
+        connect( m_cloneReader, SIGNAL(debuggingOutput(QString,QString)),
                  this, SIGNAL(debuggingOutput(QString,QString)) );
     }
 
-    m_readcdReader->setReadDevice( readingDevice() );
-    m_readcdReader->setReadSpeed( 0 ); // MAX
-    m_readcdReader->setDisableCorrection( m_noCorrection );
-    m_readcdReader->setImagePath( m_imagePath );
-    m_readcdReader->setClone( true );
-    m_readcdReader->setRetries( m_readRetries );
+    m_cloneReader->setDevice( readingDevice() );
+    m_cloneReader->setNoCorrection( m_noCorrection );
+    m_cloneReader->setImagePath( m_imagePath );
+    m_cloneReader->setRetries( m_readRetries );
 }
 
 
@@ -203,8 +203,8 @@ void K3b::CloneJob::cancel()
 {
     if( m_running ) {
         m_canceled = true;
-        if( m_readcdReader )
-            m_readcdReader->cancel();
+        if( m_cloneReader )
+            m_cloneReader->cancel();
         if( m_writerJob )
             m_writerJob->cancel();
     }
@@ -283,7 +283,6 @@ void K3b::CloneJob::slotReadingFinished( bool success )
     if( success ) {
         //
         // Make a quick test if the image is really valid.
-        // Readcd does not seem to have proper exit codes
         //
         K3b::CloneTocReader ctr( m_imagePath );
         if( ctr.isValid() ) {
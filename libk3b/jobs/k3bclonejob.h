@@ -26,7 +26,7 @@ namespace K3b {
         class Device;
     }
     class CdrecordWriter;
-    class ReadcdReader;
+    class CloneReader;
 
     class LIBK3B_EXPORT CloneJob : public BurnJob
     {
@@ -78,7 +78,7 @@ namespace K3b {
         QString m_imagePath;
 
         CdrecordWriter* m_writerJob;
-        ReadcdReader* m_readcdReader;
+        CloneReader* m_cloneReader;
 
         bool m_noCorrection;
         bool m_removeImageFiles;
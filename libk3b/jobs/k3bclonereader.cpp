@@ -0,0 +1,585 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+#include "k3bclonereader.h"
+
+#include "k3bcore.h"
+#include "k3bcrc.h"
+#include "k3bdevice.h"
+#include "k3bdeviceglobals.h"
+#include "k3bmsf.h"
+#include "k3b_i18n.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+
+#include <string.h>
+
+
+namespace {
+    // 2352 bytes of raw sector data and 96 bytes of raw P-W subchannel
+    const int s_sectorSize = 2448;
+
+    const int s_maxReadSectors = 64;
+
+    // the Q subchannel is not corrected by the drive and broken Q data is part
+    // of some copy protections, so we do not insist as much as for the main data
+    const int s_maxSubchannelRetries = 8;
+
+    // chunks queued ahead of the image writer, at most 10 MB
+    const int s_maxQueuedChunks = 64;
+
+    bool checkSubchannelCrc( const unsigned char* pw )
+    {
+        // the Q subchannel is bit 6 of each of the 96 raw P-W bytes
+        unsigned char q[12];
+        for( int i = 0; i < 12; ++i ) {
+            unsigned char b = 0;
+            for( int j = 0; j < 8; ++j )
+                b = ( b << 1 ) | ( ( pw[i*8+j] >> 6 ) & 0x1 );
+            q[i] = b;
+        }
+        return K3b::Device::checkQCrc( q );
+    }
+
+    struct WriteQueue
+    {
+        WriteQueue()
+            : file( 0 ),
+              closed( false ),
+              running( false ),
+              failed( false ) {
+        }
+
+        QFile* file;
+        QMutex mutex;
+        QWaitCondition changed;
+        QQueue<QByteArray> chunks;
+        bool closed;
+        bool running;
+        bool failed;
+    };
+
+    /**
+     * Writes the image while the next sectors are read.
+     */
+    class WriteTask : public K3b::WorkerPool::Task
+    {
+    public:
+        explicit WriteTask( WriteQueue* q )
+            : queue( q ) {
+        }
+
+        void run() {
+            bool success = true;
+            QMutexLocker locker( &queue->mutex );
+            while( success ) {
+                while( queue->chunks.isEmpty() && !queue->closed )
+                    queue->changed.wait( &queue->mutex );
+                if( queue->chunks.isEmpty() )
+                    break;
+
+                QByteArray chunk = queue->chunks.dequeue();
+                queue->changed.wakeAll();
+                locker.unlock();
+
+                success = ( queue->file->write( chunk ) == chunk.size() );
+
+                locker.relock();
+            }
+
+            if( !success ) {
+                queue->failed = true;
+                queue->chunks.clear();
+            }
+            queue->running = false;
+            queue->changed.wakeAll();
+            locker.unlock();
+
+            // the queue is not touched anymore, the reader may go on
+            delete this;
+        }
+
+    private:
+        WriteQueue* queue;
+    };
+}
+
+
+class K3b::CloneReader::Private
+{
+public:
+    Private()
+        : device( 0 ),
+          retries( 128 ),
+          noCorrection( false ),
+          oldErrorRecoveryMode( 0 ),
+          sectors( 0 ) {
+    }
+
+    Device::Device* device;
+    QString imagePath;
+    int retries;
+    bool noCorrection;
+    int oldErrorRecoveryMode;
+
+    // the raw full toc as written to the .toc file
+    QByteArray toc;
+    int sectors;
+
+    QList<ErrorRange> errors;
+
+    WriteQueue queue;
+
+    /**
+     * Blocks while the writer is busy with enough data already.
+     * \return false if writing failed.
+     */
+    bool enqueue( const QByteArray& chunk );
+
+    /**
+     * \return false if writing failed.
+     */
+    bool finishWriting();
+};
+
+
+bool K3b::CloneReader::Private::enqueue( const QByteArray& chunk )
+{
+    QMutexLocker locker( &queue.mutex );
+    if( queue.chunks.count() >= s_maxQueuedChunks && !queue.failed ) {
+        WorkerPool::BlockingSection blocking;
+        while( queue.chunks.count() >= s_maxQueuedChunks && !queue.failed )
+            queue.changed.wait( &queue.mutex );
+    }
+    if( queue.failed )
+        return false;
+
+    queue.chunks.enqueue( chunk );
+    queue.changed.wakeAll();
+    return true;
+}
+
+
+bool K3b::CloneReader::Private::finishWriting()
+{
+    QMutexLocker locker( &queue.mutex );
+    queue.closed = true;
+    queue.changed.wakeAll();
+    if( queue.running ) {
+        WorkerPool::BlockingSection blocking;
+        while( queue.running )
+            queue.changed.wait( &queue.mutex );
+    }
+    return !queue.failed;
+}
+
+
+K3b::CloneReader::CloneReader( K3b::JobHandler* jh, QObject* parent )
+    : K3b::ThreadJob( jh, parent ),
+      d( new Private() )
+{
+    setPriority( WorkerPool::Realtime );
+}
+
+
+K3b::CloneReader::~CloneReader()
+{
+    delete d;
+}
+
+
+void K3b::CloneReader::setDevice( K3b::Device::Device* dev )
+{
+    d->device = dev;
+}
+
+
+void K3b::CloneReader::setImagePath( const QString& path )
+{
+    d->imagePath = path;
+}
+
+
+void K3b::CloneReader::setRetries( int retries )
+{
+    d->retries = qMax( 1, retries );
+}
+
+
+void K3b::CloneReader::setNoCorrection( bool b )
+{
+    d->noCorrection = b;
+}
+
+
+QList<K3b::CloneReader::ErrorRange> K3b::CloneReader::errorMap() const
+{
+    return d->errors;
+}
+
+
+bool K3b::CloneReader::run()
+{
+    d->errors.clear();
+
+    if( !d->device->open() ) {
+        emit infoMessage( i18n("Could not open device %1",d->device->blockDeviceName()), K3b::Job::MessageError );
+        return false;
+    }
+
+    if( !readToc() ) {
+        d->device->close();
+        return false;
+    }
+
+    QFile file( d->imagePath );
+    if( !file.open( QIODevice::WriteOnly ) ) {
+        d->device->close();
+        emit infoMessage( i18n("Unable to open '%1' for writing.",d->imagePath), K3b::Job::MessageError );
+        return false;
+    }
+
+    k3bcore->blockDevice( d->device );
+    d->device->block( true );
+
+    setErrorRecovery( d->noCorrection ? 0x21 : 0x20 );
+
+    //
+    // Let the drive determine the optimal reading speed
+    //
+    d->device->setSpeed( 0xffff, 0xffff );
+
+    const int maxSectors = probeTransferSize( d->sectors );
+
+    emit debuggingOutput( "K3b::CloneReader",
+                          QString("reading %1 sectors with up to %2 sectors per command.")
+                          .arg( d->sectors ).arg( maxSectors ) );
+
+    d->queue.file = &file;
+    d->queue.closed = false;
+    d->queue.failed = false;
+    d->queue.running = true;
+    WorkerPool::instance()->submit( new WriteTask( &d->queue ), WorkerPool::Realtime );
+
+    int currentSector = 0;
+    int chunkSectors = maxSectors;
+    bool readError = false;
+    bool writeError = false;
+    int lastPercent = 0;
+    int lastReadMb = 0;
+    const int totalMb = qint64( d->sectors ) * s_sectorSize / 1024 / 1024;
+    while( !canceled() && currentSector < d->sectors ) {
+
+        const int count = qMin( chunkSectors, d->sectors - currentSector );
+
+        // a new buffer for each chunk since the writer still holds the last one
+        QByteArray chunk( count*s_sectorSize, 0 );
+        unsigned char* data = reinterpret_cast<unsigned char*>( chunk.data() );
+
+        if( readSectors( data, currentSector, count ) ) {
+            // back to full speed after an error, step by step
+            chunkSectors = qMin( chunkSectors*2, maxSectors );
+        }
+        else {
+            if( !retryRead( data, currentSector, count ) ) {
+                readError = true;
+                break;
+            }
+            // there may be more bad sectors ahead
+            chunkSectors = 1;
+        }
+
+        for( int i = 0; i < count && !canceled(); ++i )
+            verifySector( data + i*s_sectorSize, currentSector + i );
+
+        if( !d->enqueue( chunk ) ) {
+            emit infoMessage( i18n("Unable to write to '%1'.",d->imagePath), K3b::Job::MessageError );
+            writeError = true;
+            break;
+        }
+
+        currentSector += count;
+
+        const int currentPercent = qint64( 100 ) * currentSector / d->sectors;
+        if( currentPercent > lastPercent ) {
+            lastPercent = currentPercent;
+            emit percent( currentPercent );
+        }
+
+        const int readMb = qint64( currentSector ) * s_sectorSize / 1024 / 1024;
+        if( readMb > lastReadMb ) {
+            lastReadMb = readMb;
+            emit processedSize( readMb, totalMb );
+        }
+    }
+
+    if( !d->finishWriting() && !writeError ) {
+        emit infoMessage( i18n("Unable to write to '%1'.",d->imagePath), K3b::Job::MessageError );
+        writeError = true;
+    }
+    d->queue.file = 0;
+    file.close();
+
+    // reset the error recovery mode
+    setErrorRecovery( d->oldErrorRecoveryMode );
+
+    d->device->block( false );
+    k3bcore->unblockDevice( d->device );
+    d->device->close();
+
+    reportErrors();
+
+    if( canceled() || readError || writeError )
+        return false;
+
+    //
+    // the toc goes last so an incomplete image is never taken for a valid one
+    //
+    QFile tocFile( d->imagePath + ".toc" );
+    if( !tocFile.open( QIODevice::WriteOnly ) || tocFile.write( d->toc ) != d->toc.size() ) {
+        emit infoMessage( i18n("Unable to open '%1' for writing.",tocFile.fileName()), K3b::Job::MessageError );
+        return false;
+    }
+
+    return true;
+}
+
+
+bool K3b::CloneReader::readToc()
+{
+    //
+    // Read Raw TOC (format: 0010b)
+    // POINT a2h gives the start of the session lead-out in PMIN,PSEC,PFRAME
+    //
+    Device::UByteArray data;
+    if( !d->device->readTocPmaAtip( data, 2, false, 1 ) || data.size() < 4 ) {
+        emit infoMessage( i18n("Unable to read the table of contents."), K3b::Job::MessageError );
+        return false;
+    }
+
+    const int len = qMin<int>( Device::from2Byte( data.data() ) + 2, data.size() );
+    d->toc = QByteArray( reinterpret_cast<const char*>( data.data() ), len );
+    d->sectors = 0;
+
+    // the descriptors are 11 bytes long
+    for( int i = 4; i + 11 <= len; i += 11 ) {
+        const unsigned char* desc = data.data() + i;
+        if( desc[0] != 1 ) {
+            emit infoMessage( i18n("Only the first session of a CD can be cloned."), K3b::Job::MessageError );
+            return false;
+        }
+        if( desc[3] == 0xa2 ) {
+            // cdrecord counts from lba -150 (00:00:00)
+            d->sectors = Msf( desc[8], desc[9], desc[10] ).lba() - 150;
+        }
+    }
+
+    if( d->sectors <= 0 ) {
+        emit infoMessage( i18n("Unable to read the table of contents."), K3b::Job::MessageError );
+        return false;
+    }
+
+    emit debuggingOutput( "K3b::CloneReader", QString("raw toc with %1 bytes, lead-out at %2.").arg( len ).arg( d->sectors ) );
+    return true;
+}
+
+
+bool K3b::CloneReader::readSectors( unsigned char* buffer, int start, int count )
+{
+    return d->device->readCd( buffer, count*s_sectorSize,
+                              0,      // all sector types
+                              false,  // no dap
+                              start,
+                              count,
+                              true,   // sync
+                              true,   // header
+                              true,   // subheader
+                              true,   // user data
+                              true,   // edc/ecc
+                              0,      // no c2 info
+                              1 );    // raw P-W subchannel
+}
+
+
+int K3b::CloneReader::probeTransferSize( int sectors )
+{
+    const int maxSectors = qMin( s_maxReadSectors, sectors );
+    QByteArray buffer( maxSectors*s_sectorSize, 0 );
+    unsigned char* data = reinterpret_cast<unsigned char*>( buffer.data() );
+
+    //
+    // A failing size may as well be caused by a bad sector in the probed range. Thus
+    // we keep the largest size which worked anywhere and only try the next place
+    // if the full size failed.
+    //
+    int best = 0;
+    for( int i = 0; i < 4 && best < maxSectors; ++i ) {
+        const int start = qMin<int>( qint64( sectors ) * i / 4, sectors - maxSectors );
+        for( int count = maxSectors; count > best; count /= 2 ) {
+            if( readSectors( data, start, count ) ) {
+                best = count;
+                break;
+            }
+        }
+    }
+
+    return qMax( 1, best );
+}
+
+
+// here we read every single sector for itself to find the troubleing ones
+bool K3b::CloneReader::retryRead( unsigned char* buffer, int startSector, int len )
+{
+    emit debuggingOutput( "K3b::CloneReader", QString( "Problem while reading. Retrying from sector %1.").arg(startSector) );
+
+    for( int sector = startSector; sector < startSector+len; ++sector ) {
+        unsigned char* data = buffer + ( sector - startSector )*s_sectorSize;
+        int attempt = 0;
+        while( !canceled() && attempt < d->retries && !readSectors( data, sector, 1 ) )
+            ++attempt;
+
+        if( canceled() )
+            return false;
+
+        if( attempt == d->retries ) {
+            emit infoMessage( i18n("Error while reading sector %1.",sector), K3b::Job::MessageError );
+            emit debuggingOutput( "K3b::CloneReader", QString( "Read error in sector %1.").arg(sector) );
+            return false;
+        }
+        else if( attempt > 0 ) {
+            addError( sector, ERROR_RECOVERED );
+        }
+    }
+
+    return true;
+}
+
+
+bool K3b::CloneReader::verifySector( unsigned char* buffer, int sector )
+{
+    bool edcOk = Device::checkRawSectorEdc( buffer );
+    bool subchannelOk = checkSubchannelCrc( buffer + 2352 );
+    if( edcOk && subchannelOk )
+        return true;
+
+    // read the sector again until the broken parts are fine
+    unsigned char retry[s_sectorSize];
+    int attempt = 0;
+    while( !canceled() && !( edcOk && subchannelOk ) ) {
+        // broken sectors are part of the copy in this mode
+        const bool retryData = ( !edcOk && !d->noCorrection && attempt < d->retries );
+        const bool retrySubchannel = ( !subchannelOk && attempt < qMin( s_maxSubchannelRetries, d->retries ) );
+        if( !retryData && !retrySubchannel )
+            break;
+
+        ++attempt;
+        if( !readSectors( retry, sector, 1 ) )
+            continue;
+
+        if( !edcOk && Device::checkRawSectorEdc( retry ) ) {
+            ::memcpy( buffer, retry, 2352 );
+            edcOk = true;
+        }
+        if( !subchannelOk && checkSubchannelCrc( retry + 2352 ) ) {
+            ::memcpy( buffer + 2352, retry + 2352, s_sectorSize - 2352 );
+            subchannelOk = true;
+        }
+    }
+
+    if( !edcOk )
+        addError( sector, ERROR_EDC );
+    if( !subchannelOk )
+        addError( sector, ERROR_SUBCHANNEL );
+    if( edcOk && subchannelOk )
+        addError( sector, ERROR_RECOVERED );
+
+    return edcOk && subchannelOk;
+}
+
+
+void K3b::CloneReader::addError( int sector, ErrorType type )
+{
+    // sectors are verified in order, thus we only need to look at the
+    // latest range of the type
+    for( int i = d->errors.count()-1; i >= 0; --i ) {
+        ErrorRange& range = d->errors[i];
+        if( range.type == type ) {
+            if( range.last == sector || range.last+1 == sector ) {
+                range.last = sector;
+                return;
+            }
+            break;
+        }
+    }
+
+    ErrorRange range;
+    range.first = range.last = sector;
+    range.type = type;
+    d->errors.append( range );
+}
+
+
+void K3b::CloneReader::reportErrors()
+{
+    int counts[3] = { 0, 0, 0 };
+    QString map;
+    Q_FOREACH( const ErrorRange& range, d->errors ) {
+        counts[range.type] += range.last - range.first + 1;
+
+        static const char* const s_names[] = { "recovered", "EDC mismatch", "Q subchannel CRC mismatch" };
+        map += QString( "%1 - %2: %3\n" ).arg( range.first ).arg( range.last ).arg( s_names[range.type] );
+    }
+
+    if( !map.isEmpty() )
+        emit debuggingOutput( "K3b::CloneReader", "Error map:\n" + map );
+
+    if( counts[ERROR_RECOVERED] > 0 )
+        emit infoMessage( i18np("1 sector could only be read after retrying.",
+                                "%1 sectors could only be read after retrying.",
+                                counts[ERROR_RECOVERED] ), K3b::Job::MessageInfo );
+    if( counts[ERROR_EDC] > 0 )
+        emit infoMessage( i18np("1 sector has an invalid EDC.",
+                                "%1 sectors have an invalid EDC.",
+                                counts[ERROR_EDC] ),
+                          d->noCorrection ? K3b::Job::MessageInfo : K3b::Job::MessageWarning );
+    if( counts[ERROR_SUBCHANNEL] > 0 )
+        emit infoMessage( i18np("1 sector has invalid Q subchannel data.",
+                                "%1 sectors have invalid Q subchannel data.",
+                                counts[ERROR_SUBCHANNEL] ), K3b::Job::MessageWarning );
+}
+
+
+bool K3b::CloneReader::setErrorRecovery( int code )
+{
+    Device::UByteArray data;
+    if( !d->device->modeSense( data, 0x01 ) )
+        return false;
+
+    // in MMC1 the page has 8 bytes (12 in MMC4 but we only need the first 3 anyway)
+    if( data.size() < 8+8 ) {
+        qDebug() << "(K3b::CloneReader) modepage 0x01 data too small: " << data.size();
+        return false;
+    }
+
+    d->oldErrorRecoveryMode = data[8+2];
+    data[8+2] = code;
+
+    if( d->oldErrorRecoveryMode != code )
+        qDebug() << "(K3b::CloneReader) changing data recovery mode from " << d->oldErrorRecoveryMode << " to " << code;
+
+    return d->device->modeSelect( data, true, false );
+}
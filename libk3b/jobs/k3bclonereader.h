@@ -0,0 +1,121 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+#ifndef _K3B_CLONE_READER_H_
+#define _K3B_CLONE_READER_H_
+
+#include "k3bthreadjob.h"
+#include "k3b_export.h"
+
+#include <QList>
+
+
+namespace K3b {
+    namespace Device {
+        class Device;
+    }
+
+    /**
+     * Reads the first session of a CD in the format used by cdrecord -clone:
+     * an image with 2448 bytes per sector (the raw 2352 byte sector followed by
+     * the 96 bytes of raw P-W subchannel data) and the raw full TOC in a file
+     * with the additional extension ".toc".
+     *
+     * This replaces readcd clone=... Every sector is verified while reading: the
+     * EDC of data sectors and the CRC of the Q subchannel. Sectors which fail
+     * are read again. Read errors let the reader fall back to single sectors for
+     * the bad region, after which the transfer size is increased again step by step.
+     * The verification runs while the previous data is written to the image.
+     */
+    class LIBK3B_EXPORT CloneReader : public ThreadJob
+    {
+        Q_OBJECT
+
+    public:
+        explicit CloneReader( JobHandler*, QObject* parent = 0 );
+        ~CloneReader();
+
+        enum ErrorType {
+            /** Could be read after retrying. */
+            ERROR_RECOVERED,
+            /** The EDC does not match the data. */
+            ERROR_EDC,
+            /** The CRC of the Q subchannel does not match. */
+            ERROR_SUBCHANNEL
+        };
+
+        struct ErrorRange {
+            int first;
+            int last;
+            ErrorType type;
+        };
+
+        void setDevice( Device::Device* dev );
+
+        /**
+         * The toc is written to \p path + ".toc".
+         */
+        void setImagePath( const QString& path );
+
+        /**
+         * The number of times a sector is read before giving up.
+         */
+        void setRetries( int retries );
+
+        /**
+         * Disables the error correction of the drive and does not
+         * retry sectors with an invalid EDC. Needed to copy discs with
+         * intentionally broken sectors.
+         */
+        void setNoCorrection( bool b );
+
+        /**
+         * The problems found while reading, ordered by sector. Consecutive
+         * sectors with the same problem are combined. Valid after the job finished.
+         */
+        QList<ErrorRange> errorMap() const;
+
+    protected:
+        /**
+         * Reads \p count sectors starting at \p start in the format of the image.
+         */
+        virtual bool readSectors( unsigned char* buffer, int start, int count );
+
+        /**
+         * Determines the number of sectors the drive and the kernel accept in
+         * one command. A bad sector fails every transfer size, thus the size
+         * is probed at a few places spread over the first \p sectors sectors.
+         *
+         * \return The largest size which worked, 1 if no read succeeded at all.
+         */
+        int probeTransferSize( int sectors );
+
+        /**
+         * Checks the EDC and the Q subchannel of \p buffer and reads the sector
+         * again if one of them is broken. Problems end up in errorMap().
+         */
+        bool verifySector( unsigned char* buffer, int sector );
+
+    private:
+        bool run();
+
+        bool readToc();
+        bool retryRead( unsigned char* buffer, int startSector, int len );
+        void addError( int sector, ErrorType type );
+        void reportErrors();
+        bool setErrorRecovery( int code );
+
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
@@ -15,10 +15,10 @@
 #include "k3bdatatrackreader.h"
 
 #include "k3blibdvdcss.h"
+#include "k3bdvdcssreader.h"
 #include "k3bdevice.h"
 #include "k3bdeviceglobals.h"
 #include "k3btrack.h"
-#include "k3bthread.h"
 #include "k3bcore.h"
 #include "k3b_i18n.h"
 
@@ -51,6 +51,7 @@ public:
     ReadSectorSize sectorSize;
     bool useLibdvdcss;
     K3b::LibDvdCss* libcss;
+    K3b::DvdCssReader* cssReader;
 
     int oldErrorRecoveryMode;
 
@@ -66,13 +67,15 @@ K3b::DataTrackReader::Private::Private()
       retries(10),
       device(0),
       ioDevice(0),
-      libcss(0)
+      libcss(0),
+      cssReader(0)
 {
 }
 
 
 K3b::DataTrackReader::Private::~Private()
 {
+    delete cssReader;
     delete libcss;
 }
 
@@ -83,6 +86,8 @@ K3b::DataTrackReader::DataTrackReader( K3b::JobHandler* jh, QObject* parent )
     : K3b::ThreadJob( jh, parent ),
       d( new Private() )
 {
+    // may feed the writer when copying on-the-fly
+    setPriority( WorkerPool::Realtime );
 }
 
 
@@ -183,14 +188,19 @@ bool K3b::DataTrackReader::run()
                 return false;
             }
 
-            emit infoMessage( i18n("Retrieving all CSS keys. This might take a while."), K3b::Job::MessageInfo );
-            if( !d->libcss->crackAllKeys() ) {
+            //
+            // The keys are retrieved while reading, starting with the areas
+            // which are not encrypted.
+            //
+            if( !d->libcss->scanTitles() ) {
                 d->libcss->close();
-                emit infoMessage( i18n("Failed to retrieve all CSS keys."), K3b::Job::MessageError );
                 emit infoMessage( i18n("Video DVD decryption failed."), K3b::Job::MessageError );
                 return false;
             }
 
+            delete d->cssReader;
+            d->cssReader = new K3b::DvdCssReader( d->libcss );
+            d->cssReader->setLastSector( d->lastSector.lba() );
             d->useLibdvdcss = true;
         }
     }
@@ -261,7 +271,8 @@ bool K3b::DataTrackReader::run()
     s_bufferSizeSectors = 128;
 #endif
     unsigned char* buffer = new unsigned char[d->usedSectorSize*s_bufferSizeSectors];
-    while( s_bufferSizeSectors > 0 && read( buffer, d->firstSector.lba(), s_bufferSizeSectors ) < 0 ) {
+    // libdvdcss does not have a DMA limit and the probing would only restart reading ahead
+    while( !d->useLibdvdcss && s_bufferSizeSectors > 0 && read( buffer, d->firstSector.lba(), s_bufferSizeSectors ) < 0 ) {
         qDebug() << "(K3b::DataTrackReader) determine max read sectors: "
                  << s_bufferSizeSectors << " too high." << endl;
         s_bufferSizeSectors /= 2;
@@ -363,8 +374,12 @@ bool K3b::DataTrackReader::run()
     k3bcore->unblockDevice( d->device );
 
     // cleanup
-    if( d->useLibdvdcss )
+    if( d->useLibdvdcss ) {
+        qDebug() << "(K3b::DataTrackReader) cracked" << d->cssReader->prefetchedKeys() << "keys while reading ahead.";
+        delete d->cssReader;
+        d->cssReader = 0;
         d->libcss->close();
+    }
     d->device->close();
     delete [] buffer;
 
@@ -383,7 +398,7 @@ int K3b::DataTrackReader::read( unsigned char* buffer, unsigned long sector, uns
     // Encrypted DVD reading with libdvdcss
     //
     if( d->useLibdvdcss ) {
-        return d->libcss->readWrapped( reinterpret_cast<void*>(buffer), sector, len );
+        return d->cssReader->read( reinterpret_cast<void*>(buffer), sector, len );
     }
 
     //
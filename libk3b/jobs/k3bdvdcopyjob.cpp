@@ -15,6 +15,7 @@
 
 #include "k3bdvdcopyjob.h"
 #include "k3blibdvdcss.h"
+#include "k3bbroadcastwritingjob.h"
 
 #include "k3breadcdreader.h"
 #include "k3bdatatrackreader.h"
@@ -53,6 +54,8 @@ public:
           readcdReader(0),
           dataTrackReader(0),
           verificationJob(0),
+          broadcastJob(0),
+          broadcastFailed(false),
           usedWritingMode(K3b::WritingModeAuto),
           verifyData(false) {
         outPipe.readFrom( &imageFile, true );
@@ -72,6 +75,11 @@ public:
     K3b::DataTrackReader* dataTrackReader;
     K3b::VerificationJob* verificationJob;
 
+    // writes to all devices at once if there are additional writers
+    K3b::BroadcastWritingJob* broadcastJob;
+    // one of the copy sets failed on some device
+    bool broadcastFailed;
+
     K3b::Device::DiskInfo sourceDiskInfo;
 
     K3b::Msf lastSector;
@@ -118,6 +126,7 @@ void K3b::DvdCopyJob::start()
     d->canceled = false;
     d->running = true;
     d->readerRunning = d->writerRunning = false;
+    d->broadcastFailed = false;
 
     emit newTask( i18n("Checking Source Medium") );
 
@@ -129,6 +138,12 @@ void K3b::DvdCopyJob::start()
         emit infoMessage( i18n("Disabling on-the-fly writing."), MessageInfo );
     }
 
+    if( m_onTheFly && !m_onlyCreateImage && !m_additionalWriters.isEmpty() ) {
+        m_onTheFly = false;
+        emit infoMessage( i18n("Writing to several devices at once requires an image."), MessageWarning );
+        emit infoMessage( i18n("Disabling on-the-fly writing."), MessageInfo );
+    }
+
     emit newSubTask( i18n("Waiting for source medium") );
 
     // wait for a source disk
@@ -415,8 +430,12 @@ void K3b::DvdCopyJob::cancel()
         d->canceled = true;
         if( d->readerRunning  )
             d->dataTrackReader->cancel();
-        if( d->writerRunning )
-            d->writerJob->cancel();
+        if( d->writerRunning ) {
+            if( d->broadcastJob && d->broadcastJob->active() )
+                d->broadcastJob->cancel();
+            else
+                d->writerJob->cancel();
+        }
         if ( d->verificationJob && d->verificationJob->active() )
             d->verificationJob->cancel();
         d->inPipe.close();
@@ -597,7 +616,10 @@ void K3b::DvdCopyJob::slotReaderFinished( bool success )
 
                 d->imageFile.close();
 
-                if( waitForDvd() ) {
+                if( !m_additionalWriters.isEmpty() ) {
+                    startBroadcastWriting();
+                }
+                else if( waitForDvd() ) {
                     prepareWriter();
                     if( m_copies > 1 )
                         emit newTask( i18n("Writing copy %1",d->doneCopies+1) );
@@ -778,6 +800,87 @@ void K3b::DvdCopyJob::slotVerificationFinished( bool success )
             d->outPipe.open( true );
         }
     }
+    else {
+        if( m_removeImageFiles )
+            removeImageFiles();
+        d->running = false;
+        jobFinished( !d->broadcastFailed );
+    }
+}
+
+
+void K3b::DvdCopyJob::startBroadcastWriting()
+{
+    if( !d->broadcastJob ) {
+        d->broadcastJob = new K3b::BroadcastWritingJob( this, this );
+        connect( d->broadcastJob, SIGNAL(infoMessage(QString,int)), this, SIGNAL(infoMessage(QString,int)) );
+        connect( d->broadcastJob, SIGNAL(newTask(QString)), this, SIGNAL(newSubTask(QString)) );
+        connect( d->broadcastJob, SIGNAL(newSubTask(QString)), this, SIGNAL(newSubTask(QString)) );
+        connect( d->broadcastJob, SIGNAL(percent(int)), this, SLOT(slotBroadcastProgress(int)) );
+        connect( d->broadcastJob, SIGNAL(subPercent(int)), this, SIGNAL(subPercent(int)) );
+        connect( d->broadcastJob, SIGNAL(bufferStatus(int)), this, SIGNAL(bufferStatus(int)) );
+        connect( d->broadcastJob, SIGNAL(burning(bool)), this, SIGNAL(burning(bool)) );
+        connect( d->broadcastJob, SIGNAL(finished(bool)), this, SLOT(slotBroadcastFinished(bool)) );
+        connect( d->broadcastJob, SIGNAL(debuggingOutput(QString,QString)),
+                 this, SIGNAL(debuggingOutput(QString,QString)) );
+    }
+
+    d->broadcastJob->setBurnDevices( QList<K3b::Device::Device*>() << m_writerDevice << m_additionalWriters );
+    d->broadcastJob->setImagePath( m_imagePath );
+    d->broadcastJob->setSpeed( m_speed );
+    d->broadcastJob->setWritingMode( m_writingMode );
+    d->broadcastJob->setWritingApp( d->usedWritingApp );
+    d->broadcastJob->setSimulate( m_simulate );
+    d->broadcastJob->setVerifyData( d->verifyData );
+
+    if( m_copies > 1 )
+        emit newTask( i18n("Writing copy %1",d->doneCopies+1) );
+    else
+        emit newTask( i18n("Writing copy") );
+
+    d->writerRunning = true;
+    d->broadcastJob->start();
+}
+
+
+void K3b::DvdCopyJob::slotBroadcastProgress( int p )
+{
+    // the broadcast job includes the verification
+    int bigParts = ( m_simulate ? 1 : m_copies ) + 1;
+    emit percent( 100*(d->doneCopies+1)/bigParts + p/bigParts );
+}
+
+
+void K3b::DvdCopyJob::slotBroadcastFinished( bool success )
+{
+    d->writerRunning = false;
+
+    if( !success )
+        d->broadcastFailed = true;
+
+    // already finished?
+    if( !d->running )
+        return;
+
+    if( d->canceled ) {
+        if( m_removeImageFiles )
+            removeImageFiles();
+        emit canceled();
+        jobFinished(false);
+        d->running = false;
+    }
+    // a failed device does not stop the others from writing the remaining copies
+    else if( !m_simulate && d->broadcastJob->succeededDevices() > 0 && ++d->doneCopies < m_copies ) {
+        // make room for the next set of media
+        if( !k3bcore->globalSettings()->ejectMedia() ) {
+            Q_FOREACH( K3b::Device::Device* dev, d->broadcastJob->burnDevices() ) {
+                if( !K3b::eject( dev ) )
+                    blockingInformation( i18n("K3b was unable to eject the written medium. Please do so manually.") );
+            }
+        }
+
+        startBroadcastWriting();
+    }
     else {
         if( m_removeImageFiles )
             removeImageFiles();
@@ -959,9 +1062,15 @@ QString K3b::DvdCopyJob::jobDescription() const
 
 QString K3b::DvdCopyJob::jobDetails() const
 {
-    return i18np("Creating 1 copy",
-                 "Creating %1 copies",
-                 (m_simulate||m_onlyCreateImage) ? 1 : m_copies );
+    const int copies = (m_simulate||m_onlyCreateImage) ? 1 : m_copies;
+    if( !m_onlyCreateImage && !m_additionalWriters.isEmpty() )
+        return i18np("Creating 1 copy on %2 devices",
+                     "Creating %1 copies on %2 devices",
+                     copies, m_additionalWriters.count()+1 );
+    else
+        return i18np("Creating 1 copy",
+                     "Creating %1 copies",
+                     copies );
 }
 
 
@@ -18,6 +18,7 @@
 
 #include "k3bjob.h"
 #include "k3b_export.h"
+#include <QList>
 #include <QString>
 
 
@@ -63,6 +64,13 @@ namespace K3b {
         void setReadRetries( int i ) { m_readRetries = i; }
         void setVerifyData( bool b );
 
+        /**
+         * Write every copy to these devices at the same time as to the
+         * writer device. This needs an image, on-the-fly copying is
+         * disabled if any are set.
+         */
+        void setAdditionalWriterDevices( const QList<K3b::Device::Device*>& devs ) { m_additionalWriters = devs; }
+
     private Q_SLOTS:
         void slotDiskInfoReady( K3b::Device::DeviceHandler* );
         void slotReaderProgress( int );
@@ -72,15 +80,19 @@ namespace K3b {
         void slotWriterFinished( bool );
         void slotVerificationFinished( bool );
         void slotVerificationProgress( int p );
+        void slotBroadcastProgress( int p );
+        void slotBroadcastFinished( bool );
 
     private:
         bool waitForDvd();
         void prepareReader();
         void prepareWriter();
+        void startBroadcastWriting();
         void removeImageFiles();
 
         Device::Device* m_writerDevice;
         Device::Device* m_readerDevice;
+        QList<Device::Device*> m_additionalWriters;
         QString m_imagePath;
 
         bool m_onTheFly;
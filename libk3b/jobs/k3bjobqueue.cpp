@@ -0,0 +1,975 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bjobqueue.h"
+
+#include "k3bbinimagewritingjob.h"
+#include "k3bblankingjob.h"
+#include "k3bcdcopyjob.h"
+#include "k3bcore.h"
+#include "k3bdevice.h"
+#include "k3bdevicehandler.h"
+#include "k3bdevicemanager.h"
+#include "k3bdiskinfo.h"
+#include "k3bdvdcopyjob.h"
+#include "k3bdvdformattingjob.h"
+#include "k3biso9660imagewritingjob.h"
+#include "k3bjob.h"
+#include "k3bmediacache.h"
+#include "k3b_i18n.h"
+
+#include <KConfigCore/KConfig>
+#include <KConfigCore/KConfigGroup>
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QScopedPointer>
+#include <QSet>
+#include <QStandardPaths>
+#include <QUuid>
+
+#include <algorithm>
+
+
+namespace {
+    const char s_defaultQueueFile[] = "k3bjobqueue";
+
+    bool optionEnabled( const K3b::QueuedJob& entry, const char* name, bool def = false )
+    {
+        const QString value = entry.options.value( QLatin1String( name ) );
+        if( value.isEmpty() )
+            return def;
+        return( value == QLatin1String( "true" ) || value == QLatin1String( "1" ) );
+    }
+
+
+    class DefaultJobQueueDevices : public K3b::JobQueueDevices
+    {
+    public:
+        explicit DefaultJobQueueDevices( QObject* parent )
+            : K3b::JobQueueDevices( parent ) {
+            connect( k3bcore->mediaCache(), SIGNAL(mediumChanged(K3b::Device::Device*)),
+                     this, SIGNAL(changed()) );
+            // devices used by interactive jobs become available again
+            connect( k3bcore, SIGNAL(jobFinished(K3b::Job*)),
+                     this, SIGNAL(changed()) );
+        }
+
+        QStringList devices() const {
+            QStringList names;
+            Q_FOREACH( K3b::Device::Device* dev, k3bcore->deviceManager()->allDevices() )
+                names.append( dev->blockDeviceName() );
+            return names;
+        }
+
+        bool canWrite( const QString& name ) const {
+            K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( name );
+            return( dev && dev->burner() );
+        }
+
+        bool isAvailable( const QString& name ) const {
+            K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( name );
+            if( !dev || k3bcore->deviceBlocked( dev ) )
+                return false;
+
+            // interactive burn jobs do not block their writer
+            Q_FOREACH( K3b::Job* job, k3bcore->runningJobs() ) {
+                K3b::BurnJob* burnJob = qobject_cast<K3b::BurnJob*>( job );
+                if( burnJob && burnJob->writer() == dev )
+                    return false;
+            }
+            return true;
+        }
+
+        K3b::Device::MediaType mediaType( const QString& name ) const {
+            if( K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( name ) )
+                return k3bcore->mediaCache()->diskInfo( dev ).mediaType();
+            return K3b::Device::MEDIA_UNKNOWN;
+        }
+
+        K3b::Device::MediaState mediaState( const QString& name ) const {
+            if( K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( name ) )
+                return k3bcore->mediaCache()->diskInfo( dev ).diskState();
+            return K3b::Device::STATE_UNKNOWN;
+        }
+
+        qint64 freeSpace( const QString& name ) const {
+            K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( name );
+            if( !dev )
+                return -1;
+
+            const K3b::Device::DiskInfo info = k3bcore->mediaCache()->diskInfo( dev );
+            if( info.diskState() == K3b::Device::STATE_EMPTY || info.appendable() )
+                return qint64( info.remainingSize().mode1Bytes() );
+            else if( info.rewritable() )
+                return qint64( info.capacity().mode1Bytes() );
+            else
+                return 0;
+        }
+
+        qint64 usedSpace( const QString& name ) const {
+            if( K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( name ) )
+                return qint64( k3bcore->mediaCache()->diskInfo( dev ).size().mode1Bytes() );
+            return -1;
+        }
+
+        void eject( const QString& name ) {
+            if( K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( name ) )
+                K3b::Device::eject( dev );
+        }
+    };
+
+
+    class DefaultJobQueueFactory : public K3b::JobQueueFactory
+    {
+    public:
+        K3b::Job* createJob( K3b::QueuedJob& entry, const QString& device, K3b::JobHandler* handler, QObject* parent ) {
+            K3b::Device::Device* dev = k3bcore->deviceManager()->findDevice( device );
+            if( !dev )
+                return 0;
+
+            const int speed = entry.options.value( QLatin1String( "speed" ) ).toInt();
+            const bool simulate = optionEnabled( entry, "simulate" );
+
+            switch( entry.type ) {
+            case K3b::QueuedJob::Burn: {
+                const QFileInfo info( entry.source );
+                if( !info.isFile() )
+                    return 0;
+
+                const QString suffix = info.suffix().toLower();
+                if( suffix == QLatin1String( "k3b" ) ) {
+                    // project files need the application's project manager
+                    return 0;
+                }
+                if( suffix == QLatin1String( "cue" ) || suffix == QLatin1String( "toc" ) ) {
+                    K3b::BinImageWritingJob* job = new K3b::BinImageWritingJob( handler, parent );
+                    job->setWriter( dev );
+                    job->setTocFile( entry.source );
+                    job->setSpeed( speed );
+                    job->setSimulate( simulate );
+                    return job;
+                }
+                else {
+                    K3b::Iso9660ImageWritingJob* job = new K3b::Iso9660ImageWritingJob( handler );
+                    job->setParent( parent );
+                    job->setBurnDevice( dev );
+                    job->setImagePath( entry.source );
+                    job->setSpeed( speed );
+                    job->setSimulate( simulate );
+                    job->setVerifyData( optionEnabled( entry, "verify" ) );
+                    return job;
+                }
+            }
+
+            case K3b::QueuedJob::Copy: {
+                K3b::Device::Device* reader = k3bcore->deviceManager()->findDevice( entry.source );
+                if( !reader )
+                    return 0;
+
+                const bool onTheFly = optionEnabled( entry, "onTheFly", true );
+                if( K3b::Device::isCdMedia( k3bcore->mediaCache()->diskInfo( reader ).mediaType() ) ) {
+                    K3b::CdCopyJob* job = new K3b::CdCopyJob( handler, parent );
+                    job->setReaderDevice( reader );
+                    job->setWriterDevice( dev );
+                    job->setSpeed( speed );
+                    job->setSimulate( simulate );
+                    job->setOnTheFly( onTheFly );
+                    return job;
+                }
+                else {
+                    K3b::DvdCopyJob* job = new K3b::DvdCopyJob( handler, parent );
+                    job->setReaderDevice( reader );
+                    job->setWriterDevice( dev );
+                    job->setWriteSpeed( speed );
+                    job->setSimulate( simulate );
+                    job->setOnTheFly( onTheFly );
+                    job->setVerifyData( optionEnabled( entry, "verify" ) );
+                    return job;
+                }
+            }
+
+            case K3b::QueuedJob::Format: {
+                const K3b::FormattingMode mode = optionEnabled( entry, "complete" )
+                                                 ? K3b::FormattingComplete
+                                                 : K3b::FormattingQuick;
+                if( K3b::Device::isDvdMedia( k3bcore->mediaCache()->diskInfo( dev ).mediaType() ) ) {
+                    K3b::DvdFormattingJob* job = new K3b::DvdFormattingJob( handler, parent );
+                    job->setDevice( dev );
+                    job->setFormattingMode( mode );
+                    job->setForce( true );
+                    return job;
+                }
+                else {
+                    K3b::BlankingJob* job = new K3b::BlankingJob( handler, parent );
+                    job->setDevice( dev );
+                    job->setFormattingMode( mode );
+                    job->setSpeed( speed );
+                    job->setForce( true );
+                    return job;
+                }
+            }
+
+            case K3b::QueuedJob::Rip:
+                // ripping needs the application's encoder setup
+                return 0;
+            }
+
+            return 0;
+        }
+    };
+
+    Q_GLOBAL_STATIC( DefaultJobQueueFactory, s_defaultFactory )
+}
+
+
+K3b::QueuedJob::QueuedJob()
+    : type( Burn ),
+      priority( 0 ),
+      mediaTypes( Device::MEDIA_WRITABLE ),
+      mediaStates( Device::STATE_EMPTY ),
+      size( 0 ),
+      state( Pending )
+{
+}
+
+
+K3b::QueuedJob::QueuedJob( Type t, const QString& s )
+    : type( t ),
+      source( s ),
+      priority( 0 ),
+      mediaTypes( Device::MEDIA_WRITABLE ),
+      mediaStates( Device::STATE_EMPTY ),
+      size( 0 ),
+      state( Pending )
+{
+    switch( type ) {
+    case Burn:
+    case Copy:
+        break;
+    case Rip:
+        mediaTypes = Device::MEDIA_ALL;
+        mediaStates = Device::STATE_COMPLETE|Device::STATE_INCOMPLETE;
+        break;
+    case Format:
+        mediaTypes = Device::MEDIA_REWRITABLE;
+        mediaStates = Device::STATE_ALL;
+        break;
+    }
+}
+
+
+
+K3b::JobQueueDevices::JobQueueDevices( QObject* parent )
+    : QObject( parent )
+{
+}
+
+
+K3b::JobQueueDevices::~JobQueueDevices()
+{
+}
+
+
+bool K3b::JobQueueDevices::canWrite( const QString& ) const
+{
+    return true;
+}
+
+
+qint64 K3b::JobQueueDevices::freeSpace( const QString& ) const
+{
+    return -1;
+}
+
+
+qint64 K3b::JobQueueDevices::usedSpace( const QString& ) const
+{
+    return -1;
+}
+
+
+bool K3b::JobQueueDevices::reserve( const QString& )
+{
+    return true;
+}
+
+
+void K3b::JobQueueDevices::release( const QString& )
+{
+}
+
+
+void K3b::JobQueueDevices::eject( const QString& )
+{
+}
+
+
+K3b::JobQueueDevices* K3b::JobQueueDevices::createDefault( QObject* parent )
+{
+    return new DefaultJobQueueDevices( parent );
+}
+
+
+K3b::JobQueueFactory* K3b::JobQueueFactory::defaultFactory()
+{
+    return s_defaultFactory;
+}
+
+
+
+class K3b::JobQueue::Private
+{
+public:
+    Private()
+        : devices( 0 ),
+          ownDevices( 0 ),
+          factory( 0 ),
+          queueFile( QLatin1String( s_defaultQueueFile ) ),
+          defaultAnswer( true ),
+          running( false ),
+          scheduling( false ),
+          rescheduleRequested( false ) {
+    }
+
+    int indexOf( const QString& id ) const {
+        for( int i = 0; i < entries.count(); ++i )
+            if( entries[i].id == id )
+                return i;
+        return -1;
+    }
+
+    bool deviceBusy( const QString& dev ) const {
+        return busyDevices.contains( dev );
+    }
+
+    bool mediumMatches( const QString& dev, Device::MediaTypes types, Device::MediaStates states ) const {
+        return( ( types & devices->mediaType( dev ) ) &&
+                ( states & devices->mediaState( dev ) ) );
+    }
+
+    bool enoughSpace( const QString& dev, qint64 size ) const {
+        if( size <= 0 )
+            return true;
+        const qint64 free = devices->freeSpace( dev );
+        return( free < 0 || free >= size );
+    }
+
+    /**
+     * \return The device \p entry can be started on or an empty string.
+     */
+    QString findDevice( const QueuedJob& entry ) const;
+
+    KConfig* openConfig() const {
+        return new KConfig( queueFile, KConfig::SimpleConfig, QStandardPaths::AppDataLocation );
+    }
+
+    void load();
+    void save();
+
+    JobQueueDevices* devices;
+    JobQueueDevices* ownDevices;
+    JobQueueFactory* factory;
+    QString queueFile;
+    bool defaultAnswer;
+
+    QList<QueuedJob> entries;
+    QHash<QString, Job*> jobs;
+    QSet<QString> busyDevices;
+
+    bool running;
+    bool scheduling;
+    bool rescheduleRequested;
+};
+
+
+QString K3b::JobQueue::Private::findDevice( const QueuedJob& entry ) const
+{
+    // formatting and ripping do not write to the medium
+    qint64 size = ( entry.type == QueuedJob::Format || entry.type == QueuedJob::Rip ? 0 : entry.size );
+
+    if( entry.type == QueuedJob::Copy ) {
+        // the source has to be ready, too
+        if( deviceBusy( entry.source ) ||
+            !devices->isAvailable( entry.source ) ||
+            !mediumMatches( entry.source, Device::MEDIA_ALL, Device::STATE_COMPLETE|Device::STATE_INCOMPLETE ) )
+            return QString();
+        if( size <= 0 )
+            size = devices->usedSpace( entry.source );
+    }
+
+    const bool needsWriter = ( entry.type != QueuedJob::Rip );
+
+    Q_FOREACH( const QString& dev, devices->devices() ) {
+        if( deviceBusy( dev ) )
+            continue;
+        if( !entry.devices.isEmpty() && !entry.devices.contains( dev ) )
+            continue;
+        if( entry.type == QueuedJob::Copy && dev == entry.source )
+            continue;
+        if( needsWriter && !devices->canWrite( dev ) )
+            continue;
+        if( !devices->isAvailable( dev ) )
+            continue;
+        if( !mediumMatches( dev, entry.mediaTypes, entry.mediaStates ) )
+            continue;
+        if( !enoughSpace( dev, size ) )
+            continue;
+        return dev;
+    }
+
+    return QString();
+}
+
+
+void K3b::JobQueue::Private::load()
+{
+    entries.clear();
+
+    QScopedPointer<KConfig> c( openConfig() );
+    QStringList groups = c->groupList();
+    groups.sort();
+
+    Q_FOREACH( const QString& name, groups ) {
+        KConfigGroup grp = c->group( name );
+
+        QueuedJob e;
+        e.id = grp.readEntry( "id", QString() );
+        if( e.id.isEmpty() )
+            continue;
+        e.type = QueuedJob::Type( grp.readEntry( "type", int( QueuedJob::Burn ) ) );
+        e.source = grp.readEntry( "source", QString() );
+        e.priority = grp.readEntry( "priority", 0 );
+        e.mediaTypes = Device::MediaTypes( grp.readEntry( "media types", int( Device::MEDIA_WRITABLE ) ) );
+        e.mediaStates = Device::MediaStates( grp.readEntry( "media states", int( Device::STATE_EMPTY ) ) );
+        e.size = grp.readEntry( "size", qint64( 0 ) );
+        e.devices = grp.readEntry( "devices", QStringList() );
+        e.state = QueuedJob::State( grp.readEntry( "state", int( QueuedJob::Pending ) ) );
+        e.device = grp.readEntry( "device", QString() );
+        e.submitted = grp.readEntry( "submitted", QDateTime() );
+        e.started = grp.readEntry( "started", QDateTime() );
+        e.finished = grp.readEntry( "finished", QDateTime() );
+        e.lastError = grp.readEntry( "last error", QString() );
+
+        KConfigGroup optionGrp = grp.group( "Options" );
+        const QMap<QString, QString> options = optionGrp.entryMap();
+        for( QMap<QString, QString>::const_iterator it = options.constBegin(); it != options.constEnd(); ++it )
+            e.options.insert( it.key(), it.value() );
+
+        // K3b quit while the job was running
+        if( e.state == QueuedJob::Running ) {
+            qDebug() << "(K3b::JobQueue) requeuing interrupted entry" << e.id;
+            e.state = QueuedJob::Pending;
+            e.device.clear();
+        }
+
+        entries.append( e );
+    }
+
+    qDebug() << "(K3b::JobQueue) loaded" << entries.count() << "entries from" << queueFile;
+}
+
+
+void K3b::JobQueue::Private::save()
+{
+    QScopedPointer<KConfig> c( openConfig() );
+    Q_FOREACH( const QString& name, c->groupList() )
+        c->deleteGroup( name );
+
+    for( int i = 0; i < entries.count(); ++i ) {
+        const QueuedJob& e = entries[i];
+
+        // the group names keep the order
+        KConfigGroup grp = c->group( QString::fromLatin1( "Entry %1" ).arg( i, 5, 10, QLatin1Char( '0' ) ) );
+        grp.writeEntry( "id", e.id );
+        grp.writeEntry( "type", int( e.type ) );
+        grp.writeEntry( "source", e.source );
+        grp.writeEntry( "priority", e.priority );
+        grp.writeEntry( "media types", int( e.mediaTypes ) );
+        grp.writeEntry( "media states", int( e.mediaStates ) );
+        grp.writeEntry( "size", e.size );
+        grp.writeEntry( "devices", e.devices );
+        grp.writeEntry( "state", int( e.state ) );
+        grp.writeEntry( "device", e.device );
+        grp.writeEntry( "submitted", e.submitted );
+        grp.writeEntry( "started", e.started );
+        grp.writeEntry( "finished", e.finished );
+        grp.writeEntry( "last error", e.lastError );
+
+        KConfigGroup optionGrp = grp.group( "Options" );
+        for( QMap<QString, QString>::const_iterator it = e.options.constBegin(); it != e.options.constEnd(); ++it )
+            optionGrp.writeEntry( it.key(), it.value() );
+    }
+
+    c->sync();
+}
+
+
+
+K3b::JobQueue::JobQueue( QObject* parent )
+    : QObject( parent ),
+      d( new Private() )
+{
+    d->factory = JobQueueFactory::defaultFactory();
+    d->load();
+}
+
+
+K3b::JobQueue::~JobQueue()
+{
+    // running jobs are requeued on the next start
+    d->save();
+    delete d;
+}
+
+
+void K3b::JobQueue::setDevices( JobQueueDevices* devices )
+{
+    if( d->devices )
+        disconnect( d->devices, SIGNAL(changed()), this, SLOT(schedule()) );
+
+    d->devices = devices;
+
+    if( d->devices )
+        connect( d->devices, SIGNAL(changed()), this, SLOT(schedule()) );
+}
+
+
+K3b::JobQueueDevices* K3b::JobQueue::devices() const
+{
+    return d->devices;
+}
+
+
+void K3b::JobQueue::setJobFactory( JobQueueFactory* factory )
+{
+    d->factory = factory ? factory : JobQueueFactory::defaultFactory();
+}
+
+
+void K3b::JobQueue::setQueueFile( const QString& filename )
+{
+    if( d->queueFile != filename ) {
+        d->queueFile = filename;
+        d->load();
+        emit statisticsChanged();
+        schedule();
+    }
+}
+
+
+QString K3b::JobQueue::queueFile() const
+{
+    return d->queueFile;
+}
+
+
+void K3b::JobQueue::setDefaultAnswer( bool yes )
+{
+    d->defaultAnswer = yes;
+}
+
+
+QList<K3b::QueuedJob> K3b::JobQueue::entries() const
+{
+    return d->entries;
+}
+
+
+K3b::QueuedJob K3b::JobQueue::entry( const QString& id ) const
+{
+    const int i = d->indexOf( id );
+    return i >= 0 ? d->entries[i] : QueuedJob();
+}
+
+
+K3b::Job* K3b::JobQueue::job( const QString& id ) const
+{
+    return d->jobs.value( id );
+}
+
+
+bool K3b::JobQueue::isRunning() const
+{
+    return d->running;
+}
+
+
+int K3b::JobQueue::queueDepth() const
+{
+    int n = 0;
+    Q_FOREACH( const QueuedJob& e, d->entries )
+        if( e.state == QueuedJob::Pending )
+            ++n;
+    return n;
+}
+
+
+int K3b::JobQueue::runningCount() const
+{
+    return d->jobs.count();
+}
+
+
+double K3b::JobQueue::throughput() const
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime windowStart = now.addSecs( -3600 );
+
+    qint64 bytes = 0;
+    QDateTime first = now;
+    Q_FOREACH( const QueuedJob& e, d->entries ) {
+        if( e.state == QueuedJob::Finished && e.finished >= windowStart ) {
+            bytes += e.size;
+            first = qMin( first, qMax( e.started, windowStart ) );
+        }
+    }
+
+    const qint64 msecs = qMax( qint64( 1000 ), first.msecsTo( now ) );
+    return double( bytes ) * 1000.0 / double( msecs );
+}
+
+
+int K3b::JobQueue::finishedLastHour() const
+{
+    const QDateTime windowStart = QDateTime::currentDateTime().addSecs( -3600 );
+    int n = 0;
+    Q_FOREACH( const QueuedJob& e, d->entries )
+        if( e.state == QueuedJob::Finished && e.finished >= windowStart )
+            ++n;
+    return n;
+}
+
+
+QString K3b::JobQueue::submit( const K3b::QueuedJob& entry )
+{
+    QueuedJob e( entry );
+    e.id = QUuid::createUuid().toString();
+    e.state = QueuedJob::Pending;
+    e.device.clear();
+    e.submitted = QDateTime::currentDateTime();
+    e.started = e.finished = QDateTime();
+    e.lastError.clear();
+
+    // project files are sized by the factory
+    if( e.size <= 0 && e.type == QueuedJob::Burn &&
+        !e.source.endsWith( QLatin1String( ".k3b" ), Qt::CaseInsensitive ) )
+        e.size = QFileInfo( e.source ).size();
+
+    d->entries.append( e );
+    d->save();
+
+    emit entryAdded( e.id );
+    emit statisticsChanged();
+
+    schedule();
+
+    return e.id;
+}
+
+
+void K3b::JobQueue::cancel( const QString& id )
+{
+    if( Job* job = d->jobs.value( id ) ) {
+        // slotJobFinished does the rest
+        job->cancel();
+        return;
+    }
+
+    const int i = d->indexOf( id );
+    if( i >= 0 && d->entries[i].state == QueuedJob::Pending ) {
+        d->entries[i].state = QueuedJob::Canceled;
+        d->save();
+        emit entryChanged( id );
+        emit statisticsChanged();
+    }
+}
+
+
+bool K3b::JobQueue::remove( const QString& id )
+{
+    const int i = d->indexOf( id );
+    if( i < 0 || d->entries[i].state == QueuedJob::Running )
+        return false;
+
+    d->entries.removeAt( i );
+    d->save();
+    emit entryRemoved( id );
+    emit statisticsChanged();
+    return true;
+}
+
+
+void K3b::JobQueue::clearFinished()
+{
+    QStringList removed;
+    for( int i = d->entries.count() - 1; i >= 0; --i ) {
+        if( d->entries[i].isDone() ) {
+            removed.prepend( d->entries[i].id );
+            d->entries.removeAt( i );
+        }
+    }
+
+    if( !removed.isEmpty() ) {
+        d->save();
+        Q_FOREACH( const QString& id, removed )
+            emit entryRemoved( id );
+        emit statisticsChanged();
+    }
+}
+
+
+bool K3b::JobQueue::retry( const QString& id )
+{
+    const int i = d->indexOf( id );
+    if( i < 0 ||
+        ( d->entries[i].state != QueuedJob::Failed &&
+          d->entries[i].state != QueuedJob::Canceled ) )
+        return false;
+
+    d->entries[i].state = QueuedJob::Pending;
+    d->entries[i].device.clear();
+    d->save();
+    emit entryChanged( id );
+    emit statisticsChanged();
+
+    schedule();
+    return true;
+}
+
+
+void K3b::JobQueue::setPriority( const QString& id, int priority )
+{
+    const int i = d->indexOf( id );
+    if( i >= 0 && d->entries[i].priority != priority ) {
+        d->entries[i].priority = priority;
+        d->save();
+        emit entryChanged( id );
+        schedule();
+    }
+}
+
+
+void K3b::JobQueue::start()
+{
+    if( !d->devices ) {
+        d->ownDevices = JobQueueDevices::createDefault( this );
+        setDevices( d->ownDevices );
+    }
+
+    d->running = true;
+    schedule();
+}
+
+
+void K3b::JobQueue::pause()
+{
+    d->running = false;
+}
+
+
+void K3b::JobQueue::schedule()
+{
+    if( !d->running || !d->devices )
+        return;
+
+    // starting a job may enter an event loop
+    if( d->scheduling ) {
+        d->rescheduleRequested = true;
+        return;
+    }
+
+    d->scheduling = true;
+
+    do {
+        d->rescheduleRequested = false;
+
+        // highest priority first, oldest first within one priority
+        QList<int> pending;
+        for( int i = 0; i < d->entries.count(); ++i )
+            if( d->entries[i].state == QueuedJob::Pending )
+                pending.append( i );
+        std::stable_sort( pending.begin(), pending.end(), [this]( int a, int b ) {
+                return d->entries[a].priority > d->entries[b].priority;
+            } );
+
+        QStringList toStart;
+        Q_FOREACH( int i, pending )
+            toStart.append( d->entries[i].id );
+
+        Q_FOREACH( const QString& id, toStart ) {
+            const int i = d->indexOf( id );
+            if( i < 0 || d->entries[i].state != QueuedJob::Pending )
+                continue;
+
+            const QString dev = d->findDevice( d->entries[i] );
+            if( dev.isEmpty() )
+                continue;
+
+            QueuedJob& e = d->entries[i];
+
+            // the amount of data for the throughput statistics
+            if( e.size <= 0 ) {
+                if( e.type == QueuedJob::Copy )
+                    e.size = qMax( qint64( 0 ), d->devices->usedSpace( e.source ) );
+                else if( e.type == QueuedJob::Rip )
+                    e.size = qMax( qint64( 0 ), d->devices->usedSpace( dev ) );
+            }
+
+            if( !d->devices->reserve( dev ) )
+                continue;
+            if( e.type == QueuedJob::Copy && !d->devices->reserve( e.source ) ) {
+                d->devices->release( dev );
+                continue;
+            }
+
+            Job* job = d->factory->createJob( e, dev, this, this );
+            if( !job ) {
+                d->devices->release( dev );
+                if( e.type == QueuedJob::Copy )
+                    d->devices->release( e.source );
+                e.state = QueuedJob::Failed;
+                e.lastError = i18n("Unsupported job.");
+                d->save();
+                emit entryChanged( id );
+                emit statisticsChanged();
+                continue;
+            }
+
+            qDebug() << "(K3b::JobQueue) starting" << id << "on" << dev;
+
+            d->busyDevices.insert( dev );
+            if( e.type == QueuedJob::Copy )
+                d->busyDevices.insert( e.source );
+
+            e.state = QueuedJob::Running;
+            e.device = dev;
+            e.started = QDateTime::currentDateTime();
+            e.lastError.clear();
+            d->jobs.insert( id, job );
+            d->save();
+
+            connect( job, SIGNAL(infoMessage(QString,int)), this, SLOT(slotJobInfoMessage(QString,int)) );
+            connect( job, SIGNAL(finished(bool)), this, SLOT(slotJobFinished(bool)) );
+
+            emit entryChanged( id );
+            emit statisticsChanged();
+            emit jobStarted( id, job );
+
+            job->start();
+        }
+    } while( d->rescheduleRequested && d->running );
+
+    d->scheduling = false;
+}
+
+
+void K3b::JobQueue::slotJobInfoMessage( const QString& message, int type )
+{
+    Job* job = qobject_cast<Job*>( sender() );
+    const QString id = d->jobs.key( job );
+    if( id.isEmpty() )
+        return;
+
+    if( type == Job::MessageError ) {
+        const int i = d->indexOf( id );
+        if( i >= 0 )
+            d->entries[i].lastError = message;
+    }
+
+    emit infoMessage( id, message, type );
+}
+
+
+void K3b::JobQueue::slotJobFinished( bool success )
+{
+    Job* job = qobject_cast<Job*>( sender() );
+    const QString id = d->jobs.key( job );
+    if( id.isEmpty() )
+        return;
+
+    d->jobs.remove( id );
+    job->deleteLater();
+
+    const int i = d->indexOf( id );
+    if( i >= 0 ) {
+        QueuedJob& e = d->entries[i];
+        if( success )
+            e.state = QueuedJob::Finished;
+        else if( job->hasBeenCanceled() )
+            e.state = QueuedJob::Canceled;
+        else
+            e.state = QueuedJob::Failed;
+        e.finished = QDateTime::currentDateTime();
+
+        qDebug() << "(K3b::JobQueue)" << id << "finished on" << e.device << "with state" << e.state;
+
+        d->busyDevices.remove( e.device );
+        d->devices->release( e.device );
+        if( e.type == QueuedJob::Copy ) {
+            d->busyDevices.remove( e.source );
+            d->devices->release( e.source );
+        }
+
+        // make room for the next medium
+        if( e.state != QueuedJob::Canceled ) {
+            d->devices->eject( e.device );
+            if( e.type == QueuedJob::Copy )
+                d->devices->eject( e.source );
+        }
+
+        d->save();
+        emit entryChanged( id );
+    }
+
+    emit statisticsChanged();
+
+    schedule();
+}
+
+
+K3b::Device::MediaType K3b::JobQueue::waitForMedium( Device::Device* dev,
+                                                     Device::MediaStates mediaState,
+                                                     Device::MediaTypes mediaType,
+                                                     const K3b::Msf& minMediaSize,
+                                                     const QString& )
+{
+    // entries are only started with a suitable medium, there is nobody to insert another one
+    if( d->devices && dev ) {
+        const QString name = dev->blockDeviceName();
+        if( d->mediumMatches( name, mediaType, mediaState ) &&
+            d->enoughSpace( name, qint64( minMediaSize.mode1Bytes() ) ) )
+            return d->devices->mediaType( name );
+    }
+
+    qDebug() << "(K3b::JobQueue) no suitable medium in" << ( dev ? dev->blockDeviceName() : QString() );
+    return Device::MEDIA_UNKNOWN;
+}
+
+
+bool K3b::JobQueue::questionYesNo( const QString& text,
+                                   const QString&,
+                                   const KGuiItem&,
+                                   const KGuiItem& )
+{
+    qDebug() << "(K3b::JobQueue) answering" << text << "with" << d->defaultAnswer;
+    return d->defaultAnswer;
+}
+
+
+void K3b::JobQueue::blockingInformation( const QString& text, const QString& )
+{
+    qDebug() << "(K3b::JobQueue)" << text;
+}
+
+#include "moc_k3bjobqueue.cpp"
@@ -0,0 +1,391 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_JOB_QUEUE_H_
+#define _K3B_JOB_QUEUE_H_
+
+#include "k3bjobhandler.h"
+#include "k3bdevicetypes.h"
+#include "k3b_export.h"
+
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+namespace K3b {
+    class Job;
+
+    /**
+     * One entry in the JobQueue.
+     *
+     * Devices are referenced by their block device name which makes
+     * entries easy to persist.
+     */
+    class LIBK3B_EXPORT QueuedJob
+    {
+    public:
+        enum Type {
+            Burn,   /**< Write an image or a project file */
+            Copy,   /**< Copy the medium in the source device */
+            Rip,    /**< Read the medium, the target device is the reader */
+            Format  /**< Format or blank a rewritable medium */
+        };
+
+        enum State {
+            Pending,
+            Running,
+            Finished,
+            Failed,
+            Canceled
+        };
+
+        QueuedJob();
+
+        /**
+         * Sets the medium requirements to sensible defaults for \p type.
+         */
+        QueuedJob( Type type, const QString& source );
+
+        /**
+         * Unique id assigned by JobQueue::submit().
+         */
+        QString id;
+
+        Type type;
+
+        /**
+         * The project file or image path. The source device for Copy.
+         */
+        QString source;
+
+        /**
+         * Entries with a higher priority are started first.
+         */
+        int priority;
+
+        /**
+         * The medium the target device needs to contain for the job
+         * to be started.
+         */
+        Device::MediaTypes mediaTypes;
+        Device::MediaStates mediaStates;
+
+        /**
+         * The amount of data the job writes in bytes. Entries are only
+         * started on media with enough free space. Used for the
+         * throughput statistics. Copy and Rip entries without a size
+         * get the size of the medium they read once they are started.
+         * The JobQueueFactory may fill it in for project files.
+         */
+        qint64 size;
+
+        /**
+         * Only use these target devices. Any device if empty.
+         */
+        QStringList devices;
+
+        /**
+         * Job specific settings like "speed", "simulate", or "verify"
+         * which are interpreted by the JobQueueFactory.
+         */
+        QMap<QString, QString> options;
+
+        State state;
+
+        /**
+         * The target device the job is or was running on.
+         */
+        QString device;
+
+        QDateTime submitted;
+        QDateTime started;
+        QDateTime finished;
+
+        /**
+         * The last error message the job reported.
+         */
+        QString lastError;
+
+        bool isDone() const { return state == Finished || state == Failed || state == Canceled; }
+    };
+
+
+    /**
+     * The devices the JobQueue schedules on.
+     *
+     * The default implementation uses the burners from the device manager and
+     * the media cache. Tests and special setups can provide their own.
+     */
+    class LIBK3B_EXPORT JobQueueDevices : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit JobQueueDevices( QObject* parent = 0 );
+        virtual ~JobQueueDevices();
+
+        /**
+         * The block device names of all devices jobs can run on.
+         */
+        virtual QStringList devices() const = 0;
+
+        /**
+         * \return false if the device is in use outside of the queue.
+         */
+        virtual bool isAvailable( const QString& dev ) const = 0;
+
+        /**
+         * \return true if the device can write media. Only Rip entries
+         *         are started on devices which cannot. The default
+         *         implementation returns true.
+         */
+        virtual bool canWrite( const QString& dev ) const;
+
+        virtual Device::MediaType mediaType( const QString& dev ) const = 0;
+        virtual Device::MediaState mediaState( const QString& dev ) const = 0;
+
+        /**
+         * The number of bytes which can be written to the medium in \p dev,
+         * including space which is freed by blanking or overwriting it.
+         *
+         * \return -1 if unknown. The default implementation returns -1.
+         */
+        virtual qint64 freeSpace( const QString& dev ) const;
+
+        /**
+         * The number of bytes of data on the medium in \p dev.
+         *
+         * \return -1 if unknown. The default implementation returns -1.
+         */
+        virtual qint64 usedSpace( const QString& dev ) const;
+
+        /**
+         * Reserve the device for a queued job. The queue keeps track of the
+         * devices its jobs use itself, this is only needed for additional
+         * locking outside of K3b. The jobs block their devices in the Core
+         * while writing. The default implementation does nothing.
+         */
+        virtual bool reserve( const QString& dev );
+        virtual void release( const QString& dev );
+
+        /**
+         * Called once a job finished to make room for the next medium.
+         */
+        virtual void eject( const QString& dev );
+
+        /**
+         * The default implementation based on the device manager and the media cache.
+         */
+        static JobQueueDevices* createDefault( QObject* parent = 0 );
+
+    Q_SIGNALS:
+        /**
+         * Emitted when a medium or the availability of a device changed.
+         */
+        void changed();
+    };
+
+
+    /**
+     * Creates the jobs for the queue entries.
+     *
+     * The default factory burns images (ISO 9660 and cue/toc),
+     * copies CDs and DVDs, and formats rewritable media. Project files
+     * and ripping need the application: it implements its own factory
+     * and falls back to defaultFactory() for the rest.
+     */
+    class LIBK3B_EXPORT JobQueueFactory
+    {
+    public:
+        virtual ~JobQueueFactory() {}
+
+        /**
+         * The factory may set the size of \p entry if it is not known yet.
+         *
+         * \return A new unstarted job or 0 if \p entry is not supported.
+         */
+        virtual Job* createJob( QueuedJob& entry, const QString& device, JobHandler* handler, QObject* parent ) = 0;
+
+        static JobQueueFactory* defaultFactory();
+    };
+
+
+    /**
+     * Queue of jobs which are scheduled on the available devices without
+     * user interaction.
+     *
+     * An entry is started once a device which is not busy contains a
+     * medium matching the entry with enough free space. Entries with a
+     * higher priority go first.
+     * The queue is saved on every change and reloaded on startup; entries
+     * which were running when K3b quit are queued again.
+     *
+     * The queue is its own JobHandler: questions are answered with the
+     * default answer and no dialogs are shown.
+     */
+    class LIBK3B_EXPORT JobQueue : public QObject, public JobHandler
+    {
+        Q_OBJECT
+
+    public:
+        explicit JobQueue( QObject* parent = 0 );
+        ~JobQueue();
+
+        /**
+         * The queue does not take ownership. Has to be set before start().
+         */
+        void setDevices( JobQueueDevices* devices );
+        JobQueueDevices* devices() const;
+
+        /**
+         * The queue does not take ownership.
+         */
+        void setJobFactory( JobQueueFactory* factory );
+
+        /**
+         * The file the queue is stored in. Defaults to "k3bjobqueue"
+         * in the application data location. Loads the entries from the file.
+         */
+        void setQueueFile( const QString& filename );
+        QString queueFile() const;
+
+        /**
+         * The answer to JobHandler::questionYesNo. Defaults to true.
+         */
+        void setDefaultAnswer( bool yes );
+
+        QList<QueuedJob> entries() const;
+        QueuedJob entry( const QString& id ) const;
+
+        /**
+         * The running job for entry \p id or 0.
+         */
+        Job* job( const QString& id ) const;
+
+        bool isRunning() const;
+
+        /**
+         * Number of entries waiting for a device.
+         */
+        int queueDepth() const;
+        int runningCount() const;
+
+        /**
+         * Bytes processed per second by the finished entries of the last hour.
+         */
+        double throughput() const;
+
+        /**
+         * Entries finished successfully during the last hour.
+         */
+        int finishedLastHour() const;
+
+        /**
+         * reimplemented from JobHandler
+         */
+        Device::MediaType waitForMedium( Device::Device*,
+                                         Device::MediaStates mediaState = Device::STATE_EMPTY,
+                                         Device::MediaTypes mediaType = Device::MEDIA_WRITABLE_CD,
+                                         const K3b::Msf& minMediaSize = K3b::Msf(),
+                                         const QString& message = QString() );
+
+        /**
+         * reimplemented from JobHandler
+         */
+        bool questionYesNo( const QString& text,
+                            const QString& caption = QString(),
+                            const KGuiItem& buttonYes = KStandardGuiItem::yes(),
+                            const KGuiItem& buttonNo = KStandardGuiItem::no() );
+
+        /**
+         * reimplemented from JobHandler
+         */
+        void blockingInformation( const QString& text,
+                                  const QString& caption = QString() );
+
+    public Q_SLOTS:
+        /**
+         * Adds \p entry to the queue.
+         *
+         * \return The id of the new entry.
+         */
+        QString submit( const K3b::QueuedJob& entry );
+
+        /**
+         * Cancels a running entry or removes a pending one from scheduling.
+         */
+        void cancel( const QString& id );
+
+        /**
+         * Removes a finished or pending entry.
+         */
+        bool remove( const QString& id );
+
+        /**
+         * Removes all finished entries.
+         */
+        void clearFinished();
+
+        /**
+         * Queue a failed or canceled entry again.
+         */
+        bool retry( const QString& id );
+
+        void setPriority( const QString& id, int priority );
+
+        /**
+         * Start scheduling entries.
+         */
+        void start();
+
+        /**
+         * Do not start new entries. Running ones are not affected.
+         */
+        void pause();
+
+        /**
+         * Start all entries which can be started now.
+         */
+        void schedule();
+
+    Q_SIGNALS:
+        void entryAdded( const QString& id );
+        void entryChanged( const QString& id );
+        void entryRemoved( const QString& id );
+
+        void jobStarted( const QString& id, K3b::Job* job );
+
+        /**
+         * Messages of the running jobs.
+         */
+        void infoMessage( const QString& id, const QString& message, int type );
+
+        /**
+         * Emitted whenever the queue depth, the number of running jobs, or the
+         * throughput changed.
+         */
+        void statisticsChanged();
+
+    private Q_SLOTS:
+        void slotJobInfoMessage( const QString&, int );
+        void slotJobFinished( bool );
+
+    private:
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
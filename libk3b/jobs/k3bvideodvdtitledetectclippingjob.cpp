@@ -21,6 +21,7 @@
 #include "k3b_i18n.h"
 
 #include <QDebug>
+#include <QThread>
 
 
 static const int s_unrealisticHighClippingValue = 100000;
@@ -29,18 +30,46 @@ static const int s_unrealisticHighClippingValue = 100000;
 class K3b::VideoDVDTitleDetectClippingJob::Private
 {
 public:
+    /**
+     * One transcode process analysing one chapter.
+     */
+    struct Analysis {
+        K3b::Process* process;
+        unsigned int chapter;
+        unsigned int frames;
+        int progress;
+    };
+
+    Analysis* analysisFor( QObject* process ) {
+        Q_FOREACH( Analysis* a, analyses )
+            if( a->process == process )
+                return a;
+        return 0;
+    }
+
+    void clear() {
+        Q_FOREACH( Analysis* a, analyses ) {
+            a->process->disconnect();
+            delete a->process;
+            delete a;
+        }
+        analyses.clear();
+    }
+
     const K3b::ExternalBin* usedTranscodeBin;
 
-    K3b::Process* process;
+    // the chapters are independent and analysed in parallel
+    QList<Analysis*> analyses;
+    int maxParallel;
 
     bool canceled;
+    bool failed;
 
-    unsigned int currentChapter;
-    unsigned int currentFrames;
+    unsigned int nextChapter;
+    unsigned int finishedChapters;
     unsigned int totalChapters;
 
     int lastProgress;
-    int lastSubProgress;
 };
 
 
@@ -54,13 +83,12 @@ K3b::VideoDVDTitleDetectClippingJob::VideoDVDTitleDetectClippingJob( K3b::JobHan
       m_lowPriority( true )
 {
     d = new Private;
-    d->process = 0;
 }
 
 
 K3b::VideoDVDTitleDetectClippingJob::~VideoDVDTitleDetectClippingJob()
 {
-    delete d->process;
+    d->clear();
     delete d;
 }
 
@@ -70,7 +98,9 @@ void K3b::VideoDVDTitleDetectClippingJob::start()
     jobStarted();
 
     d->canceled = false;
+    d->failed = false;
     d->lastProgress = 0;
+    d->clear();
 
     //
     // It seems as if the last chapter is often way too short
@@ -109,96 +139,133 @@ void K3b::VideoDVDTitleDetectClippingJob::start()
                                ,d->usedTranscodeBin->copyright()), MessageInfo );
 
     emit newTask( i18n("Analysing Title %1 of Video DVD %2",m_titleNumber,m_dvd.volumeIdentifier()) );
+    emit newSubTask( i18np("Analysing %1 chapter", "Analysing %1 chapters", d->totalChapters) );
+    emit subPercent( 0 );
+
+    //
+    // Each transcode process decodes a single stream, thus we run one per core.
+    // More processes only make the drive seek back and forth between the chapters.
+    //
+    d->maxParallel = qBound( 1, QThread::idealThreadCount(), 4 );
+    d->nextChapter = 1;
+    d->finishedChapters = 0;
+    startTranscodes();
+}
+
+
+void K3b::VideoDVDTitleDetectClippingJob::startTranscodes()
+{
+    while( !d->failed &&
+           d->nextChapter <= d->totalChapters &&
+           d->analyses.count() < d->maxParallel ) {
+        if( !startTranscode( d->nextChapter++ ) ) {
+            d->failed = true;
+            Q_FOREACH( Private::Analysis* a, d->analyses )
+                if( a->process->isRunning() )
+                    a->process->kill();
+            break;
+        }
+    }
 
-    startTranscode( 1 );
+    if( d->analyses.isEmpty() ) {
+        jobFinished( false );
+    }
 }
 
 
-void K3b::VideoDVDTitleDetectClippingJob::startTranscode( int chapter )
+bool K3b::VideoDVDTitleDetectClippingJob::startTranscode( int chapter )
 {
-    d->currentChapter = chapter;
-    d->lastSubProgress = 0;
+    Private::Analysis* analysis = new Private::Analysis;
+    analysis->chapter = chapter;
+    analysis->progress = 0;
 
     //
     // If we have only one chapter and it is not longer than 2 minutes (value guessed based on some test DVD)
     // use the whole chapter
     //
     if( d->totalChapters == 1 )
-        d->currentFrames = qMin( 3000, qMax( 1, ( int )m_dvd[m_titleNumber-1][d->currentChapter-1].playbackTime().totalFrames() ) );
+        analysis->frames = qMin( 3000, qMax( 1, ( int )m_dvd[m_titleNumber-1][chapter-1].playbackTime().totalFrames() ) );
     else
-        d->currentFrames = qMin( 200, qMax( 1, ( int )m_dvd[m_titleNumber-1][d->currentChapter-1].playbackTime().totalFrames() ) );
+        analysis->frames = qMin( 200, qMax( 1, ( int )m_dvd[m_titleNumber-1][chapter-1].playbackTime().totalFrames() ) );
 
     //
     // prepare the process
     //
-    delete d->process;
-    d->process = new K3b::Process();
-    d->process->setSuppressEmptyLines(true);
-    d->process->setSplitStdout(true);
-    connect( d->process, SIGNAL(stdoutLine(QString)), this, SLOT(slotTranscodeStderr(QString)) );
-    connect( d->process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotTranscodeExited(int,QProcess::ExitStatus)) );
+    analysis->process = new K3b::Process();
+    analysis->process->setSuppressEmptyLines(true);
+    analysis->process->setSplitStdout(true);
+    connect( analysis->process, SIGNAL(stdoutLine(QString)), this, SLOT(slotTranscodeStderr(QString)) );
+    connect( analysis->process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotTranscodeExited(int,QProcess::ExitStatus)) );
+
+    K3b::Process* process = analysis->process;
 
     // the executable
-    *d->process << d->usedTranscodeBin;
+    *process << d->usedTranscodeBin;
 
     // low priority
     if( m_lowPriority )
-        *d->process << "--nice" << "19";
+        *process << "--nice" << "19";
 
     if ( d->usedTranscodeBin->version() >= Version( 1, 1, 0 ) )
-        *d->process << "--log_no_color";
+        *process << "--log_no_color";
 
     // the input
-    *d->process << "-i" << m_dvd.device()->blockDeviceName();
+    *process << "-i" << m_dvd.device()->blockDeviceName();
 
     // select the title number and chapter
-    *d->process << "-T" << QString("%1,%2").arg(m_titleNumber).arg(chapter);
+    *process << "-T" << QString("%1,%2").arg(m_titleNumber).arg(chapter);
 
     // null output
-    *d->process << "-y" << "null,null" << "-o" << "/dev/null";
+    *process << "-y" << "null,null" << "-o" << "/dev/null";
 
     // analyze the first 200 frames
-    *d->process << "-J" << QString("detectclipping=range=0-%1/5").arg(d->currentFrames);
+    *process << "-J" << QString("detectclipping=range=0-%1/5").arg(analysis->frames);
 
     // also only decode the first 200 frames
-    *d->process << "-c" << QString("0-%1").arg(d->currentFrames+1);
+    *process << "-c" << QString("0-%1").arg(analysis->frames+1);
 
     // additional user parameters from config
     const QStringList& params = d->usedTranscodeBin->userParameters();
     for( QStringList::const_iterator it = params.begin(); it != params.end(); ++it )
-        *d->process << *it;
+        *process << *it;
 
     // produce some debugging output
     qDebug() << "***** transcode parameters:\n";
-    QString s = d->process->joinedArgs();
+    QString s = process->joinedArgs();
     qDebug() << s << flush;
     emit debuggingOutput( d->usedTranscodeBin->name() + " command:", s);
 
     // start the process
-    if( !d->process->start( KProcess::MergedChannels ) ) {
+    if( !process->start( KProcess::MergedChannels ) ) {
         // something went wrong when starting the program
         // it "should" be the executable
         emit infoMessage( i18n("Could not start %1.",d->usedTranscodeBin->name()), K3b::Job::MessageError );
-        jobFinished(false);
-    }
-    else {
-        emit newSubTask( i18n("Analysing Chapter %1 of %2",chapter,m_dvd[m_titleNumber-1].numPTTs()) );
-        emit subPercent( 0 );
+        delete process;
+        delete analysis;
+        return false;
     }
+
+    d->analyses.append( analysis );
+    return true;
 }
 
 
 void K3b::VideoDVDTitleDetectClippingJob::cancel()
 {
     d->canceled = true;
-    if( d->process && d->process->isRunning() )
-        d->process->kill();
+    Q_FOREACH( Private::Analysis* a, d->analyses )
+        if( a->process->isRunning() )
+            a->process->kill();
 }
 
 
 void K3b::VideoDVDTitleDetectClippingJob::slotTranscodeStderr( const QString& line )
 {
-    emit debuggingOutput( "transcode", line );
+    Private::Analysis* analysis = d->analysisFor( sender() );
+    if( !analysis )
+        return;
+
+    emit debuggingOutput( QString::fromLatin1( "transcode (chapter %1)" ).arg( analysis->chapter ), line );
 
     // parse progress
     // encoding frame [185],  24.02 fps, 93.0%, ETA: 0:00:00, ( 0| 0| 0)
@@ -209,23 +276,8 @@ void K3b::VideoDVDTitleDetectClippingJob::slotTranscodeStderr( const QString& li
             bool ok;
             int encodedFrames = line.mid( pos1+1, pos2-pos1-1 ).toInt( &ok );
             if( ok ) {
-                int progress = 100 * encodedFrames / d->currentFrames;
-
-                if( progress > d->lastSubProgress ) {
-                    d->lastSubProgress = progress;
-                    emit subPercent( progress );
-                }
-
-                double part = 100.0 / (double)d->totalChapters;
-
-                progress = (int)( ( (double)(d->currentChapter-1) * part )
-                                  + ( (double)progress / (double)d->totalChapters )
-                                  + 0.5 );
-
-                if( progress > d->lastProgress ) {
-                    d->lastProgress = progress;
-                    emit percent( progress );
-                }
+                analysis->progress = qMin( 100, 100 * encodedFrames / (int)analysis->frames );
+                updateProgress();
             }
         }
     }
@@ -248,41 +300,72 @@ void K3b::VideoDVDTitleDetectClippingJob::slotTranscodeStderr( const QString& li
 
 void K3b::VideoDVDTitleDetectClippingJob::slotTranscodeExited( int exitCode, QProcess::ExitStatus )
 {
-    switch( exitCode ) {
-    case 0:
-        d->currentChapter++;
-        if( d->currentChapter > d->totalChapters ) {
-            //
-            // check if we did set any values at all
-            //
-            if( m_clippingTop == s_unrealisticHighClippingValue )
-                m_clippingTop = m_clippingLeft = m_clippingBottom = m_clippingRight = 0;
-
-            if( d->totalChapters < m_dvd[m_titleNumber-1].numPTTs() )
-                emit infoMessage( i18n("Ignoring clipping values of last chapter due to its short playback time."), MessageInfo );
-
-            jobFinished( true );
-        }
-        else {
-            startTranscode( d->currentChapter );
-        }
-        break;
+    Private::Analysis* analysis = d->analysisFor( sender() );
+    if( !analysis )
+        return;
+
+    d->analyses.removeAll( analysis );
+    analysis->process->deleteLater();
+    const unsigned int chapter = analysis->chapter;
+    delete analysis;
 
-    default:
+    if( exitCode == 0 ) {
+        ++d->finishedChapters;
+        updateProgress();
+    }
+    else if( !d->failed ) {
         // FIXME: error handling
 
-        if( d->canceled ) {
-            emit canceled();
-        }
-        else {
+        d->failed = true;
+        if( !d->canceled ) {
             emit infoMessage( i18n("%1 returned an unknown error (code %2).",
                                    d->usedTranscodeBin->name(), exitCode ),
                               K3b::Job::MessageError );
             emit infoMessage( i18n("Please send me an email with the last output."), K3b::Job::MessageError );
         }
+        qDebug() << "(K3b::VideoDVDTitleDetectClippingJob) analysis of chapter" << chapter << "failed.";
 
-        jobFinished( false );
+        // no need to wait for the others
+        Q_FOREACH( Private::Analysis* a, d->analyses )
+            if( a->process->isRunning() )
+                a->process->kill();
+    }
+
+    if( d->failed ) {
+        if( d->analyses.isEmpty() ) {
+            if( d->canceled )
+                emit canceled();
+            jobFinished( false );
+        }
+    }
+    else if( d->finishedChapters == d->totalChapters ) {
+        //
+        // check if we did set any values at all
+        //
+        if( m_clippingTop == s_unrealisticHighClippingValue )
+            m_clippingTop = m_clippingLeft = m_clippingBottom = m_clippingRight = 0;
+
+        if( d->totalChapters < m_dvd[m_titleNumber-1].numPTTs() )
+            emit infoMessage( i18n("Ignoring clipping values of last chapter due to its short playback time."), MessageInfo );
+
+        jobFinished( true );
+    }
+    else {
+        startTranscodes();
     }
 }
 
 
+void K3b::VideoDVDTitleDetectClippingJob::updateProgress()
+{
+    int progress = 0;
+    Q_FOREACH( Private::Analysis* a, d->analyses )
+        progress += a->progress;
+    progress = ( 100*d->finishedChapters + progress ) / d->totalChapters;
+
+    if( progress > d->lastProgress ) {
+        d->lastProgress = progress;
+        emit percent( progress );
+        emit subPercent( progress );
+    }
+}
@@ -23,6 +23,9 @@
 namespace K3b {
     /**
      * Job to detect the clipping values for a Video DVD title.
+     *
+     * The chapters of the title are analysed in parallel, one transcode
+     * process per core.
      */
     class LIBK3B_EXPORT VideoDVDTitleDetectClippingJob : public Job
     {
@@ -85,7 +88,9 @@ namespace K3b {
         void slotTranscodeExited( int, QProcess::ExitStatus );
 
     private:
-        void startTranscode( int chapter );
+        void startTranscodes();
+        bool startTranscode( int chapter );
+        void updateProgress();
 
         VideoDVD::VideoDVD m_dvd;
 
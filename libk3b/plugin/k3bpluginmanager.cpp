@@ -96,6 +96,24 @@ QList<K3b::Plugin*> K3b::PluginManager::plugins( const QString& group ) const
 }
 
 
+K3b::Plugin* K3b::PluginManager::createPluginInstance( Plugin* plugin, QObject* parent ) const
+{
+    KService::Ptr service = plugin->pluginInfo().service();
+    if( !service )
+        return 0;
+
+    QString err;
+    K3b::Plugin* instance = service->createInstance<K3b::Plugin>( 0, parent, QVariantList(), &err );
+    if( instance ) {
+        instance->m_pluginInfo = plugin->pluginInfo();
+    }
+    else {
+        qDebug() << "Creating another instance of" << service->name() << "failed. Error:" << err;
+    }
+    return instance;
+}
+
+
 void K3b::PluginManager::Private::loadPlugin( const KService::Ptr &service )
 {
     qDebug() << service->name() << service->library();
@@ -52,6 +52,16 @@ namespace K3b {
          */
         QStringList categories() const;
 
+        /**
+         * Creates another instance of \p plugin. Plugins like the
+         * AudioEncoders keep state and thus one instance cannot be used
+         * by several jobs at the same time.
+         *
+         * \return The new instance which is owned by \p parent or 0 if
+         *         the plugin could not be loaded again.
+         */
+        Plugin* createPluginInstance( Plugin* plugin, QObject* parent = 0 ) const;
+
         int pluginSystemVersion() const;
         
         bool hasPluginDialog( Plugin* plugin ) const;
@@ -36,9 +36,12 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QStringList>
 #include <QTextStream>
 #include <QDomElement>
+#include <QVector>
 
 
 class K3b::AudioDoc::Private
@@ -48,6 +51,10 @@ public:
     :
         firstTrack( 0 ),
         lastTrack( 0 ),
+        tracksValid( true ),
+        firstDirtyTrack( 0 ),
+        offsetsValid( false ),
+        firstDirtyOffset( 0 ),
         cdTextValidator( new K3b::CdTextValidator() )
     {
     }
@@ -59,6 +66,25 @@ public:
     AudioTrack* firstTrack;
     AudioTrack* lastTrack;
 
+    //
+    // Track cache
+    // --------------------------------------------------
+    // The track list is a linked list but the project model and the
+    // jobs need random access by track number and the track offsets.
+    // Both are cached here and only the part following the first
+    // changed track is rebuilt. The imager reads the cache from a
+    // worker thread, thus the mutex.
+    mutable QMutex trackCacheMutex;
+    mutable QVector<AudioTrack*> tracks;
+    // offsets[i] is the first sector of track i, the last entry
+    // the length of the whole project
+    mutable QVector<Msf> offsets;
+    mutable bool tracksValid;
+    mutable int firstDirtyTrack;
+    mutable bool offsetsValid;
+    mutable int firstDirtyOffset;
+    // --------------------------------------------------
+
     bool hideFirstTrack;
     bool normalize;
 
@@ -172,14 +198,94 @@ KIO::filesize_t K3b::AudioDoc::size() const
 
 K3b::Msf K3b::AudioDoc::length() const
 {
-    K3b::Msf length = 0;
-    K3b::AudioTrack* track = d->firstTrack;
-    while( track ) {
-        length += track->length();
-        track = track->next();
+    QMutexLocker locker( &d->trackCacheMutex );
+    validateTrackCache();
+    return d->offsets.last();
+}
+
+
+void K3b::AudioDoc::trackListChanged( int position )
+{
+    QMutexLocker locker( &d->trackCacheMutex );
+    d->firstDirtyTrack = qMax( 0, qMin( d->firstDirtyTrack, position ) );
+    d->tracksValid = false;
+}
+
+
+void K3b::AudioDoc::trackLengthChanged( K3b::AudioTrack* track )
+{
+    QMutexLocker locker( &d->trackCacheMutex );
+    // a track which is not cached is either not part of the list or
+    // follows the first changed track and will be recalculated anyway
+    int index = cachedTrackIndex( track );
+    if( index >= 0 ) {
+        d->firstDirtyOffset = qMin( d->firstDirtyOffset, index );
+        d->offsetsValid = false;
     }
+}
 
-    return length;
+
+int K3b::AudioDoc::cachedTrackIndex( const K3b::AudioTrack* track ) const
+{
+    int index = track->d->index;
+    if( index >= 0 &&
+        index < qMin( d->firstDirtyTrack, d->tracks.count() ) &&
+        d->tracks[index] == track )
+        return index;
+    else
+        return -1;
+}
+
+
+void K3b::AudioDoc::validateTrackCache() const
+{
+    if( !d->tracksValid ) {
+        int i = qMin( d->firstDirtyTrack, d->tracks.count() );
+        d->tracks.resize( i );
+        for( K3b::AudioTrack* track = ( i > 0 ? d->tracks[i-1]->next() : d->firstTrack );
+             track; track = track->next() ) {
+            track->d->index = d->tracks.count();
+            d->tracks.append( track );
+        }
+        d->firstDirtyTrack = d->tracks.count();
+        d->tracksValid = true;
+
+        d->firstDirtyOffset = qMin( d->firstDirtyOffset, i );
+        d->offsetsValid = false;
+    }
+
+    if( !d->offsetsValid ) {
+        int i = qMin( d->firstDirtyOffset, d->tracks.count() );
+        d->offsets.resize( i+1 ); // offsets[0] is always 0
+        for( ; i < d->tracks.count(); ++i )
+            d->offsets.append( d->offsets[i] + d->tracks[i]->sourcesLength() );
+        d->firstDirtyOffset = d->tracks.count();
+        d->offsetsValid = true;
+    }
+}
+
+
+int K3b::AudioDoc::trackIndex( const K3b::AudioTrack* track ) const
+{
+    QMutexLocker locker( &d->trackCacheMutex );
+    validateTrackCache();
+    return cachedTrackIndex( track );
+}
+
+
+bool K3b::AudioDoc::trackPosition( const K3b::AudioTrack* track, K3b::Msf* offset, K3b::Msf* length ) const
+{
+    QMutexLocker locker( &d->trackCacheMutex );
+    validateTrackCache();
+    int index = cachedTrackIndex( track );
+    if( index < 0 )
+        return false;
+
+    if( offset )
+        *offset = d->offsets[index];
+    if( length )
+        *length = d->offsets[index+1] - d->offsets[index];
+    return true;
 }
 
 
@@ -504,16 +610,12 @@ void K3b::AudioDoc::addTrack( const QUrl& url, int position )
 
 K3b::AudioTrack* K3b::AudioDoc::getTrack( int trackNum )
 {
-    K3b::AudioTrack* track = d->firstTrack;
-    int i = 1;
-    while( track ) {
-        if( i == trackNum )
-            return track;
-        track = track->next();
-        ++i;
-    }
-
-    return 0;
+    QMutexLocker locker( &d->trackCacheMutex );
+    validateTrackCache();
+    if( trackNum >= 1 && trackNum <= d->tracks.count() )
+        return d->tracks[trackNum-1];
+    else
+        return 0;
 }
 
 
@@ -525,6 +627,7 @@ void K3b::AudioDoc::addTrack( K3b::AudioTrack* track, int position )
     if( !d->firstTrack ) {
         emit trackAboutToBeAdded( 0 );
         d->firstTrack = d->lastTrack = track;
+        trackListChanged( 0 );
         emit trackAdded( 0 );
     } else if( position == 0 ) {
         track->moveAhead( d->firstTrack );
@@ -994,7 +1097,9 @@ bool K3b::AudioDoc::hideFirstTrack() const
 
 int K3b::AudioDoc::numOfTracks() const
 {
-    return ( d->lastTrack ? d->lastTrack->trackNumber() : 0 );
+    QMutexLocker locker( &d->trackCacheMutex );
+    validateTrackCache();
+    return d->tracks.count();
 }
 
 
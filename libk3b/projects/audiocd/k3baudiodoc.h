@@ -68,7 +68,6 @@ namespace K3b {
         AudioTrack* lastTrack() const;
 
         /**
-         * Slow.
          * \return the AudioTrack with track number trackNum (starting at 1) or 0 if trackNum > numOfTracks()
          */
         AudioTrack* getTrack( int trackNum );
@@ -218,6 +217,40 @@ namespace K3b {
          */
         void setLastTrack( AudioTrack* track );
 
+        /**
+         * Used by AudioTrack to tell the doc that the track list changed at
+         * \p position. The cached track numbers and offsets from there on
+         * are rebuilt on the next request.
+         */
+        void trackListChanged( int position );
+
+        /**
+         * Used by AudioTrack to tell the doc that the length of \p track changed.
+         * Only the offsets of the following tracks need to be recalculated.
+         */
+        void trackLengthChanged( AudioTrack* track );
+
+        /**
+         * \return The index of \p track in the track list or -1 if it is not
+         * part of the list.
+         */
+        int trackIndex( const AudioTrack* track ) const;
+
+        /**
+         * Retrieves the first sector and the length of \p track from the
+         * track cache.
+         *
+         * \return false if \p track is not part of the track list.
+         */
+        bool trackPosition( const AudioTrack* track, Msf* offset, Msf* length ) const;
+
+        /**
+         * Rebuilds the invalidated parts of the track cache. Has to be called
+         * with the cache mutex locked.
+         */
+        void validateTrackCache() const;
+        int cachedTrackIndex( const AudioTrack* track ) const;
+
         /**
          * Used by AudioFile to tell the doc that it does not need the decoder anymore.
          */
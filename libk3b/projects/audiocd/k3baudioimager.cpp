@@ -19,31 +19,292 @@
 #include "k3baudiotrack.h"
 #include "k3baudiotrackreader.h"
 #include "k3baudiodatasource.h"
-#include "k3bthread.h"
+#include "k3baudiofile.h"
+#include "k3baudiozerodata.h"
+#include "k3baudioloudness.h"
 #include "k3bwavefilewriter.h"
 #include "k3b_i18n.h"
 
+#include <QByteArray>
 #include <QDebug>
 #include <QIODevice>
 #include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
 
 #include <unistd.h>
 
 
+namespace {
+    // the number of tracks decoded ahead of the one being written
+    const int s_decodeAheadTracks = 2;
+
+    // PCM data decoded ahead, about 30 seconds of audio
+    const qint64 s_maxBufferedBytes = 30*75*2352;
+
+    const int s_chunkSize = 2352*10;
+}
+
+
 class K3b::AudioImager::Private
 {
 public:
     Private()
-        : ioDev(0) {
+        : ioDev(0),
+          minBuffered(-1) {
+    }
+
+    int fillPercent( qint64 bytes ) const {
+        return bytes < 0 ? -1 : static_cast<int>( 100LL * bytes / s_maxBufferedBytes );
     }
 
+    class DecodeTask;
+
+    struct TrackBuffer {
+        TrackBuffer()
+            : track(0),
+              gain(1.0),
+              task(0),
+              queued(0),
+              started(false),
+              done(false),
+              failed(false) {
+        }
+
+        AudioTrack* track;
+        double gain;
+
+        // the decoders and devices the track reads from, tracks sharing
+        // one of them cannot be decoded in parallel
+        QList<const void*> resources;
+
+        DecodeTask* task;
+        QQueue<QByteArray> chunks;
+        qint64 queued;
+        bool started;
+        bool done;
+        bool failed;
+    };
+
     QIODevice* ioDev;
     AudioImager::ErrorType lastError;
     AudioDoc* doc;
     AudioJobTempData* tempData;
+    QVector<double> gains;
+
+    //
+    // The decode-ahead stage. The tracks are decoded on the WorkerPool into
+    // one queue of chunks per track while the current track is written.
+    //
+    QMutex mutex;
+    QWaitCondition changed;
+    QVector<TrackBuffer> buffers;
+    int current;
+    qint64 buffered;
+    int running;
+    bool abort;
+
+    // the lowest amount of decoded data waiting for the writer, only
+    // counted once the first chunk arrived
+    qint64 minBuffered;
+
+    void initBuffers();
+
+    /**
+     * Starts the decoding of the next tracks as far as possible.
+     * Has to be called with the mutex locked.
+     */
+    void startDecoding();
+
+    /**
+     * Stops all decoding and waits for the tasks to finish.
+     */
+    void stopDecoding();
+};
+
+
+class K3b::AudioImager::Private::DecodeTask : public K3b::WorkerPool::Task
+{
+public:
+    DecodeTask( Private* p, int i )
+        : d( p ),
+          index( i ) {
+    }
+
+    void run();
+
+private:
+    bool enqueue( const QByteArray& chunk );
+
+    Private* d;
+    int index;
 };
 
 
+void K3b::AudioImager::Private::DecodeTask::run()
+{
+    d->mutex.lock();
+    AudioTrack* track = d->buffers[index].track;
+    const double gain = d->buffers[index].gain;
+    d->mutex.unlock();
+
+    AudioTrackReader trackReader( *track );
+    bool success = trackReader.open();
+    if( !success )
+        qDebug() << "(K3b::AudioImager) unable to open track" << track->trackNumber();
+
+    qint64 trackRead = 0;
+    while( success && !trackReader.atEnd() ) {
+        QByteArray chunk( s_chunkSize, Qt::Uninitialized );
+        qint64 read = trackReader.read( chunk.data(), chunk.size() );
+        if( read < 0 ) {
+            qDebug() << "(K3b::AudioImager) read error on track " << track->trackNumber()
+                     << " at pos " << K3b::Msf(trackRead/2352);
+            success = false;
+            break;
+        }
+        else if( read == 0 ) {
+            break;
+        }
+
+        if( gain != 1.0 ) {
+            // do not split a sample
+            if( read % 2 ) {
+                qint64 r = trackReader.read( chunk.data()+read, 1 );
+                if( r > 0 )
+                    read += r;
+            }
+            AudioLoudnessMeter::applyGain( chunk.data(), read, gain );
+        }
+
+        chunk.resize( read );
+        trackRead += read;
+        if( !enqueue( chunk ) )
+            break;
+    }
+
+    QMutexLocker locker( &d->mutex );
+    d->buffers[index].done = true;
+    d->buffers[index].failed = !success;
+    d->buffers[index].task = 0;
+    --d->running;
+    d->changed.wakeAll();
+    locker.unlock();
+
+    delete this;
+}
+
+
+bool K3b::AudioImager::Private::DecodeTask::enqueue( const QByteArray& chunk )
+{
+    QMutexLocker locker( &d->mutex );
+    TrackBuffer& buffer = d->buffers[index];
+
+    // The current track only waits for the writer, the following ones
+    // have to leave room for it.
+    while( !d->abort &&
+           ( index == d->current
+             ? buffer.queued >= s_maxBufferedBytes
+             : d->buffered >= s_maxBufferedBytes ) ) {
+        WorkerPool::BlockingSection blocking;
+        d->changed.wait( &d->mutex );
+    }
+    if( d->abort )
+        return false;
+
+    buffer.chunks.enqueue( chunk );
+    buffer.queued += chunk.size();
+    d->buffered += chunk.size();
+    d->changed.wakeAll();
+    return true;
+}
+
+
+void K3b::AudioImager::Private::initBuffers()
+{
+    buffers.clear();
+    current = 0;
+    buffered = 0;
+    running = 0;
+    abort = false;
+
+    int index = 0;
+    for( AudioTrack* track = doc->firstTrack(); track != 0; track = track->next(), ++index ) {
+        TrackBuffer buffer;
+        buffer.track = track;
+        buffer.gain = index < gains.count() ? gains[index] : 1.0;
+        for( AudioDataSource* source = track->firstSource(); source; source = source->next() ) {
+            const void* resource = 0;
+            if( AudioFile* file = dynamic_cast<AudioFile*>( source ) )
+                resource = file->decoder();
+            else if( !dynamic_cast<AudioZeroData*>( source ) )
+                resource = doc; // devices and everything else in order
+            if( resource && !buffer.resources.contains( resource ) )
+                buffer.resources.append( resource );
+        }
+        buffers.append( buffer );
+    }
+}
+
+
+void K3b::AudioImager::Private::startDecoding()
+{
+    const int last = qMin( current + s_decodeAheadTracks, buffers.count()-1 );
+    for( int i = current; i <= last && !abort; ++i ) {
+        TrackBuffer& buffer = buffers[i];
+        if( buffer.started )
+            continue;
+
+        bool blocked = false;
+        for( int j = current; j < i && !blocked; ++j ) {
+            if( !buffers[j].done ) {
+                Q_FOREACH( const void* resource, buffer.resources ) {
+                    if( buffers[j].resources.contains( resource ) ) {
+                        blocked = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if( !blocked ) {
+            buffer.started = true;
+            buffer.task = new DecodeTask( this, i );
+            ++running;
+            WorkerPool::instance()->submit( buffer.task, WorkerPool::Realtime );
+        }
+    }
+}
+
+
+void K3b::AudioImager::Private::stopDecoding()
+{
+    QMutexLocker locker( &mutex );
+    abort = true;
+    changed.wakeAll();
+
+    for( int i = 0; i < buffers.count(); ++i ) {
+        if( buffers[i].task && WorkerPool::instance()->cancel( buffers[i].task ) ) {
+            delete buffers[i].task;
+            buffers[i].task = 0;
+            --running;
+        }
+    }
+
+    if( running > 0 ) {
+        WorkerPool::BlockingSection blocking;
+        while( running > 0 )
+            changed.wait( &mutex );
+    }
+
+    buffers.clear();
+    buffered = 0;
+}
+
+
 
 K3b::AudioImager::AudioImager( AudioDoc* doc, AudioJobTempData* tempData, JobHandler* jh, QObject* parent )
     : K3b::ThreadJob( jh, parent ),
@@ -51,6 +312,9 @@ K3b::AudioImager::AudioImager( AudioDoc* doc, AudioJobTempData* tempData, JobHan
 {
     d->doc = doc;
     d->tempData = tempData;
+
+    // feeds the writer
+    setPriority( WorkerPool::Realtime );
 }
 
 
@@ -66,41 +330,55 @@ void K3b::AudioImager::writeTo( QIODevice* dev )
 }
 
 
+void K3b::AudioImager::setTrackGains( const QVector<double>& gains )
+{
+    d->gains = gains;
+}
+
+
 K3b::AudioImager::ErrorType K3b::AudioImager::lastErrorType() const
 {
     return d->lastError;
 }
 
 
+int K3b::AudioImager::minimumBufferFill() const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->fillPercent( d->minBuffered );
+}
+
+
 bool K3b::AudioImager::run()
 {
     d->lastError = K3b::AudioImager::ERROR_UNKNOWN;
 
+    d->mutex.lock();
+    d->minBuffered = -1;
+    d->mutex.unlock();
+
+    d->initBuffers();
+
+    bool success = writeTracks();
+
+    d->stopDecoding();
+
+    return success;
+}
+
+
+bool K3b::AudioImager::writeTracks()
+{
     K3b::WaveFileWriter waveFileWriter;
 
     qint64 totalSize = d->doc->length().audioBytes();
     qint64 totalRead = 0;
-    char buffer[2352 * 10];
 
-    for( AudioTrack* track = d->doc->firstTrack(); track != 0; track = track->next() ) {
+    for( int index = 0; index < d->buffers.count(); ++index ) {
+        AudioTrack* track = d->buffers[index].track;
 
         emit nextTrack( track->trackNumber(), d->doc->numOfTracks() );
 
-        //
-        // Create track reader
-        //
-        AudioTrackReader trackReader( *track );
-        if( !trackReader.open() ) {
-            emit infoMessage( i18n("Unable to read track %1.", track->trackNumber()), K3b::Job::MessageError );
-            return false;
-        }
-
-        //
-        // Initialize the reading
-        //
-        qint64 read = 0;
-        qint64 trackRead = 0;
-
         //
         // Create the image file
         //
@@ -112,15 +390,59 @@ bool K3b::AudioImager::run()
             }
         }
 
-        //
-        // Read data from the track
-        //
-        while( !trackReader.atEnd() && (read = trackReader.read( buffer, sizeof(buffer) )) > 0 ) {
+        const qint64 trackSize = track->length().audioBytes();
+        qint64 trackRead = 0;
+
+        forever {
+            //
+            // Take the next chunk of decoded data
+            //
+            QMutexLocker locker( &d->mutex );
+            d->startDecoding();
+
+            Private::TrackBuffer& buffer = d->buffers[index];
+            if( buffer.chunks.isEmpty() && !buffer.done ) {
+                // the decoders fell behind
+                if( d->minBuffered > 0 ) {
+                    d->minBuffered = 0;
+                    emit minimumBufferFillChanged( 0 );
+                }
+
+                WorkerPool::BlockingSection blocking;
+                while( buffer.chunks.isEmpty() && !buffer.done ) {
+                    d->changed.wait( &d->mutex );
+                    d->startDecoding();
+                }
+            }
+
+            if( buffer.chunks.isEmpty() ) {
+                if( buffer.failed ) {
+                    emit infoMessage( i18n("Error while decoding track %1.", track->trackNumber()), K3b::Job::MessageError );
+                    d->lastError = K3b::AudioImager::ERROR_DECODING_TRACK;
+                    return false;
+                }
+                break;
+            }
+
+            if( d->minBuffered < 0 || d->buffered < d->minBuffered ) {
+                const int oldFill = d->fillPercent( d->minBuffered );
+                d->minBuffered = d->buffered;
+                if( d->fillPercent( d->minBuffered ) != oldFill )
+                    emit minimumBufferFillChanged( d->fillPercent( d->minBuffered ) );
+            }
+
+            const QByteArray chunk = buffer.chunks.dequeue();
+            buffer.queued -= chunk.size();
+            d->buffered -= chunk.size();
+            d->changed.wakeAll();
+            locker.unlock();
+
+            const qint64 read = chunk.size();
             if( !d->ioDev ) {
-                waveFileWriter.write( buffer, read, K3b::WaveFileWriter::BigEndian );
+                waveFileWriter.write( chunk.constData(), read, K3b::WaveFileWriter::BigEndian );
             }
             else {
-                qint64 w = d->ioDev->write( buffer, read );
+                qint64 w = d->ioDev->write( chunk.constData(), read );
                 if ( w != read ) {
                     qDebug() << "(K3b::AudioImager::WorkThread) writing to device" << d->ioDev << "failed:" << read << w;
                     d->lastError = K3b::AudioImager::ERROR_FD_WRITE;
@@ -138,22 +460,25 @@ bool K3b::AudioImager::run()
             totalRead += read;
             trackRead += read;
 
-            emit subPercent( 100LL*trackRead/trackReader.size() );
+            emit subPercent( 100LL*trackRead/trackSize );
             emit percent( 100LL*totalRead/totalSize );
-            emit processedSubSize( trackRead/1024LL/1024LL, trackReader.size()/1024LL/1024LL );
+            emit processedSubSize( trackRead/1024LL/1024LL, trackSize/1024LL/1024LL );
             emit processedSize( totalRead/1024LL/1024LL, totalSize/1024LL/1024LL );
         }
 
-        if( read < 0 ) {
-            emit infoMessage( i18n("Error while decoding track %1.", track->trackNumber()), K3b::Job::MessageError );
-            qDebug() << "(K3b::AudioImager::WorkThread) read error on track " << track->trackNumber()
-                     << " at pos " << K3b::Msf(trackRead/2352) << endl;
-            d->lastError = K3b::AudioImager::ERROR_DECODING_TRACK;
-            return false;
-        }
+        //
+        // Move on to the next track which lifts the limit for its decoder
+        //
+        QMutexLocker locker( &d->mutex );
+        d->current = index+1;
+        d->changed.wakeAll();
     }
 
+    QMutexLocker locker( &d->mutex );
+    emit debuggingOutput( "K3b::AudioImager",
+                          QString( "Minimum decode-ahead buffer fill: %1 of %2 KB" )
+                          .arg( qMax( d->minBuffered, qint64( 0 ) )/1024 )
+                          .arg( s_maxBufferedBytes/1024 ) );
+
     return true;
 }
-
-
@@ -17,12 +17,22 @@
 
 #include "k3bthreadjob.h"
 
+#include <QVector>
+
 class QIODevice;
 
 namespace K3b {
     class AudioDoc;
     class AudioJobTempData;
 
+    /**
+     * Writes the tracks of an AudioDoc into image files or a device.
+     *
+     * The tracks are decoded on the WorkerPool ahead of the one being
+     * written so slow decoders do not stall the writer at track boundaries.
+     * The lowest fill level of the decode-ahead buffer is available
+     * through minimumBufferFill().
+     */
     class AudioImager : public ThreadJob
     {
         Q_OBJECT
@@ -38,6 +48,13 @@ namespace K3b {
          */
         void writeTo( QIODevice* dev );
 
+        /**
+         * Multiply the samples of each track with the factor at its index,
+         * typically as determined by the AudioNormalizeJob.
+         * An empty vector leaves the audio untouched.
+         */
+        void setTrackGains( const QVector<double>& gains );
+
         enum ErrorType {
             ERROR_FD_WRITE,
             ERROR_DECODING_TRACK,
@@ -46,8 +63,22 @@ namespace K3b {
 
         ErrorType lastErrorType() const;
 
+        /**
+         * The lowest fill level of the decode-ahead buffer in percent
+         * while writing, 0 if the writer had to wait for the decoders.
+         * -1 if nothing has been written yet.
+         */
+        int minimumBufferFill() const;
+
+    Q_SIGNALS:
+        /**
+         * Emitted from the job's thread whenever minimumBufferFill() drops.
+         */
+        void minimumBufferFillChanged( int percent );
+
     private:
         bool run();
+        bool writeTracks();
 
         class Private;
         Private* const d;
@@ -306,6 +306,20 @@ void K3b::AudioJob::start()
     }
 
 
+    //
+    // The volume levels are determined before decoding so the
+    // gains can be applied on the fly
+    //
+    m_audioImager->setTrackGains( QVector<double>() );
+    if( m_doc->normalize() )
+        normalizeTracks();
+    else
+        startDecoding();
+}
+
+
+void K3b::AudioJob::startDecoding()
+{
     if( !m_doc->onlyCreateImages() && m_doc->onTheFly() ) {
         if( m_doc->speed() == 0 ) {
             // try to determine the max possible speed
@@ -378,6 +392,9 @@ void K3b::AudioJob::cancel()
 {
     m_canceled = true;
 
+    if( m_normalizeJob )
+        m_normalizeJob->cancel();
+
     if( m_maxSpeedJob )
         m_maxSpeedJob->cancel();
 
@@ -453,14 +470,15 @@ void K3b::AudioJob::slotAudioDecoderFinished( bool success )
         return;
     }
 
+    // the writer had to wait for the decoders at least once
+    if( m_doc->onTheFly() && !m_doc->onlyCreateImages() && m_audioImager->minimumBufferFill() == 0 )
+        emit infoMessage( i18n("Decoding the audio tracks was slower than writing them at times."), MessageWarning );
+
     if( m_doc->onlyCreateImages() || !m_doc->onTheFly() ) {
 
         emit infoMessage( i18n("Successfully decoded all tracks."), MessageSuccess );
 
-        if( m_doc->normalize() ) {
-            normalizeFiles();
-        }
-        else if( !m_doc->onlyCreateImages() ) {
+        if( !m_doc->onlyCreateImages() ) {
             if( !prepareWriter() ) {
                 cleanupAfterError();
                 jobFinished(false);
@@ -617,7 +635,7 @@ void K3b::AudioJob::slotAudioDecoderPercent( int p )
 {
     if( m_doc->onlyCreateImages() ) {
         if( m_doc->normalize() )
-            emit percent( p/2 );
+            emit percent( 50 + p/2 );
         else
             emit percent( p );
     }
@@ -626,6 +644,7 @@ void K3b::AudioJob::slotAudioDecoderPercent( int p )
         double tasksDone = d->copiesDone; // =0 when creating an image
         if( m_doc->normalize() ) {
             totalTasks+=1.0;
+            tasksDone+=1.0;
         }
         if( !m_doc->onTheFly() ) {
             totalTasks+=1.0;
@@ -701,32 +720,21 @@ void K3b::AudioJob::removeBufferFiles()
 }
 
 
-void K3b::AudioJob::normalizeFiles()
+void K3b::AudioJob::normalizeTracks()
 {
     if( !m_normalizeJob ) {
-        m_normalizeJob = new K3b::AudioNormalizeJob( this, this );
+        m_normalizeJob = new K3b::AudioNormalizeJob( m_doc, this, this );
 
         connect( m_normalizeJob, SIGNAL(infoMessage(QString,int)),
                  this, SIGNAL(infoMessage(QString,int)) );
         connect( m_normalizeJob, SIGNAL(percent(int)), this, SLOT(slotNormalizeProgress(int)) );
-        connect( m_normalizeJob, SIGNAL(subPercent(int)), this, SLOT(slotNormalizeSubProgress(int)) );
+        connect( m_normalizeJob, SIGNAL(percent(int)), this, SIGNAL(subPercent(int)) );
         connect( m_normalizeJob, SIGNAL(finished(bool)), this, SLOT(slotNormalizeJobFinished(bool)) );
         connect( m_normalizeJob, SIGNAL(newTask(QString)), this, SIGNAL(newSubTask(QString)) );
         connect( m_normalizeJob, SIGNAL(debuggingOutput(QString,QString)),
                  this, SIGNAL(debuggingOutput(QString,QString)) );
     }
 
-    // add all the files
-    // TODO: we may need to split the wave files and put them back together!
-    QList<QString> files;
-    K3b::AudioTrack* track = m_doc->firstTrack();
-    while( track ) {
-        files.append( m_tempData->bufferFileName(track) );
-        track = track->next();
-    }
-
-    m_normalizeJob->setFilesToNormalize( files );
-
     emit newTask( i18n("Normalizing volume levels") );
     m_normalizeJob->start();
 }
@@ -737,18 +745,8 @@ void K3b::AudioJob::slotNormalizeJobFinished( bool success )
         return;
 
     if( success ) {
-        if( m_doc->onlyCreateImages() ) {
-            jobFinished(true);
-        }
-        else {
-            // start the writing
-            if( !prepareWriter() ) {
-                cleanupAfterError();
-                jobFinished(false);
-            }
-            else
-                startWriting();
-        }
+        m_audioImager->setTrackGains( m_normalizeJob->trackGains() );
+        startDecoding();
     }
     else {
         cleanupAfterError();
@@ -758,16 +756,14 @@ void K3b::AudioJob::slotNormalizeJobFinished( bool success )
 
 void K3b::AudioJob::slotNormalizeProgress( int p )
 {
-    double totalTasks = d->copies+2.0;
-    double tasksDone = 1; // the decoding has been finished
-
-    emit percent( (int)((100.0*tasksDone + (double)p) / totalTasks) );
-}
-
-
-void K3b::AudioJob::slotNormalizeSubProgress( int p )
-{
-    emit subPercent( p );
+    // the normalizing is the first task
+    double totalTasks = 1.0;
+    if( !m_doc->onlyCreateImages() )
+        totalTasks += d->copies;
+    if( m_doc->onlyCreateImages() || !m_doc->onTheFly() )
+        totalTasks += 1.0;
+
+    emit percent( (int)((double)p / totalTasks) );
 }
 
 
@@ -65,7 +65,6 @@ namespace K3b {
         // normalizing slots
         void slotNormalizeJobFinished( bool );
         void slotNormalizeProgress( int );
-        void slotNormalizeSubProgress( int );
 
         // max speed
         void slotMaxSpeedJobFinished( bool );
@@ -75,7 +74,8 @@ namespace K3b {
         bool startWriting();
         void cleanupAfterError();
         void removeBufferFiles();
-        void normalizeFiles();
+        void normalizeTracks();
+        void startDecoding();
         bool writeTocFile();
         bool writeInfFiles();
         bool checkAudioSources();
@@ -0,0 +1,250 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baudioloudness.h"
+
+#include <QVector>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+namespace {
+    const int s_sampleRate = 44100;
+
+    // gating blocks of 400 ms are assembled from steps of 100 ms
+    const int s_stepFrames = s_sampleRate / 10;
+    const int s_blockSteps = 4;
+
+    const double s_absoluteGate = -70.0;
+    const double s_relativeGate = -10.0;
+
+    double loudness( double energy )
+    {
+        return -0.691 + 10.0 * ::log10( energy );
+    }
+
+    double energy( double loudness )
+    {
+        return ::pow( 10.0, ( loudness + 0.691 ) / 10.0 );
+    }
+
+    // Direct form II transposed biquad
+    struct Biquad
+    {
+        double b0, b1, b2, a1, a2;
+
+        double filter( double x, double* z ) const {
+            const double y = b0*x + z[0];
+            z[0] = b1*x - a1*y + z[1];
+            z[1] = b2*x - a2*y;
+            return y;
+        }
+    };
+}
+
+
+class K3b::AudioLoudnessMeter::Private
+{
+public:
+    Private();
+
+    void processFrame( const unsigned char* frame );
+
+    // the K-weighting: a high shelf followed by a high pass
+    Biquad shelf;
+    Biquad highPass;
+
+    // filter state per channel and stage
+    double z[2][2][2];
+
+    double stepEnergy[s_blockSteps];
+    int steps;
+    double sum;
+    int frames;
+
+    // mean square of each gating block
+    QVector<double> blocks;
+
+    int peak;
+
+    unsigned char carry[4];
+    int carryLen;
+};
+
+
+K3b::AudioLoudnessMeter::Private::Private()
+{
+    // The filters of ITU-R BS.1770 are specified for 48 kHz.
+    // Derive them for our sample rate from their analog prototypes.
+    double f0 = 1681.974450955533;
+    double q = 0.7071752369554196;
+    double k = ::tan( M_PI * f0 / s_sampleRate );
+    const double vh = ::pow( 10.0, 3.999843853973347 / 20.0 );
+    const double vb = ::pow( vh, 0.4996667741545416 );
+    double a0 = 1.0 + k/q + k*k;
+    shelf.b0 = ( vh + vb*k/q + k*k ) / a0;
+    shelf.b1 = 2.0 * ( k*k - vh ) / a0;
+    shelf.b2 = ( vh - vb*k/q + k*k ) / a0;
+    shelf.a1 = 2.0 * ( k*k - 1.0 ) / a0;
+    shelf.a2 = ( 1.0 - k/q + k*k ) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = ::tan( M_PI * f0 / s_sampleRate );
+    a0 = 1.0 + k/q + k*k;
+    highPass.b0 = 1.0;
+    highPass.b1 = -2.0;
+    highPass.b2 = 1.0;
+    highPass.a1 = 2.0 * ( k*k - 1.0 ) / a0;
+    highPass.a2 = ( 1.0 - k/q + k*k ) / a0;
+}
+
+
+void K3b::AudioLoudnessMeter::Private::processFrame( const unsigned char* frame )
+{
+    for( int channel = 0; channel < 2; ++channel ) {
+        const qint16 sample = static_cast<qint16>( ( frame[2*channel] << 8 ) | frame[2*channel+1] );
+        peak = qMax( peak, qAbs( int(sample) ) );
+
+        const double x = double(sample) / 32768.0;
+        const double y = highPass.filter( shelf.filter( x, z[channel][0] ), z[channel][1] );
+        sum += y*y;
+    }
+
+    if( ++frames == s_stepFrames ) {
+        stepEnergy[steps % s_blockSteps] = sum / double(s_stepFrames);
+        ++steps;
+        sum = 0.0;
+        frames = 0;
+
+        if( steps >= s_blockSteps ) {
+            double block = 0.0;
+            for( int i = 0; i < s_blockSteps; ++i )
+                block += stepEnergy[i];
+            blocks.append( block / double(s_blockSteps) );
+        }
+    }
+}
+
+
+K3b::AudioLoudnessMeter::AudioLoudnessMeter()
+    : d( new Private() )
+{
+    reset();
+}
+
+
+K3b::AudioLoudnessMeter::~AudioLoudnessMeter()
+{
+    delete d;
+}
+
+
+void K3b::AudioLoudnessMeter::reset()
+{
+    ::memset( d->z, 0, sizeof(d->z) );
+    ::memset( d->stepEnergy, 0, sizeof(d->stepEnergy) );
+    d->steps = 0;
+    d->sum = 0.0;
+    d->frames = 0;
+    d->blocks.clear();
+    d->peak = 0;
+    d->carryLen = 0;
+}
+
+
+void K3b::AudioLoudnessMeter::process( const char* data, qint64 len )
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>( data );
+
+    // complete a frame split by the previous call
+    while( d->carryLen > 0 && len > 0 ) {
+        d->carry[d->carryLen++] = *p++;
+        --len;
+        if( d->carryLen == 4 ) {
+            d->processFrame( d->carry );
+            d->carryLen = 0;
+        }
+    }
+
+    for( ; len >= 4; p += 4, len -= 4 )
+        d->processFrame( p );
+
+    for( ; len > 0; --len )
+        d->carry[d->carryLen++] = *p++;
+}
+
+
+double K3b::AudioLoudnessMeter::integratedLoudness() const
+{
+    double threshold = energy( s_absoluteGate );
+
+    // two passes: the absolute gate yields the relative gate
+    for( int pass = 0; pass < 2; ++pass ) {
+        double sum = 0.0;
+        int count = 0;
+        for( int i = 0; i < d->blocks.count(); ++i ) {
+            if( d->blocks[i] > threshold ) {
+                sum += d->blocks[i];
+                ++count;
+            }
+        }
+
+        if( count == 0 )
+            return -std::numeric_limits<double>::infinity();
+        else if( pass == 0 )
+            threshold = qMax( threshold, energy( loudness( sum / count ) + s_relativeGate ) );
+        else
+            return loudness( sum / count );
+    }
+
+    return -std::numeric_limits<double>::infinity();
+}
+
+
+double K3b::AudioLoudnessMeter::samplePeak() const
+{
+    return double(d->peak) / 32768.0;
+}
+
+
+double K3b::AudioLoudnessMeter::referenceLoudness()
+{
+    return -18.0;
+}
+
+
+double K3b::AudioLoudnessMeter::gain( double loudness, double peak, double target )
+{
+    // also catches -infinity
+    if( !( loudness > s_absoluteGate ) || peak <= 0.0 )
+        return 1.0;
+
+    double g = ::pow( 10.0, ( target - loudness ) / 20.0 );
+    if( g * peak > 1.0 )
+        g = 1.0 / peak;
+    return g;
+}
+
+
+void K3b::AudioLoudnessMeter::applyGain( char* data, qint64 len, double gain )
+{
+    unsigned char* p = reinterpret_cast<unsigned char*>( data );
+    for( qint64 i = 0; i+1 < len; i += 2 ) {
+        const qint16 sample = static_cast<qint16>( ( p[i] << 8 ) | p[i+1] );
+        const long scaled = qBound( -32768L, ::lround( double(sample) * gain ), 32767L );
+        p[i] = static_cast<unsigned char>( ( scaled >> 8 ) & 0xff );
+        p[i+1] = static_cast<unsigned char>( scaled & 0xff );
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_AUDIO_LOUDNESS_H_
+#define _K3B_AUDIO_LOUDNESS_H_
+
+#include "k3b_export.h"
+
+#include <QtGlobal>
+
+namespace K3b {
+    /**
+     * Measures the integrated loudness of audio data according to
+     * EBU R128 (ITU-R BS.1770): the signal is K-weighted, split into
+     * gating blocks of 400 ms overlapping by 75% and the blocks below
+     * -70 LUFS and 10 LU below the ungated loudness are ignored.
+     *
+     * The data has to be 16 bit big endian stereo samples at 44100 Hz
+     * as delivered by the AudioDecoder and AudioTrackReader.
+     */
+    class LIBK3B_EXPORT AudioLoudnessMeter
+    {
+    public:
+        AudioLoudnessMeter();
+        ~AudioLoudnessMeter();
+
+        void reset();
+
+        /**
+         * Feed the meter. \p len does not need to be a multiple of
+         * the frame size.
+         */
+        void process( const char* data, qint64 len );
+
+        /**
+         * \return The integrated loudness in LUFS or -infinity if
+         *         all of the data was gated, ie. silence.
+         */
+        double integratedLoudness() const;
+
+        /**
+         * \return The highest absolute sample value in the range [0,1].
+         */
+        double samplePeak() const;
+
+        /**
+         * The loudness tracks are normalized to. This is the ReplayGain 2.0
+         * reference level.
+         */
+        static double referenceLoudness();
+
+        /**
+         * \return The factor which brings audio of \p loudness to \p target.
+         *         It is limited so that \p peak is not clipped. Silence is
+         *         never amplified.
+         */
+        static double gain( double loudness, double peak, double target = referenceLoudness() );
+
+        /**
+         * Multiplies 16 bit big endian samples with \p gain in place,
+         * clipping at the limits of the sample range. A trailing odd
+         * byte is left untouched.
+         */
+        static void applyGain( char* data, qint64 len, double gain );
+
+    private:
+        class Private;
+        Private* const d;
+
+        Q_DISABLE_COPY(AudioLoudnessMeter)
+    };
+}
+
+#endif
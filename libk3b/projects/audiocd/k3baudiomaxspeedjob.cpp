@@ -19,7 +19,6 @@
 #include "k3baudiocdtracksource.h"
 #include "k3baudiodatasourceiterator.h"
 #include "k3bdevice.h"
-#include "k3bthread.h"
 #include "k3b_i18n.h"
 
 #include <QDateTime>
@@ -119,6 +118,7 @@ K3b::AudioMaxSpeedJob::AudioMaxSpeedJob( K3b::AudioDoc* doc, K3b::JobHandler* jh
 {
     d->doc = doc;
     d->buffer = new char[2352*10];
+    setPriority( WorkerPool::Background );
 }
 
 
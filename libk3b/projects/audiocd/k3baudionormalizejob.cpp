@@ -14,190 +14,377 @@
 
 
 #include "k3baudionormalizejob.h"
-#include "k3bexternalbinmanager.h"
-#include "k3bprocess.h"
-#include "k3bcore.h"
+#include "k3baudiodoc.h"
+#include "k3baudiotrack.h"
+#include "k3baudiofile.h"
+#include "k3baudiozerodata.h"
+#include "k3baudiodecoder.h"
+#include "k3baudioloudness.h"
+#include "k3btaskgroup.h"
 #include "k3b_i18n.h"
 
+#include <KConfigCore/KConfig>
+#include <KConfigCore/KConfigGroup>
+
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QMap>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUrl>
+
+#include <cmath>
+#include <cstring>
+
+
+namespace {
+    const char s_cacheFile[] = "k3bloudnesscache";
+    const int s_maxCacheEntries = 2000;
+
+    // a source of a track, null decoders stand for silence
+    struct Segment
+    {
+        K3b::AudioDecoder* decoder;
+        K3b::Msf startOffset;
+        qint64 length;
+    };
+
+    /**
+     * Identifies the audio of a track by its sources. Empty if the
+     * track contains sources which cannot be decoded on their own.
+     */
+    QString trackKey( K3b::AudioTrack* track )
+    {
+        QCryptographicHash hash( QCryptographicHash::Sha1 );
+        for( K3b::AudioDataSource* source = track->firstSource(); source; source = source->next() ) {
+            if( K3b::AudioFile* file = dynamic_cast<K3b::AudioFile*>( source ) ) {
+                QFileInfo info( file->filename() );
+                hash.addData( QFile::encodeName( info.absoluteFilePath() ) );
+                hash.addData( QByteArray::number( info.size() ) );
+                hash.addData( QByteArray::number( info.lastModified().toMSecsSinceEpoch() ) );
+            }
+            else if( dynamic_cast<K3b::AudioZeroData*>( source ) ) {
+                hash.addData( "zero" );
+            }
+            else {
+                return QString();
+            }
+            hash.addData( QByteArray::number( source->startOffset().lba() ) );
+            hash.addData( QByteArray::number( source->length().lba() ) );
+        }
+        return QString::fromLatin1( hash.result().toHex() );
+    }
 
+    void pruneCache( KConfig& c )
+    {
+        const QStringList groups = c.groupList();
+        if( groups.count() <= s_maxCacheEntries )
+            return;
 
-K3b::AudioNormalizeJob::AudioNormalizeJob( K3b::JobHandler* hdl, QObject* parent )
-    : K3b::Job( hdl, parent ),
-      m_process(0)
-{
+        QMultiMap<qint64, QString> byAge;
+        Q_FOREACH( const QString& group, groups ) {
+            byAge.insert( c.group( group ).readEntry( "lastUsed", qint64( 0 ) ), group );
+        }
+        int remove = groups.count() - s_maxCacheEntries;
+        for( QMultiMap<qint64, QString>::const_iterator it = byAge.constBegin(); remove > 0; ++it, --remove ) {
+            c.deleteGroup( it.value() );
+        }
+    }
 }
 
 
-K3b::AudioNormalizeJob::~AudioNormalizeJob()
+class K3b::AudioNormalizeJob::Task : public K3b::TaskGroup::Task
 {
-    delete m_process;
-}
+public:
+    Task( int i, const QString& k )
+        : index( i ),
+          key( k ),
+          success( false ),
+          loudness( 0.0 ),
+          peak( 0.0 ) {
+    }
 
+    ~Task() {
+        Q_FOREACH( const Segment& segment, segments ) {
+            delete segment.decoder;
+        }
+    }
 
-void K3b::AudioNormalizeJob::start()
-{
-    m_canceled = false;
-    m_currentAction = COMPUTING_LEVELS;
-    m_currentTrack = 1;
+    void runTask();
 
-    jobStarted();
+    bool measure();
 
-    if( m_process )
-        delete m_process;
+    int index;
+    QString key;
+    QList<Segment> segments;
 
-    m_process = new K3b::Process();
-    connect( m_process, SIGNAL(stderrLine(QString)), this, SLOT(slotStdLine(QString)) );
-    connect( m_process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotProcessExited(int,QProcess::ExitStatus)) );
+    // in frames, polled by the job
+    QAtomicInt processed;
 
-    const K3b::ExternalBin* bin = k3bcore->externalBinManager()->binObject( "normalize" );
+    bool success;
+    double loudness;
+    double peak;
+};
 
-    if( !bin ) {
-        emit infoMessage( i18n("Could not find normalize executable."), MessageError );
-        jobFinished(false);
-        return;
-    }
 
-    if( !bin->copyright().isEmpty() )
-        emit infoMessage( i18n("Using %1 %2 – Copyright © %3",bin->name(),bin->version(),bin->copyright()), MessageInfo );
+class K3b::AudioNormalizeJob::Private
+{
+public:
+    AudioDoc* doc;
+    QVector<double> gains;
+
+    QList<Task*> tasks;
+    qint64 totalFrames;
+    qint64 finishedFrames;
+    bool canceled;
+    bool failed;
+
+    QTimer progressTimer;
 
-    // create the commandline
-    *m_process << bin;
+    // owns the tasks until slotTaskFinished()
+    TaskGroup taskGroup;
+};
 
-    // additional user parameters from config
-    const QStringList& params = bin->userParameters();
-    for( QStringList::const_iterator it = params.begin(); it != params.end(); ++it )
-        *m_process << *it;
 
-    // end the options
-    *m_process << "--";
+void K3b::AudioNormalizeJob::Task::runTask()
+{
+    success = measure();
+}
 
-    // add the files
-    for( int i = 0; i < m_files.count(); ++i )
-        *m_process << m_files[i];
 
-    // now start the process
-    if( !m_process->start( KProcess::OnlyStderrChannel ) ) {
-        // something went wrong when starting the program
-        // it "should" be the executable
-        qDebug() << "(K3b::AudioNormalizeJob) could not start normalize";
-        emit infoMessage( i18n("Could not start normalize."), K3b::Job::MessageError );
-        jobFinished(false);
+bool K3b::AudioNormalizeJob::Task::measure()
+{
+    AudioLoudnessMeter meter;
+    char buffer[10*2352];
+    qint64 bytes = 0;
+
+    Q_FOREACH( const Segment& segment, segments ) {
+        if( segment.decoder &&
+            !( segment.decoder->analyseFile() && segment.decoder->initDecoder( segment.startOffset ) ) ) {
+            qDebug() << "(K3b::AudioNormalizeJob) unable to decode" << segment.decoder->filename();
+            return false;
+        }
+
+        qint64 remaining = segment.length;
+        while( remaining > 0 ) {
+            if( isCanceled() )
+                return false;
+
+            int len = static_cast<int>( qMin<qint64>( sizeof(buffer), remaining ) );
+            if( segment.decoder ) {
+                len = segment.decoder->decode( buffer, len );
+                if( len < 0 )
+                    return false;
+                else if( len == 0 )
+                    break;
+            }
+            else {
+                ::memset( buffer, 0, len );
+            }
+
+            meter.process( buffer, len );
+            remaining -= len;
+            bytes += len;
+            processed.store( static_cast<int>( bytes / 2352 ) );
+        }
     }
+
+    loudness = meter.integratedLoudness();
+    peak = meter.samplePeak();
+    return true;
 }
 
 
-void K3b::AudioNormalizeJob::cancel()
+K3b::AudioNormalizeJob::AudioNormalizeJob( K3b::AudioDoc* doc, K3b::JobHandler* hdl, QObject* parent )
+    : K3b::Job( hdl, parent ),
+      d( new Private() )
 {
-    m_canceled = true;
+    d->doc = doc;
+    d->progressTimer.setInterval( 500 );
+    connect( &d->progressTimer, SIGNAL(timeout()), this, SLOT(slotProgress()) );
+    connect( &d->taskGroup, SIGNAL(taskFinished()), this, SLOT(slotTaskFinished()) );
+}
 
-    if( m_process )
-        if( m_process->isRunning() ) {
-            m_process->kill();
-        }
+
+K3b::AudioNormalizeJob::~AudioNormalizeJob()
+{
+    // the task group waits for the running tasks
+    delete d;
+}
+
+
+QVector<double> K3b::AudioNormalizeJob::trackGains() const
+{
+    return d->gains;
 }
 
 
-void K3b::AudioNormalizeJob::slotStdLine( const QString& line )
+void K3b::AudioNormalizeJob::start()
 {
-    // percent, subPercent, newTask (compute level and adjust)
+    jobStarted();
 
-    //  emit newSubTask( i18n("Normalizing track %1 of %2 (%3)",t,tt,m_files.at(t-1)) );
+    d->canceled = false;
+    d->failed = false;
+    d->totalFrames = 0;
+    d->finishedFrames = 0;
+    d->gains.fill( 1.0, d->doc->numOfTracks() );
 
-    emit debuggingOutput( "normalize", line );
+    KConfig cache( QLatin1String( s_cacheFile ), KConfig::SimpleConfig, QStandardPaths::GenericCacheLocation );
 
-    // wenn "% done" drin:
-    //    wenn ein --% drin ist, so beginnt ein neuer track
-    //    sonst prozent parsen "batch xxx" ist der fortschritt der action
-    //                         also ev. den batch fortschritt * 1/2
+    int index = 0;
+    for( AudioTrack* track = d->doc->firstTrack(); track; track = track->next(), ++index ) {
+        const QString key = trackKey( track );
+        if( key.isEmpty() ) {
+            emit infoMessage( i18n("Track %1 cannot be normalized.", index+1), MessageWarning );
+            continue;
+        }
 
-    if( line.startsWith( "Applying adjustment" ) ) {
-        if( m_currentAction == COMPUTING_LEVELS ) {
-            // starting the adjustment with track 1
-            m_currentTrack = 1;
-            m_currentAction = ADJUSTING_LEVELS;
+        KConfigGroup grp = cache.group( key );
+        if( grp.hasKey( "loudness" ) ) {
+            d->gains[index] = AudioLoudnessMeter::gain( grp.readEntry( "loudness", 0.0 ),
+                                                        grp.readEntry( "peak", 0.0 ) );
+            emit debuggingOutput( QLatin1String( "Normalize" ),
+                                  QString::fromLatin1( "track %1 cached loudness: %2 LUFS peak: %3 gain: %4" )
+                                  .arg( index+1 )
+                                  .arg( grp.readEntry( "loudness", 0.0 ) )
+                                  .arg( grp.readEntry( "peak", 0.0 ) )
+                                  .arg( d->gains[index] ) );
+            grp.writeEntry( "lastUsed", QDateTime::currentMSecsSinceEpoch() );
+            continue;
         }
+
+        // Every task uses its own decoders since the ones of the
+        // project are shared between the tracks of a file.
+        Task* task = new Task( index, key );
+        for( AudioDataSource* source = track->firstSource(); source; source = source->next() ) {
+            Segment segment = { 0, source->startOffset(), source->length().audioBytes() };
+            if( AudioFile* file = dynamic_cast<AudioFile*>( source ) ) {
+                segment.decoder = AudioDecoderFactory::createDecoder( QUrl::fromLocalFile( file->filename() ) );
+                if( !segment.decoder ) {
+                    delete task;
+                    task = 0;
+                    break;
+                }
+                segment.decoder->setFilename( file->filename() );
+            }
+            task->segments.append( segment );
+        }
+
+        if( !task ) {
+            emit infoMessage( i18n("Track %1 cannot be normalized.", index+1), MessageWarning );
+            continue;
+        }
+
+        d->tasks.append( task );
+        d->totalFrames += track->length().lba();
     }
 
-    else if( line.contains( "already normalized" ) ) {
-        // no normalization necessary for the current track
-        emit infoMessage( i18n("Track %1 is already normalized.",m_currentTrack), MessageInfo );
-        m_currentTrack++;
+    if( d->tasks.isEmpty() ) {
+        finish();
+        return;
     }
 
-    else if( line.contains( "--% done") ) {
-        if( m_currentAction == ADJUSTING_LEVELS ) {
-            emit newTask( i18n("Adjusting volume level for track %1 of %2",m_currentTrack,m_files.count()) );
-            qDebug() << "(K3b::AudioNormalizeJob) adjusting level for track "
-                     << m_currentTrack
-                     << " "
-                     << m_files.at(m_currentTrack-1)
-                     << endl;
-        }
-        else {
-            emit newTask( i18n("Computing level for track %1 of %2",m_currentTrack,m_files.count()) );
-            qDebug() << "(K3b::AudioNormalizeJob) computing level for track "
-                     << m_currentTrack
-                     << " "
-                     << m_files.at(m_currentTrack-1)
-                     << endl;
-        }
+    emit newTask( i18n("Measuring loudness of %1 tracks", d->tasks.count()) );
 
-        m_currentTrack++;
+    Q_FOREACH( Task* task, d->tasks ) {
+        d->taskGroup.submit( task, WorkerPool::Interactive );
     }
+    d->progressTimer.start();
+}
 
-    else if( int pos = line.indexOf( "% done" ) > 0 ) {
-        // parse progress: "XXX% done" and "batch XXX% done"
-        pos -= 3;
-        bool ok;
-        // TODO: do not use fixed values
-        // track progress starts at position 19 in version 0.7.6
-        int p = line.mid( 19, 3 ).toInt(&ok);
-        if( ok )
-            emit subPercent( p );
-        else
-            qDebug() << "(K3b::AudioNormalizeJob) subPercent parsing error at pos "
-                     << 19 << " in line '" << line.mid( 19, 3 ) << "'" << endl;
-
-        // batch progress starts at position 50 in version 0.7.6
-        p = line.mid( 50, 3 ).toInt(&ok);
-        if( ok && m_currentAction == COMPUTING_LEVELS )
-            emit percent( (int)((double)p/2.0) );
-        else if( ok && m_currentAction == ADJUSTING_LEVELS )
-            emit percent( 50 + (int)((double)p/2.0) );
-        else
-            qDebug() << "(K3b::AudioNormalizeJob) percent parsing error at pos "
-                     << 50 << " in line '" << line.mid( 50, 3 ) << "'" << endl;
 
+void K3b::AudioNormalizeJob::cancel()
+{
+    d->canceled = true;
+
+    for( QList<Task*>::iterator it = d->tasks.begin(); it != d->tasks.end(); ) {
+        if( d->taskGroup.cancel( *it ) )
+            it = d->tasks.erase( it );
+        else
+            ++it;
     }
+
+    // otherwise slotTaskFinished() finishes
+    if( d->tasks.isEmpty() && active() )
+        finish();
 }
 
 
-void K3b::AudioNormalizeJob::slotProcessExited( int exitCode, QProcess::ExitStatus exitStatus )
+void K3b::AudioNormalizeJob::slotTaskFinished()
 {
-    if( exitStatus == QProcess::NormalExit ) {
-        switch( exitCode ) {
-        case 0:
-            emit infoMessage( i18n("Successfully normalized all tracks."), MessageSuccess );
-            jobFinished(true);
-            break;
-        default:
-            if( !m_canceled ) {
-                emit infoMessage( i18n("%1 returned an unknown error (code %2).",QString("normalize"), exitCode),
-                                  K3b::Job::MessageError );
-                emit infoMessage( i18n("Please send me an email with the last output."), K3b::Job::MessageError );
-                emit infoMessage( i18n("Error while normalizing tracks."), MessageError );
-            }
-            else
-                emit canceled();
-            jobFinished(false);
-            break;
+    const QList<TaskGroup::Task*> finished = d->taskGroup.takeFinished();
+    if( finished.isEmpty() )
+        return;
+
+    KConfig cache( QLatin1String( s_cacheFile ), KConfig::SimpleConfig, QStandardPaths::GenericCacheLocation );
+
+    Q_FOREACH( TaskGroup::Task* t, finished ) {
+        Task* task = static_cast<Task*>( t );
+        d->tasks.removeOne( task );
+        d->finishedFrames += task->processed.load();
+
+        if( task->success ) {
+            d->gains[task->index] = AudioLoudnessMeter::gain( task->loudness, task->peak );
+            emit debuggingOutput( QLatin1String( "Normalize" ),
+                                  QString::fromLatin1( "track %1 loudness: %2 LUFS peak: %3 gain: %4" )
+                                  .arg( task->index+1 )
+                                  .arg( task->loudness )
+                                  .arg( task->peak )
+                                  .arg( d->gains[task->index] ) );
+
+            // silence is stored below the absolute gate
+            KConfigGroup grp = cache.group( task->key );
+            grp.writeEntry( "loudness", std::isfinite( task->loudness ) ? task->loudness : -1000.0 );
+            grp.writeEntry( "peak", task->peak );
+            grp.writeEntry( "lastUsed", QDateTime::currentMSecsSinceEpoch() );
+        }
+        else if( !d->canceled && !task->isCanceled() ) {
+            emit infoMessage( i18n("Unable to decode track %1.", task->index+1), MessageError );
+            d->failed = true;
         }
+
+        delete task;
     }
-    else {
-        emit infoMessage( i18n("%1 did not exit cleanly.",QString("Normalize")), K3b::Job::MessageError );
-        jobFinished( false );
+
+    pruneCache( cache );
+    cache.sync();
+
+    if( d->tasks.isEmpty() )
+        finish();
+}
+
+
+void K3b::AudioNormalizeJob::slotProgress()
+{
+    qint64 frames = d->finishedFrames;
+    Q_FOREACH( Task* task, d->tasks ) {
+        frames += task->processed.load();
     }
+
+    if( d->totalFrames > 0 )
+        emit percent( static_cast<int>( 100LL * qMin( frames, d->totalFrames ) / d->totalFrames ) );
 }
 
 
+void K3b::AudioNormalizeJob::finish()
+{
+    d->progressTimer.stop();
+
+    if( d->canceled ) {
+        emit canceled();
+        jobFinished( false );
+    }
+    else if( d->failed ) {
+        emit infoMessage( i18n("Error while normalizing tracks."), MessageError );
+        jobFinished( false );
+    }
+    else {
+        emit percent( 100 );
+        emit infoMessage( i18n("Determined the volume levels of all tracks."), MessageSuccess );
+        jobFinished( true );
+    }
+}
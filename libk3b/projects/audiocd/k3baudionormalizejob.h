@@ -19,43 +19,48 @@
 
 #include "k3bjob.h"
 
-#include <QList>
-#include <QProcess>
+#include <QVector>
 
 namespace K3b {
-    class Process;
-
+    class AudioDoc;
+
+    /**
+     * Determines the volume adjustment of every track of an audio project.
+     *
+     * The loudness of the tracks is measured according to EBU R128 by
+     * decoding them in parallel on the WorkerPool. Nothing is written,
+     * the AudioImager applies the resulting gains while decoding the tracks
+     * for writing. Measurements are cached so the same tracks are not
+     * decoded again when burning them another time.
+     */
     class AudioNormalizeJob : public Job
     {
         Q_OBJECT
 
     public:
-        explicit AudioNormalizeJob( JobHandler*, QObject* parent = 0 );
+        AudioNormalizeJob( AudioDoc* doc, JobHandler*, QObject* parent = 0 );
         ~AudioNormalizeJob();
 
+        /**
+         * The factors to apply to the tracks in the order of the project.
+         * Only valid after the job finished successfully.
+         */
+        QVector<double> trackGains() const;
+
     public Q_SLOTS:
         void start();
         void cancel();
 
-        void setFilesToNormalize( const QList<QString>& files ) { m_files = files; }
-
     private Q_SLOTS:
-        void slotStdLine( const QString& line );
-        void slotProcessExited( int exitCode, QProcess::ExitStatus exitStatus );
+        void slotTaskFinished();
+        void slotProgress();
 
     private:
-        Process* m_process;
-
-        QList<QString> m_files;
-        bool m_canceled;
-
-        enum Action {
-            COMPUTING_LEVELS,
-            ADJUSTING_LEVELS
-        };
+        void finish();
 
-        int m_currentAction;
-        int m_currentTrack;
+        class Task;
+        class Private;
+        Private* const d;
     };
 }
 
@@ -0,0 +1,297 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baudiopeakextractor.h"
+#include "k3baudiodatasource.h"
+#include "k3baudiofile.h"
+#include "k3baudiotrack.h"
+#include "k3baudiozerodata.h"
+#include "k3baudiodecoder.h"
+#include "k3btaskgroup.h"
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <cmath>
+
+
+namespace {
+    // frames are cached in memory up to 32 MB worth of peaks
+    const int s_maxMemoryCost = 32*1024;
+
+    K3b::AudioPeakExtractor* s_instance = 0;
+
+    struct CacheEntry
+    {
+        K3b::AudioPeaks peaks;
+        QDateTime modified;
+        qint64 size;
+    };
+
+    QString cacheFileName( const QFileInfo& info )
+    {
+        QCryptographicHash hash( QCryptographicHash::Sha1 );
+        hash.addData( QFile::encodeName( info.absoluteFilePath() ) );
+        hash.addData( QByteArray::number( info.size() ) );
+        hash.addData( QByteArray::number( info.lastModified().toMSecsSinceEpoch() ) );
+
+        return QStandardPaths::writableLocation( QStandardPaths::CacheLocation )
+            + QLatin1String( "/peaks/" )
+            + QString::fromLatin1( hash.result().toHex() )
+            + QLatin1String( ".peaks" );
+    }
+}
+
+
+class K3b::AudioPeakExtractor::Task : public K3b::TaskGroup::Task
+{
+public:
+    Task( AudioDecoder* dec, const QFileInfo& info )
+        : decoder( dec ),
+          filename( info.absoluteFilePath() ),
+          cacheFile( cacheFileName( info ) ),
+          modified( info.lastModified() ),
+          size( info.size() ) {
+    }
+
+    ~Task() {
+        delete decoder;
+    }
+
+    void runTask();
+
+    AudioPeaks decode();
+
+    AudioDecoder* decoder;
+    QString filename;
+    QString cacheFile;
+    QDateTime modified;
+    qint64 size;
+
+    AudioPeaks peaks;
+};
+
+
+class K3b::AudioPeakExtractor::Private
+{
+public:
+    Private()
+        : cache( s_maxMemoryCost ) {
+    }
+
+    QCache<QString, CacheEntry> cache;
+    QHash<QString, Task*> tasks;
+
+    // owns the tasks until slotTaskFinished()
+    TaskGroup taskGroup;
+};
+
+
+void K3b::AudioPeakExtractor::Task::runTask()
+{
+    QFile f( cacheFile );
+    if( f.open( QIODevice::ReadOnly ) ) {
+        QDataStream s( &f );
+        peaks = AudioPeaks::load( s );
+        f.close();
+    }
+
+    if( peaks.isNull() ) {
+        peaks = decode();
+
+        if( !peaks.isNull() ) {
+            QDir().mkpath( QFileInfo( cacheFile ).absolutePath() );
+            QSaveFile out( cacheFile );
+            if( out.open( QIODevice::WriteOnly ) ) {
+                QDataStream s( &out );
+                peaks.save( s );
+                out.commit();
+            }
+            else {
+                qDebug() << "(K3b::AudioPeakExtractor) unable to write" << cacheFile;
+            }
+        }
+    }
+}
+
+
+K3b::AudioPeaks K3b::AudioPeakExtractor::Task::decode()
+{
+    decoder->setFilename( filename );
+    if( !decoder->analyseFile() ) {
+        qDebug() << "(K3b::AudioPeakExtractor) unable to decode" << filename;
+        return AudioPeaks();
+    }
+
+    // the decoder delivers 16 bit big endian stereo samples, 588 per frame
+    const int samplesPerFrame = 588*2;
+    QVector<AudioPeaks::Peak> frames;
+    frames.reserve( decoder->length().lba() );
+
+    AudioPeaks::Peak current;
+    double sumOfSquares = 0.0;
+    int samples = 0;
+
+    char buffer[10*2352];
+    int len = 0;
+    while( !isCanceled() && ( len = decoder->decode( buffer, sizeof(buffer) ) ) > 0 ) {
+        for( int i = 0; i+1 < len; i += 2 ) {
+            const qint16 sample = static_cast<qint16>( ( static_cast<unsigned char>( buffer[i] ) << 8 ) |
+                                                       static_cast<unsigned char>( buffer[i+1] ) );
+            if( samples == 0 )
+                current.min = current.max = sample;
+            else {
+                current.min = qMin( current.min, sample );
+                current.max = qMax( current.max, sample );
+            }
+            sumOfSquares += double(sample) * double(sample);
+
+            if( ++samples == samplesPerFrame ) {
+                current.rms = static_cast<quint16>( ::sqrt( sumOfSquares / samples ) );
+                frames.append( current );
+                sumOfSquares = 0.0;
+                samples = 0;
+            }
+        }
+    }
+
+    if( len < 0 || isCanceled() )
+        return AudioPeaks();
+
+    // the last frame is padded with silence on the disc
+    if( samples > 0 ) {
+        current.min = qMin<qint16>( current.min, 0 );
+        current.max = qMax<qint16>( current.max, 0 );
+        current.rms = static_cast<quint16>( ::sqrt( sumOfSquares / samplesPerFrame ) );
+        frames.append( current );
+    }
+
+    return AudioPeaks( frames );
+}
+
+
+K3b::AudioPeakExtractor::AudioPeakExtractor()
+    : QObject( QCoreApplication::instance() ),
+      d( new Private )
+{
+    connect( &d->taskGroup, SIGNAL(taskFinished()), this, SLOT(slotTaskFinished()) );
+}
+
+
+K3b::AudioPeakExtractor::~AudioPeakExtractor()
+{
+    s_instance = 0;
+
+    // the task group waits for the running tasks
+    delete d;
+}
+
+
+K3b::AudioPeakExtractor* K3b::AudioPeakExtractor::instance()
+{
+    if( !s_instance )
+        s_instance = new AudioPeakExtractor();
+    return s_instance;
+}
+
+
+K3b::AudioPeaks K3b::AudioPeakExtractor::peaks( const QString& filename )
+{
+    QFileInfo info( filename );
+    if( !info.isFile() )
+        return AudioPeaks();
+
+    const QString key = info.absoluteFilePath();
+    if( CacheEntry* entry = d->cache.object( key ) ) {
+        // a null entry means the file could not be decoded
+        if( entry->modified == info.lastModified() && entry->size == info.size() )
+            return entry->peaks;
+    }
+
+    if( !d->tasks.contains( key ) ) {
+        AudioDecoder* decoder = AudioDecoderFactory::createDecoder( QUrl::fromLocalFile( key ) );
+        if( !decoder ) {
+            d->cache.insert( key, new CacheEntry{ AudioPeaks(), info.lastModified(), info.size() }, 0 );
+            return AudioPeaks();
+        }
+
+        Task* task = new Task( decoder, info );
+        d->tasks.insert( key, task );
+        d->taskGroup.submit( task, WorkerPool::Background );
+    }
+
+    return AudioPeaks();
+}
+
+
+K3b::AudioPeaks K3b::AudioPeakExtractor::sourcePeaks( AudioDataSource* source )
+{
+    if( AudioFile* file = dynamic_cast<AudioFile*>( source ) ) {
+        return peaks( file->filename() );
+    }
+    else if( dynamic_cast<AudioZeroData*>( source ) ) {
+        return AudioPeaks( QVector<AudioPeaks::Peak>( source->originalLength().lba() ) );
+    }
+    else {
+        return AudioPeaks();
+    }
+}
+
+
+K3b::AudioPeaks K3b::AudioPeakExtractor::trackPeaks( AudioTrack* track )
+{
+    QVector<AudioPeaks::Peak> frames;
+    bool complete = true;
+    for( AudioDataSource* source = track->firstSource(); source; source = source->next() ) {
+        // request all sources even if one is missing already
+        AudioPeaks p = sourcePeaks( source );
+        if( p.isNull() )
+            complete = false;
+        else if( complete )
+            frames += p.frames( source->startOffset(), source->length() );
+    }
+
+    if( complete )
+        return AudioPeaks( frames );
+    else
+        return AudioPeaks();
+}
+
+
+void K3b::AudioPeakExtractor::slotTaskFinished()
+{
+    Q_FOREACH( TaskGroup::Task* t, d->taskGroup.takeFinished() ) {
+        Task* task = static_cast<Task*>( t );
+        d->tasks.remove( task->filename );
+
+        // the cost is the size of the pyramid in KB
+        d->cache.insert( task->filename,
+                         new CacheEntry{ task->peaks, task->modified, task->size },
+                         task->peaks.length().lba() * 12 / 1024 );
+
+        const QString filename = task->filename;
+        delete task;
+        emit peaksReady( filename );
+    }
+}
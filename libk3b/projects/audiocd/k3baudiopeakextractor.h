@@ -0,0 +1,87 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_AUDIO_PEAK_EXTRACTOR_H_
+#define _K3B_AUDIO_PEAK_EXTRACTOR_H_
+
+#include "k3b_export.h"
+#include "k3baudiopeaks.h"
+
+#include <QObject>
+#include <QString>
+
+namespace K3b {
+    class AudioDataSource;
+    class AudioTrack;
+
+    /**
+     * Provides the waveforms of audio files.
+     *
+     * Each file is decoded once in the background by the WorkerPool. The
+     * resulting AudioPeaks are kept in memory and in the user's cache
+     * directory so they survive a restart as long as the file does not
+     * change.
+     *
+     * All methods have to be called from the GUI thread.
+     */
+    class LIBK3B_EXPORT AudioPeakExtractor : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        ~AudioPeakExtractor();
+
+        static AudioPeakExtractor* instance();
+
+        /**
+         * \return The peaks of \p filename or a null object if they are not
+         *         available yet. In the latter case the extraction is started
+         *         and peaksReady() is emitted once it is done.
+         */
+        AudioPeaks peaks( const QString& filename );
+
+        /**
+         * The waveform of the complete source, ie. ignoring its offsets.
+         *
+         * Supports AudioFile and AudioZeroData sources. For all others a null
+         * object is returned.
+         */
+        AudioPeaks sourcePeaks( AudioDataSource* source );
+
+        /**
+         * The waveform of \p track assembled from the used parts of its sources.
+         *
+         * \return A null object as long as the peaks of one of the sources
+         *         are not available.
+         */
+        AudioPeaks trackPeaks( AudioTrack* track );
+
+    Q_SIGNALS:
+        /**
+         * Emitted once the peaks of \p filename have been extracted or loaded
+         * from the disk cache. The peaks are null if the file could not be decoded.
+         */
+        void peaksReady( const QString& filename );
+
+    private Q_SLOTS:
+        void slotTaskFinished();
+
+    private:
+        AudioPeakExtractor();
+
+        class Task;
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baudiopeaks.h"
+
+#include <QDataStream>
+#include <QSharedData>
+
+#include <cmath>
+
+
+namespace {
+    const quint32 s_magic = 0x4b334250; // "K3BP"
+    const quint16 s_version = 1;
+
+    // the peak of a range is combined from at least
+    // 1<<s_minValues and less than 2<<s_minValues values
+    const int s_minValues = 2;
+
+    K3b::AudioPeaks::Peak combine( const K3b::AudioPeaks::Peak& p1, const K3b::AudioPeaks::Peak& p2 )
+    {
+        K3b::AudioPeaks::Peak p;
+        p.min = qMin( p1.min, p2.min );
+        p.max = qMax( p1.max, p2.max );
+        p.rms = static_cast<quint16>( ::sqrt( ( double(p1.rms)*double(p1.rms) + double(p2.rms)*double(p2.rms) ) / 2.0 ) );
+        return p;
+    }
+}
+
+
+class K3b::AudioPeaks::Private : public QSharedData
+{
+public:
+    // levels[0] holds one value per frame
+    QVector<QVector<Peak> > levels;
+
+    void buildLevels() {
+        while( levels.last().count() > 1 ) {
+            const QVector<Peak>& below = levels.last();
+            QVector<Peak> level( ( below.count() + 1 ) / 2 );
+            for( int i = 0; i < level.count(); ++i ) {
+                if( 2*i+1 < below.count() )
+                    level[i] = combine( below[2*i], below[2*i+1] );
+                else
+                    level[i] = below[2*i];
+            }
+            levels.append( level );
+        }
+    }
+};
+
+
+K3b::AudioPeaks::AudioPeaks()
+    : d( new Private )
+{
+}
+
+
+K3b::AudioPeaks::AudioPeaks( const QVector<Peak>& frames )
+    : d( new Private )
+{
+    if( !frames.isEmpty() ) {
+        d->levels.append( frames );
+        d->buildLevels();
+    }
+}
+
+
+K3b::AudioPeaks::AudioPeaks( const AudioPeaks& other )
+    : d( other.d )
+{
+}
+
+
+K3b::AudioPeaks::~AudioPeaks()
+{
+}
+
+
+K3b::AudioPeaks& K3b::AudioPeaks::operator=( const AudioPeaks& other )
+{
+    d = other.d;
+    return *this;
+}
+
+
+bool K3b::AudioPeaks::isNull() const
+{
+    return d->levels.isEmpty();
+}
+
+
+K3b::Msf K3b::AudioPeaks::length() const
+{
+    return isNull() ? 0 : d->levels.first().count();
+}
+
+
+K3b::AudioPeaks::Peak K3b::AudioPeaks::peak( const Msf& first, const Msf& last ) const
+{
+    Peak p;
+    if( isNull() )
+        return p;
+
+    int start = qBound( 0, first.lba(), d->levels.first().count()-1 );
+    int end = qBound( start, last.lba(), d->levels.first().count()-1 );
+
+    // pick the level in which the range spans only a few values
+    int level = 0;
+    while( level+1 < d->levels.count() &&
+           ( (end-start+1) >> (level+1) ) >= (1<<s_minValues) )
+        ++level;
+
+    // Use the values starting inside the range. That way consecutive
+    // ranges, like the columns of a waveform, do not share any value.
+    const QVector<Peak>& values = d->levels[level];
+    const int first = ( start + (1<<level) - 1 ) >> level;
+    const int last = end >> level;
+    p = values[first];
+    for( int i = first+1; i <= last; ++i )
+        p = combine( p, values[i] );
+    return p;
+}
+
+
+QVector<K3b::AudioPeaks::Peak> K3b::AudioPeaks::frames( const Msf& start, const Msf& length ) const
+{
+    if( isNull() )
+        return QVector<Peak>( length.lba() );
+
+    QVector<Peak> f = d->levels.first().mid( start.lba(), length.lba() );
+    // pad in case the decoded length differs from the source's length
+    if( f.count() < length.lba() )
+        f.resize( length.lba() );
+    return f;
+}
+
+
+QList<K3b::Msf> K3b::AudioPeaks::silenceSplitPoints( double thresholdDb, const Msf& minLength ) const
+{
+    QList<Msf> points;
+    if( isNull() )
+        return points;
+
+    const int threshold = static_cast<int>( 32767.0 * ::pow( 10.0, thresholdDb / 20.0 ) );
+    const QVector<Peak>& frames = d->levels.first();
+
+    int silenceStart = -1;
+    bool sound = false;
+    for( int i = 0; i < frames.count(); ++i ) {
+        const bool silent = ( qAbs( int(frames[i].min) ) <= threshold &&
+                              qAbs( int(frames[i].max) ) <= threshold );
+        if( silent ) {
+            if( silenceStart < 0 )
+                silenceStart = i;
+        }
+        else {
+            // split at the first frame of the next song
+            if( sound && silenceStart >= 0 && i - silenceStart >= minLength.lba() )
+                points.append( i );
+            silenceStart = -1;
+            sound = true;
+        }
+    }
+
+    return points;
+}
+
+
+void K3b::AudioPeaks::save( QDataStream& s ) const
+{
+    s << s_magic << s_version << quint32( d->levels.count() );
+    for( int level = 0; level < d->levels.count(); ++level ) {
+        const QVector<Peak>& values = d->levels[level];
+        s << quint32( values.count() );
+        for( int i = 0; i < values.count(); ++i )
+            s << values[i].min << values[i].max << values[i].rms;
+    }
+}
+
+
+K3b::AudioPeaks K3b::AudioPeaks::load( QDataStream& s )
+{
+    quint32 magic = 0, levelCount = 0;
+    quint16 version = 0;
+    s >> magic >> version >> levelCount;
+    if( magic != s_magic || version != s_version || levelCount > 32 )
+        return AudioPeaks();
+
+    AudioPeaks peaks;
+    quint32 expected = 0;
+    for( quint32 level = 0; level < levelCount; ++level ) {
+        quint32 count = 0;
+        s >> count;
+        // every level has to be the half of the one below
+        if( s.status() != QDataStream::Ok ||
+            ( level > 0 && count != ( expected + 1 ) / 2 ) ||
+            count > 75*60*60*24 )
+            return AudioPeaks();
+
+        QVector<Peak> values( count );
+        for( quint32 i = 0; i < count; ++i )
+            s >> values[i].min >> values[i].max >> values[i].rms;
+        peaks.d->levels.append( values );
+        expected = count;
+    }
+
+    if( s.status() != QDataStream::Ok || ( levelCount > 0 && expected != 1 ) )
+        return AudioPeaks();
+
+    return peaks;
+}
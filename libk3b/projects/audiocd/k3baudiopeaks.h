@@ -0,0 +1,112 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_AUDIO_PEAKS_H_
+#define _K3B_AUDIO_PEAKS_H_
+
+#include "k3b_export.h"
+#include "k3bmsf.h"
+
+#include <QList>
+#include <QSharedDataPointer>
+#include <QVector>
+
+class QDataStream;
+
+namespace K3b {
+    /**
+     * The waveform of a piece of audio as a pyramid of peak values.
+     *
+     * The base level contains one Peak per audio frame (1/75 second),
+     * every following level half as many, each combining two values of the
+     * level below. This way the peak of an arbitrary range can be determined
+     * by combining a handful of values regardless of its length.
+     *
+     * AudioPeaks is implicitly shared.
+     *
+     * \see AudioPeakExtractor
+     */
+    class LIBK3B_EXPORT AudioPeaks
+    {
+    public:
+        struct Peak {
+            Peak()
+                : min( 0 ), max( 0 ), rms( 0 ) {
+            }
+
+            qint16 min;
+            qint16 max;
+            quint16 rms;
+        };
+
+        /**
+         * Creates a null object.
+         */
+        AudioPeaks();
+
+        /**
+         * Creates the pyramid from the per frame peaks in \p frames.
+         */
+        explicit AudioPeaks( const QVector<Peak>& frames );
+
+        AudioPeaks( const AudioPeaks& );
+        ~AudioPeaks();
+
+        AudioPeaks& operator=( const AudioPeaks& );
+
+        bool isNull() const;
+
+        /**
+         * The covered length.
+         */
+        Msf length() const;
+
+        /**
+         * \return The combined peak of the frames \p first to \p last, both included.
+         *         The range is rounded to the resolution of the level which
+         *         contains only a few values for it. Thus the cost does not
+         *         depend on the length of the range.
+         */
+        Peak peak( const Msf& first, const Msf& last ) const;
+
+        /**
+         * The per frame peaks of \p length frames starting at \p start. Used to
+         * assemble the waveform of a track from the waveforms of its sources.
+         */
+        QVector<Peak> frames( const Msf& start, const Msf& length ) const;
+
+        /**
+         * Searches for passages which stay below \p thresholdDb for at least
+         * \p minLength and proposes to split at their end, ie. at the first
+         * frame of the next song. Silence at the beginning and at the end
+         * is ignored.
+         */
+        QList<Msf> silenceSplitPoints( double thresholdDb = -50.0,
+                                       const Msf& minLength = Msf( 0, 1, 0 ) ) const;
+
+        /**
+         * Serializes all levels.
+         */
+        void save( QDataStream& s ) const;
+
+        /**
+         * \return A null object if \p s does not contain valid peaks.
+         */
+        static AudioPeaks load( QDataStream& s );
+
+    private:
+        class Private;
+        QSharedDataPointer<Private> d;
+    };
+}
+
+#endif
@@ -41,6 +41,7 @@ public:
       prev(0),
       next(0),
       firstSource(0),
+      index(-1),
       currentlyDeleting(false) {
         cdTextValidator = new K3b::CdTextValidator();
     }
@@ -65,6 +66,10 @@ public:
 
     AudioDataSource* firstSource;
 
+    // position in the doc's track cache, only valid as long as
+    // the doc does not tell otherwise
+    int index;
+
     bool currentlyDeleting;
 
     K3b::CdTextValidator* cdTextValidator;
@@ -121,6 +126,13 @@ void K3b::AudioTrack::emitChanged()
 }
 
 
+void K3b::AudioTrack::emitLengthChanged()
+{
+    if( d->parent )
+        d->parent->trackLengthChanged( this );
+}
+
+
 void K3b::AudioTrack::setArtist( const QString& a )
 {
     setPerformer( a );
@@ -252,6 +264,16 @@ bool K3b::AudioTrack::inList() const
 
 
 K3b::Msf K3b::AudioTrack::length() const
+{
+    K3b::Msf length;
+    if( d->parent && d->parent->trackPosition( this, 0, &length ) )
+        return length;
+    else
+        return sourcesLength();
+}
+
+
+K3b::Msf K3b::AudioTrack::sourcesLength() const
 {
     K3b::Msf length;
     K3b::AudioDataSource* source = d->firstSource;
@@ -336,10 +358,18 @@ bool K3b::AudioTrack::preEmp() const
 
 unsigned int K3b::AudioTrack::trackNumber() const
 {
-    if( d->prev )
-        return d->prev->trackNumber() + 1;
-    else
+    if( !d->prev )
         return 1;
+
+    int index = ( d->parent ? d->parent->trackIndex( this ) : -1 );
+    if( index >= 0 )
+        return index + 1;
+
+    // not part of the doc's list
+    unsigned int number = 1;
+    for( K3b::AudioTrack* track = d->prev; track; track = track->d->prev )
+        ++number;
+    return number;
 }
 
 
@@ -390,8 +420,10 @@ K3b::AudioTrack* K3b::AudioTrack::take()
         d->prev = d->next = 0;
 
         // remove from doc
-        if( doc() )
+        if( doc() ) {
+            doc()->trackListChanged( position );
             doc()->slotTrackRemoved( position );
+        }
 
         d->parent = 0;
     }
@@ -416,6 +448,7 @@ void K3b::AudioTrack::moveAfter( K3b::AudioTrack* track )
             emit doc()->trackAboutToBeAdded( 0 );
             doc()->setFirstTrack( take() );
             doc()->setLastTrack( this );
+            doc()->trackListChanged( 0 );
             emit doc()->trackAdded( 0 );
         }
     }
@@ -427,7 +460,8 @@ void K3b::AudioTrack::moveAfter( K3b::AudioTrack* track )
         // remove this from the list
         take();
 
-        emit track->doc()->trackAboutToBeAdded( track->trackNumber()-1 );
+        const int position = track->trackNumber();
+        emit track->doc()->trackAboutToBeAdded( position-1 );
 
         // set the new parent doc
         d->parent = track->doc();
@@ -448,7 +482,9 @@ void K3b::AudioTrack::moveAfter( K3b::AudioTrack* track )
         if( !d->next )
             doc()->setLastTrack( this );
 
-        emit doc()->trackAdded( track->trackNumber()-1 );
+        doc()->trackListChanged( position );
+
+        emit doc()->trackAdded( position-1 );
     }
 
     emitChanged();
@@ -470,6 +506,7 @@ void K3b::AudioTrack::moveAhead( K3b::AudioTrack* track )
             emit doc()->trackAboutToBeAdded( 0 );
             doc()->setFirstTrack( take() );
             doc()->setLastTrack( this );
+            doc()->trackListChanged( 0 );
             emit doc()->trackAdded( 0 );
         }
     }
@@ -481,7 +518,8 @@ void K3b::AudioTrack::moveAhead( K3b::AudioTrack* track )
         // remove this from the list
         take();
 
-        emit track->doc()->trackAboutToBeAdded( track->trackNumber()-1 );
+        const int position = track->trackNumber()-1;
+        emit track->doc()->trackAboutToBeAdded( position );
 
         // set the new parent doc
         d->parent = track->doc();
@@ -502,7 +540,9 @@ void K3b::AudioTrack::moveAhead( K3b::AudioTrack* track )
         if( !d->next )
             doc()->setLastTrack( this );
 
-        emit doc()->trackAdded( track->trackNumber()-1 );
+        doc()->trackListChanged( position );
+
+        emit doc()->trackAdded( position );
     }
 
     emitChanged();
@@ -573,6 +613,7 @@ void K3b::AudioTrack::setFirstSource( K3b::AudioDataSource* source )
         source = source->next();
     }
 
+    emitLengthChanged();
     emitChanged();
 }
 
@@ -599,6 +640,8 @@ void K3b::AudioTrack::sourceChanged( K3b::AudioDataSource* )
 
     // TODO: update indices
 
+    emitLengthChanged();
+
     if( d->index0Offset > length() )
         d->index0Offset = length()-1;
 
@@ -689,15 +732,12 @@ K3b::Device::Track K3b::AudioTrack::toCdTrack() const
     if( !inList() )
         return K3b::Device::Track();
 
-    K3b::Msf firstSector;
-    K3b::AudioTrack* track = doc()->firstTrack();
-    while( track != this ) {
-        firstSector += track->length();
-        track = track->next();
-    }
+    K3b::Msf firstSector, trackLength;
+    if( !doc()->trackPosition( this, &firstSector, &trackLength ) )
+        return K3b::Device::Track();
 
     K3b::Device::Track cdTrack( firstSector,
-                              firstSector + length() - 1,
+                              firstSector + trackLength - 1,
                               K3b::Device::Track::TYPE_AUDIO );
 
     // FIXME: auch im audiotrack copy permitted
@@ -755,6 +795,8 @@ void K3b::AudioTrack::emitSourceAboutToBeRemoved( AudioDataSource* source )
 
 void K3b::AudioTrack::emitSourceRemoved( K3b::AudioDataSource* source )
 {
+    emitLengthChanged();
+
     if ( doc() ) {
         // set the first source by hand (without using setFirstSource() )
         // just to avoid the model to read invalid firstSources
@@ -785,6 +827,8 @@ void K3b::AudioTrack::emitSourceAboutToBeAdded( int position )
 
 void K3b::AudioTrack::emitSourceAdded( AudioDataSource* source )
 {
+    emitLengthChanged();
+
     if ( doc() ) {
         emit doc()->sourceAdded( this, source->sourceIndex() );
         doc()->slotTrackChanged( this );
@@ -215,6 +215,16 @@ namespace K3b {
          */
         void emitChanged();
 
+        /**
+         * Tells the doc that the length of the track changed
+         */
+        void emitLengthChanged();
+
+        /**
+         * The sum of the source lengths, ie. the uncached length.
+         */
+        Msf sourcesLength() const;
+
         void debug();
 
         class Private;
@@ -14,7 +14,6 @@
 
 #include "k3bdatamultisessionparameterjob.h"
 
-#include "k3bthread.h"
 #include "k3biso9660.h"
 #include "k3bdevice.h"
 #include "k3bdiskinfo.h"
@@ -27,7 +27,9 @@ K3b::AbstractWriter::AbstractWriter( K3b::Device::Device* dev, K3b::JobHandler*
       m_burnDevice(dev),
       m_burnSpeed(0),
       m_simulate(false),
-      m_sourceUnreadable(false)
+      m_sourceUnreadable(false),
+      m_stallTime(0),
+      m_stallStart(-1)
 {
 }
 
@@ -46,6 +48,38 @@ K3b::Device::Device* K3b::AbstractWriter::burnDevice()
 }
 
 
+void K3b::AbstractWriter::startTelemetry()
+{
+    m_telemetryClock.start();
+    m_stallTime = 0;
+    m_stallStart = -1;
+
+    TelemetrySample sample;
+    sample.device = burnDevice();
+    sample.inputStallTime = 0;
+    emit telemetry( sample );
+}
+
+
+qint64 K3b::AbstractWriter::inputStallTime( int fifoFill )
+{
+    if( !m_telemetryClock.isValid() )
+        m_telemetryClock.start();
+
+    const qint64 now = m_telemetryClock.elapsed();
+    if( fifoFill == 0 ) {
+        if( m_stallStart < 0 )
+            m_stallStart = now;
+    }
+    else if( m_stallStart >= 0 ) {
+        m_stallTime += now - m_stallStart;
+        m_stallStart = -1;
+    }
+
+    return m_stallTime + ( m_stallStart >= 0 ? now - m_stallStart : 0 );
+}
+
+
 void K3b::AbstractWriter::cancel()
 {
     if( burnDevice() ) {
@@ -21,6 +21,7 @@
 #include "k3bdevicetypes.h"
 
 #include <QDateTime>
+#include <QElapsedTimer>
 
 class QIODevice;
 
@@ -77,6 +78,21 @@ namespace K3b {
 
         bool wasSourceUnreadable() const { return m_sourceUnreadable; }
 
+        /**
+         * Announces the burn device through the telemetry signal so
+         * JobTelemetry can poll its buffer. Resets the input stall time.
+         * To be called by subclasses once the writing process started.
+         */
+        void startTelemetry();
+
+        /**
+         * Accounts the fill level \p fifoFill of the writing application's
+         * fifo. The application waits for input while its fifo is empty.
+         *
+         * \return The accumulated time in milliseconds the fifo was empty.
+         */
+        qint64 inputStallTime( int fifoFill );
+
     protected Q_SLOTS:
         void slotUnblockWhileCancellationFinished( bool success );
         void slotEjectWhileCancellationFinished( bool success );
@@ -86,6 +102,10 @@ namespace K3b {
         int m_burnSpeed;
         bool m_simulate;
         bool m_sourceUnreadable;
+
+        QElapsedTimer m_telemetryClock;
+        qint64 m_stallTime;
+        qint64 m_stallStart;
     };
 }
 
@@ -25,6 +25,7 @@
 #include "k3bthroughputestimator.h"
 #include "k3bglobals.h"
 #include "k3bglobalsettings.h"
+#include "k3bwriteroutputparser.h"
 #include "k3b_i18n.h"
 
 #include <KIOCore/KIO/CopyJob>
@@ -34,7 +35,6 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QRegExp>
 #include <QString>
 #include <QStringList>
 #include <QTemporaryFile>
@@ -557,6 +557,9 @@ void K3b::CdrdaoWriter::start()
     }
     else
     {
+        if( m_command == WRITE )
+            startTelemetry();
+
         switch ( m_command )
         {
         case WRITE:
@@ -786,7 +789,7 @@ void K3b::CdrdaoWriter::unknownCdrdaoLine( const QString& line )
     {
         // parse the speed and inform the user if cdrdao switched it down
         int pos = line.indexOf( "at speed" );
-        int po2 = line.indexOf( QRegExp("\\D"), pos + 9 );
+        int po2 = WriterOutput::indexOfNonDigit( line, pos + 9 );
         int speed = line.mid( pos+9, po2-pos-9 ).toInt();
         if( speed < d->usedSpeed )
         {
@@ -901,18 +904,19 @@ void K3b::CdrdaoWriter::parseCdrdaoError( const QString& line )
 
 void K3b::CdrdaoWriter::parseCdrdaoWrote( const QString& line )
 {
-    int pos, po2;
-    pos = line.indexOf( "Wrote" );
-    po2 = line.indexOf( " ", pos + 6 );
-    int processed = line.mid( pos+6, po2-pos-6 ).toInt();
-
-    pos = line.indexOf( "of" );
-    po2 = line.indexOf( " ", pos + 3 );
-    m_size = line.mid( pos+3, po2-pos-3 ).toInt();
+    int processed = 0;
+    if( !WriterOutput::parseCdrdaoWrote( line, processed, m_size ) ) {
+        qDebug() << "(K3b::CdrdaoWriter) unable to parse" << line;
+        return;
+    }
 
     d->speedEst->dataWritten( processed*1024 );
 
     emit processedSize( processed, m_size );
+
+    TelemetrySample sample;
+    sample.bytesWritten = qint64( processed ) * 1024LL * 1024LL;
+    emit telemetry( sample );
 }
 
 
@@ -1001,8 +1005,16 @@ void K3b::CdrdaoWriter::parseCdrdaoMessage()
 
             emit buffer(d->newMsg.bufferFillRate);
 
-            if( d->progressMsgSize == (unsigned int)sizeof(ProgressMsg2) )
+            TelemetrySample sample;
+            sample.fifoFill = d->newMsg.bufferFillRate;
+            sample.inputStallTime = inputStallTime( d->newMsg.bufferFillRate );
+
+            if( d->progressMsgSize == (unsigned int)sizeof(ProgressMsg2) ) {
                 emit deviceBuffer( d->newMsg.writerFillRate );
+                sample.deviceBufferFill = d->newMsg.writerFillRate;
+            }
+
+            emit telemetry( sample );
 
             ::memcpy( &d->oldMsg, &d->newMsg, d->progressMsgSize );
         }
@@ -1012,6 +1024,10 @@ void K3b::CdrdaoWriter::parseCdrdaoMessage()
 
 void K3b::CdrdaoWriter::slotThroughput( int t )
 {
+    TelemetrySample sample;
+    sample.writeSpeed = t;
+    emit telemetry( sample );
+
     // FIXME: determine sector size
     emit writeSpeed( t, K3b::Device::SPEED_FACTOR_CD_MODE1 );
 }
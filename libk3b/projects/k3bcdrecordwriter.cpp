@@ -26,11 +26,11 @@
 #include "k3bglobals.h"
 #include "k3bthroughputestimator.h"
 #include "k3bglobalsettings.h"
+#include "k3bwriteroutputparser.h"
 
 #include <QDebug>
 #include <QString>
 #include <QStringList>
-#include <QRegExp>
 #include <QFile>
 #include "k3b_i18n.h"
 
@@ -442,6 +442,8 @@ void K3b::CdrecordWriter::start()
         jobFinished(false);
     }
     else {
+        startTelemetry();
+
         const QString formattedSpeed = formatWritingSpeedFactor( d->usedSpeed, d->burnedMediaType, SpeedFormatInteger );
         const QString formattedMode = writingModeString( d->writingMode );
         // FIXME: these messages should also take DVD into account.
@@ -477,15 +479,8 @@ void K3b::CdrecordWriter::cancel()
 
 void K3b::CdrecordWriter::slotStdLine( const QString& line )
 {
-    static QRegExp s_burnfreeCounterRx( "^BURN\\-Free\\swas\\s(\\d+)\\stimes\\sused" );
-    static QRegExp s_burnfreeCounterRxPredict( "^Total\\sof\\s(\\d+)\\s\\spossible\\sbuffer\\sunderruns\\spredicted" );
-
-    // tracknumber: cap(1)
-    // done: cap(2)
-    // complete: cap(3)
-    // fifo: cap(4)  (it seems as if some patched cdrecord versions do not emit the fifo info but only the buf... :(
-    // buffer: cap(5)
-    static QRegExp s_progressRx( "Track\\s(\\d\\d)\\:\\s*(\\d*)\\sof\\s*(\\d*)\\sMB\\swritten\\s(?:\\(fifo\\s*(\\d*)\\%\\)\\s*)?(?:\\[buf\\s*(\\d*)\\%\\])?.*" );
+    WriterOutput::CdrecordProgress progress;
+    int num = 0;
 
     emit debuggingOutput( d->cdrecordBinObject->name(), line );
 
@@ -506,7 +501,7 @@ void K3b::CdrecordWriter::slotStdLine( const QString& line )
 
                 d->totalTracks = tt;
 
-                int sizeStart = line.indexOf( QRegExp("\\d"), 10 );
+                int sizeStart = WriterOutput::indexOfDigit( line, 10 );
                 int sizeEnd = line.indexOf( "MB", sizeStart );
                 track.size = line.mid( sizeStart, sizeEnd-sizeStart ).toInt(&ok);
 
@@ -523,17 +518,16 @@ void K3b::CdrecordWriter::slotStdLine( const QString& line )
                          << line.mid( 6, 2 );
         }
 
-        else if( s_progressRx.exactMatch( line ) ) {
-            //      int num = s_progressRx.cap(1).toInt();
-            int made = s_progressRx.cap(2).toInt();
-            int size = s_progressRx.cap(3).toInt();
-            int fifo = s_progressRx.cap(4).toInt();
+        else if( WriterOutput::parseCdrecordProgress( line, progress ) ) {
+            int made = progress.written;
+            int size = progress.size;
+            // it seems as if some patched cdrecord versions do not emit the fifo info but only the buf... :(
+            int fifo = qMax( 0, progress.fifo );
 
             emit buffer( fifo );
             d->lastFifoValue = fifo;
 
-            if( s_progressRx.captureCount() > 4 )
-                emit deviceBuffer( s_progressRx.cap(5).toInt() );
+            emit deviceBuffer( qMax( 0, progress.buffer ) );
 
             //
             // cdrecord's output sucks a bit.
@@ -567,6 +561,13 @@ void K3b::CdrecordWriter::slotStdLine( const QString& line )
             }
 
             d->speedEst->dataWritten( (d->alreadyWritten+made)*1024 );
+
+            TelemetrySample sample;
+            sample.bytesWritten = qint64( d->alreadyWritten+made ) * 1024LL * 1024LL;
+            sample.fifoFill = progress.fifo;
+            sample.inputStallTime = inputStallTime( progress.fifo );
+            sample.deviceBufferFill = progress.buffer;
+            emit telemetry( sample );
         }
     }
 
@@ -740,17 +741,15 @@ void K3b::CdrecordWriter::slotStdLine( const QString& line )
         // hopefully this will do it since I have no possibility to test it!
         d->process.write( "\n", 1 );
     }
-    else if( s_burnfreeCounterRx.indexIn( line ) ) {
-        bool ok;
-        int num = s_burnfreeCounterRx.cap(1).toInt(&ok);
-        if( ok )
-            emit infoMessage( i18np("Burnfree was used once.", "Burnfree was used %1 times.", num), MessageInfo );
+    else if( WriterOutput::parseBurnfreeCounter( line, num ) ) {
+        emit infoMessage( i18np("Burnfree was used once.", "Burnfree was used %1 times.", num), MessageInfo );
+
+        TelemetrySample sample;
+        sample.burnfreeEvents = num;
+        emit telemetry( sample );
     }
-    else if( s_burnfreeCounterRxPredict.indexIn( line ) ) {
-        bool ok;
-        int num = s_burnfreeCounterRxPredict.cap(1).toInt(&ok);
-        if( ok )
-            emit infoMessage( i18np("Buffer was low once.", "Buffer was low %1 times.", num), MessageInfo );
+    else if( WriterOutput::parsePredictedUnderruns( line, num ) ) {
+        emit infoMessage( i18np("Buffer was low once.", "Buffer was low %1 times.", num), MessageInfo );
     }
     else if( line.contains("Medium Error") ) {
         d->cdrecordError = MEDIUM_ERROR;
@@ -923,6 +922,10 @@ void K3b::CdrecordWriter::slotProcessExited( int exitCode, QProcess::ExitStatus
 
 void K3b::CdrecordWriter::slotThroughput( int t )
 {
+    TelemetrySample sample;
+    sample.writeSpeed = t;
+    emit telemetry( sample );
+
     emit writeSpeed( t, d->tracks.count() > d->currentTrack && !d->tracks[d->currentTrack-1].audio
                      ? K3b::Device::SPEED_FACTOR_CD_MODE1
                      : d->usedSpeedFactor );
@@ -18,17 +18,196 @@
 #include "k3bglobals.h"
 #include "k3btrack.h"
 #include "k3bcdtext.h"
+#include "k3bworkerpool.h"
 
+#include <QCache>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QRegExp>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
 
 
 // TODO: add method: usableByCdrecordDirectly()
 // TODO: add Toc with sector sizes
 
+namespace {
+    const int s_maxCachedFiles = 256;
+
+    /**
+     * Everything readFile() determines about a valid cue file. The cache is
+     * validated against the size and modification time of the cue file
+     * and the existence of the image file.
+     */
+    struct ParsedCueFile
+    {
+        QDateTime modified;
+        qint64 size;
+
+        QString imageFilename;
+        bool imageFilenameInCue;
+        QString imageFileType;
+        K3b::Device::Toc toc;
+        K3b::Device::CdText cdText;
+    };
+
+    struct ParsedCueFileCache
+    {
+        ParsedCueFileCache()
+            : files( s_maxCachedFiles ) {
+        }
+
+        QMutex mutex;
+        QCache<QString, ParsedCueFile> files;
+    };
+
+    Q_GLOBAL_STATIC( ParsedCueFileCache, s_cache )
+
+
+    bool isDigits( const QString& s, int from, int len )
+    {
+        if( from + len > s.length() )
+            return false;
+        for( int i = from; i < from + len; ++i )
+            if( !s[i].isDigit() )
+                return false;
+        return true;
+    }
+
+    // \w as in QRegExp
+    bool isWordChars( const QString& s, int from, int len )
+    {
+        if( from + len > s.length() )
+            return false;
+        for( int i = from; i < from + len; ++i )
+            if( !s[i].isLetterOrNumber() && !s[i].isMark() && s[i] != '_' )
+                return false;
+        return true;
+    }
+
+    // one or two digits
+    int parseNumber( const QString& s, bool* ok )
+    {
+        *ok = ( ( s.length() == 1 || s.length() == 2 ) && isDigits( s, 0, s.length() ) );
+        return *ok ? s.toInt() : 0;
+    }
+
+    // mm:ss:ff with seconds < 60 and frames < 75
+    K3b::Msf parseMsf( const QString& s, bool* ok )
+    {
+        *ok = false;
+        const int colon = s.indexOf( ':' );
+        if( colon < 1 || s.length() != colon + 6 || s[colon+3] != ':' ||
+            !isDigits( s, 0, colon ) || !isDigits( s, colon+1, 2 ) || !isDigits( s, colon+4, 2 ) )
+            return K3b::Msf();
+
+        const int sec = s.midRef( colon+1, 2 ).toInt();
+        const int frames = s.midRef( colon+4, 2 ).toInt();
+        if( sec > 59 || frames > 74 )
+            return K3b::Msf();
+
+        *ok = true;
+        return K3b::Msf( s.leftRef( colon ).toInt(), sec, frames );
+    }
+
+    // "?([^"]{0,80})"?
+    bool parseCdTextString( const QString& s, QString* value )
+    {
+        int from = 0;
+        int to = s.length();
+        if( to > from && s[from] == '"' )
+            ++from;
+        if( to > from && s[to-1] == '"' )
+            --to;
+        if( to - from > 80 || s.midRef( from, to - from ).contains( '"' ) )
+            return false;
+        *value = s.mid( from, to - from );
+        return true;
+    }
+
+    // "?([^"].*[^"\s])"?\s"?(.*)"?
+    bool parseFileStatement( const QString& s, QString* file, QString* type )
+    {
+        int typeStart = -1;
+        if( s.startsWith( '"' ) ) {
+            const int end = s.indexOf( '"', 1 );
+            if( end < 0 || end + 1 >= s.length() || !s[end+1].isSpace() )
+                return false;
+            *file = s.mid( 1, end-1 );
+            typeStart = end+2;
+        }
+        else {
+            // file names with spaces need not be quoted, the type never contains one
+            int end = s.length();
+            while( end > 0 && !s[end-1].isSpace() )
+                --end;
+            if( end <= 1 )
+                return false;
+            *file = s.left( end-1 );
+            typeStart = end;
+        }
+
+        if( file->isEmpty() || file->endsWith( '"' ) || file->at( file->length()-1 ).isSpace() )
+            return false;
+
+        *type = s.mid( typeStart );
+        if( type->startsWith( '"' ) )
+            type->remove( 0, 1 );
+        if( type->endsWith( '"' ) )
+            type->chop( 1 );
+        return true;
+    }
+
+    bool isFlag( const QString& s )
+    {
+        return ( s == QLatin1String( "DCP" ) ||
+                 s == QLatin1String( "4CH" ) ||
+                 s == QLatin1String( "PRE" ) ||
+                 s == QLatin1String( "SCMS" ) );
+    }
+
+
+    class ValidationBatch
+    {
+    public:
+        QMutex mutex;
+        QWaitCondition done;
+        int pending;
+        QVector<bool> results;
+    };
+
+    class ValidationTask : public K3b::WorkerPool::Task
+    {
+    public:
+        ValidationTask( ValidationBatch* batch, int index, const QString& filename )
+            : m_batch( batch ),
+              m_index( index ),
+              m_filename( filename ) {
+        }
+
+        void run() {
+            K3b::CueFileParser parser( m_filename );
+            {
+                QMutexLocker locker( &m_batch->mutex );
+                m_batch->results[m_index] = parser.isValid();
+                if( --m_batch->pending == 0 )
+                    m_batch->done.wakeAll();
+            }
+            // the batch may be gone already
+            delete this;
+        }
+
+    private:
+        ValidationBatch* m_batch;
+        int m_index;
+        QString m_filename;
+    };
+}
+
+
 class K3b::CueFileParser::Private
 {
 public:
@@ -65,6 +244,27 @@ K3b::CueFileParser::~CueFileParser()
 }
 
 
+QVector<bool> K3b::CueFileParser::validateFiles( const QStringList& filenames )
+{
+    ValidationBatch batch;
+    batch.pending = filenames.count();
+    batch.results.fill( false, filenames.count() );
+    if( filenames.isEmpty() )
+        return batch.results;
+
+    for( int i = 0; i < filenames.count(); ++i )
+        WorkerPool::instance()->submit( new ValidationTask( &batch, i, filenames[i] ), WorkerPool::Background );
+
+    QMutexLocker locker( &batch.mutex );
+    if( batch.pending > 0 ) {
+        WorkerPool::BlockingSection blocking;
+        while( batch.pending > 0 )
+            batch.done.wait( &batch.mutex );
+    }
+    return batch.results;
+}
+
+
 void K3b::CueFileParser::readFile()
 {
     setValid(true);
@@ -73,15 +273,50 @@ void K3b::CueFileParser::readFile()
     d->trackMode = K3b::Device::Track::UNKNOWN;
     d->toc.clear();
     d->cdText.clear();
+    d->imageFileType.clear();
     d->currentParsedTrack = 0;
 
+    QFileInfo info( filename() );
+    if( !info.isFile() ) {
+        qDebug() << "(K3b::CueFileParser) could not open file " << filename();
+        setValid(false);
+        return;
+    }
+
+    const QString key = info.absoluteFilePath();
+    {
+        QMutexLocker locker( &s_cache->mutex );
+        if( ParsedCueFile* cached = s_cache->files.object( key ) ) {
+            if( cached->modified == info.lastModified() &&
+                cached->size == info.size() &&
+                QFileInfo( cached->imageFilename ).isFile() ) {
+                setImageFilename( cached->imageFilename );
+                m_imageFilenameInCue = cached->imageFilenameInCue;
+                d->imageFileType = cached->imageFileType;
+                d->toc = cached->toc;
+                d->cdText = cached->cdText;
+                return;
+            }
+        }
+    }
+
     QFile f( filename() );
     if( f.open( QIODevice::ReadOnly ) ) {
-        while( !f.atEnd() ) {
-            if( !parseLine( QString::fromUtf8(f.readLine() ) ) ) {
+        // cue files are tiny, reading them at once saves a syscall per line
+        const QByteArray data = f.readAll();
+        f.close();
+
+        // skip the UTF-8 byte order mark some tools write
+        int pos = ( data.startsWith( "\xef\xbb\xbf" ) ? 3 : 0 );
+        while( pos < data.size() ) {
+            int end = data.indexOf( '\n', pos );
+            if( end < 0 )
+                end = data.size();
+            if( !parseLine( QString::fromUtf8( data.constData() + pos, end - pos ) ) ) {
                 setValid(false);
                 break;
             }
+            pos = end + 1;
         }
 
         if( isValid() ) {
@@ -104,6 +339,19 @@ void K3b::CueFileParser::readFile()
             }
 
             qDebug() << "------------------------------------------------";
+
+            // invalid files are not cached since the image may show up any time
+            ParsedCueFile* parsed = new ParsedCueFile;
+            parsed->modified = info.lastModified();
+            parsed->size = info.size();
+            parsed->imageFilename = imageFilename();
+            parsed->imageFilenameInCue = m_imageFilenameInCue;
+            parsed->imageFileType = d->imageFileType;
+            parsed->toc = d->toc;
+            parsed->cdText = d->cdText;
+
+            QMutexLocker locker( &s_cache->mutex );
+            s_cache->files.insert( key, parsed );
         }
     }
     else {
@@ -115,33 +363,6 @@ void K3b::CueFileParser::readFile()
 
 bool K3b::CueFileParser::parseLine( QString line )
 {
-    // use cap(1) for the filename
-    static QRegExp fileRx( "FILE\\s\"?([^\"].*[^\"\\s])\"?\\s\"?(.*)\"?" );
-
-    // use cap(1) for the flags
-    static QRegExp flagsRx( "FLAGS(\\s(DCP|4CH|PRE|SCMS)){1,4}" );
-
-    // use cap(1) for the tracknumber and cap(2) for the datatype
-    static QRegExp trackRx( "TRACK\\s(\\d{1,2})\\s(AUDIO|CDG|MODE1/2048|MODE1/2352|MODE2/2336|MODE2/2352|CDI/2336|CDI/2352)" );
-
-    // use cap(1) for the index number, cap(3) for the minutes, cap(4) for the seconds, cap(5) for the frames,
-    // and cap(2) for the MSF value string
-    static QRegExp indexRx( "INDEX\\s(\\d{1,2})\\s((\\d+):([0-5]\\d):((?:[0-6]\\d)|(?:7[0-4])))" );
-
-    // use cap(1) for the MCN
-    static QRegExp catalogRx( "CATALOG\\s(\\w{13,13})" );
-
-    // use cap(1) for the ISRC
-    static QRegExp isrcRx( "ISRC\\s(\\w{5,5}\\d{7,7})" );
-
-    static QString cdTextRxStr = "\"?([^\"]{0,80})\"?";
-
-    // use cap(1) for the string
-    static QRegExp titleRx( "TITLE\\s" + cdTextRxStr );
-    static QRegExp performerRx( "PERFORMER\\s" + cdTextRxStr );
-    static QRegExp songwriterRx( "SONGWRITER\\s" + cdTextRxStr );
-
-
     // simplify all white spaces except those in filenames and CD-TEXT
     simplified( line );
 
@@ -149,13 +370,26 @@ bool K3b::CueFileParser::parseLine( QString line )
     if( line.startsWith("REM") || line.startsWith('#') || line.isEmpty() )
         return true;
 
+    // the keyword decides which statement we have, the rest are its arguments
+    int space = 0;
+    while( space < line.length() && !line[space].isSpace() )
+        ++space;
+    const QString keyword = line.left( space );
+    const QString args = line.mid( space+1 );
+    const bool haveArgs = ( space < line.length() );
+
 
     //
     // FILE
     //
-    if( fileRx.exactMatch( line ) ) {
+    if( keyword == QLatin1String( "FILE" ) ) {
+        QString file, type;
+        if( !haveArgs || !parseFileStatement( args, &file, &type ) ) {
+            qDebug() << "(K3b::CueFileParser) invalid FILE statement: '" << line << "'";
+            return false;
+        }
 
-        setValid( findImageFileName( fileRx.cap(1) ) );
+        setValid( findImageFileName( file ) );
 
         if( d->inFile ) {
             qDebug() << "(K3b::CueFileParser) only one FILE statement allowed.";
@@ -164,7 +398,7 @@ bool K3b::CueFileParser::parseLine( QString line )
         d->inFile = true;
         d->inTrack = false;
         d->haveIndex1 = false;
-        d->imageFileType = fileRx.cap( 2 ).toLower();
+        d->imageFileType = type.toLower();
         return true;
     }
 
@@ -172,7 +406,25 @@ bool K3b::CueFileParser::parseLine( QString line )
     //
     // TRACK
     //
-    else if( trackRx.exactMatch( line ) ) {
+    else if( keyword == QLatin1String( "TRACK" ) ) {
+        const int sep = args.indexOf( ' ' );
+        bool ok = false;
+        if( haveArgs && sep > 0 )
+            parseNumber( args.left( sep ), &ok );
+        const QString dataType = args.mid( sep+1 );
+        if( !ok ||
+            ( dataType != QLatin1String( "AUDIO" ) &&
+              dataType != QLatin1String( "CDG" ) &&
+              dataType != QLatin1String( "MODE1/2048" ) &&
+              dataType != QLatin1String( "MODE1/2352" ) &&
+              dataType != QLatin1String( "MODE2/2336" ) &&
+              dataType != QLatin1String( "MODE2/2352" ) &&
+              dataType != QLatin1String( "CDI/2336" ) &&
+              dataType != QLatin1String( "CDI/2352" ) ) ) {
+            qDebug() << "(K3b::CueFileParser) invalid TRACK statement: '" << line << "'";
+            return false;
+        }
+
         if( !d->inFile ) {
             qDebug() << "(K3b::CueFileParser) TRACK statement before FILE.";
             return false;
@@ -196,22 +448,22 @@ bool K3b::CueFileParser::parseLine( QString line )
         d->currentParsedTrack++;
 
         // parse the tracktype
-        if( trackRx.cap(2) == "AUDIO" ) {
+        if( dataType == "AUDIO" ) {
             d->trackType = K3b::Device::Track::TYPE_AUDIO;
             d->trackMode = K3b::Device::Track::UNKNOWN;
         }
         else {
             d->trackType = K3b::Device::Track::TYPE_DATA;
-            if( trackRx.cap(2).startsWith("MODE1") ) {
+            if( dataType.startsWith("MODE1") ) {
                 d->trackMode = K3b::Device::Track::MODE1;
-                d->rawData = (trackRx.cap(2) == "MODE1/2352");
+                d->rawData = (dataType == "MODE1/2352");
             }
-            else if( trackRx.cap(2).startsWith("MODE2") ) {
+            else if( dataType.startsWith("MODE2") ) {
                 d->trackMode = K3b::Device::Track::MODE2;
-                d->rawData = (trackRx.cap(2) == "MODE2/2352");
+                d->rawData = (dataType == "MODE2/2352");
             }
             else {
-                qDebug() << "(K3b::CueFileParser) unsupported track type: " << trackRx.cap(2);
+                qDebug() << "(K3b::CueFileParser) unsupported track type: " << dataType;
                 return false;
             }
         }
@@ -227,7 +479,16 @@ bool K3b::CueFileParser::parseLine( QString line )
     //
     // FLAGS
     //
-    else if( flagsRx.exactMatch( line ) ) {
+    else if( keyword == QLatin1String( "FLAGS" ) ) {
+        const QStringList flags = args.split( ' ' );
+        bool ok = ( haveArgs && flags.count() <= 4 );
+        for( int i = 0; ok && i < flags.count(); ++i )
+            ok = isFlag( flags[i] );
+        if( !ok ) {
+            qDebug() << "(K3b::CueFileParser) invalid FLAGS statement: '" << line << "'";
+            return false;
+        }
+
         if( !d->inTrack ) {
             qDebug() << "(K3b::CueFileParser) FLAGS statement without TRACK.";
             return false;
@@ -241,16 +502,26 @@ bool K3b::CueFileParser::parseLine( QString line )
     //
     // INDEX
     //
-    else if( indexRx.exactMatch( line ) ) {
+    else if( keyword == QLatin1String( "INDEX" ) ) {
+        const int sep = args.indexOf( ' ' );
+        bool ok = false;
+        unsigned int indexNumber = 0;
+        K3b::Msf indexStart;
+        if( haveArgs && sep > 0 ) {
+            indexNumber = parseNumber( args.left( sep ), &ok );
+            if( ok )
+                indexStart = parseMsf( args.mid( sep+1 ), &ok );
+        }
+        if( !ok ) {
+            qDebug() << "(K3b::CueFileParser) invalid INDEX statement: '" << line << "'";
+            return false;
+        }
+
         if( !d->inTrack ) {
             qDebug() << "(K3b::CueFileParser) INDEX statement without TRACK.";
             return false;
         }
 
-        unsigned int indexNumber = indexRx.cap(1).toInt();
-
-        K3b::Msf indexStart = K3b::Msf::fromString( indexRx.cap(2) );
-
         if( indexNumber == 0 ) {
             d->index0 = indexStart;
 
@@ -280,7 +551,12 @@ bool K3b::CueFileParser::parseLine( QString line )
     //
     // CATALOG
     //
-    if( catalogRx.exactMatch( line ) ) {
+    else if( keyword == QLatin1String( "CATALOG" ) ) {
+        if( !haveArgs || args.length() != 13 || !isWordChars( args, 0, 13 ) ) {
+            qDebug() << "(K3b::CueFileParser) invalid CATALOG statement: '" << line << "'";
+            return false;
+        }
+
         // TODO: set the toc's mcn
         return true;
     }
@@ -289,7 +565,12 @@ bool K3b::CueFileParser::parseLine( QString line )
     //
     // ISRC
     //
-    if( isrcRx.exactMatch( line ) ) {
+    else if( keyword == QLatin1String( "ISRC" ) ) {
+        if( !haveArgs || args.length() != 12 || !isWordChars( args, 0, 5 ) || !isDigits( args, 5, 7 ) ) {
+            qDebug() << "(K3b::CueFileParser) invalid ISRC statement: '" << line << "'";
+            return false;
+        }
+
         if( d->inTrack ) {
             // TODO: set the track's ISRC
             return true;
@@ -305,27 +586,33 @@ bool K3b::CueFileParser::parseLine( QString line )
     // CD-TEXT
     // TODO: create K3b::Device::TrackCdText entries
     //
-    else if( titleRx.exactMatch( line ) ) {
-        if( d->inTrack )
-            d->cdText[d->currentParsedTrack-1].setTitle( titleRx.cap(1) );
-        else
-            d->cdText.setTitle( titleRx.cap(1) );
-        return true;
-    }
-
-    else if( performerRx.exactMatch( line ) ) {
-        if( d->inTrack )
-            d->cdText[d->currentParsedTrack-1].setPerformer( performerRx.cap(1) );
-        else
-            d->cdText.setPerformer( performerRx.cap(1) );
-        return true;
-    }
+    else if( keyword == QLatin1String( "TITLE" ) ||
+             keyword == QLatin1String( "PERFORMER" ) ||
+             keyword == QLatin1String( "SONGWRITER" ) ) {
+        QString value;
+        if( !haveArgs || !parseCdTextString( args, &value ) ) {
+            qDebug() << "(K3b::CueFileParser) invalid CD-Text statement: '" << line << "'";
+            return false;
+        }
 
-    else if( songwriterRx.exactMatch( line ) ) {
-        if( d->inTrack )
-            d->cdText[d->currentParsedTrack-1].setSongwriter( songwriterRx.cap(1) );
-        else
-            d->cdText.setSongwriter( songwriterRx.cap(1) );
+        if( keyword == QLatin1String( "TITLE" ) ) {
+            if( d->inTrack )
+                d->cdText[d->currentParsedTrack-1].setTitle( value );
+            else
+                d->cdText.setTitle( value );
+        }
+        else if( keyword == QLatin1String( "PERFORMER" ) ) {
+            if( d->inTrack )
+                d->cdText[d->currentParsedTrack-1].setPerformer( value );
+            else
+                d->cdText.setPerformer( value );
+        }
+        else {
+            if( d->inTrack )
+                d->cdText[d->currentParsedTrack-1].setSongwriter( value );
+            else
+                d->cdText.setSongwriter( value );
+        }
         return true;
     }
 
@@ -340,19 +627,23 @@ void K3b::CueFileParser::simplified( QString& s )
 {
     s = s.trimmed();
 
-    int i = 0;
+    QString result;
+    result.reserve( s.length() );
     bool insideQuote = false;
-    while( i < s.length() ) {
-        if( !insideQuote ) {
-            if( s[i].isSpace() && s[i+1].isSpace() )
-                s.remove( i, 1 );
-        }
+    for( int i = 0; i < s.length(); ++i ) {
+        if( !insideQuote && s[i].isSpace() && i+1 < s.length() && s[i+1].isSpace() )
+            continue;
 
         if( s[i] == '"' )
             insideQuote = !insideQuote;
 
-        ++i;
+        // the tokenizer only splits at plain spaces
+        if( !insideQuote && s[i].isSpace() )
+            result.append( ' ' );
+        else
+            result.append( s[i] );
     }
+    s = result;
 }
 
 
@@ -386,21 +677,31 @@ bool K3b::CueFileParser::findImageFileName( const QString& dataFile )
     m_imageFilenameInCue = true;
 
     // first try filename as a hole (absolut)
-    if( QFile::exists( dataFile ) ) {
+    if( QDir::isAbsolutePath( dataFile ) && QFileInfo( dataFile ).isFile() ) {
         setImageFilename( QFileInfo(dataFile).absoluteFilePath() );
         return true;
     }
 
     // try the filename in the cue's directory
-    if( QFileInfo( K3b::parentDir(filename()) + dataFile.section( '/', -1 ) ).isFile() ) {
-        setImageFilename( K3b::parentDir(filename()) + dataFile.section( '/', -1 ) );
+    const QString dir = K3b::parentDir( filename() );
+    const QString name = dataFile.section( '/', -1 );
+    if( QFileInfo( dir + name ).isFile() ) {
+        setImageFilename( dir + name );
         qDebug() << "(K3b::CueFileParser) found image file: " << imageFilename();
         return true;
     }
 
+    //
+    // All other candidates are searched in a single listing of the folder
+    // instead of testing each of them with a stat call.
+    //
+    QDir parentDir( dir );
+    const QStringList files = parentDir.entryList( QDir::Files );
+
     // try the filename ignoring case
-    if( QFileInfo( K3b::parentDir(filename()) + dataFile.section( '/', -1 ).toLower() ).isFile() ) {
-        setImageFilename( K3b::parentDir(filename()) + dataFile.section( '/', -1 ).toLower() );
+    const QString lowerName = name.toLower();
+    if( files.contains( lowerName ) ) {
+        setImageFilename( dir + lowerName );
         qDebug() << "(K3b::CueFileParser) found image file: " << imageFilename();
         return true;
     }
@@ -408,8 +709,10 @@ bool K3b::CueFileParser::findImageFileName( const QString& dataFile )
     m_imageFilenameInCue = false;
 
     // try removing the ending from the cue file (image.bin.cue and image.bin)
-    if( QFileInfo( filename().left( filename().length()-4 ) ).isFile() ) {
-        setImageFilename( filename().left( filename().length()-4 ) );
+    const QString cueName = filename().section( '/', -1 );
+    const QString withoutExtension = cueName.left( cueName.length()-4 );
+    if( files.contains( withoutExtension ) ) {
+        setImageFilename( dir + withoutExtension );
         qDebug() << "(K3b::CueFileParser) found image file: " << imageFilename();
         return true;
     }
@@ -419,21 +722,19 @@ bool K3b::CueFileParser::findImageFileName( const QString& dataFile )
     // Search for another one having the same filename as the cue but a different extension
     //
 
-    QDir parentDir( K3b::parentDir(filename()) );
-    QString filenamePrefix = filename().section( '/', -1 );
+    QString filenamePrefix = cueName;
     filenamePrefix.truncate( filenamePrefix.length() - 3 ); // remove cue extension
     qDebug() << "(K3b::CueFileParser) checking folder " << parentDir.path() << " for files: " << filenamePrefix << "*";
 
     //
     // we cannot use the nameFilter in QDir because of the spaces that may occur in filenames
     //
-    QStringList possibleImageFiles = parentDir.entryList( QDir::Files );
     int cnt = 0;
-    for( QStringList::const_iterator it = possibleImageFiles.constBegin(); it != possibleImageFiles.constEnd(); ++it ) {
-        if( (*it).toLower() == dataFile.section( '/', -1 ).toLower() ||
+    for( QStringList::const_iterator it = files.constBegin(); it != files.constEnd(); ++it ) {
+        if( (*it).toLower() == lowerName ||
             ((*it).startsWith( filenamePrefix ) && !(*it).endsWith( "cue" )) ) {
             ++cnt;
-            setImageFilename( K3b::parentDir(filename()) + *it );
+            setImageFilename( dir + *it );
         }
     }
 
@@ -441,5 +742,5 @@ bool K3b::CueFileParser::findImageFileName( const QString& dataFile )
     // we only do this if there is one unique file which fits the requirements.
     // Otherwise we cannot be certain to have the right file.
     //
-    return ( cnt == 1 && QFileInfo( imageFilename() ).isFile() );
+    return ( cnt == 1 );
 }
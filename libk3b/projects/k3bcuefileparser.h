@@ -21,11 +21,18 @@
 #include "k3bcdtext.h"
 #include "k3b_export.h"
 
+#include <QStringList>
+#include <QVector>
+
 namespace K3b {
     /**
      * Parses a cue file.
      * Datatracks have either mode1 or mode2 where the latter contains xa form1/2.
      * The last track may not have a proper length!
+     *
+     * Valid cue files are cached process-wide, so opening the same file again
+     * only costs a stat of the cue and the image file as long as neither changed.
+     * The parser can be used from any thread.
      */
     class LIBK3B_EXPORT CueFileParser : public ImageFileReader
     {
@@ -49,6 +56,15 @@ namespace K3b {
          */
         QString imageFileType() const;
 
+        /**
+         * Parses \p filenames concurrently in the WorkerPool and blocks until
+         * all of them are done. Since the results are cached, creating a
+         * CueFileParser for one of the valid files afterwards is cheap.
+         *
+         * \return For each file whether it is a valid cue file with an image file.
+         */
+        static QVector<bool> validateFiles( const QStringList& filenames );
+
     private:
         void readFile();
         bool parseLine( QString line );
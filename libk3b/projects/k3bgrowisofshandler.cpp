@@ -17,6 +17,7 @@
 #include "k3bcore.h"
 #include "k3bglobalsettings.h"
 #include "k3bdevicehandler.h"
+#include "k3bwriteroutputparser.h"
 #include "k3b_i18n.h"
 
 #include <QDebug>
@@ -69,6 +70,8 @@ void K3b::GrowisofsHandler::handleStart()
 void K3b::GrowisofsHandler::handleLine( const QString& line )
 {
     int pos = 0;
+    double ringBuffer = 0.0;
+    double deviceBuffer = 0.0;
 
     if( line.startsWith( ":-[" ) ) {
         // Error
@@ -176,39 +179,34 @@ void K3b::GrowisofsHandler::handleLine( const QString& line )
         } else
             qDebug() << "(K3b::GrowisofsHandler) parsing error: '" << line.mid( pos, endPos-pos ) << "'";
     }
-    else if( (pos = line.indexOf( "RBU" )) > 0 ) {
-
-        // FIXME: use QRegExp
-
+    else if( WriterOutput::parseGrowisofsBuffers( line, ringBuffer, deviceBuffer ) ) {
         // parse ring buffer fill for growisofs >= 6.0
-        pos += 4;
-        int endPos = line.indexOf( '%', pos+1 );
-        bool ok = true;
-        double val = line.mid( pos, endPos-pos ).toDouble( &ok );
-        if( ok ) {
-            int newBuffer = (int)(val+0.5);
-            if( newBuffer != d->lastBuffer ) {
-                d->lastBuffer = newBuffer;
-                emit buffer( newBuffer );
-            }
+        TelemetrySample sample;
+
+        int newBuffer = (int)(ringBuffer+0.5);
+        sample.fifoFill = newBuffer;
+        if( newBuffer != d->lastBuffer ) {
+            d->lastBuffer = newBuffer;
+            emit buffer( newBuffer );
+        }
 
-            // device buffer for growisofs >= 7.0
-            pos = line.indexOf( "UBU", pos );
-            endPos = line.indexOf( '%', pos+5 );
-            if( pos > 0 ) {
-                pos += 4;
-                val = line.mid( pos, endPos-pos ).toDouble( &ok );
-                if( ok ) {
-                    int newBuffer = (int)(val+0.5);
-                    if( newBuffer != d->lastDeviceBuffer ) {
-                        d->lastDeviceBuffer = newBuffer;
-                        emit deviceBuffer( newBuffer );
-                    }
-                }
+        // device buffer for growisofs >= 7.0
+        if( deviceBuffer >= 0.0 ) {
+            newBuffer = (int)(deviceBuffer+0.5);
+            sample.deviceBufferFill = newBuffer;
+            if( newBuffer != d->lastDeviceBuffer ) {
+                d->lastDeviceBuffer = newBuffer;
+                emit deviceBuffer( newBuffer );
             }
         }
-        else
-            qDebug() << "(K3b::GrowisofsHandler) failed to parse ring buffer fill from '" << line.mid( pos, endPos-pos ) << "'";
+        else if( ( pos = line.indexOf( "UBU" ) ) > 0 ) {
+            qDebug() << "(K3b::GrowisofsHandler) device buffer parsing failed: '" << line.mid( pos ) << "'";
+        }
+
+        emit telemetry( sample );
+    }
+    else if( ( pos = line.indexOf( "RBU" ) ) > 0 ) {
+        qDebug() << "(K3b::GrowisofsHandler) ring buffer parsing failed: '" << line.mid( pos ) << "'";
     }
 
     else {
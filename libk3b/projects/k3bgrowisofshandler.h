@@ -16,6 +16,7 @@
 #define _K3B_GROWISOFS_HANDLER_H_
 
 #include "k3bdevice.h"
+#include "k3bjobtelemetry.h"
 
 #include <QObject>
 
@@ -69,6 +70,7 @@ namespace K3b {
         void newSubTask( const QString& );
         void buffer( int );
         void deviceBuffer( int );
+        void telemetry( const K3b::TelemetrySample& );
 
         /**
          * We need this to know when the writing finished to update the progress
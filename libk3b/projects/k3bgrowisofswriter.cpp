@@ -107,6 +107,8 @@ K3b::GrowisofsWriter::GrowisofsWriter( K3b::Device::Device* dev, K3b::JobHandler
              this, SIGNAL(buffer(int)) );
     connect( d->gh, SIGNAL(deviceBuffer(int)),
              this, SIGNAL(deviceBuffer(int)) );
+    connect( d->gh, SIGNAL(telemetry(K3b::TelemetrySample)),
+             this, SLOT(slotHandlerTelemetry(K3b::TelemetrySample)) );
     connect( d->gh, SIGNAL(flushingCache()),
              this, SLOT(slotFlushingCache()) );
 
@@ -372,6 +374,7 @@ void K3b::GrowisofsWriter::start()
                 emit infoMessage( i18n("Starting disc write..."), K3b::Job::MessageInfo );
             }
 
+            startTelemetry();
             d->gh->handleStart();
         }
     }
@@ -453,6 +456,9 @@ void K3b::GrowisofsWriter::slotReceivedStderr( const QString& line )
                 emit subPercent( p );
                 d->lastProgress = p;
             }
+            TelemetrySample sample;
+            sample.bytesWritten = done;
+
             if( (unsigned int)(done/1024/1024) > d->lastProgressed ) {
                 d->lastProgressed = (unsigned int)(done/1024/1024);
                 emit processedSize( d->lastProgressed, (int)(d->overallSizeFromOutput/1024/1024)  );
@@ -469,6 +475,7 @@ void K3b::GrowisofsWriter::slotReceivedStderr( const QString& line )
                         emit writeSpeed((int)(speed * d->speedMultiplicator()), d->speedMultiplicator());
                     }
                     d->lastWritingSpeed = speed;
+                    sample.writeSpeed = (int)(speed * d->speedMultiplicator());
                 }
                 else
                     qDebug() << "(K3b::GrowisofsWriter) speed parsing failed: '"
@@ -477,6 +484,8 @@ void K3b::GrowisofsWriter::slotReceivedStderr( const QString& line )
             else {
                 d->speedEst->dataWritten( done/1024 );
             }
+
+            emit telemetry( sample );
         }
         else
             qDebug() << "(K3b::GrowisofsWriter) progress parsing failed: '"
@@ -537,8 +546,22 @@ void K3b::GrowisofsWriter::slotProcessExited( int exitCode, QProcess::ExitStatus
 }
 
 
+void K3b::GrowisofsWriter::slotHandlerTelemetry( const K3b::TelemetrySample& sample )
+{
+    // the handler reports the ring buffer
+    TelemetrySample s( sample );
+    if( s.fifoFill >= 0 )
+        s.inputStallTime = inputStallTime( s.fifoFill );
+    emit telemetry( s );
+}
+
+
 void K3b::GrowisofsWriter::slotThroughput( int t )
 {
+    TelemetrySample sample;
+    sample.writeSpeed = t;
+    emit telemetry( sample );
+
     emit writeSpeed( t, d->speedMultiplicator() );
 }
 
@@ -95,6 +95,7 @@ namespace K3b {
         void slotReceivedStderr( const QString& );
         void slotProcessExited( int, QProcess::ExitStatus );
         void slotThroughput( int t );
+        void slotHandlerTelemetry( const K3b::TelemetrySample& sample );
         void slotFlushingCache();
 
     private:
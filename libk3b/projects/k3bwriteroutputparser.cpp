@@ -0,0 +1,274 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bwriteroutputparser.h"
+
+
+namespace {
+    inline bool isDigit( const QChar& c )
+    {
+        return( c.unicode() >= '0' && c.unicode() <= '9' );
+    }
+
+
+    /**
+     * Minimal scanner working directly on the QString data.
+     */
+    class Cursor
+    {
+    public:
+        Cursor( const QString& s, int pos = 0 )
+            : m_data( s.constData() ),
+              m_len( s.length() ),
+              m_pos( pos ) {
+        }
+
+        bool atEnd() const { return m_pos >= m_len; }
+        int pos() const { return m_pos; }
+        void setPos( int pos ) { m_pos = pos; }
+
+        int skipSpaces() {
+            int n = 0;
+            while( !atEnd() && m_data[m_pos].isSpace() ) {
+                ++m_pos;
+                ++n;
+            }
+            return n;
+        }
+
+        bool expectSpace() {
+            if( !atEnd() && m_data[m_pos].isSpace() ) {
+                ++m_pos;
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * Consumes @p s if it follows, otherwise the position is unchanged.
+         */
+        bool expect( const char* s ) {
+            const int start = m_pos;
+            for( ; *s; ++s, ++m_pos ) {
+                if( atEnd() || m_data[m_pos].unicode() != ushort( *s ) ) {
+                    m_pos = start;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * \return the number of digits read. @p value is 0 if there were none.
+         */
+        int readNumber( int& value ) {
+            int n = 0;
+            value = 0;
+            while( !atEnd() && isDigit( m_data[m_pos] ) ) {
+                value = value*10 + ( m_data[m_pos].unicode() - '0' );
+                ++m_pos;
+                ++n;
+            }
+            return n;
+        }
+
+        bool readDecimal( double& value ) {
+            int intPart = 0;
+            if( readNumber( intPart ) == 0 )
+                return false;
+            value = intPart;
+            if( !atEnd() && m_data[m_pos] == QLatin1Char( '.' ) ) {
+                ++m_pos;
+                double f = 0.1;
+                while( !atEnd() && isDigit( m_data[m_pos] ) ) {
+                    value += f * double( m_data[m_pos].unicode() - '0' );
+                    f *= 0.1;
+                    ++m_pos;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Reads "<spaces><number><spaces>" where at least one space has to
+         * follow the number. Like "\\s*(\\d*)\\s" in a regular expression.
+         */
+        bool readSpacedNumber( int& value ) {
+            const int leading = skipSpaces();
+            const int digits = readNumber( value );
+            const int trailing = skipSpaces();
+            return( trailing > 0 || ( digits == 0 && leading > 0 ) );
+        }
+
+    private:
+        const QChar* m_data;
+        int m_len;
+        int m_pos;
+    };
+
+
+    bool readPercentAfter( const QString& line, const char* key, int from, double& value, int& end )
+    {
+        const int pos = line.indexOf( QLatin1String( key ), from );
+        if( pos <= 0 )
+            return false;
+
+        Cursor c( line, pos + 3 );
+        c.skipSpaces();
+        if( c.readDecimal( value ) && c.expect( "%" ) ) {
+            end = c.pos();
+            return true;
+        }
+        return false;
+    }
+}
+
+
+bool K3b::WriterOutput::parseCdrecordProgress( const QString& line, CdrecordProgress& progress )
+{
+    Cursor c( line );
+
+    if( !c.expect( "Track" ) || !c.expectSpace() )
+        return false;
+
+    if( c.readNumber( progress.track ) != 2 || !c.expect( ":" ) )
+        return false;
+
+    if( !c.readSpacedNumber( progress.written ) || !c.expect( "of" ) )
+        return false;
+
+    if( !c.readSpacedNumber( progress.size ) || !c.expect( "MB" ) )
+        return false;
+
+    if( !c.expectSpace() || !c.expect( "written" ) || !c.expectSpace() )
+        return false;
+
+    progress.fifo = -1;
+    progress.buffer = -1;
+
+    // (fifo 100%) - not printed by some patched cdrecord versions
+    int pos = c.pos();
+    int value = 0;
+    if( c.expect( "(fifo" ) ) {
+        c.skipSpaces();
+        c.readNumber( value );
+        if( c.expect( "%)" ) ) {
+            progress.fifo = value;
+            c.skipSpaces();
+        }
+        else {
+            c.setPos( pos );
+        }
+    }
+
+    // [buf  99%]
+    pos = c.pos();
+    if( c.expect( "[buf" ) ) {
+        c.skipSpaces();
+        c.readNumber( value );
+        if( c.expect( "%]" ) )
+            progress.buffer = value;
+        else
+            c.setPos( pos );
+    }
+
+    return true;
+}
+
+
+bool K3b::WriterOutput::parseBurnfreeCounter( const QString& line, int& count )
+{
+    Cursor c( line );
+    return( c.expect( "BURN-Free" ) &&
+            c.expectSpace() &&
+            c.expect( "was" ) &&
+            c.expectSpace() &&
+            c.readNumber( count ) > 0 &&
+            c.expectSpace() &&
+            c.expect( "times" ) &&
+            c.expectSpace() &&
+            c.expect( "used" ) );
+}
+
+
+bool K3b::WriterOutput::parsePredictedUnderruns( const QString& line, int& count )
+{
+    Cursor c( line );
+    return( c.expect( "Total" ) &&
+            c.expectSpace() &&
+            c.expect( "of" ) &&
+            c.expectSpace() &&
+            c.readNumber( count ) > 0 &&
+            c.expectSpace() &&
+            c.expectSpace() &&
+            c.expect( "possible" ) &&
+            c.expectSpace() &&
+            c.expect( "buffer" ) &&
+            c.expectSpace() &&
+            c.expect( "underruns" ) &&
+            c.expectSpace() &&
+            c.expect( "predicted" ) );
+}
+
+
+bool K3b::WriterOutput::parseGrowisofsBuffers( const QString& line, double& ringBuffer, double& deviceBuffer )
+{
+    int end = 0;
+    if( !readPercentAfter( line, "RBU", 0, ringBuffer, end ) )
+        return false;
+
+    // device buffer for growisofs >= 7.0
+    if( !readPercentAfter( line, "UBU", end, deviceBuffer, end ) )
+        deviceBuffer = -1.0;
+
+    return true;
+}
+
+
+bool K3b::WriterOutput::parseCdrdaoWrote( const QString& line, int& written, int& size )
+{
+    const int pos = line.indexOf( QLatin1String( "Wrote" ) );
+    if( pos < 0 )
+        return false;
+
+    Cursor c( line, pos + 5 );
+    c.skipSpaces();
+    if( c.readNumber( written ) == 0 )
+        return false;
+    c.skipSpaces();
+    if( !c.expect( "of" ) )
+        return false;
+    c.skipSpaces();
+    return( c.readNumber( size ) > 0 );
+}
+
+
+int K3b::WriterOutput::indexOfDigit( const QString& line, int from )
+{
+    const QChar* data = line.constData();
+    for( int i = qMax( 0, from ); i < line.length(); ++i ) {
+        if( isDigit( data[i] ) )
+            return i;
+    }
+    return -1;
+}
+
+
+int K3b::WriterOutput::indexOfNonDigit( const QString& line, int from )
+{
+    const QChar* data = line.constData();
+    for( int i = qMax( 0, from ); i < line.length(); ++i ) {
+        if( !isDigit( data[i] ) )
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,84 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_WRITER_OUTPUT_PARSER_H_
+#define _K3B_WRITER_OUTPUT_PARSER_H_
+
+#include "k3b_export.h"
+
+#include <QString>
+
+namespace K3b {
+    /**
+     * Hand-written matchers for the progress output of the external
+     * writing applications.
+     *
+     * The writers receive many progress lines per second while burning.
+     * These functions replace the per-line QRegExp matching and do not
+     * allocate memory.
+     */
+    namespace WriterOutput
+    {
+        /**
+         * Progress line as printed by cdrecord, wodim and cdrskin:
+         * <pre>Track 01:   12 of  700 MB written (fifo 100%) [buf  99%]  16.0x.</pre>
+         *
+         * Fields which are not part of the line are set to -1.
+         */
+        struct CdrecordProgress
+        {
+            int track;
+            int written;
+            int size;
+            int fifo;
+            int buffer;
+        };
+
+        LIBK3B_EXPORT bool parseCdrecordProgress( const QString& line, CdrecordProgress& progress );
+
+        /**
+         * <pre>BURN-Free was 3 times used.</pre>
+         */
+        LIBK3B_EXPORT bool parseBurnfreeCounter( const QString& line, int& count );
+
+        /**
+         * <pre>Total of 2  possible buffer underruns predicted.</pre>
+         */
+        LIBK3B_EXPORT bool parsePredictedUnderruns( const QString& line, int& count );
+
+        /**
+         * Ring buffer (RBU) and drive buffer (UBU) fill levels in percent
+         * as printed by growisofs >= 6.0 and >= 7.0 respectively:
+         * <pre>  1234567/4567890 (27.0%) @2.4x, remaining 5:12 RBU 100.0% UBU  98.0%</pre>
+         *
+         * \param deviceBuffer is set to -1 if the line does not contain the UBU value.
+         */
+        LIBK3B_EXPORT bool parseGrowisofsBuffers( const QString& line, double& ringBuffer, double& deviceBuffer );
+
+        /**
+         * <pre>Wrote 12 of 700 MB (Buffers 100%  96%).</pre>
+         */
+        LIBK3B_EXPORT bool parseCdrdaoWrote( const QString& line, int& written, int& size );
+
+        /**
+         * \return The index of the first digit in @p line at or after @p from or -1.
+         */
+        LIBK3B_EXPORT int indexOfDigit( const QString& line, int from = 0 );
+
+        /**
+         * \return The index of the first non-digit in @p line at or after @p from or -1.
+         */
+        LIBK3B_EXPORT int indexOfNonDigit( const QString& line, int from = 0 );
+    }
+}
+
+#endif
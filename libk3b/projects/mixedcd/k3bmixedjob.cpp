@@ -223,6 +223,20 @@ void K3b::MixedJob::start()
 
     determineWritingMode();
 
+    //
+    // The volume levels are determined before decoding so the
+    // gains can be applied on the fly
+    //
+    m_audioImager->setTrackGains( QVector<double>() );
+    if( m_doc->audioDoc()->normalize() )
+        normalizeTracks();
+    else
+        initIsoImager();
+}
+
+
+void K3b::MixedJob::initIsoImager()
+{
     //
     // First we make sure the data portion is valid
     //
@@ -363,6 +377,8 @@ void K3b::MixedJob::cancel()
     if( d->maxSpeedJob )
         d->maxSpeedJob->cancel();
 
+    if( m_normalizeJob && m_normalizeJob->active() )
+        m_normalizeJob->cancel();
     if( m_writer && m_writer->active() )
         m_writer->cancel();
     if ( m_isoImager->active() )
@@ -593,19 +609,14 @@ void K3b::MixedJob::slotAudioDecoderFinished( bool success )
     else {
         emit infoMessage( i18n("Audio images successfully created."), MessageSuccess );
 
-        if( m_doc->audioDoc()->normalize() ) {
-            normalizeFiles();
-        }
-        else {
-            if( m_doc->mixedType() == K3b::MixedDoc::DATA_FIRST_TRACK )
-                m_currentAction = WRITING_ISO_IMAGE;
-            else
-                m_currentAction = WRITING_AUDIO_IMAGE;
+        if( m_doc->mixedType() == K3b::MixedDoc::DATA_FIRST_TRACK )
+            m_currentAction = WRITING_ISO_IMAGE;
+        else
+            m_currentAction = WRITING_AUDIO_IMAGE;
 
-            if( !prepareWriter() || !startWriting() ) {
-                cleanupAfterError();
-                jobFinished(false);
-            }
+        if( !prepareWriter() || !startWriting() ) {
+            cleanupAfterError();
+            jobFinished(false);
         }
     }
 }
@@ -817,8 +828,7 @@ void K3b::MixedJob::addAudioTracks( K3b::CdrecordWriter* writer )
 
     writer->addArgument( "-audio" );
 
-    // we always pad because although K3b makes sure all tracks' length are multiples of 2352
-    // it seems that normalize sometimes corrupts these lengths
+    // we always pad to be on the safe side with odd track lengths
     // FIXME: see K3b::AudioJob for the whole less4secs and zeroPregap handling
     writer->addArgument( "-pad" );
 
@@ -934,15 +944,19 @@ void K3b::MixedJob::slotAudioDecoderPercent( int p )
     // the only thing finished here might be the isoimager which is part of this task
     if( !m_doc->onTheFly() ) {
         double totalTasks = d->copies+1;
-        if( m_doc->audioDoc()->normalize() )
+        double tasksDone = 0.0;
+        if( m_doc->audioDoc()->normalize() ) {
             totalTasks+=1.0;
+            // the normalizer finished
+            tasksDone+=1.0;
+        }
 
         if( m_doc->mixedType() == K3b::MixedDoc::DATA_SECOND_SESSION )
             p = (int)((double)p*m_audioDocPartOfProcess);
         else
             p = (int)(100.0*(1.0-m_audioDocPartOfProcess) + (double)p*m_audioDocPartOfProcess);
 
-        emit percent( (int)((double)p / totalTasks) );
+        emit percent( (int)((100.0*tasksDone + (double)p) / totalTasks) );
     }
 }
 
@@ -979,10 +993,14 @@ void K3b::MixedJob::slotIsoImagerPercent( int p )
         }
         else {
             double totalTasks = d->copies+1.0;
-            if( m_doc->audioDoc()->normalize() )
+            double tasksDone = 0.0;
+            if( m_doc->audioDoc()->normalize() ) {
                 totalTasks+=1.0;
+                // the normalizer finished
+                tasksDone+=1.0;
+            }
 
-            emit percent( (int)((double)(p*(1.0-m_audioDocPartOfProcess)) / totalTasks) );
+            emit percent( (int)((100.0*tasksDone + (double)(p*(1.0-m_audioDocPartOfProcess))) / totalTasks) );
         }
     }
 }
@@ -1247,31 +1265,19 @@ void K3b::MixedJob::determineWritingMode()
 }
 
 
-void K3b::MixedJob::normalizeFiles()
+void K3b::MixedJob::normalizeTracks()
 {
     if( !m_normalizeJob ) {
-        m_normalizeJob = new K3b::AudioNormalizeJob( this, this );
+        m_normalizeJob = new K3b::AudioNormalizeJob( m_doc->audioDoc(), this, this );
 
         connect( m_normalizeJob, SIGNAL(infoMessage(QString,int)),
                  this, SIGNAL(infoMessage(QString,int)) );
         connect( m_normalizeJob, SIGNAL(percent(int)), this, SLOT(slotNormalizeProgress(int)) );
-        connect( m_normalizeJob, SIGNAL(subPercent(int)), this, SLOT(slotNormalizeSubProgress(int)) );
+        connect( m_normalizeJob, SIGNAL(percent(int)), this, SIGNAL(subPercent(int)) );
         connect( m_normalizeJob, SIGNAL(finished(bool)), this, SLOT(slotNormalizeJobFinished(bool)) );
         connect( m_normalizeJob, SIGNAL(newTask(QString)), this, SIGNAL(newSubTask(QString)) );
-        connect( m_normalizeJob, SIGNAL(debuggingOutput(QString,QString)),
-                 this, SIGNAL(debuggingOutput(QString,QString)) );
     }
 
-    // add all the files
-    QList<QString> files;
-    K3b::AudioTrack* track = m_doc->audioDoc()->firstTrack();
-    while( track ) {
-        files.append( m_tempData->bufferFileName(track) );
-        track = track->next();
-    }
-
-    m_normalizeJob->setFilesToNormalize( files );
-
     emit newTask( i18n("Normalizing volume levels") );
     m_normalizeJob->start();
 }
@@ -1282,15 +1288,8 @@ void K3b::MixedJob::slotNormalizeJobFinished( bool success )
         return;
 
     if( success ) {
-        if( m_doc->mixedType() == K3b::MixedDoc::DATA_FIRST_TRACK )
-            m_currentAction = WRITING_ISO_IMAGE;
-        else
-            m_currentAction = WRITING_AUDIO_IMAGE;
-
-        if( !prepareWriter() || !startWriting() ) {
-            cleanupAfterError();
-            jobFinished(false);
-        }
+        m_audioImager->setTrackGains( m_normalizeJob->trackGains() );
+        initIsoImager();
     }
     else {
         cleanupAfterError();
@@ -1300,27 +1299,12 @@ void K3b::MixedJob::slotNormalizeJobFinished( bool success )
 
 void K3b::MixedJob::slotNormalizeProgress( int p )
 {
-    double totalTasks = d->copies+2.0;
-    double tasksDone = 0;
-
-    if( m_doc->mixedType() == K3b::MixedDoc::DATA_SECOND_SESSION ) {
-        // the audio imager finished (m_audioDocPartOfProcess*1 task)
-        // plus the normalize progress
-        tasksDone = m_audioDocPartOfProcess;
-    }
-    else {
-        // the iso and audio imagers already finished (one task)
-        // plus the normalize progress
-        tasksDone = 1.0;
-    }
-
-    emit percent( (int)((100.0*tasksDone + (double)p) / totalTasks) );
-}
-
+    // the normalizing is the first task
+    double totalTasks = d->copies+1.0;
+    if( !m_doc->onTheFly() )
+        totalTasks+=1.0;
 
-void K3b::MixedJob::slotNormalizeSubProgress( int p )
-{
-    emit subPercent( p );
+    emit percent( (int)((double)p / totalTasks) );
 }
 
 
@@ -76,7 +76,6 @@ namespace K3b {
         // normalizing slots
         void slotNormalizeJobFinished( bool );
         void slotNormalizeProgress( int );
-        void slotNormalizeSubProgress( int );
 
         // misc slots
         void slotMediaReloadedForSecondSession( K3b::Device::DeviceHandler* dh );
@@ -95,7 +94,8 @@ namespace K3b {
         void removeBufferFiles();
         void createIsoImage();
         void determineWritingMode();
-        void normalizeFiles();
+        void normalizeTracks();
+        void initIsoImager();
         void prepareProgressInformation();
         void writeNextCopy();
         void determinePreliminaryDataImageSize();
@@ -15,6 +15,15 @@
 #include "k3bmpeginfo.h"
 #include "k3b_i18n.h"
 
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <string.h>
+
 #ifdef Q_OS_WIN32
 #define ftello ftell
 #define fseeko fseek
@@ -27,18 +36,86 @@ static const double frame_rates[ 16 ] =
     60.0, 0.0,
 };
 
+
+namespace {
+    // the scanner steps back a few bytes now and then (packet headers)
+    // which should not result in reading a complete new window
+    const llong s_lookBehind = 4096;
+
+    // never keep more results than this around
+    const int s_maxCacheEntries = 256;
+
+    class CacheEntry
+    {
+    public:
+        llong size;
+        QDateTime lastModified;
+        K3b::Mpeginfo info;
+        QString errorString;
+    };
+
+    //
+    // Parsing a big MPEG file takes a while and VcdDoc parses every file
+    // again when a project is reloaded. Thus, we remember the results for
+    // unchanged files.
+    //
+    class ResultCache
+    {
+    public:
+        bool lookup( const QFileInfo& file, K3b::Mpeginfo* info, QString& errorString ) {
+            QMutexLocker locker( &mutex );
+            QHash<QString, CacheEntry>::const_iterator it = entries.constFind( file.absoluteFilePath() );
+            if ( it == entries.constEnd() ||
+                 it->size != file.size() ||
+                 it->lastModified != file.lastModified() )
+                return false;
+            *info = it->info;
+            errorString = it->errorString;
+            return true;
+        }
+
+        void store( const QFileInfo& file, const K3b::Mpeginfo* info, const QString& errorString ) {
+            QMutexLocker locker( &mutex );
+            if ( entries.count() >= s_maxCacheEntries )
+                entries.clear();
+            CacheEntry& entry = entries[ file.absoluteFilePath() ];
+            entry.size = file.size();
+            entry.lastModified = file.lastModified();
+            entry.info = *info;
+            entry.errorString = errorString;
+        }
+
+    private:
+        QMutex mutex;
+        QHash<QString, CacheEntry> entries;
+    };
+
+    Q_GLOBAL_STATIC( ResultCache, s_resultCache )
+}
+
+
 K3b::MpegInfo::MpegInfo( const char* filename )
     : m_mpegfile( 0 ),
       m_filename( filename ),
+      m_filesize( 0 ),
       m_done( false ),
       m_buffstart( 0 ),
       m_buffend( 0 ),
       m_buffer( 0 ),
+      m_bdBuffstart( 0 ),
+      m_bdBuffend( 0 ),
+      m_bdBuffer( 0 ),
       m_initial_TS( 0.0 )
 {
 
     mpeg_info = new Mpeginfo();
 
+    const QFileInfo fileInfo( QFile::decodeName( filename ) );
+    if ( s_resultCache->lookup( fileInfo, mpeg_info, m_error_string ) ) {
+        qDebug() << QString( "Using cached information for %1" ).arg( m_filename );
+        return ;
+    }
+
     m_mpegfile = fopen( filename, "rb" );
 
     if ( m_mpegfile == 0 ) {
@@ -68,16 +145,17 @@ K3b::MpegInfo::MpegInfo( const char* filename )
     }
 
     m_buffer = new byte[ BUFFERSIZE ];
+    m_bdBuffer = new byte[ BUFFERSIZE ];
 
     MpegParsePacket ( );
 
+    s_resultCache->store( fileInfo, mpeg_info, m_error_string );
 }
 
 K3b::MpegInfo::~MpegInfo()
 {
-    if ( m_buffer ) {
-        delete[] m_buffer;
-    }
+    delete[] m_buffer;
+    delete[] m_bdBuffer;
     if ( m_mpegfile ) {
         fclose( m_mpegfile );
     }
@@ -324,50 +402,70 @@ llong K3b::MpegInfo::MpegParsePacket ( llong offset )
     return offset;
 }
 
-byte K3b::MpegInfo::GetByte( llong offset )
+bool K3b::MpegInfo::FillBuffer( llong offset )
 {
-    unsigned long nread;
-    if ( ( offset >= m_buffend ) || ( offset < m_buffstart ) ) {
+    llong start = offset - s_lookBehind;
+    start = start >= 0 ? start : 0;
 
-        if ( fseeko( m_mpegfile, offset, SEEK_SET ) ) {
-            qDebug() << QString( "could not get seek to offset (%1) in file %2 (size:%3)" ).arg( offset ).arg( m_filename ).arg( m_filesize );
-            return 0x11;
-        }
-        nread = fread( m_buffer, 1, BUFFERSIZE, m_mpegfile );
-        m_buffstart = offset;
-        m_buffend = offset + nread;
-        if ( ( offset >= m_buffend ) || ( offset < m_buffstart ) ) {
-            // weird
-            qDebug() << QString( "could not get offset %1 in file %2 [%3]" ).arg( offset ).arg( m_filename ).arg( m_filesize );
-            return 0x11;
-        }
+    if ( fseeko( m_mpegfile, start, SEEK_SET ) ) {
+        qDebug() << QString( "could not get seek to offset (%1) in file %2 (size:%3)" ).arg( start ).arg( m_filename ).arg( m_filesize );
+        m_buffstart = m_buffend = 0;
+        return false;
     }
-    return m_buffer[ offset - m_buffstart ];
+    unsigned long nread = fread( m_buffer, 1, BUFFERSIZE, m_mpegfile );
+    m_buffstart = start;
+    m_buffend = start + nread;
+    if ( ( offset >= m_buffend ) || ( offset < m_buffstart ) ) {
+        // weird
+        qDebug() << QString( "could not get offset %1 in file %2 [%3]" ).arg( offset ).arg( m_filename ).arg( m_filesize );
+        return false;
+    }
+    return true;
 }
 
-// same as above but improved for backward search
-byte K3b::MpegInfo::bdGetByte( llong offset )
+
+bool K3b::MpegInfo::bdFillBuffer( llong offset )
 {
-    unsigned long nread;
-    if ( ( offset >= m_buffend ) || ( offset < m_buffstart ) ) {
-        llong start = offset - BUFFERSIZE + 1 ;
-        start = start >= 0 ? start : 0;
+    llong start = offset - BUFFERSIZE + 1 ;
+    start = start >= 0 ? start : 0;
 
-        fseeko( m_mpegfile, start, SEEK_SET );
+    if ( fseeko( m_mpegfile, start, SEEK_SET ) ) {
+        qDebug() << QString( "could not get seek to offset (%1) in file %2 (size:%3)" ).arg( start ).arg( m_filename ).arg( m_filesize );
+        m_bdBuffstart = m_bdBuffend = 0;
+        return false;
+    }
+    unsigned long nread = fread( m_bdBuffer, 1, BUFFERSIZE, m_mpegfile );
+    m_bdBuffstart = start;
+    m_bdBuffend = start + nread;
+    if ( ( offset >= m_bdBuffend ) || ( offset < m_bdBuffstart ) ) {
+        // weird
+        qDebug() << QString( "could not get offset %1 in file %2 [%3]" ).arg( offset ).arg( m_filename ).arg( m_filesize );
+        return false;
+    }
+    return true;
+}
 
-        nread = fread( m_buffer, 1, BUFFERSIZE, m_mpegfile );
-        m_buffstart = start;
-        m_buffend = start + nread;
-        if ( ( offset >= m_buffend ) || ( offset < m_buffstart ) ) {
-            // weird
-            qDebug() << QString( "could not get offset %1 in file %2 [%3]" ).arg( offset ).arg( m_filename ).arg( m_filesize );
 
+byte K3b::MpegInfo::GetByte( llong offset )
+{
+    if ( ( offset >= m_buffend ) || ( offset < m_buffstart ) ) {
+        if ( !FillBuffer( offset ) )
             return 0x11;
-        }
     }
     return m_buffer[ offset - m_buffstart ];
 }
 
+// same as above but using a separate window which ends at the offset
+// so backward searches do not throw away the forward window
+byte K3b::MpegInfo::bdGetByte( llong offset )
+{
+    if ( ( offset >= m_bdBuffend ) || ( offset < m_bdBuffstart ) ) {
+        if ( !bdFillBuffer( offset ) )
+            return 0x11;
+    }
+    return m_bdBuffer[ offset - m_bdBuffstart ];
+}
+
 
 llong K3b::MpegInfo::GetNBytes( llong offset, int n )
 {
@@ -403,14 +501,31 @@ bool K3b::MpegInfo::EnsureMPEG( llong offset, byte mark )
 // find next 0x 00 00 01 xx sequence, returns offset or -1 on err
 llong K3b::MpegInfo::FindNextMarker( llong from )
 {
-    llong offset;
-    for ( offset = from; offset < ( m_filesize - 4 ); offset++ ) {
-        if (
-            ( GetByte( offset + 0 ) == 0x00 ) &&
-            ( GetByte( offset + 1 ) == 0x00 ) &&
-            ( GetByte( offset + 2 ) == 0x01 ) ) {
-            return offset;
+    const llong end = m_filesize - 4;
+    llong offset = from >= 0 ? from : 0;
+
+    while ( offset < end ) {
+        // make sure the window contains the complete start code at offset
+        if ( ( offset < m_buffstart ) || ( offset + 2 >= m_buffend ) ) {
+            if ( !FillBuffer( offset ) || offset + 2 >= m_buffend )
+                return -1;
+        }
+
+        // the 0x01 is much rarer than the zeros (stuffing) so that is what we look for
+        const llong stop = qMin( m_buffend, end + 2 );
+        const byte* p = m_buffer + ( offset + 2 - m_buffstart );
+        const byte* const e = m_buffer + ( stop - m_buffstart );
+        while ( p < e ) {
+            p = static_cast<const byte*>( ::memchr( p, 0x01, e - p ) );
+            if ( !p )
+                break;
+            if ( p[ -1 ] == 0x00 && p[ -2 ] == 0x00 )
+                return m_buffstart + ( p - m_buffer ) - 2;
+            ++p;
         }
+
+        // continue with the first offset we did not check
+        offset = stop - 2;
     }
     return -1;
 }
@@ -449,29 +564,39 @@ llong K3b::MpegInfo::FindNextMarker( llong from, byte mark )
 
 llong K3b::MpegInfo::bdFindNextMarker( llong from, byte mark )
 {
-    llong offset;
-    for ( offset = from; offset >= 0; offset-- ) {
-        if (
-            ( bdGetByte( offset ) == 0x00 ) &&
-            ( bdGetByte( offset + 1 ) == 0x00 ) &&
-            ( bdGetByte( offset + 2 ) == 0x01 ) &&
-            ( bdGetByte( offset + 3 ) == mark ) ) {
+    llong offset = from;
+    while ( offset >= 0 ) {
+        offset = bdFindNextMarker( offset, ( byte* )0 );
+        if ( offset < 0 || bdGetByte( offset + 3 ) == mark )
             return offset;
-        }
+        offset--;
     }
     return -1;
 }
 
+// find previous 0x 00 00 01 xx sequence, returns offset or -1 on err and
+// change mark to xx if mark is not 0
 llong K3b::MpegInfo::bdFindNextMarker( llong from, byte* mark )
 {
-    llong offset;
-    for ( offset = from; offset >= 0; offset-- ) {
-        if ( ( bdGetByte( offset ) == 0x00 ) &&
-             ( bdGetByte( offset + 1 ) == 0x00 ) &&
-             ( bdGetByte( offset + 2 ) == 0x01 ) ) {
-            *mark = bdGetByte( offset + 3 );
-            return offset;
+    llong offset = from;
+    while ( offset >= 0 ) {
+        // make sure the window contains the complete start code at offset
+        if ( ( offset < m_bdBuffstart ) || ( offset + 3 >= m_bdBuffend ) ) {
+            if ( !bdFillBuffer( offset + 3 ) )
+                return -1;
         }
+
+        for ( llong i = offset - m_bdBuffstart; i >= 0; --i ) {
+            const byte* p = m_bdBuffer + i;
+            if ( p[ 2 ] == 0x01 && p[ 1 ] == 0x00 && p[ 0 ] == 0x00 ) {
+                offset = m_bdBuffstart + i;
+                if ( mark )
+                    *mark = bdGetByte( offset + 3 );
+                return offset;
+            }
+        }
+
+        offset = m_bdBuffstart - 1;
     }
     return -1;
 
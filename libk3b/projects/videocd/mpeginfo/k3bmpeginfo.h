@@ -18,7 +18,8 @@
 #include <stdio.h>
 
 // #define BUFFERSIZE   16384
-#define BUFFERSIZE   65536
+// #define BUFFERSIZE   65536
+#define BUFFERSIZE   1048576
 
 #define MPEG_START_CODE_PATTERN  ((ulong) 0x00000100)
 #define MPEG_START_CODE_MASK     ((ulong) 0xffffff00)
@@ -138,6 +139,8 @@ namespace K3b {
 
     private:
         //  General ToolBox
+        bool FillBuffer( llong offset );
+        bool bdFillBuffer( llong offset );
         byte GetByte( llong offset );
         byte bdGetByte( llong offset );
         llong GetNBytes( llong, int );
@@ -169,9 +172,16 @@ namespace K3b {
 
         bool m_done;
 
+        // forward window
         llong m_buffstart;
         llong m_buffend;
         byte* m_buffer;
+
+        // backward window
+        llong m_bdBuffstart;
+        llong m_bdBuffend;
+        byte* m_bdBuffer;
+
         double m_initial_TS;
         QString m_error_string;
 
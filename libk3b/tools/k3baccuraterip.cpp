@@ -0,0 +1,418 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baccuraterip.h"
+
+#include "k3bcrc.h"
+#include "k3btoc.h"
+#include "k3btrack.h"
+
+#include <QDebug>
+#include <QFile>
+
+
+namespace {
+    const int s_samplesPerSector = 588;
+
+    // AccurateRip ignores the first and last five sectors of the disc
+    const int s_skippedSamples = 5*s_samplesPerSector;
+
+    quint32 fromLe32( const unsigned char* p )
+    {
+        return quint32( p[0] ) | quint32( p[1] )<<8 | quint32( p[2] )<<16 | quint32( p[3] )<<24;
+    }
+
+    struct TrackState
+    {
+        TrackState()
+            : samples( 0 ),
+              checkFrom( 1 ),
+              checkTo( 0 ),
+              processed( 0 ),
+              v1( 0 ),
+              v2( 0 ),
+              sum( 0 ),
+              crc32( 0 ),
+              headComplete( false ),
+              tailFilled( 0 ) {
+        }
+
+        // the track in samples, positions are 1-based like the AccurateRip multiplier
+        qint64 samples;
+        qint64 checkFrom;
+        qint64 checkTo;
+
+        qint64 processed;
+        quint32 v1;
+        quint32 v2;
+        quint32 sum;
+        quint32 crc32;
+
+        // the samples checkFrom-window .. checkFrom+window-1
+        QVector<quint32> head;
+        bool headComplete;
+
+        // the samples checkTo-window+1 .. checkTo+window
+        QVector<quint32> tail;
+
+        // number of samples of the next track stored in tail
+        qint64 tailFilled;
+
+        bool valid() const {
+            return samples > 0 && processed == samples;
+        }
+    };
+}
+
+
+class K3b::AccurateRip::Private
+{
+public:
+    int window;
+
+    // the audio tracks by toc index
+    QVector<TrackState> tracks;
+    int firstAudioTrack;
+    int lastAudioTrack;
+
+    quint32 id1;
+    quint32 id2;
+    quint32 cddbId;
+    int audioTrackCount;
+
+    // the current track, the previous one if it was processed right before
+    int current;
+    int previous;
+
+    // incomplete byte of a sample
+    char carry[4];
+    int carryLen;
+
+    void addSample( quint32 sample );
+
+    qint64 tailNeeded( const TrackState& t ) const {
+        return qMax<qint64>( 0, t.checkTo + window - t.samples );
+    }
+};
+
+
+void K3b::AccurateRip::Private::addSample( quint32 sample )
+{
+    TrackState& t = tracks[current];
+    const qint64 m = ++t.processed;
+
+    if( m >= t.checkFrom && m <= t.checkTo ) {
+        const quint64 product = quint64( sample ) * quint64( m );
+        t.v1 += quint32( product );
+        t.v2 += quint32( product ) + quint32( product >> 32 );
+        t.sum += sample;
+    }
+
+    const qint64 headIndex = m - ( t.checkFrom - window );
+    if( headIndex >= 0 && headIndex < t.head.count() )
+        t.head[headIndex] = sample;
+
+    const qint64 tailIndex = m - ( t.checkTo - window + 1 );
+    if( tailIndex >= 0 && tailIndex < t.tail.count() )
+        t.tail[tailIndex] = sample;
+
+    // the first samples belong to the tail of the previous track, too
+    if( previous >= 0 ) {
+        TrackState& p = tracks[previous];
+        if( p.tailFilled < tailNeeded( p ) ) {
+            p.tail[p.samples + p.tailFilled + 1 - ( p.checkTo - window + 1 )] = sample;
+            ++p.tailFilled;
+        }
+        else {
+            previous = -1;
+        }
+    }
+}
+
+
+K3b::AccurateRip::AccurateRip( const Device::Toc& toc, int offsetWindow )
+    : d( new Private() )
+{
+    d->window = qBound( 0, offsetWindow, s_skippedSamples-1 );
+    d->tracks.resize( toc.count() );
+    d->firstAudioTrack = d->lastAudioTrack = -1;
+    d->current = d->previous = -1;
+    d->carryLen = 0;
+
+    for( int i = 0; i < toc.count(); ++i ) {
+        if( toc[i].type() == Device::Track::TYPE_AUDIO ) {
+            if( d->firstAudioTrack < 0 )
+                d->firstAudioTrack = i;
+            d->lastAudioTrack = i;
+        }
+    }
+
+    d->id1 = d->id2 = 0;
+    d->audioTrackCount = 0;
+    d->cddbId = toc.discId();
+    if( d->firstAudioTrack < 0 )
+        return;
+
+    for( int i = d->firstAudioTrack; i <= d->lastAudioTrack; ++i ) {
+        TrackState& t = d->tracks[i];
+        t.samples = qint64( toc[i].length().lba() ) * s_samplesPerSector;
+        t.checkFrom = ( i == d->firstAudioTrack ? s_skippedSamples : 1 );
+        t.checkTo = ( i == d->lastAudioTrack ? t.samples - s_skippedSamples : t.samples );
+        t.head.fill( 0, 2*d->window );
+        t.tail.fill( 0, 2*d->window );
+        t.headComplete = ( t.checkFrom - d->window >= 1 );
+
+        const quint32 offset = toc[i].firstSector().lba();
+        d->id1 += offset;
+        d->id2 += qMax<quint32>( offset, 1 ) * quint32( i+1 );
+        ++d->audioTrackCount;
+    }
+
+    const quint32 leadOut = toc[d->lastAudioTrack].lastSector().lba() + 1;
+    d->id1 += leadOut;
+    d->id2 += leadOut * quint32( d->lastAudioTrack+2 );
+}
+
+
+K3b::AccurateRip::~AccurateRip()
+{
+    delete d;
+}
+
+
+int K3b::AccurateRip::offsetWindow() const
+{
+    return d->window;
+}
+
+
+void K3b::AccurateRip::beginTrack( int track )
+{
+    const int index = track-1;
+    if( index < d->firstAudioTrack || index > d->lastAudioTrack ) {
+        qDebug() << "(K3b::AccurateRip) no audio track:" << track;
+        d->current = d->previous = -1;
+        return;
+    }
+
+    // only consecutive tracks share their border samples
+    d->previous = -1;
+    if( d->current == index-1 && d->tracks[index-1].valid() ) {
+        d->previous = index-1;
+
+        TrackState& p = d->tracks[index-1];
+        TrackState& t = d->tracks[index];
+        p.tailFilled = 0;
+        if( !t.headComplete ) {
+            // the samples before the track are the last ones of the previous track
+            const qint64 missing = d->window - ( t.checkFrom - 1 );
+            for( qint64 i = 0; i < missing; ++i ) {
+                const qint64 m = p.samples - missing + 1 + i;
+                t.head[i] = p.tail[m - ( p.checkTo - d->window + 1 )];
+            }
+            t.headComplete = true;
+        }
+    }
+
+    TrackState& t = d->tracks[index];
+    t.processed = 0;
+    t.v1 = t.v2 = t.sum = t.crc32 = 0;
+    t.tailFilled = 0;
+    d->current = index;
+    d->carryLen = 0;
+}
+
+
+void K3b::AccurateRip::process( const char* data, qint64 len )
+{
+    if( d->current < 0 )
+        return;
+
+    TrackState& t = d->tracks[d->current];
+    const unsigned char* p = reinterpret_cast<const unsigned char*>( data );
+
+    // never go beyond the track, the rest belongs to nobody we know
+    len = qMin( len, ( t.samples - t.processed )*4 - d->carryLen );
+    if( len <= 0 )
+        return;
+
+    t.crc32 = Device::calcCrc32( p, len, t.crc32 );
+
+    if( d->carryLen > 0 ) {
+        while( d->carryLen < 4 && len > 0 ) {
+            d->carry[d->carryLen++] = *p++;
+            --len;
+        }
+        if( d->carryLen < 4 )
+            return;
+        d->addSample( fromLe32( reinterpret_cast<const unsigned char*>( d->carry ) ) );
+        d->carryLen = 0;
+    }
+
+    while( len >= 4 ) {
+        d->addSample( fromLe32( p ) );
+        p += 4;
+        len -= 4;
+    }
+
+    while( len-- > 0 )
+        d->carry[d->carryLen++] = *p++;
+}
+
+
+void K3b::AccurateRip::endTrack()
+{
+    if( d->current >= 0 && !d->tracks[d->current].valid() ) {
+        qDebug() << "(K3b::AccurateRip) track" << d->current+1 << "incomplete.";
+        d->current = -1;
+    }
+    d->previous = -1;
+}
+
+
+K3b::AccurateRip::TrackResult K3b::AccurateRip::result( int track ) const
+{
+    TrackResult r;
+    const int index = track-1;
+    if( index < d->firstAudioTrack || index > d->lastAudioTrack || !d->tracks[index].valid() )
+        return r;
+
+    const TrackState& t = d->tracks[index];
+    r.valid = true;
+    r.v1 = t.v1;
+    r.v2 = t.v2;
+    r.crc32 = t.crc32;
+
+    if( !t.headComplete || t.tailFilled < d->tailNeeded( t ) || d->window == 0 )
+        return r;
+
+    // The checksum for offset k is sum( i*x[i+k] ) over checkFrom <= i <= checkTo.
+    // Moving k by one only changes the terms at the borders and
+    // multiplies everything in between by one less (or more).
+    const int w = d->window;
+    const qint64 a = t.checkFrom;
+    const qint64 b = t.checkTo;
+    const QVector<quint32>& head = t.head;
+    const QVector<quint32>& tail = t.tail;
+    // x[a+j] == head[w+j], x[b+j] == tail[w-1+j]
+    r.offsetV1.resize( 2*w+1 );
+    r.offsetV1[w] = t.v1;
+
+    quint32 c = t.v1;
+    quint32 s = t.sum;
+    for( int k = 1; k <= w; ++k ) {
+        const quint32 first = head[w+k-1];
+        const quint32 last = tail[w-1+k];
+        c = c - s + first + quint32( b )*last - quint32( a )*first;
+        s = s - first + last;
+        r.offsetV1[w+k] = c;
+    }
+
+    c = t.v1;
+    s = t.sum;
+    for( int k = 0; k > -w; --k ) {
+        const quint32 first = head[w+k-1];
+        const quint32 last = tail[w-1+k];
+        c = c - quint32( b )*last + quint32( a-1 )*first + s - last + first;
+        s = s - last + first;
+        r.offsetV1[w+k-1] = c;
+    }
+
+    return r;
+}
+
+
+QString K3b::AccurateRip::discId() const
+{
+    return QString().sprintf( "%03d-%08x-%08x-%08x", d->audioTrackCount, d->id1, d->id2, d->cddbId );
+}
+
+
+QString K3b::AccurateRip::databaseFilename() const
+{
+    return QLatin1String( "dBAR-" ) + discId() + QLatin1String( ".bin" );
+}
+
+
+QList<QList<K3b::AccurateRip::DatabaseEntry> > K3b::AccurateRip::loadDatabase( const QString& filename ) const
+{
+    QList<QList<DatabaseEntry> > entries;
+
+    QFile f( filename );
+    if( !f.open( QIODevice::ReadOnly ) ) {
+        qDebug() << "(K3b::AccurateRip) could not open" << filename;
+        return entries;
+    }
+
+    // one chunk per pressing: track count, the three disc ids and
+    // confidence, checksum, and the checksum of frame 450 per track
+    const QByteArray data = f.readAll();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>( data.constData() );
+    int pos = 0;
+    while( pos + 13 <= data.size() ) {
+        const int trackCount = p[pos];
+        if( trackCount != d->audioTrackCount ||
+            fromLe32( p+pos+1 ) != d->id1 ||
+            fromLe32( p+pos+5 ) != d->id2 ||
+            fromLe32( p+pos+9 ) != d->cddbId ||
+            pos + 13 + trackCount*9 > data.size() ) {
+            qDebug() << "(K3b::AccurateRip)" << filename << "does not belong to disc" << discId();
+            return QList<QList<DatabaseEntry> >();
+        }
+        pos += 13;
+
+        while( entries.count() < trackCount )
+            entries.append( QList<DatabaseEntry>() );
+
+        for( int i = 0; i < trackCount; ++i ) {
+            DatabaseEntry e;
+            e.confidence = p[pos];
+            e.crc = fromLe32( p+pos+1 );
+            if( e.confidence > 0 )
+                entries[i].append( e );
+            pos += 9;
+        }
+    }
+
+    return entries;
+}
+
+
+K3b::AccurateRip::Match K3b::AccurateRip::match( int track, const QList<DatabaseEntry>& entries ) const
+{
+    Match m;
+    const TrackResult r = result( track );
+    if( !r.valid )
+        return m;
+
+    Q_FOREACH( const DatabaseEntry& e, entries ) {
+        if( e.crc == r.v2 || e.crc == r.v1 ) {
+            if( m.offset != 0 || e.confidence > m.confidence ) {
+                m.confidence = e.confidence;
+                m.offset = 0;
+                m.v2 = ( e.crc == r.v2 );
+            }
+        }
+        else if( m.confidence == 0 || m.offset != 0 ) {
+            for( int i = 0; i < r.offsetV1.count(); ++i ) {
+                const int offset = i - d->window;
+                if( offset != 0 && r.offsetV1[i] == e.crc && e.confidence > m.confidence ) {
+                    m.confidence = e.confidence;
+                    m.offset = offset;
+                    m.v2 = false;
+                }
+            }
+        }
+    }
+
+    return m;
+}
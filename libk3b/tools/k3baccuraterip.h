@@ -0,0 +1,168 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_ACCURATE_RIP_H_
+#define _K3B_ACCURATE_RIP_H_
+
+#include "k3b_export.h"
+
+#include <QList>
+#include <QString>
+#include <QVector>
+
+namespace K3b {
+    namespace Device {
+        class Toc;
+    }
+
+    /**
+     * Computes the AccurateRip v1 and v2 checksums and the CRC32 of the
+     * audio tracks of a CD while the audio data is ripped.
+     *
+     * The CRC32 covers the complete track data like the copy CRC of EAC.
+     * It is not the checksum used by the CUETools database. The AccurateRip
+     * checksums skip the first and the last five sectors of the disc as
+     * defined by AccurateRip.
+     *
+     * In addition the v1 checksum is determined for all read offsets within
+     * offsetWindow() samples, which allows to verify a rip done with an
+     * uncorrected drive offset without reading the disc again. This needs the
+     * samples around the track borders, thus the offsets of a track are only
+     * available if its neighbouring tracks have been processed in order,
+     * too, as is the case when ripping a complete disc.
+     *
+     * Only ripping uses this class. Burned audio CDs are not verified since
+     * VerificationJob only handles data tracks.
+     *
+     * Usage:
+     * <pre>
+     * AccurateRip ar( toc );
+     * ar.beginTrack( 1 );
+     * while( ... ) ar.process( data, len );
+     * ar.endTrack();
+     * ar.result( 1 );
+     * </pre>
+     */
+    class LIBK3B_EXPORT AccurateRip
+    {
+    public:
+        struct TrackResult
+        {
+            TrackResult()
+                : valid( false ),
+                  v1( 0 ),
+                  v2( 0 ),
+                  crc32( 0 ) {
+            }
+
+            /**
+             * false if the track has not been processed completely.
+             */
+            bool valid;
+            quint32 v1;
+            quint32 v2;
+            quint32 crc32;
+
+            /**
+             * The v1 checksums for the read offsets -offsetWindow() to
+             * offsetWindow(). Empty if the neighbouring samples are missing.
+             */
+            QVector<quint32> offsetV1;
+        };
+
+        /**
+         * One entry of an AccurateRip database file.
+         */
+        struct DatabaseEntry
+        {
+            int confidence;
+            quint32 crc;
+        };
+
+        struct Match
+        {
+            Match()
+                : confidence( 0 ),
+                  offset( 0 ),
+                  v2( false ) {
+            }
+
+            /**
+             * 0 if no entry matches.
+             */
+            int confidence;
+
+            /**
+             * The read offset in samples the entry matches with.
+             */
+            int offset;
+            bool v2;
+        };
+
+        /**
+         * \param toc The toc of the disc. Only the audio tracks are used.
+         * \param offsetWindow The maximum read offset in samples to check.
+         */
+        explicit AccurateRip( const Device::Toc& toc, int offsetWindow = 5*588-1 );
+        ~AccurateRip();
+
+        int offsetWindow() const;
+
+        /**
+         * \param track The 1-based track number in the toc.
+         */
+        void beginTrack( int track );
+
+        /**
+         * Add 16 bit little endian stereo samples of the current track.
+         */
+        void process( const char* data, qint64 len );
+
+        void endTrack();
+
+        TrackResult result( int track ) const;
+
+        /**
+         * The disc identification used by the AccurateRip database
+         * in the form "003-0004d3a2-001ca6d6-1a0a6b03".
+         */
+        QString discId() const;
+
+        /**
+         * The name of the AccurateRip database file of the disc,
+         * i.e. "dBAR-" + discId() + ".bin".
+         */
+        QString databaseFilename() const;
+
+        /**
+         * Parses an AccurateRip database file.
+         *
+         * \return The entries per audio track. Empty if the file cannot be read or
+         *         belongs to a different disc.
+         */
+        QList<QList<DatabaseEntry> > loadDatabase( const QString& filename ) const;
+
+        /**
+         * Compares the result of \p track with the database \p entries of the track
+         * as returned by loadDatabase(). Offset 0 is preferred over other offsets.
+         */
+        Match match( int track, const QList<DatabaseEntry>& entries ) const;
+
+    private:
+        class Private;
+        Private* const d;
+
+        Q_DISABLE_COPY(AccurateRip)
+    };
+}
+
+#endif
@@ -21,12 +21,17 @@
 #include "k3btoc.h"
 #include "k3bmsf.h"
 
+#include <QBitArray>
+#include <QByteArray>
 #include <QDebug>
 #include <QFile>
 #include <QGlobalStatic>
 #include <QLibrary>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QVector>
+
+#include <string.h>
 
 #ifdef Q_OS_WIN32
 typedef short int int16_t;
@@ -160,6 +165,43 @@ extern "C" {
 #define PARANOIA_MODE_NEVERSKIP   32
 
 
+namespace {
+    // sectors read at once in the fast first pass
+    const int s_burstSectors = 27;
+
+    // one bit per byte of a sector (MMC READ CD error field 01b)
+    const int s_c2Size = 294;
+
+    // sense key of a command the drive does not support
+    const int s_illegalRequest = 0x5;
+
+    // Sectors to read in between the two reads of a sector so the second one
+    // is not served from the drive cache. About 19 MB, more than the cache of
+    // any CD drive.
+    const int s_cacheSectors = 8192;
+
+    // the checksum pass reads this much at once to save seeks
+    const int s_checkAhead = 2048;
+
+    enum C2Support {
+        C2Unknown,
+        C2Supported,
+        C2Unsupported
+    };
+
+    // FNV-1a, only used to compare two reads of the same sector
+    quint32 sectorChecksum( const char* data )
+    {
+        quint32 hash = 2166136261U;
+        for( int i = 0; i < CD_FRAMESIZE_RAW; ++i ) {
+            hash ^= static_cast<unsigned char>( data[i] );
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+}
+
+
 
 namespace K3b {
     /**
@@ -344,6 +386,14 @@ public:
           paranoiaLevel(0),
           neverSkip(true),
           maxRetries(5),
+          fastFirstPass(false),
+          c2Support(C2Unknown),
+          checkedEnd(0),
+          sectorsRead(0),
+          burstStart(0),
+          burstCount(0),
+          paranoiaUntil(0),
+          suspiciousCount(0),
           data(0) {
     }
 
@@ -387,10 +437,192 @@ public:
     bool neverSkip;
     int maxRetries;
 
+    // fast first pass
+    bool fastFirstPass;
+    C2Support c2Support;
+
+    // The checksum pass runs ahead of the copy pass. Per sector of the
+    // range it records the checksum and whether the drive reported an error.
+    long checkedEnd;
+    QVector<quint32> checksums;
+    QBitArray checkErrors;
+    // per burst: the value of sectorsRead once the checksum pass read it
+    QVector<qint64> checkStamps;
+    qint64 sectorsRead;
+
+    // the copy pass
+    QByteArray burstBuffer;
+    long burstStart;
+    int burstCount;
+    // the confidence map of the burst: sectors which need paranoia
+    QBitArray suspicious;
+    // paranoia reads up to here once it had to take over in a burst
+    long paranoiaUntil;
+    long suspiciousCount;
+    char sectorBuffer[CD_FRAMESIZE_RAW];
+
     K3b::CdparanoiaLibData* data;
+
+    bool useFastFirstPass() const {
+        return fastFirstPass && paranoiaLevel > 0;
+    }
+
+    bool readBurst( long start, int count, QByteArray& audio, QBitArray& errors );
+    void checkBurst();
+    void flushCache( long pos, qint64 sectors );
+    void fillBurst( long start );
 };
 
 
+/**
+ * Reads \p count sectors with C2 error pointers if the drive supports them.
+ */
+bool K3b::CdparanoiaLib::Private::readBurst( long start, int count, QByteArray& audio, QBitArray& errors )
+{
+    const bool c2 = ( c2Support != C2Unsupported );
+    const int sectorSize = CD_FRAMESIZE_RAW + ( c2 ? s_c2Size : 0 );
+    QByteArray raw( count * sectorSize, 0 );
+    int senseKey = -1;
+    const bool success = device->readCd( reinterpret_cast<unsigned char*>( raw.data() ),
+                                         raw.size(),
+                                         1,     // CD-DA
+                                         false, // no DAP, paranoia does the error correction
+                                         start,
+                                         count,
+                                         false,
+                                         false,
+                                         false,
+                                         true,  // user data
+                                         false,
+                                         c2 ? 1 : 0,
+                                         0,
+                                         &senseKey );
+    sectorsRead += count;
+
+    if( !success ) {
+        //
+        // Only a rejected command tells us that the drive cannot deliver C2 pointers.
+        // Any other error (most likely a medium error) just concerns this block.
+        //
+        if( c2 && senseKey == s_illegalRequest && c2Support == C2Unknown ) {
+            qDebug() << "(K3b::CdparanoiaLib) no C2 error pointers. Only comparing checksums.";
+            c2Support = C2Unsupported;
+            return readBurst( start, count, audio, errors );
+        }
+        return false;
+    }
+
+    if( c2 )
+        c2Support = C2Supported;
+
+    audio.resize( count * CD_FRAMESIZE_RAW );
+    errors.fill( false, count );
+    for( int i = 0; i < count; ++i ) {
+        const char* sector = raw.constData() + i*sectorSize;
+        ::memcpy( audio.data() + i*CD_FRAMESIZE_RAW, sector, CD_FRAMESIZE_RAW );
+        if( c2 ) {
+            for( int j = 0; j < s_c2Size; ++j ) {
+                if( sector[CD_FRAMESIZE_RAW+j] ) {
+                    errors.setBit( i );
+                    break;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+void K3b::CdparanoiaLib::Private::checkBurst()
+{
+    const long first = checkedEnd - startSector;
+    const int count = qMin<long>( s_burstSectors, lastSector - checkedEnd + 1 );
+
+    QByteArray audio;
+    QBitArray errors;
+    if( readBurst( checkedEnd, count, audio, errors ) ) {
+        for( int i = 0; i < count; ++i ) {
+            checksums[first+i] = sectorChecksum( audio.constData() + i*CD_FRAMESIZE_RAW );
+            if( errors.testBit( i ) )
+                checkErrors.setBit( first+i );
+        }
+    }
+    else {
+        checkErrors.fill( true, first, first+count );
+    }
+
+    checkStamps[first / s_burstSectors] = sectorsRead;
+    checkedEnd += count;
+}
+
+
+/**
+ * Reads \p sectors sectors far away from \p pos to push the data of the
+ * checksum pass out of the drive cache.
+ */
+void K3b::CdparanoiaLib::Private::flushCache( long pos, qint64 sectors )
+{
+    const long discStart = toc.firstSector().lba();
+    const long discEnd = toc.lastSector().lba();
+    long sector = ( pos - discStart >= sectors ? discStart : qMax<long>( discStart, discEnd - sectors + 1 ) );
+
+    qDebug() << "(K3b::CdparanoiaLib) reading" << sectors << "sectors at" << sector << "to flush the drive cache.";
+
+    QByteArray audio;
+    QBitArray errors;
+    while( sectors > 0 ) {
+        const int count = qMin<qint64>( s_burstSectors, qMin<qint64>( sectors, discEnd - sector + 1 ) );
+        if( count <= 0 )
+            break;
+        readBurst( sector, count, audio, errors );
+        sector += count;
+        sectors -= count;
+    }
+}
+
+
+void K3b::CdparanoiaLib::Private::fillBurst( long start )
+{
+    if( checksums.isEmpty() ) {
+        const long sectors = lastSector - startSector + 1;
+        checksums.fill( 0, sectors );
+        checkErrors.fill( false, sectors );
+        checkStamps.fill( 0, ( sectors + s_burstSectors - 1 ) / s_burstSectors );
+    }
+
+    burstStart = start;
+    burstCount = qMin<long>( s_burstSectors, lastSector - start + 1 );
+
+    // keep the checksum pass ahead far enough for its data to have left the cache
+    if( checkedEnd <= lastSector && checkedEnd < start + burstCount + s_cacheSectors ) {
+        const long end = qMin<long>( lastSector + 1, start + burstCount + s_cacheSectors + s_checkAhead );
+        while( checkedEnd < end )
+            checkBurst();
+    }
+
+    // ranges shorter than the cache
+    const qint64 readSince = sectorsRead - checkStamps[( start - startSector ) / s_burstSectors];
+    if( readSince < s_cacheSectors )
+        flushCache( start, s_cacheSectors - readSince );
+
+    QBitArray errors;
+    if( readBurst( start, burstCount, burstBuffer, errors ) ) {
+        suspicious = errors;
+        for( int i = 0; i < burstCount; ++i ) {
+            const long index = start - startSector + i;
+            if( checkErrors.testBit( index ) ||
+                checksums[index] != sectorChecksum( burstBuffer.constData() + i*CD_FRAMESIZE_RAW ) )
+                suspicious.setBit( i );
+        }
+    }
+    else {
+        // leave the whole block to paranoia
+        suspicious.fill( true, burstCount );
+    }
+}
+
+
 K3b::CdparanoiaLib::CdparanoiaLib()
 {
     d = new Private();
@@ -687,6 +919,13 @@ bool K3b::CdparanoiaLib::initReading( long start, long end )
             d->toc.lastSector().lba() >= end ) {
             d->startSector = d->currentSector = start;
             d->lastSector = end;
+            d->burstCount = 0;
+            d->paranoiaUntil = 0;
+            d->suspiciousCount = 0;
+            d->checkedEnd = start;
+            d->checksums.clear();
+            d->checkErrors.clear();
+            d->checkStamps.clear();
 
             // determine track number
             d->currentTrack = 1;
@@ -721,8 +960,46 @@ char* K3b::CdparanoiaLib::read( int* statusCode, unsigned int* track, bool littl
         return 0;
     }
 
+    if( d->useFastFirstPass() ) {
+        if( d->currentSector < d->burstStart || d->currentSector >= d->burstStart + d->burstCount )
+            d->fillBurst( d->currentSector );
+
+        const int i = d->currentSector - d->burstStart;
+        if( d->currentSector >= d->paranoiaUntil && !d->suspicious.testBit( i ) ) {
+            // the drive delivers little endian samples
+            ::memcpy( d->sectorBuffer, d->burstBuffer.constData() + i*CD_FRAMESIZE_RAW, CD_FRAMESIZE_RAW );
+            if( !littleEndian ) {
+                for( int j = 0; j < CD_FRAMESIZE_RAW-1; j+=2 ) {
+                    char b = d->sectorBuffer[j];
+                    d->sectorBuffer[j] = d->sectorBuffer[j+1];
+                    d->sectorBuffer[j+1] = b;
+                }
+            }
+
+            d->status = S_OK;
+            if( statusCode )
+                *statusCode = d->status;
+            if( track )
+                *track = d->currentTrack;
+
+            d->currentSector++;
+            if( d->toc[d->currentTrack-1].lastSector() < d->currentSector )
+                d->currentTrack++;
+
+            return d->sectorBuffer;
+        }
+
+        // Paranoia reads the rest of the burst so it only needs to seek
+        // once instead of for every suspicious sector.
+        if( d->currentSector >= d->paranoiaUntil )
+            d->paranoiaUntil = d->burstStart + d->burstCount;
+        ++d->suspiciousCount;
+    }
+
     if( d->currentSector != d->data->sector() ) {
-        qDebug() << "(K3b::CdparanoiaLib) need to seek before read. Looks as if we are reusing the paranoia instance.";
+        // switching over from the fast first pass is expected
+        if( !d->useFastFirstPass() )
+            qDebug() << "(K3b::CdparanoiaLib) need to seek before read. Looks as if we are reusing the paranoia instance.";
         if( d->data->paranoiaSeek( d->currentSector, SEEK_SET ) == -1 )
             return 0;
     }
@@ -804,3 +1081,15 @@ void K3b::CdparanoiaLib::setMaxRetries( int r )
 {
     d->maxRetries = r;
 }
+
+
+void K3b::CdparanoiaLib::setFastFirstPass( bool b )
+{
+    d->fastFirstPass = b;
+}
+
+
+long K3b::CdparanoiaLib::suspiciousSectors() const
+{
+    return d->suspiciousCount;
+}
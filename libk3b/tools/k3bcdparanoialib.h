@@ -78,6 +78,22 @@ namespace K3b {
         /** default: 5 */
         void setMaxRetries( int );
 
+        /**
+         * Read in two stages: every sector is read twice with fast burst
+         * reads, far enough apart for the second read not to come from the
+         * drive cache. Only sectors whose checksums differ or which the
+         * drive reported C2 errors for are verified with paranoia.
+         *
+         * Only has an effect for paranoia modes above 0. default: false
+         */
+        void setFastFirstPass( bool b );
+
+        /**
+         * The number of sectors in the range set with initReading() which
+         * had to be read with paranoia after the fast first pass so far.
+         */
+        long suspiciousSectors() const;
+
         /**
          * This will read the Toc and initialize some stuff.
          * It will also call paranoiaInit( const QString& )
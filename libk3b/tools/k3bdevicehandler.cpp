@@ -15,7 +15,6 @@
 
 #include "k3bdevicehandler.h"
 #include "k3bprogressinfoevent.h"
-#include "k3bthread.h"
 #include "k3bdevice.h"
 #include "k3bcdtext.h"
 #include "k3bcore.h"
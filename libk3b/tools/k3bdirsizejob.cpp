@@ -14,7 +14,6 @@
 
 #include "k3bdirsizejob.h"
 
-#include "k3bthread.h"
 #include "k3bthreadjob.h"
 #include "k3bsimplejobhandler.h"
 #include "k3bglobals.h"
@@ -50,6 +49,7 @@ K3b::DirSizeJob::DirSizeJob( QObject* parent )
     : K3b::ThreadJob( new K3b::SimpleJobHandler(), parent ),
       d( new Private() )
 {
+    setPriority( WorkerPool::Background );
 }
 
 
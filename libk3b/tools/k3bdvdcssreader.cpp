@@ -0,0 +1,293 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bdvdcssreader.h"
+#include "k3blibdvdcss.h"
+#include "k3bworkerpool.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+
+#include <string.h>
+
+
+namespace {
+    struct Chunk
+    {
+        QByteArray data;
+        int firstSector;
+        int requested;
+
+        // -1 on error
+        int sectors;
+    };
+}
+
+
+class K3b::DvdCssReader::Private : public K3b::WorkerPool::Task
+{
+public:
+    Private( LibDvdCss* c )
+        : css( c ),
+          chunkSize( 512 ),
+          readAhead( 16 ),
+          prefetchKeys( true ),
+          lastSector( -1 ),
+          readPos( 0 ),
+          consumePos( 0 ),
+          consumeOffset( 0 ),
+          resumeSector( -1 ),
+          running( false ),
+          stopRequested( false ),
+          producerDone( true ),
+          prefetched( 0 ) {
+    }
+
+    void run();
+
+    void startReading( int sector );
+
+    /**
+     * Needs to be called with the mutex locked.
+     */
+    void stopReading();
+
+    /**
+     * \return The index of the next title behind \p sector with an unknown key or -1.
+     */
+    int nextUnknownKey( int sector ) const;
+
+    LibDvdCss* css;
+    int chunkSize;
+    int readAhead;
+    bool prefetchKeys;
+    int lastSector;
+
+    QQueue<Chunk> ring;
+    QList<QByteArray> spareBuffers;
+    int readPos;
+    int consumePos;
+    int consumeOffset;
+    int resumeSector;
+
+    bool running;
+    bool stopRequested;
+    bool producerDone;
+    int prefetched;
+
+    QMutex mutex;
+    QWaitCondition condition;
+};
+
+
+void K3b::DvdCssReader::Private::run()
+{
+    QMutexLocker locker( &mutex );
+
+    while( !stopRequested && readPos <= lastSector ) {
+        if( ring.count() >= readAhead ) {
+            // the consumer is busy, use the time to crack the keys ahead
+            int title = -1;
+            if( prefetchKeys )
+                title = nextUnknownKey( readPos );
+            if( title >= 0 ) {
+                locker.unlock();
+                css->crackKey( title );
+                locker.relock();
+                ++prefetched;
+            }
+            else {
+                condition.wait( &mutex );
+            }
+            continue;
+        }
+
+        Chunk chunk;
+        chunk.firstSector = readPos;
+        chunk.requested = qMin( chunkSize, lastSector - readPos + 1 );
+        if( !spareBuffers.isEmpty() )
+            chunk.data = spareBuffers.takeFirst();
+        chunk.data.resize( chunkSize * LibDvdCss::DVDCSS_BLOCK_SIZE );
+
+        locker.unlock();
+        chunk.sectors = css->readWrapped( chunk.data.data(), chunk.firstSector, chunk.requested );
+        locker.relock();
+
+        ring.enqueue( chunk );
+        condition.wakeAll();
+
+        if( chunk.sectors <= 0 ) {
+            qDebug() << "(K3b::DvdCssReader) read error at sector" << chunk.firstSector;
+            break;
+        }
+        readPos += chunk.sectors;
+    }
+
+    producerDone = true;
+    condition.wakeAll();
+}
+
+
+int K3b::DvdCssReader::Private::nextUnknownKey( int sector ) const
+{
+    const QVector<LibDvdCss::TitleKey> keys = css->keyTable();
+    for( int i = 0; i < keys.count(); ++i ) {
+        if( keys[i].firstSector >= sector && keys[i].state == LibDvdCss::KeyUnknown )
+            return i;
+    }
+    return -1;
+}
+
+
+void K3b::DvdCssReader::Private::startReading( int sector )
+{
+    ring.clear();
+    readPos = consumePos = sector;
+    consumeOffset = 0;
+    running = true;
+    stopRequested = false;
+    producerDone = false;
+    WorkerPool::instance()->submit( this, WorkerPool::Realtime );
+}
+
+
+void K3b::DvdCssReader::Private::stopReading()
+{
+    if( !running )
+        return;
+
+    stopRequested = true;
+    condition.wakeAll();
+    while( !producerDone )
+        condition.wait( &mutex );
+
+    Q_FOREACH( const Chunk& chunk, ring )
+        spareBuffers.append( chunk.data );
+    ring.clear();
+    running = false;
+}
+
+
+
+K3b::DvdCssReader::DvdCssReader( LibDvdCss* css )
+    : d( new Private( css ) )
+{
+}
+
+
+K3b::DvdCssReader::~DvdCssReader()
+{
+    stop();
+    delete d;
+}
+
+
+void K3b::DvdCssReader::setChunkSize( int sectors )
+{
+    QMutexLocker locker( &d->mutex );
+    d->stopReading();
+    d->chunkSize = qMax( 1, sectors );
+    d->spareBuffers.clear();
+}
+
+
+void K3b::DvdCssReader::setReadAhead( int chunks )
+{
+    QMutexLocker locker( &d->mutex );
+    d->readAhead = qMax( 1, chunks );
+}
+
+
+void K3b::DvdCssReader::setPrefetchKeys( bool b )
+{
+    QMutexLocker locker( &d->mutex );
+    d->prefetchKeys = b;
+}
+
+
+void K3b::DvdCssReader::setLastSector( int lastSector )
+{
+    QMutexLocker locker( &d->mutex );
+    d->stopReading();
+    d->lastSector = lastSector;
+}
+
+
+int K3b::DvdCssReader::read( void* buffer, int firstSector, int sectors )
+{
+    QMutexLocker locker( &d->mutex );
+
+    if( !d->running || firstSector != d->consumePos ) {
+        d->stopReading();
+
+        // retrying a failed range, no need to read ahead
+        if( firstSector < d->resumeSector || firstSector > d->lastSector ) {
+            locker.unlock();
+            return d->css->readWrapped( buffer, firstSector, sectors );
+        }
+
+        d->startReading( firstSector );
+    }
+
+    char* out = static_cast<char*>( buffer );
+    int done = 0;
+    while( done < sectors ) {
+        while( d->ring.isEmpty() && !d->producerDone )
+            d->condition.wait( &d->mutex );
+        if( d->ring.isEmpty() )
+            break;
+
+        Chunk& chunk = d->ring.head();
+        if( chunk.sectors <= 0 ) {
+            // deliver what we have, the error is reported with the next read
+            if( done > 0 )
+                break;
+            d->resumeSector = chunk.firstSector + chunk.requested;
+            d->stopReading();
+            return -1;
+        }
+
+        const int n = qMin( chunk.sectors - d->consumeOffset, sectors - done );
+        ::memcpy( out + done*LibDvdCss::DVDCSS_BLOCK_SIZE,
+                  chunk.data.constData() + d->consumeOffset*LibDvdCss::DVDCSS_BLOCK_SIZE,
+                  n*LibDvdCss::DVDCSS_BLOCK_SIZE );
+        done += n;
+        d->consumeOffset += n;
+        if( d->consumeOffset == chunk.sectors ) {
+            d->spareBuffers.append( d->ring.dequeue().data );
+            d->consumeOffset = 0;
+            d->condition.wakeAll();
+        }
+    }
+
+    d->consumePos += done;
+    return done;
+}
+
+
+void K3b::DvdCssReader::stop()
+{
+    QMutexLocker locker( &d->mutex );
+    d->stopReading();
+}
+
+
+int K3b::DvdCssReader::prefetchedKeys() const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->prefetched;
+}
@@ -0,0 +1,94 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_DVDCSS_READER_H_
+#define _K3B_DVDCSS_READER_H_
+
+#include "k3b_export.h"
+
+
+namespace K3b {
+    class LibDvdCss;
+
+    /**
+     * Reads an encrypted Video DVD through libdvdcss ahead of the consumer.
+     *
+     * A worker reads large sequential chunks into a ring of buffers while the
+     * consumer empties it. Title keys are cracked on demand when the reading
+     * enters a title, and whenever the ring is full the worker uses the time
+     * to crack the keys of the titles ahead. Thus copying starts immediately
+     * instead of cracking all keys first.
+     *
+     * The LibDvdCss object must not be used by anyone else while the reader
+     * exists.
+     */
+    class LIBK3B_EXPORT DvdCssReader
+    {
+    public:
+        /**
+         * \param css An opened LibDvdCss object after LibDvdCss::scanTitles().
+         *        The reader does not take ownership.
+         */
+        explicit DvdCssReader( LibDvdCss* css );
+        ~DvdCssReader();
+
+        /**
+         * The size of one read in sectors. Defaults to 512 (1 MB).
+         */
+        void setChunkSize( int sectors );
+
+        /**
+         * The number of chunks read ahead. Defaults to 16.
+         */
+        void setReadAhead( int chunks );
+
+        /**
+         * Crack the keys of the titles ahead while the consumer is busy.
+         * Defaults to true.
+         */
+        void setPrefetchKeys( bool b );
+
+        /**
+         * The reader never reads ahead beyond \p lastSector. Needs to be set
+         * before reading.
+         */
+        void setLastSector( int lastSector );
+
+        /**
+         * Reads \p sectors sectors starting at \p firstSector.
+         *
+         * Sequential reads are served from the ring. Any other read restarts
+         * reading ahead at \p firstSector. After a read error the failed range
+         * is read directly without reading ahead which allows the consumer to
+         * retry single sectors.
+         *
+         * \return The number of sectors read or -1 on error.
+         */
+        int read( void* buffer, int firstSector, int sectors );
+
+        /**
+         * Stops reading ahead. Called by the destructor.
+         */
+        void stop();
+
+        /**
+         * Number of keys cracked while the ring was full.
+         */
+        int prefetchedKeys() const;
+
+    private:
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
@@ -0,0 +1,460 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bfanoutpipe.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QIODevice>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+
+class K3b::FanOutPipe::Private
+{
+public:
+    class ReaderThread;
+    class SinkThread;
+
+    struct Sink
+    {
+        Sink( QIODevice* dev = 0, bool c = false )
+            : device( dev ),
+              close( c ),
+              thread( 0 ),
+              consumed( 0 ),
+              bytesWritten( 0 ),
+              failed( false ),
+              writing( false ) {
+        }
+
+        QIODevice* device;
+        bool close;
+        SinkThread* thread;
+
+        // the number of chunks written to the device
+        quint64 consumed;
+        quint64 bytesWritten;
+        bool failed;
+
+        // true while the thread accesses a chunk outside the lock
+        bool writing;
+    };
+
+    Private()
+        : source( 0 ),
+          closeSource( false ),
+          numChunks( 64 ),
+          chunkSize( 64*1024 ),
+          produced( 0 ),
+          bytesRead( 0 ),
+          eof( false ),
+          readError( false ),
+          canceled( false ),
+          reader( 0 ),
+          runningThreads( 0 ),
+          md5( QCryptographicHash::Md5 ) {
+    }
+
+    /**
+     * The number of chunks the slowest sink has written.
+     * Needs to be called with the mutex locked.
+     */
+    quint64 slowestConsumed() const {
+        quint64 slowest = produced;
+        Q_FOREACH( const Sink& sink, sinks ) {
+            if( ( !sink.failed || sink.writing ) && sink.consumed < slowest )
+                slowest = sink.consumed;
+        }
+        return slowest;
+    }
+
+    bool haveActiveSinks() const {
+        Q_FOREACH( const Sink& sink, sinks ) {
+            if( !sink.failed )
+                return true;
+        }
+        return false;
+    }
+
+    void readerRun();
+    void sinkRun( int index );
+
+    FanOutPipe* q;
+
+    QIODevice* source;
+    bool closeSource;
+
+    QList<Sink> sinks;
+
+    int numChunks;
+    int chunkSize;
+    QVector<QByteArray> chunks;
+    QVector<int> chunkLengths;
+
+    // the number of chunks read from the source
+    quint64 produced;
+    quint64 bytesRead;
+    bool eof;
+    bool readError;
+    bool canceled;
+
+    ReaderThread* reader;
+    int runningThreads;
+
+    QCryptographicHash md5;
+    QByteArray checksum;
+
+    mutable QMutex mutex;
+    QWaitCondition waitCondition;
+};
+
+
+class K3b::FanOutPipe::Private::ReaderThread : public QThread
+{
+public:
+    ReaderThread( FanOutPipe::Private* d )
+        : m_d( d ) {
+    }
+
+protected:
+    void run() {
+        m_d->readerRun();
+    }
+
+private:
+    FanOutPipe::Private* m_d;
+};
+
+
+class K3b::FanOutPipe::Private::SinkThread : public QThread
+{
+public:
+    SinkThread( FanOutPipe::Private* d, int index )
+        : m_d( d ),
+          m_index( index ) {
+    }
+
+protected:
+    void run() {
+        m_d->sinkRun( m_index );
+    }
+
+private:
+    FanOutPipe::Private* m_d;
+    int m_index;
+};
+
+
+void K3b::FanOutPipe::Private::readerRun()
+{
+    qDebug() << "(K3b::FanOutPipe) reading from" << source << "into" << sinks.count() << "sinks";
+
+    QMutexLocker locker( &mutex );
+
+    while( true ) {
+        // wait for the slowest sink to free a chunk
+        while( !canceled &&
+               haveActiveSinks() &&
+               produced - slowestConsumed() >= quint64( numChunks ) )
+            waitCondition.wait( &mutex );
+
+        if( canceled || !haveActiveSinks() )
+            break;
+
+        // no sink is accessing this chunk
+        const int slot = produced % numChunks;
+        locker.unlock();
+
+        char* buffer = chunks[slot].data();
+        qint64 r = 0;
+        while( r < chunkSize ) {
+            const qint64 rr = source->read( buffer + r, chunkSize - r );
+            if( rr <= 0 ) {
+                if( rr < 0 && r == 0 )
+                    r = rr;
+                break;
+            }
+            r += rr;
+        }
+
+        if( r > 0 )
+            md5.addData( buffer, r );
+
+        locker.relock();
+
+        if( r <= 0 ) {
+            if( r < 0 ) {
+                qDebug() << "(K3b::FanOutPipe) read failed:" << source->errorString();
+                readError = true;
+            }
+            break;
+        }
+
+        chunkLengths[slot] = r;
+        bytesRead += r;
+        ++produced;
+        waitCondition.wakeAll();
+    }
+
+    eof = true;
+    checksum = md5.result().toHex();
+    waitCondition.wakeAll();
+
+    qDebug() << "(K3b::FanOutPipe) done reading" << bytesRead << "bytes.";
+}
+
+
+void K3b::FanOutPipe::Private::sinkRun( int index )
+{
+    QMutexLocker locker( &mutex );
+
+    while( true ) {
+        while( !canceled &&
+               !sinks[index].failed &&
+               !eof &&
+               sinks[index].consumed == produced )
+            waitCondition.wait( &mutex );
+
+        if( canceled ||
+            sinks[index].failed ||
+            sinks[index].consumed == produced )
+            break;
+
+        const int slot = sinks[index].consumed % numChunks;
+        const int len = chunkLengths[slot];
+        QIODevice* dev = sinks[index].device;
+        sinks[index].writing = true;
+        locker.unlock();
+
+        // the reader does not touch this chunk before we mark it as consumed
+        const char* data = chunks[slot].constData();
+        int written = 0;
+        while( written < len ) {
+            const qint64 w = dev->write( data + written, len - written );
+            if( w <= 0 )
+                break;
+            written += w;
+        }
+
+        locker.relock();
+        sinks[index].writing = false;
+
+        if( written < len ) {
+            qDebug() << "(K3b::FanOutPipe) write to sink" << index << "failed:" << dev->errorString();
+            sinks[index].failed = true;
+            waitCondition.wakeAll();
+            locker.unlock();
+            emit q->sinkFailed( index );
+            return;
+        }
+
+        sinks[index].bytesWritten += len;
+        ++sinks[index].consumed;
+        waitCondition.wakeAll();
+    }
+
+    qDebug() << "(K3b::FanOutPipe) sink" << index << "done after" << sinks[index].bytesWritten << "bytes.";
+}
+
+
+
+K3b::FanOutPipe::FanOutPipe( QObject* parent )
+    : QObject( parent ),
+      d( new Private() )
+{
+    d->q = this;
+}
+
+
+K3b::FanOutPipe::~FanOutPipe()
+{
+    close();
+    delete d->reader;
+    for( int i = 0; i < d->sinks.count(); ++i )
+        delete d->sinks[i].thread;
+    delete d;
+}
+
+
+void K3b::FanOutPipe::setBufferSize( int chunks, int chunkSize )
+{
+    d->numChunks = qMax( 2, chunks );
+    d->chunkSize = qMax( 2048, chunkSize );
+}
+
+
+void K3b::FanOutPipe::readFrom( QIODevice* dev, bool close )
+{
+    d->source = dev;
+    d->closeSource = close;
+}
+
+
+int K3b::FanOutPipe::addSink( QIODevice* dev, bool close )
+{
+    d->sinks.append( Private::Sink( dev, close ) );
+    return d->sinks.count() - 1;
+}
+
+
+int K3b::FanOutPipe::numSinks() const
+{
+    return d->sinks.count();
+}
+
+
+bool K3b::FanOutPipe::open()
+{
+    if( d->runningThreads > 0 || !d->source || d->sinks.isEmpty() )
+        return false;
+
+    if( !d->source->isOpen() && !d->source->open( QIODevice::ReadOnly ) ) {
+        qDebug() << "(K3b::FanOutPipe) could not open source" << d->source;
+        return false;
+    }
+
+    for( int i = 0; i < d->sinks.count(); ++i ) {
+        Private::Sink& sink = d->sinks[i];
+        if( !sink.device || ( !sink.device->isOpen() && !sink.device->open( QIODevice::WriteOnly ) ) ) {
+            qDebug() << "(K3b::FanOutPipe) could not open sink" << sink.device;
+            sink.failed = true;
+        }
+        sink.consumed = 0;
+        sink.bytesWritten = 0;
+    }
+
+    d->chunks.resize( d->numChunks );
+    d->chunkLengths.fill( 0, d->numChunks );
+    for( int i = 0; i < d->numChunks; ++i )
+        d->chunks[i].resize( d->chunkSize );
+
+    d->produced = 0;
+    d->bytesRead = 0;
+    d->eof = false;
+    d->readError = false;
+    d->canceled = false;
+    d->md5.reset();
+    d->checksum.clear();
+
+    delete d->reader;
+    d->reader = new Private::ReaderThread( d );
+    connect( d->reader, SIGNAL(finished()), this, SLOT(slotThreadFinished()) );
+
+    for( int i = 0; i < d->sinks.count(); ++i ) {
+        delete d->sinks[i].thread;
+        d->sinks[i].thread = new Private::SinkThread( d, i );
+        connect( d->sinks[i].thread, SIGNAL(finished()), this, SLOT(slotThreadFinished()) );
+    }
+
+    d->runningThreads = d->sinks.count() + 1;
+    d->reader->start();
+    for( int i = 0; i < d->sinks.count(); ++i )
+        d->sinks[i].thread->start();
+
+    return true;
+}
+
+
+void K3b::FanOutPipe::close()
+{
+    d->mutex.lock();
+    d->canceled = true;
+    d->waitCondition.wakeAll();
+    d->mutex.unlock();
+
+    if( d->reader )
+        d->reader->wait();
+    for( int i = 0; i < d->sinks.count(); ++i ) {
+        if( d->sinks[i].thread )
+            d->sinks[i].thread->wait();
+    }
+}
+
+
+void K3b::FanOutPipe::dropSink( int index )
+{
+    QMutexLocker locker( &d->mutex );
+    if( index >= 0 && index < d->sinks.count() ) {
+        d->sinks[index].failed = true;
+        d->waitCondition.wakeAll();
+    }
+}
+
+
+bool K3b::FanOutPipe::isSinkFailed( int index ) const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->sinks[index].failed;
+}
+
+
+quint64 K3b::FanOutPipe::bytesRead() const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->bytesRead;
+}
+
+
+quint64 K3b::FanOutPipe::bytesWritten( int index ) const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->sinks[index].bytesWritten;
+}
+
+
+int K3b::FanOutPipe::bufferFill() const
+{
+    QMutexLocker locker( &d->mutex );
+    return 100 * ( d->produced - d->slowestConsumed() ) / d->numChunks;
+}
+
+
+bool K3b::FanOutPipe::readError() const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->readError;
+}
+
+
+QByteArray K3b::FanOutPipe::checksum() const
+{
+    QMutexLocker locker( &d->mutex );
+    return d->checksum;
+}
+
+
+void K3b::FanOutPipe::slotThreadFinished()
+{
+    // close the devices from the thread they live in. A sink is closed as soon
+    // as it is done since some writers (growisofs) only exit once their stdin
+    // has been closed.
+    if( sender() == d->reader ) {
+        if( d->closeSource )
+            d->source->close();
+    }
+    else {
+        for( int i = 0; i < d->sinks.count(); ++i ) {
+            if( sender() == d->sinks[i].thread && d->sinks[i].close && d->sinks[i].device )
+                d->sinks[i].device->close();
+        }
+    }
+
+    if( --d->runningThreads == 0 )
+        emit finished();
+}
+
+#include "moc_k3bfanoutpipe.cpp"
@@ -0,0 +1,129 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_FAN_OUT_PIPE_H_
+#define _K3B_FAN_OUT_PIPE_H_
+
+#include "k3b_export.h"
+
+#include <QObject>
+
+class QIODevice;
+
+namespace K3b {
+    /**
+     * The fan-out pipe pumps data from one source to several sinks.
+     *
+     * The data is read once into a ring of fixed size chunks. Every sink
+     * is served by its own thread so a sink which blocks does not hold up
+     * the others until the ring is full. A chunk is only reused once all
+     * sinks have written it. Thus, the slowest sink sets the pace.
+     *
+     * A sink which fails to write is dropped. The remaining sinks are not
+     * affected. The pipe also calculates the md5 sum of the data read
+     * which can be used to verify all the copies.
+     */
+    class LIBK3B_EXPORT FanOutPipe : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit FanOutPipe( QObject* parent = 0 );
+        ~FanOutPipe();
+
+        /**
+         * The size of the ring buffer. Has to be set before calling open().
+         * The default is 4 MB in chunks of 64 KB.
+         */
+        void setBufferSize( int chunks, int chunkSize = 64*1024 );
+
+        /**
+         * The device will be opened QIODevice::ReadOnly if necessary.
+         *
+         * \param close If true the device will be closed once all data
+         *        has been read.
+         */
+        void readFrom( QIODevice* dev, bool close = false );
+
+        /**
+         * Add a sink. Sinks have to be added before calling open().
+         * The device will be opened QIODevice::WriteOnly if necessary.
+         *
+         * \param close If true the device will be closed once all data
+         *        has been written to it.
+         *
+         * \return The index of the sink.
+         */
+        int addSink( QIODevice* dev, bool close = false );
+
+        int numSinks() const;
+
+        /**
+         * Starts the pumping.
+         */
+        bool open();
+
+        /**
+         * Stops the pumping and waits for all threads to finish.
+         */
+        void close();
+
+        /**
+         * Stop writing to sink \p index, for example since the job
+         * consuming the data failed. This does not emit sinkFailed().
+         */
+        void dropSink( int index );
+
+        bool isSinkFailed( int index ) const;
+
+        quint64 bytesRead() const;
+        quint64 bytesWritten( int index ) const;
+
+        /**
+         * The fill level of the ring buffer in percent, i.e. how far
+         * the slowest sink is behind the source.
+         */
+        int bufferFill() const;
+
+        /**
+         * \return true if the source could not be read.
+         */
+        bool readError() const;
+
+        /**
+         * The md5 sum of all the data read in hex format. Only valid once
+         * finished() has been emitted.
+         */
+        QByteArray checksum() const;
+
+    Q_SIGNALS:
+        /**
+         * Emitted if writing to a sink failed.
+         */
+        void sinkFailed( int index );
+
+        /**
+         * Emitted once all data has been written to all sinks or
+         * the pumping stopped.
+         */
+        void finished();
+
+    private Q_SLOTS:
+        void slotThreadFinished();
+
+    private:
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
@@ -31,7 +31,8 @@
 
 K3b::Iso9660DeviceBackend::Iso9660DeviceBackend( K3b::Device::Device* dev )
     : m_device( dev ),
-      m_isOpen(false)
+      m_isOpen(false),
+      m_maxReadSectors(512)
 {
 }
 
@@ -70,19 +71,25 @@ int K3b::Iso9660DeviceBackend::read( unsigned int sector, char* data, int len )
 {
     if( isOpen() ) {
         //
-        // split the number of sectors to be read
-        // FIXME: use a "real" value, not some arbitrary one
+        // split the number of sectors to be read into the largest transfers
+        // the drive and the kernel accept. We start with 1 MB and halve it on
+        // failure which is cheap compared to reading with tiny transfers.
         //
-        static const int maxReadSectors = 20;
         int sectorsRead = 0;
         int retries = 10;  // TODO: no fixed value
         while( retries ) {
-            int read = qMin(len-sectorsRead, maxReadSectors);
+            int read = qMin(len-sectorsRead, m_maxReadSectors);
             if( !m_device->read10( (unsigned char*)(data+sectorsRead*2048),
                                    read*2048,
                                    sector+sectorsRead,
                                    read ) ) {
-                retries--;
+                if( read > 16 && read == m_maxReadSectors ) {
+                    m_maxReadSectors /= 2;
+                    qDebug() << "(K3b::Iso9660DeviceBackend) reducing max read sectors to" << m_maxReadSectors;
+                }
+                else {
+                    retries--;
+                }
             }
             else {
                 sectorsRead += read;
@@ -190,9 +197,10 @@ bool K3b::Iso9660LibDvdCssBackend::open()
 
         if( m_libDvdCss ) {
 
+            // the keys are cracked on demand by LibDvdCss::readWrapped()
             if( !m_libDvdCss->open( m_device ) ||
-                !m_libDvdCss->crackAllKeys() ) {
-                qDebug() << "(K3b::Iso9660LibDvdCssBackend) Failed to retrieve all CSS keys.";
+                !m_libDvdCss->scanTitles() ) {
+                qDebug() << "(K3b::Iso9660LibDvdCssBackend) Failed to retrieve the CSS titles.";
                 close();
             }
         }
@@ -223,13 +231,25 @@ int K3b::Iso9660LibDvdCssBackend::read( unsigned int sector, char* data, int len
     int read = -1;
 
     if( isOpen() ) {
+        //
+        // readWrapped() stops at the borders of the encrypted areas
+        //
+        int sectorsRead = 0;
         int retries = 10;  // TODO: no fixed value
-        while( retries && !m_libDvdCss->readWrapped( reinterpret_cast<void*>(data),
-                                                     sector,
-                                                     len ) )
-            retries--;
+        while( retries && sectorsRead < len ) {
+            int ret = m_libDvdCss->readWrapped( reinterpret_cast<void*>(data + sectorsRead*2048),
+                                                sector + sectorsRead,
+                                                len - sectorsRead );
+            if( ret > 0 ) {
+                sectorsRead += ret;
+                retries = 10;
+            }
+            else {
+                retries--;
+            }
+        }
 
-        if( retries > 0 )
+        if( sectorsRead == len )
             read = len;
     }
 
@@ -52,6 +52,9 @@ namespace K3b {
     private:
         Device::Device* m_device;
         bool m_isOpen;
+
+        // the largest transfer the drive accepted so far
+        int m_maxReadSectors;
     };
 
     class LIBK3B_EXPORT Iso9660FileBackend : public Iso9660Backend
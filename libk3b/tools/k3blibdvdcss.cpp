@@ -20,10 +20,15 @@
 #include "k3biso9660.h"
 #include "k3biso9660backend.h"
 
+#include <QCryptographicHash>
 #include <QFile>
 #include <QGlobalStatic>
+#include <QHash>
 #include <QLibrary>
-#include <QPair>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
 
 
 
@@ -41,6 +46,37 @@ extern "C" {
 Q_GLOBAL_STATIC(QLibrary, s_libDvdCss)
 
 
+namespace {
+    /**
+     * Title offsets and key states of the discs seen so far.
+     */
+    class KeyCache
+    {
+    public:
+        QVector<K3b::LibDvdCss::TitleKey> keys( const QString& discId ) const {
+            QMutexLocker locker( &mutex );
+            return cache.value( discId );
+        }
+
+        void setKeys( const QString& discId, const QVector<K3b::LibDvdCss::TitleKey>& keys ) {
+            QMutexLocker locker( &mutex );
+            cache.insert( discId, keys );
+        }
+
+        void clear() {
+            QMutexLocker locker( &mutex );
+            cache.clear();
+        }
+
+    private:
+        mutable QMutex mutex;
+        QHash<QString, QVector<K3b::LibDvdCss::TitleKey> > cache;
+    };
+
+    Q_GLOBAL_STATIC( KeyCache, s_keyCache )
+}
+
+
 
 class K3b::LibDvdCss::Private
 {
@@ -49,13 +85,71 @@ public:
         :dvd(0) {
     }
 
+    /**
+     * \return The index of the title containing \p sector or -1.
+     */
+    int findTitle( int sector ) const;
+
+    /**
+     * \return The index of the first title starting after \p sector or -1.
+     */
+    int nextTitle( int sector ) const;
+
+    bool readTitles( K3b::Device::Device* dev );
+    QString readDiscId( LibDvdCss* css ) const;
+
     dvdcss_t dvd;
     K3b::Device::Device* device;
-    QVector< QPair<int,int> > titleOffsets;
+    QVector<TitleKey> keys;
+    QString discId;
     int currentSector;
-    bool currentSectorInTitle;
+
+    // the title the libdvdcss key has been selected for
+    int currentKey;
 };
 
+
+int K3b::LibDvdCss::Private::findTitle( int sector ) const
+{
+    int i = nextTitle( sector );
+    if( i < 0 )
+        i = keys.count();
+    --i;
+    if( i >= 0 && sector < keys[i].firstSector + keys[i].sectors )
+        return i;
+    else
+        return -1;
+}
+
+
+int K3b::LibDvdCss::Private::nextTitle( int sector ) const
+{
+    // binary search for the first title starting behind sector
+    int first = 0;
+    int last = keys.count();
+    while( first < last ) {
+        const int middle = ( first + last ) / 2;
+        if( keys[middle].firstSector <= sector )
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return first < keys.count() ? first : -1;
+}
+
+
+QString K3b::LibDvdCss::Private::readDiscId( LibDvdCss* css ) const
+{
+    // the primary volume descriptor contains the volume ids and the creation
+    // date which is good enough to tell discs apart
+    QByteArray pvd( DVDCSS_BLOCK_SIZE, '\0' );
+    if( css->seek( 16, DVDCSS_NOFLAGS ) != 16 ||
+        css->read( pvd.data(), 1, DVDCSS_NOFLAGS ) != 1 )
+        return QString();
+
+    return QString::fromLatin1( QCryptographicHash::hash( pvd, QCryptographicHash::Md5 ).toHex() );
+}
+
 K3b::LibDvdCss::LibDvdCss()
 {
     d = new Private();
@@ -74,8 +168,10 @@ bool K3b::LibDvdCss::open( K3b::Device::Device* dev )
     d->device = dev;
     dev->close();
     d->dvd = k3b_dvdcss_open( const_cast<char*>( QFile::encodeName(dev->blockDeviceName()).data() ) );
-    d->currentSector = 0;
-    d->currentSectorInTitle = false;
+    d->currentSector = -1;
+    d->currentKey = -1;
+    d->keys.clear();
+    d->discId.clear();
     return ( d->dvd != 0 );
 }
 
@@ -102,97 +198,59 @@ int K3b::LibDvdCss::read( void* buffer, int sectors, int flags )
 
 int K3b::LibDvdCss::readWrapped( void* buffer, int firstSector, int sectors )
 {
-    // 1. are we in a title?
-    // 2. does a new title start in the read sector area?
-    //    - see below, set title if firstSector is the first sector of a new title
-    // 3. does a title end in the read sector area?
-    //    3.1 does a previous title end
-    //    3.2 does the title from 2. already end
-
-    // we need to seek to the first sector. Otherwise we get faulty data.
-    bool needToSeek = ( firstSector != d->currentSector || firstSector == 0 );
-    bool inTitle = false;
-    bool startOfTitle = false;
-
     //
     // Make sure we never read encrypted and unencrypted data at once since libdvdcss
     // only decrypts the whole area of read sectors or nothing at all.
     //
-    for( int i = 0; i < d->titleOffsets.count(); ++i ) {
-        int titleStart = d->titleOffsets[i].first;
-        int titleEnd = titleStart + d->titleOffsets[i].second - 1;
-
-        // update key when entrering a new title
-        // FIXME: we also need this if we seek into a new title (not only the start of the title)
-        if( titleStart == firstSector )
-            startOfTitle = needToSeek = inTitle = true;
-
-        // check if a new title or non-title area starts inside the read sector range
-        if( firstSector < titleStart && firstSector+sectors > titleStart ) {
-            qDebug() << "(K3b::LibDvdCss) title start inside of sector range ("
-                     << firstSector << "-" << (firstSector+sectors-1)
-                     << "). only reading " << (titleStart - firstSector) << " sectors up to title offset "
-                     << (titleStart-1);
-            sectors = titleStart - firstSector;
-        }
-
-        if( firstSector < titleEnd && firstSector+sectors > titleEnd ) {
-            qDebug() << "(K3b::LibDvdCss) title end inside of sector range ("
-                     << firstSector << "-" << (firstSector+sectors-1)
-                     << "). only reading " << (titleEnd - firstSector + 1) << " sectors up to title offset "
-                     << titleEnd;
-            sectors = titleEnd - firstSector + 1;
-            inTitle = true;
-        }
-
-        // is our read range part of one title
-        if( firstSector >= titleStart && firstSector+sectors-1 <= titleEnd )
-            inTitle = true;
+    const int title = d->findTitle( firstSector );
+    if( title >= 0 ) {
+        const TitleKey& key = d->keys[title];
+        sectors = qMin( sectors, key.firstSector + key.sectors - firstSector );
+    }
+    else {
+        const int next = d->nextTitle( firstSector );
+        if( next >= 0 )
+            sectors = qMin( sectors, d->keys[next].firstSector - firstSector );
     }
 
-    if( needToSeek ) {
-        int flags = DVDCSS_NOFLAGS;
-        if( startOfTitle )
-            flags = DVDCSS_SEEK_KEY;
-        else if( inTitle )
-            flags = DVDCSS_SEEK_MPEG;
+    //
+    // Only entering an area with a different key needs a seek. libdvdcss looks the key
+    // up by the first sector of the title, thus we always select it there.
+    //
+    if( title >= 0 && title != d->currentKey ) {
+        if( !selectKey( title ) )
+            return -1;
+    }
 
-        qDebug() << "(K3b::LibDvdCss) need to seek from " << d->currentSector << " to " << firstSector << " with " << flags;
+    if( firstSector != d->currentSector ) {
+        qDebug() << "(K3b::LibDvdCss) need to seek from " << d->currentSector << " to " << firstSector;
 
-        d->currentSector = seek( firstSector, flags );
+        d->currentSector = seek( firstSector, DVDCSS_NOFLAGS );
         if( d->currentSector != firstSector ) {
             qDebug() << "(K3b::LibDvdCss) seek failed: " << d->currentSector;
+            d->currentSector = -1;
             return -1;
         }
-
-        qDebug() << "(K3b::LibDvdCss) seek done: " << d->currentSector;
     }
 
-
-    int flags = DVDCSS_NOFLAGS;
-    if( inTitle )
-        flags = DVDCSS_READ_DECRYPT;
-
-    int ret = read( buffer, sectors, flags );
+    int ret = read( buffer, sectors, title >= 0 ? DVDCSS_READ_DECRYPT : DVDCSS_NOFLAGS );
     if( ret >= 0 )
         d->currentSector += ret;
     else
-        d->currentSector = 0; // force a seek the next time
+        d->currentSector = -1; // force a seek the next time
 
     return ret;
 }
 
 
-bool K3b::LibDvdCss::crackAllKeys()
+bool K3b::LibDvdCss::Private::readTitles( K3b::Device::Device* dev )
 {
     //
-    // Loop over all titles and crack the keys (inspired by libdvdread)
+    // Loop over all titles (inspired by libdvdread)
     //
-    qDebug() << "(K3b::LibDvdCss) cracking all keys.";
-
-    d->titleOffsets.clear();
+    keys.clear();
 
-    K3b::Iso9660 iso( new K3b::Iso9660DeviceBackend( d->device ) );
+    K3b::Iso9660 iso( new K3b::Iso9660DeviceBackend( dev ) );
     iso.setPlainIso9660( true );
     if( !iso.open() ) {
         qDebug() << "(K3b::LibDvdCss) could not open iso9660 fs.";
@@ -217,15 +275,18 @@ bool K3b::LibDvdCss::crackAllKeys()
 
         const K3b::Iso9660File* file = dynamic_cast<const K3b::Iso9660File*>( dir->entry( filename ) );
         if( file && file->size() > 0 ) {
-            d->titleOffsets.append( qMakePair( (int)file->startSector(), (int)(file->size() / 2048U) ) );
-            qDebug() << "(K3b::LibDvdCss) Get key for /" << filename << " at " << file->startSector();
-            if( seek( (int)file->startSector(), DVDCSS_SEEK_KEY ) < 0 ) {
-                qDebug() << "(K3b::LibDvdCss) failed to crash key for " << filename << " at " << file->startSector();
-            }
+            TitleKey key;
+            key.firstSector = file->startSector();
+            key.sectors = file->size() / 2048U;
+            key.state = KeyUnknown;
+            keys.append( key );
         }
 
         if( title > 0 ) {
-            QPair<int,int> p;
+            TitleKey key;
+            key.firstSector = 0;
+            key.sectors = 0;
+            key.state = KeyUnknown;
             int vob = 1;
             for( ; vob < 100; ++vob ) {
                 filename.sprintf( "VIDEO_TS/VTS_%02d_%d.VOB", title, vob );
@@ -233,17 +294,9 @@ bool K3b::LibDvdCss::crackAllKeys()
                 if( file ) {
                     if( file->size() % 2048 )
                         qCritical() << "(K3b::LibDvdCss) FILESIZE % 2048 != 0!!!" << endl;
-                    if( vob == 1 ) {
-                        p.first = file->startSector();
-                        p.second = file->size() / 2048;
-                        qDebug() << "(K3b::LibDvdCss) Get key for /" << filename << " at " << file->startSector();
-                        if( seek( (int)file->startSector(), DVDCSS_SEEK_KEY ) < 0 ) {
-                            qDebug() << "(K3b::LibDvdCss) failed to crash key for " << filename << " at " << file->startSector();
-                        }
-                    }
-                    else {
-                        p.second += file->size() / 2048;
-                    }
+                    if( vob == 1 )
+                        key.firstSector = file->startSector();
+                    key.sectors += file->size() / 2048;
                 }
                 else {
                     // last vob
@@ -256,19 +309,133 @@ bool K3b::LibDvdCss::crackAllKeys()
             if( vob == 0 )
                 break;
 
-            qDebug() << "(K3b::LibDvdCss) Title " << title << " " << vob << " vobs with length " << p.second;
-            d->titleOffsets.append( p );
+            qDebug() << "(K3b::LibDvdCss) Title " << title << " " << vob << " vobs with length " << key.sectors;
+            keys.append( key );
         }
     }
 
     --title;
 
+    std::sort( keys.begin(), keys.end(),
+               []( const TitleKey& a, const TitleKey& b ) { return a.firstSector < b.firstSector; } );
+
     qDebug() << "(K3b::LibDvdCss) found " << title << " titles.";
 
     return (title > 0);
 }
 
 
+bool K3b::LibDvdCss::scanTitles()
+{
+    d->currentKey = -1;
+    d->currentSector = -1;
+    d->discId = d->readDiscId( this );
+
+    if( !d->discId.isEmpty() ) {
+        d->keys = s_keyCache->keys( d->discId );
+        if( !d->keys.isEmpty() ) {
+            qDebug() << "(K3b::LibDvdCss) using cached titles of disc" << d->discId;
+            return true;
+        }
+    }
+
+    if( !d->readTitles( d->device ) )
+        return false;
+
+    if( !d->discId.isEmpty() )
+        s_keyCache->setKeys( d->discId, d->keys );
+
+    return true;
+}
+
+
+bool K3b::LibDvdCss::selectKey( int title )
+{
+    TitleKey& key = d->keys[title];
+
+    qDebug() << "(K3b::LibDvdCss) Get key for title at " << key.firstSector;
+
+    d->currentSector = seek( key.firstSector, DVDCSS_SEEK_KEY );
+    if( d->currentSector != key.firstSector ) {
+        qDebug() << "(K3b::LibDvdCss) failed to crack key for title at " << key.firstSector;
+        key.state = KeyFailed;
+        d->currentSector = -1;
+        d->currentKey = -1;
+        return false;
+    }
+
+    d->currentKey = title;
+    if( key.state != KeyCracked ) {
+        key.state = KeyCracked;
+        if( !d->discId.isEmpty() )
+            s_keyCache->setKeys( d->discId, d->keys );
+    }
+
+    return true;
+}
+
+
+bool K3b::LibDvdCss::crackKey( int title )
+{
+    if( title < 0 || title >= d->keys.count() )
+        return false;
+    else if( d->keys[title].state == KeyCracked )
+        return true;
+
+    const int previousKey = d->currentKey;
+    const int previousSector = d->currentSector;
+
+    const bool success = selectKey( title );
+
+    //
+    // Cracking a key ahead of the reader must not cost the reader a seek. libdvdcss
+    // keeps the cracked keys, so selecting the previous key again is cheap, and we do
+    // it here while the reader is busy with the data it already has.
+    //
+    if( previousKey >= 0 && previousKey != title && previousSector >= 0 ) {
+        if( selectKey( previousKey ) && previousSector != d->currentSector ) {
+            d->currentSector = seek( previousSector, DVDCSS_NOFLAGS );
+            if( d->currentSector != previousSector )
+                d->currentSector = -1;
+        }
+    }
+
+    return success;
+}
+
+
+bool K3b::LibDvdCss::crackAllKeys()
+{
+    qDebug() << "(K3b::LibDvdCss) cracking all keys.";
+
+    if( !scanTitles() )
+        return false;
+
+    for( int i = 0; i < d->keys.count(); ++i )
+        crackKey( i );
+
+    return true;
+}
+
+
+QVector<K3b::LibDvdCss::TitleKey> K3b::LibDvdCss::keyTable() const
+{
+    return d->keys;
+}
+
+
+QString K3b::LibDvdCss::discId() const
+{
+    return d->discId;
+}
+
+
+void K3b::LibDvdCss::clearKeyCache()
+{
+    s_keyCache->clear();
+}
+
+
 K3b::LibDvdCss* K3b::LibDvdCss::create()
 {
     if( !s_libDvdCss->isLoaded() ) {
@@ -17,6 +17,9 @@
 
 #include "k3b_export.h"
 
+#include <QString>
+#include <QVector>
+
 namespace K3b {
     namespace Device {
         class Device;
@@ -38,6 +41,22 @@ namespace K3b {
         static const int DVDCSS_SEEK_MPEG = (1 << 0);
         static const int DVDCSS_SEEK_KEY = (1 << 1);
 
+        enum KeyState {
+            KeyUnknown,
+            KeyCracked,
+            KeyFailed
+        };
+
+        /**
+         * One encrypted area of the disc: the menu VOB or all VOBs
+         * of a title set, which share one title key.
+         */
+        struct TitleKey {
+            int firstSector;
+            int sectors;
+            KeyState state;
+        };
+
         /**
          * Try to open a Video DVD and authenticate it.
          * @return true if the Video DVD could be authenticated successfully, false otherwise.
@@ -52,17 +71,58 @@ namespace K3b {
          * This method optimized the seek calls to maximize reading performance.
          * It also makes sure we never read unscrambled and scrambled data at the same time.
          *
-         * You have to call crackAllKeys() before using this. Do never call this in combination
-         * with seek or read!
+         * Sequential reads only seek when entering an encrypted area with a different
+         * title key. The key is cracked at that point if that did not happen before.
+         *
+         * You have to call scanTitles() or crackAllKeys() before using this. Do never call
+         * this in combination with seek or read!
+         *
+         * \return The number of sectors read which may be less than \p sectors if
+         *         the range crosses the border of an encrypted area, or -1 on error.
          */
         int readWrapped( void* buffer, int firstSector, int sectors );
 
+        /**
+         * Creates the title offset list which is needed by readWrapped without cracking
+         * any key. The list is cached per disc so opening the same disc again does
+         * not need to read the file system.
+         */
+        bool scanTitles();
+
         /**
          * Cache all CSS keys to guarantee smooth reading further on.
          * This method also creates a title offset list which is needed by readWrapped.
+         * Keys which are already known are not cracked again.
          */
         bool crackAllKeys();
 
+        /**
+         * Crack the key of entry \p title in keyTable(). Does nothing if the key
+         * is known already.
+         *
+         * The key selected for readWrapped() and its position are restored afterwards
+         * so cracking keys ahead does not make the next sequential read seek.
+         */
+        bool crackKey( int title );
+
+        /**
+         * The encrypted areas of the disc sorted by their first sector together with
+         * the state of their keys. libdvdcss keeps the keys itself (and in its own
+         * disk cache) so a cracked key is only a cheap seek away.
+         */
+        QVector<TitleKey> keyTable() const;
+
+        /**
+         * Identifies the disc by a hash over its primary volume descriptor.
+         * Valid after scanTitles().
+         */
+        QString discId() const;
+
+        /**
+         * Forget the cached title offsets and key states of all discs.
+         */
+        static void clearKeyCache();
+
         /**
          * returns 0 if the libdvdcss could not
          * be found on the system.
@@ -72,6 +132,8 @@ namespace K3b {
         static LibDvdCss* create();
 
     private:
+        bool selectKey( int title );
+
         class Private;
         Private* d;
 
@@ -0,0 +1,126 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3blinesplitter.h"
+
+#include <string.h>
+
+
+K3b::LineSplitter::LineSplitter()
+    : m_readPos( 0 ),
+      m_suppressEmptyLines( true ),
+      m_inBackspaceRun( false )
+{
+    // a reserved capacity is kept when the buffer is emptied
+    m_buffer.reserve( 4096 );
+}
+
+
+K3b::LineSplitter::~LineSplitter()
+{
+}
+
+
+void K3b::LineSplitter::setSuppressEmptyLines( bool b )
+{
+    m_suppressEmptyLines = b;
+}
+
+
+bool K3b::LineSplitter::suppressEmptyLines() const
+{
+    return m_suppressEmptyLines;
+}
+
+
+void K3b::LineSplitter::reset()
+{
+    m_buffer.resize( 0 );
+    m_readPos = 0;
+    m_inBackspaceRun = false;
+}
+
+
+void K3b::LineSplitter::feed( const char* data, int len )
+{
+    if( len <= 0 )
+        return;
+
+    // drop the lines which have already been read
+    if( m_readPos > 0 ) {
+        const int rest = m_buffer.size() - m_readPos;
+        if( rest > 0 )
+            ::memmove( m_buffer.data(), m_buffer.constData() + m_readPos, rest );
+        m_buffer.resize( rest );
+        m_readPos = 0;
+    }
+
+    // the simplified data is never longer than the input plus the
+    // line feed we might add for a line ending in a dot
+    const int oldSize = m_buffer.size();
+    m_buffer.resize( oldSize + len + 1 );
+    char* const start = m_buffer.data() + oldSize;
+    char* out = start;
+
+    for( int i = 0; i < len; ++i ) {
+        char c = data[i];
+        if( c == '\b' ) {
+            // we replace multiple backspaces with a single line feed
+            if( !m_inBackspaceRun ) {
+                *out++ = '\n';
+                m_inBackspaceRun = true;
+            }
+            continue;
+        }
+
+        m_inBackspaceRun = false;
+
+        if( c == '\r' )
+            c = '\n';
+        else if( c == '\t' ) // replace tabs with a single space
+            c = ' ';
+        *out++ = c;
+    }
+
+    // cdrecord and friends end progress lines with a dot and no line feed
+    if( out > start && out[-1] == '.' )
+        *out++ = '\n';
+
+    m_buffer.resize( out - m_buffer.constData() );
+}
+
+
+bool K3b::LineSplitter::readLine( QString& line )
+{
+    while( m_readPos < m_buffer.size() ) {
+        const char* start = m_buffer.constData() + m_readPos;
+        const char* end = static_cast<const char*>( ::memchr( start, '\n', m_buffer.size() - m_readPos ) );
+        if( !end )
+            return false;
+
+        const int len = end - start;
+        m_readPos += len + 1;
+
+        if( len > 0 || !m_suppressEmptyLines ) {
+            line = QString::fromLocal8Bit( start, len );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool K3b::LineSplitter::hasUnfinishedLine() const
+{
+    return( m_buffer.size() > m_readPos && m_buffer.at( m_buffer.size()-1 ) != '\n' );
+}
@@ -0,0 +1,74 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_LINE_SPLITTER_H_
+#define _K3B_LINE_SPLITTER_H_
+
+#include "k3b_export.h"
+
+#include <QByteArray>
+#include <QString>
+
+namespace K3b {
+    /**
+     * Incremental splitter for the output of external programs.
+     *
+     * Data is fed in arbitrary chunks and complete lines are fetched with
+     * readLine(). The splitter simplifies the output for parsing the same
+     * way Process always did: carriage returns and runs of backspaces end
+     * a line and tabs are replaced with a single space. A line ending in
+     * a dot is considered complete even without a line feed.
+     *
+     * The internal buffer is reused between chunks so that splitting does
+     * not allocate in the steady state.
+     */
+    class LIBK3B_EXPORT LineSplitter
+    {
+    public:
+        LineSplitter();
+        ~LineSplitter();
+
+        /**
+         * Default is true.
+         */
+        void setSuppressEmptyLines( bool b );
+        bool suppressEmptyLines() const;
+
+        /**
+         * Discard all buffered data including an unfinished line.
+         */
+        void reset();
+
+        void feed( const char* data, int len );
+        void feed( const QByteArray& data ) { feed( data.constData(), data.length() ); }
+
+        /**
+         * Fetch the next complete line.
+         *
+         * \return false if no complete line is buffered.
+         */
+        bool readLine( QString& line );
+
+        /**
+         * \return true if an unfinished line is buffered.
+         */
+        bool hasUnfinishedLine() const;
+
+    private:
+        QByteArray m_buffer;
+        int m_readPos;
+        bool m_suppressEmptyLines;
+        bool m_inBackspaceRun;
+    };
+}
+
+#endif
@@ -31,76 +31,307 @@
 
 #include <KCddb/Client>
 
+#include <Solid/Device>
+#include <Solid/DeviceNotifier>
+
+
+
+namespace {
+    // drives supporting media events are queried with GET EVENT STATUS NOTIFICATION
+    const qint64 s_eventPollInterval = 2000;
+
+    // all other drives are polled with TEST UNIT READY
+    const qint64 s_pollInterval = 4000;
+
+    const int s_maxCachedCdTexts = 64;
+
+    // the cddb disc id alone is too weak to identify a disc
+    QString cdTextCacheKey( const K3b::Device::Toc& toc )
+    {
+        QString key = QString::number( toc.discId(), 16 );
+        for( K3b::Device::Toc::const_iterator it = toc.constBegin(); it != toc.constEnd(); ++it )
+            key += QLatin1Char( ':' ) + QString::number( (*it).firstSector().lba() );
+        key += QLatin1Char( ':' ) + QString::number( toc.length().lba() );
+        return key;
+    }
+}
 
 
 K3b::MediaCache::DeviceEntry::DeviceEntry( K3b::MediaCache* c, K3b::Device::Device* dev )
     : medium(dev),
       blockedId(0),
+      eventsSupported(true),
+      updatePending(false),
+      nextPoll(0),
       cache(c)
 {
-    thread = new K3b::MediaCache::PollThread( this );
-    connect( thread, SIGNAL(mediumChanged(K3b::Device::Device*)),
-             c, SLOT(_k_mediumChanged(K3b::Device::Device*)),
-             Qt::QueuedConnection );
-    connect( thread, SIGNAL(checkingMedium(K3b::Device::Device*,QString)),
-             c, SIGNAL(checkingMedium(K3b::Device::Device*,QString)),
-             Qt::QueuedConnection );
 }
 
 
 K3b::MediaCache::DeviceEntry::~DeviceEntry()
 {
-    delete thread;
+}
+
+
+
+class K3b::MediaCache::PollThread::UpdateTask : public QRunnable
+{
+public:
+    UpdateTask( PollThread* thread, MediaCache::DeviceEntry* entry )
+        : m_thread( thread ),
+          m_entry( entry ) {
+    }
+
+    void run() {
+        m_thread->updateEntry( m_entry );
+    }
+
+private:
+    PollThread* m_thread;
+    MediaCache::DeviceEntry* m_entry;
+};
+
+
+K3b::MediaCache::PollThread::PollThread()
+    : m_stopped( false ),
+      m_woken( false ),
+      m_cdTextCache( s_maxCachedCdTexts )
+{
+    m_clock.start();
+}
+
+
+K3b::MediaCache::PollThread::~PollThread()
+{
+    stop();
+}
+
+
+void K3b::MediaCache::PollThread::setEntries( const QList<MediaCache::DeviceEntry*>& entries )
+{
+    QMutexLocker locker( &m_mutex );
+    m_entries = entries;
+    m_stopped = false;
+    m_woken = false;
+}
+
+
+void K3b::MediaCache::PollThread::wake( MediaCache::DeviceEntry* entry )
+{
+    QMutexLocker locker( &m_mutex );
+    Q_FOREACH( DeviceEntry* e, m_entries ) {
+        if( !entry || e == entry )
+            e->nextPoll = 0;
+    }
+    m_woken = true;
+    m_waitCondition.wakeAll();
+}
+
+
+void K3b::MediaCache::PollThread::stop()
+{
+    m_mutex.lock();
+    m_stopped = true;
+    m_waitCondition.wakeAll();
+    m_mutex.unlock();
+
+    wait();
+
+    // there is no need to update the media of the devices we stop polling
+    m_updatePool.clear();
+    m_updatePool.waitForDone();
 }
 
 
 void K3b::MediaCache::PollThread::run()
 {
-    while( m_deviceEntry->blockedId == 0 ) {
-        bool unitReady = m_deviceEntry->medium.device()->testUnitReady();
-        bool mediumCached = ( m_deviceEntry->medium.diskInfo().diskState() != K3b::Device::STATE_NO_MEDIA );
+    QMutexLocker locker( &m_mutex );
+
+    while( !m_stopped ) {
+        m_woken = false;
+
+        qint64 now = m_clock.elapsed();
+        qint64 nextPoll = -1;
+
+        Q_FOREACH( DeviceEntry* e, m_entries ) {
+            if( m_stopped )
+                break;
+
+            if( e->blockedId || e->updatePending )
+                continue;
+
+            if( e->nextPoll <= now ) {
+                // schedule the next check before unlocking so we do not override a wake() call
+                e->nextPoll = now + ( e->eventsSupported ? s_eventPollInterval : s_pollInterval );
+
+                locker.unlock();
+                const bool changed = checkEntry( e );
+                locker.relock();
+
+                now = m_clock.elapsed();
+
+                if( changed && !e->blockedId ) {
+                    e->updatePending = true;
+                    m_updatePool.start( new UpdateTask( this, e ) );
+                    continue;
+                }
+            }
+
+            if( nextPoll < 0 || e->nextPoll < nextPoll )
+                nextPoll = e->nextPoll;
+        }
+
+        if( m_stopped || m_woken )
+            continue;
+
+        if( nextPoll < 0 )
+            m_waitCondition.wait( &m_mutex );
+        else if( nextPoll > now )
+            m_waitCondition.wait( &m_mutex, nextPoll - now );
+    }
+}
+
+
+bool K3b::MediaCache::PollThread::checkEntry( MediaCache::DeviceEntry* e )
+{
+    // the device is blocked or being checked already
+    if( !e->busyMutex.tryLock() )
+        return false;
+
+    bool changed = false;
+
+    if( e->blockedId == 0 ) {
+        K3b::Device::Device* dev = e->medium.device();
+
+        e->readMutex.lock();
+        const int state = e->medium.diskInfo().diskState();
+        e->readMutex.unlock();
+
+        const bool mediumCached = ( state != K3b::Device::STATE_NO_MEDIA );
 
         //
         // we only get the other information in case the disk state changed or if we have
         // no info at all (FIXME: there are drives around that are not able to provide a proper
         // disk state)
         //
-        if( m_deviceEntry->medium.diskInfo().diskState() == K3b::Device::STATE_UNKNOWN ||
-            unitReady != mediumCached ) {
-
-            if( m_deviceEntry->blockedId == 0 )
-                emit checkingMedium( m_deviceEntry->medium.device(), QString() );
-
-            //
-            // we block for writing before the update
-            // This is important to make sure we do not overwrite a reset operation
-            //
-            m_deviceEntry->writeMutex.lock();
-
-            //
-            // The medium has changed. We need to update the information.
-            //
-            K3b::Medium m( m_deviceEntry->medium.device() );
-            m.update();
-
-            // block the info since it is not valid anymore
-            m_deviceEntry->readMutex.lock();
-
-            m_deviceEntry->medium = m;
-
-            // the information is valid. let the info go.
-            m_deviceEntry->readMutex.unlock();
-            m_deviceEntry->writeMutex.unlock();
-
-            //
-            // inform the media cache about the media change
-            //
-            if( m_deviceEntry->blockedId == 0 )
-                emit mediumChanged( m_deviceEntry->medium.device() );
+        if( state == K3b::Device::STATE_UNKNOWN ) {
+            changed = true;
+        }
+        else {
+            int event = K3b::Device::Device::MEDIA_EVENT_NO_CHANGE;
+            bool mediumPresent = false;
+            if( e->eventsSupported && dev->getMediaEventStatus( event, mediumPresent ) ) {
+                if( event == K3b::Device::Device::MEDIA_EVENT_NEW_MEDIA ||
+                    event == K3b::Device::Device::MEDIA_EVENT_MEDIA_REMOVAL ||
+                    event == K3b::Device::Device::MEDIA_EVENT_MEDIA_CHANGED ) {
+                    changed = true;
+                }
+                else if( mediumPresent != mediumCached ) {
+                    // a medium which is present is not necessarily ready yet
+                    changed = ( dev->testUnitReady() != mediumCached );
+                }
+            }
+            else {
+                if( e->eventsSupported ) {
+                    qDebug() << dev->blockDeviceName() << "does not report media events. Falling back to polling.";
+                    e->eventsSupported = false;
+                }
+                changed = ( dev->testUnitReady() != mediumCached );
+            }
+        }
+    }
+
+    e->busyMutex.unlock();
+
+    return changed;
+}
+
+
+// called from the update pool
+void K3b::MediaCache::PollThread::updateEntry( MediaCache::DeviceEntry* e )
+{
+    e->busyMutex.lock();
+
+    if( e->blockedId == 0 ) {
+        emit checkingMedium( e->medium.device(), QString() );
+
+        //
+        // we block for writing before the update
+        // This is important to make sure we do not overwrite a reset operation
+        //
+        e->writeMutex.lock();
+
+        //
+        // The medium has changed. We need to update the information.
+        //
+        K3b::Medium m( e->medium.device() );
+        m.update();
+
+        // the contents are shown in most places right away. The writing speeds are
+        // only needed for burning and are read after the change has been announced.
+        if( m.diskInfo().diskState() == K3b::Device::STATE_COMPLETE ||
+            m.diskInfo().diskState() == K3b::Device::STATE_INCOMPLETE ) {
+            m.fetch( K3b::Medium::InfoToc|K3b::Medium::InfoContent );
+            fetchCdText( m );
+        }
+
+        // block the info since it is not valid anymore
+        e->readMutex.lock();
+
+        e->medium = m;
+
+        // the information is valid. let the info go.
+        e->readMutex.unlock();
+        e->writeMutex.unlock();
+
+        //
+        // inform the media cache about the media change
+        //
+        if( e->blockedId == 0 )
+            emit mediumChanged( m.device() );
+
+        if( e->blockedId == 0 && ( m.diskInfo().mediaType() & K3b::Device::MEDIA_WRITABLE ) ) {
+            m.fetch( K3b::Medium::InfoWritingSpeeds );
+            if( e->blockedId == 0 )
+                emit writingSpeedsChanged( m.device() );
         }
+    }
+
+    e->busyMutex.unlock();
+
+    QMutexLocker locker( &m_mutex );
+    e->updatePending = false;
+    e->nextPoll = m_clock.elapsed() + ( e->eventsSupported ? s_eventPollInterval : s_pollInterval );
+    m_woken = true;
+    m_waitCondition.wakeAll();
+}
+
+
+// called from the update pool
+void K3b::MediaCache::PollThread::fetchCdText( K3b::Medium& m )
+{
+    const K3b::Device::Toc toc = m.toc();
+    // rewritable discs may get new CD-Text with the same toc
+    if( m.diskInfo().rewritable() ||
+        ( toc.contentType() != K3b::Device::AUDIO &&
+          toc.contentType() != K3b::Device::MIXED ) ) {
+        m.fetch( K3b::Medium::InfoCdText );
+        return;
+    }
 
-        if( m_deviceEntry->blockedId == 0 )
-            QThread::sleep( 2 );
+    const QString key = cdTextCacheKey( toc );
+
+    QMutexLocker locker( &m_cdTextCacheMutex );
+    if( K3b::Device::CdText* cdText = m_cdTextCache.object( key ) ) {
+        m.d->details->setCdText( *cdText );
+        return;
+    }
+    locker.unlock();
+
+    // do not remember read errors
+    if( m.d->details->cdTextRead() ) {
+        locker.relock();
+        m_cdTextCache.insert( key, new K3b::Device::CdText( m.cdText() ) );
     }
 }
 
@@ -118,11 +349,14 @@ class K3b::MediaCache::Private
 public:
     QMap<K3b::Device::Device*, DeviceEntry*> deviceMap;
     KCDDB::Client cddbClient;
+    PollThread pollThread;
 
     K3b::MediaCache* q;
 
     void _k_mediumChanged( K3b::Device::Device* );
     void _k_cddbJobFinished( KJob* job );
+    void _k_solidDeviceAdded( const QString& udi );
+    void _k_solidDeviceRemoved( const QString& udi );
 };
 
 
@@ -161,11 +395,45 @@ void K3b::MediaCache::Private::_k_cddbJobFinished( KJob* job )
 
 
 
+// a new disc shows up as a child of its drive
+void K3b::MediaCache::Private::_k_solidDeviceAdded( const QString& udi )
+{
+    const QString parentUdi = Solid::Device( udi ).parentUdi();
+    for( QMap<K3b::Device::Device*, DeviceEntry*>::const_iterator it = deviceMap.constBegin();
+         it != deviceMap.constEnd(); ++it ) {
+        if( it.key()->solidDevice().udi() == parentUdi )
+            pollThread.wake( it.value() );
+    }
+}
+
+
+// we cannot determine the parent of a removed device anymore
+void K3b::MediaCache::Private::_k_solidDeviceRemoved( const QString& )
+{
+    pollThread.wake();
+}
+
+
 K3b::MediaCache::MediaCache( QObject* parent )
     : QObject( parent ),
       d( new Private() )
 {
     d->q = this;
+
+    connect( &d->pollThread, SIGNAL(mediumChanged(K3b::Device::Device*)),
+             this, SLOT(_k_mediumChanged(K3b::Device::Device*)),
+             Qt::QueuedConnection );
+    connect( &d->pollThread, SIGNAL(writingSpeedsChanged(K3b::Device::Device*)),
+             this, SIGNAL(mediumChanged(K3b::Device::Device*)),
+             Qt::QueuedConnection );
+    connect( &d->pollThread, SIGNAL(checkingMedium(K3b::Device::Device*,QString)),
+             this, SIGNAL(checkingMedium(K3b::Device::Device*,QString)),
+             Qt::QueuedConnection );
+
+    connect( Solid::DeviceNotifier::instance(), SIGNAL(deviceAdded(QString)),
+             this, SLOT(_k_solidDeviceAdded(QString)) );
+    connect( Solid::DeviceNotifier::instance(), SIGNAL(deviceRemoved(QString)),
+             this, SLOT(_k_solidDeviceRemoved(QString)) );
 }
 
 
@@ -193,8 +461,9 @@ int K3b::MediaCache::blockDevice( K3b::Device::Device* dev )
             // let the info go
             e->readMutex.unlock();
 
-            // wait for the thread to stop
-            e->thread->wait();
+            // wait for a running check or update to finish
+            e->busyMutex.lock();
+            e->busyMutex.unlock();
 
             return e->blockedId;
         }
@@ -213,8 +482,8 @@ bool K3b::MediaCache::unblockDevice( K3b::Device::Device* dev, int id )
 
         e->medium = K3b::Medium( dev );
 
-        // restart the poll thread
-        e->thread->start();
+        // check the device right away
+        d->pollThread.wake( e );
 
         return true;
     }
@@ -287,8 +556,11 @@ K3b::Device::CdText K3b::MediaCache::cdText( K3b::Device::Device* dev )
 QList<int> K3b::MediaCache::writingSpeeds( K3b::Device::Device* dev )
 {
     if( DeviceEntry* e = findDeviceEntry( dev ) ) {
+        QList<int> ws;
         e->readMutex.lock();
-        QList<int> ws = e->medium.writingSpeeds();
+        // never block the caller, the poll thread reads the speeds after each medium change
+        if( e->medium.isFetched( K3b::Medium::InfoWritingSpeeds ) )
+            ws = e->medium.writingSpeeds();
         e->readMutex.unlock();
         return ws;
     }
@@ -311,20 +583,11 @@ void K3b::MediaCache::clearDeviceList()
 {
     qDebug();
 
-    // make all the threads stop
-    for( QMap<K3b::Device::Device*, DeviceEntry*>::iterator it = d->deviceMap.begin();
-         it != d->deviceMap.end(); ++it ) {
-        it.value()->blockedId = 1;
-    }
-
-    // and remove them
-    for( QMap<K3b::Device::Device*, DeviceEntry*>::iterator it = d->deviceMap.begin();
-         it != d->deviceMap.end(); ++it ) {
-        qDebug() << " waiting for info thread " << it.key()->blockDeviceName() << " to finish";
-        it.value()->thread->wait();
-        delete it.value();
-    }
+    // stop the polling
+    d->pollThread.stop();
+    d->pollThread.setEntries( QList<DeviceEntry*>() );
 
+    qDeleteAll( d->deviceMap );
     d->deviceMap.clear();
 }
 
@@ -348,12 +611,9 @@ void K3b::MediaCache::buildDeviceList( K3b::Device::DeviceManager* dm )
             d->deviceMap[*it]->blockedId = bi_it.value();
     }
 
-    // start all the polling threads
-    for( QMap<K3b::Device::Device*, DeviceEntry*>::iterator it = d->deviceMap.begin();
-         it != d->deviceMap.end(); ++it ) {
-        if( !it.value()->blockedId )
-            it.value()->thread->start();
-    }
+    // start the polling
+    d->pollThread.setEntries( d->deviceMap.values() );
+    d->pollThread.start();
 }
 
 
@@ -388,7 +648,8 @@ void K3b::MediaCache::resetDevice( K3b::Device::Device* dev )
         e->medium.reset();
         e->readMutex.unlock();
         e->writeMutex.unlock();
-        // no need to emit mediumChanged here. The poll thread will act on it soon
+        // no need to emit mediumChanged here. The poll thread will act on it
+        d->pollThread.wake( e );
     }
 }
 
@@ -42,9 +42,11 @@ namespace K3b {
      * It should be used to get information about media and device status
      * instead of the libk3bdevice methods for faster access.
      *
-     * The Media Cache polls for new information every 2 seconds on all devices
-     * (except for blocked ones) and emits signals in case a device status changed
-     * (for example a media was inserted or removed).
+     * The Media Cache checks all devices (except for blocked ones) for medium changes
+     * and emits signals in case a device status changed (for example a media was
+     * inserted or removed). Drives are queried for media events every 2 seconds or
+     * polled every 4 seconds if they do not support them. Solid notifications about
+     * new discs trigger an immediate check.
      *
      * To start the media caching call buildDeviceList().
      */
@@ -100,6 +102,10 @@ namespace K3b {
 
         /**
          * Read cached supported writing speeds.
+         *
+         * The speeds are determined after the medium change has been
+         * announced. Until then the list is empty and mediumChanged()
+         * is emitted a second time once they are known.
          */
         QList<int> writingSpeeds( Device::Device* );
 
@@ -177,6 +183,8 @@ namespace K3b {
 
         Q_PRIVATE_SLOT( d, void _k_mediumChanged( K3b::Device::Device* ) )
         Q_PRIVATE_SLOT( d, void _k_cddbJobFinished( KJob* job ) )
+        Q_PRIVATE_SLOT( d, void _k_solidDeviceAdded( const QString& ) )
+        Q_PRIVATE_SLOT( d, void _k_solidDeviceRemoved( const QString& ) )
     };
 }
 
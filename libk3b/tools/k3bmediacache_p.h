@@ -18,6 +18,13 @@
 
 #include "k3bmediacache.h"
 
+#include <QCache>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+
 class K3b::MediaCache::DeviceEntry
 {
 public:
@@ -31,7 +38,18 @@ public:
     QMutex readMutex;
     QMutex writeMutex;
 
-    MediaCache::PollThread* thread;
+    /**
+     * Held while a command is sent to the device from the poll thread
+     * or an update task. blockDevice() uses it to wait for both to finish.
+     */
+    QMutex busyMutex;
+
+    // only used from the poll thread
+    bool eventsSupported;
+
+    // protected by the poll thread mutex
+    bool updatePending;
+    qint64 nextPoll;
 
     MediaCache* cache;
 
@@ -41,23 +59,72 @@ public:
 };
 
 
+/**
+ * One thread checking all devices for medium changes.
+ *
+ * Drives supporting GET EVENT STATUS NOTIFICATION are queried with it,
+ * which is cheaper than TEST UNIT READY and does not access the medium.
+ * All other drives are polled less often with TEST UNIT READY. A device
+ * is checked right away when woken up through wake(), which is done on
+ * Solid notifications about discs appearing or disappearing.
+ *
+ * The expensive Medium::update() runs in a thread pool so a slow drive
+ * does not delay the detection of changes in other drives.
+ *
+ * The decoded CD-Text is kept per disc so inserting a disc again does
+ * not require reading and parsing it again.
+ */
 class K3b::MediaCache::PollThread : public QThread
 {
     Q_OBJECT
 
 public:
-    PollThread( MediaCache::DeviceEntry* de )
-        : m_deviceEntry( de ) {}
+    PollThread();
+    ~PollThread();
+
+    /**
+     * Only to be used while the thread is not running.
+     */
+    void setEntries( const QList<MediaCache::DeviceEntry*>& entries );
+
+    /**
+     * Check \p entry as soon as possible. If \p entry is 0 all devices are checked.
+     */
+    void wake( MediaCache::DeviceEntry* entry = 0 );
+
+    /**
+     * Stop the thread and wait for all running updates to finish.
+     */
+    void stop();
 
 Q_SIGNALS:
     void mediumChanged( K3b::Device::Device* dev );
+    void writingSpeedsChanged( K3b::Device::Device* dev );
     void checkingMedium( K3b::Device::Device* dev, const QString& );
 
 protected:
     void run();
 
 private:
-    MediaCache::DeviceEntry* m_deviceEntry;
+    class UpdateTask;
+
+    bool checkEntry( MediaCache::DeviceEntry* entry );
+    void updateEntry( MediaCache::DeviceEntry* entry );
+    void fetchCdText( Medium& medium );
+
+    QList<MediaCache::DeviceEntry*> m_entries;
+
+    QMutex m_mutex;
+    QWaitCondition m_waitCondition;
+    bool m_stopped;
+    bool m_woken;
+
+    QElapsedTimer m_clock;
+    QThreadPool m_updatePool;
+
+    // the CD-Text of the last discs by toc, used from the update pool
+    QMutex m_cdTextCacheMutex;
+    QCache<QString, Device::CdText> m_cdTextCache;
 };
 
 #endif
@@ -24,16 +24,304 @@
 
 #include <KIOCore/KIO/Global>
 
+#include <QCoreApplication>
+#include <QDebug>
 #include <QList>
+#include <QMutexLocker>
 #include <QSharedData>
+#include <QThread>
 
 #include <KCddb/Cdinfo>
 
 
 
+namespace {
+    bool inGuiThread()
+    {
+        return( QCoreApplication::instance() &&
+                QThread::currentThread() == QCoreApplication::instance()->thread() );
+    }
+}
+
+
+K3b::MediumDetails::MediumDetails( K3b::Device::Device* dev, const K3b::Device::DiskInfo& info )
+    : m_device( dev ),
+      m_diskInfo( info ),
+      m_fetched( 0 ),
+      m_cdTextRead( false ),
+      m_content( K3b::Medium::ContentNone )
+{
+}
+
+
+void K3b::MediumDetails::fetch( K3b::Medium::Informations info )
+{
+    if( info & K3b::Medium::InfoToc )
+        fetchToc();
+    if( info & K3b::Medium::InfoContent )
+        fetchContent();
+    if( info & K3b::Medium::InfoCdText )
+        fetchCdText();
+    if( info & K3b::Medium::InfoWritingSpeeds )
+        fetchWritingSpeeds();
+}
+
+
+K3b::Medium::Informations K3b::MediumDetails::fetched() const
+{
+    QMutexLocker locker( &m_fetchedMutex );
+    return m_fetched;
+}
+
+
+void K3b::MediumDetails::setFetched( K3b::Medium::Information info )
+{
+    QMutexLocker locker( &m_fetchedMutex );
+    m_fetched |= info;
+}
+
+
+bool K3b::MediumDetails::available( K3b::Medium::Information info )
+{
+    //
+    // Reading from the device blocks for seconds. The GUI thread only gets
+    // what has been read already, the MediaCache reads everything in its own
+    // thread and emits mediumChanged() once it is done.
+    //
+    if( inGuiThread() )
+        return fetched().testFlag( info );
+
+    fetch( info );
+    return true;
+}
+
+
+//
+// The values are never changed once they have been read. Thus, it is safe
+// to access them after the mutex has been released.
+//
+K3b::Device::Toc K3b::MediumDetails::toc()
+{
+    if( available( K3b::Medium::InfoToc ) )
+        return m_toc;
+    else
+        return K3b::Device::Toc();
+}
+
+
+K3b::Device::CdText K3b::MediumDetails::cdText()
+{
+    if( available( K3b::Medium::InfoCdText ) )
+        return m_cdText;
+    else
+        return K3b::Device::CdText();
+}
+
+
+QList<int> K3b::MediumDetails::writingSpeeds()
+{
+    if( available( K3b::Medium::InfoWritingSpeeds ) )
+        return m_writingSpeeds;
+    else
+        return QList<int>();
+}
+
+
+K3b::Medium::MediumContents K3b::MediumDetails::content()
+{
+    if( available( K3b::Medium::InfoContent ) )
+        return m_content;
+    else
+        return K3b::Medium::ContentNone;
+}
+
+
+const K3b::Iso9660SimplePrimaryDescriptor& K3b::MediumDetails::isoDescriptor()
+{
+    static const Iso9660SimplePrimaryDescriptor s_emptyDesc;
+    if( available( K3b::Medium::InfoContent ) )
+        return m_isoDesc;
+    else
+        return s_emptyDesc;
+}
+
+
+void K3b::MediumDetails::fetchToc()
+{
+    QMutexLocker locker( &m_tocMutex );
+    if( fetched() & K3b::Medium::InfoToc )
+        return;
+
+    if( m_diskInfo.diskState() == K3b::Device::STATE_COMPLETE ||
+        m_diskInfo.diskState() == K3b::Device::STATE_INCOMPLETE ) {
+        m_toc = m_device->readToc();
+    }
+
+    setFetched( K3b::Medium::InfoToc );
+}
+
+
+void K3b::MediumDetails::fetchCdText()
+{
+    fetchToc();
+
+    QMutexLocker locker( &m_cdTextMutex );
+    if( fetched() & K3b::Medium::InfoCdText )
+        return;
+
+    if( m_toc.contentType() == K3b::Device::AUDIO ||
+        m_toc.contentType() == K3b::Device::MIXED ) {
+        m_cdText = K3b::Device::CdText( m_device->readRawCdText( &m_cdTextRead ) );
+    }
+
+    setFetched( K3b::Medium::InfoCdText );
+}
+
+
+void K3b::MediumDetails::setCdText( const K3b::Device::CdText& cdText )
+{
+    QMutexLocker locker( &m_cdTextMutex );
+    if( fetched() & K3b::Medium::InfoCdText )
+        return;
+
+    m_cdText = cdText;
+
+    setFetched( K3b::Medium::InfoCdText );
+}
+
+
+bool K3b::MediumDetails::cdTextRead()
+{
+    return( available( K3b::Medium::InfoCdText ) && m_cdTextRead );
+}
+
+
+void K3b::MediumDetails::fetchWritingSpeeds()
+{
+    QMutexLocker locker( &m_writingSpeedsMutex );
+    if( fetched() & K3b::Medium::InfoWritingSpeeds )
+        return;
+
+    if( m_diskInfo.mediaType() & K3b::Device::MEDIA_WRITABLE ) {
+        m_writingSpeeds = m_device->determineSupportedWriteSpeeds();
+    }
+
+    setFetched( K3b::Medium::InfoWritingSpeeds );
+}
+
+
+void K3b::MediumDetails::fetchContent()
+{
+    fetchToc();
+
+    QMutexLocker locker( &m_contentMutex );
+    if( fetched() & K3b::Medium::InfoContent )
+        return;
+
+    // set basic content types
+    switch( m_toc.contentType() ) {
+    case K3b::Device::AUDIO:
+        m_content = K3b::Medium::ContentAudio;
+        break;
+    case K3b::Device::DATA:
+        m_content = K3b::Medium::ContentData;
+        break;
+    case K3b::Device::MIXED:
+        m_content = K3b::Medium::ContentAudio|K3b::Medium::ContentData;
+        break;
+    default:
+        m_content = K3b::Medium::ContentNone;
+    }
+
+    // analyze filesystem
+    if( m_content & K3b::Medium::ContentData ) {
+        //qDebug() << "(K3b::Medium) Checking file system.";
+
+        unsigned long startSec = 0;
+
+        if( m_diskInfo.numSessions() > 1 && !m_toc.isEmpty() ) {
+            // We use the last data track
+            // this way we get the latest session on a ms cd
+            for( int i = m_toc.size()-1; i >= 0; --i ) {
+                if( m_toc.at(i).type() == K3b::Device::Track::TYPE_DATA ) {
+                    startSec = m_toc.at(i).firstSector().lba();
+                    break;
+                }
+            }
+        }
+        else if( !m_toc.isEmpty() ) {
+            // use first data track
+            for( int i = 0; i < m_toc.size(); ++i ) {
+                if( m_toc.at(i).type() == K3b::Device::Track::TYPE_DATA ) {
+                    startSec = m_toc.at(i).firstSector().lba();
+                    break;
+                }
+            }
+        }
+        else {
+            qDebug() << "(K3b::Medium) ContentData is set and Toc is empty, disk is probably broken!";
+        }
+
+        //qDebug() << "(K3b::Medium) Checking file system at " << startSec;
+
+        // force the backend since we don't need decryption
+        // which just slows down the whole process
+        K3b::Iso9660 iso( new K3b::Iso9660DeviceBackend( m_device ) );
+        iso.setStartSector( startSec );
+        iso.setPlainIso9660( true );
+        if( iso.open() ) {
+            m_isoDesc = iso.primaryDescriptor();
+            qDebug() << "(K3b::Medium) found volume id from start sector " << startSec
+                     << ": '" << m_isoDesc.volumeId << "'" ;
+
+            if( const Iso9660Directory* firstDirEntry = iso.firstIsoDirEntry() ) {
+                if( Device::isDvdMedia( m_diskInfo.mediaType() ) ) {
+                    // Every VideoDVD needs to have a VIDEO_TS.IFO file
+                    if( firstDirEntry->entry( "VIDEO_TS/VIDEO_TS.IFO" ) != 0 )
+                        m_content |= K3b::Medium::ContentVideoDVD;
+                }
+                else {
+                    qDebug() << "(K3b::Medium) checking for VCD.";
+
+                    // check for VCD
+                    const K3b::Iso9660Entry* vcdEntry = firstDirEntry->entry( "VCD/INFO.VCD" );
+                    const K3b::Iso9660Entry* svcdEntry = firstDirEntry->entry( "SVCD/INFO.SVD" );
+                    const K3b::Iso9660File* vcdInfoFile = 0;
+                    if( vcdEntry ) {
+                        qDebug() << "(K3b::Medium) found vcd entry.";
+                        if( vcdEntry->isFile() )
+                            vcdInfoFile = static_cast<const K3b::Iso9660File*>(vcdEntry);
+                    }
+                    if( svcdEntry && !vcdInfoFile ) {
+                        qDebug() << "(K3b::Medium) found svcd entry.";
+                        if( svcdEntry->isFile() )
+                            vcdInfoFile = static_cast<const K3b::Iso9660File*>(svcdEntry);
+                    }
+
+                    if( vcdInfoFile ) {
+                        char buffer[8];
+
+                        if ( vcdInfoFile->read( 0, buffer, 8 ) == 8 &&
+                            ( !qstrncmp( buffer, "VIDEO_CD", 8 ) ||
+                            !qstrncmp( buffer, "SUPERVCD", 8 ) ||
+                            !qstrncmp( buffer, "HQ-VCD  ", 8 ) ) )
+                            m_content |= K3b::Medium::ContentVideoCD;
+                    }
+                }
+            }
+            else {
+                qDebug() << "(K3b::Medium) root ISO directory is null, disk is probably broken!";
+            }
+        }  // opened iso9660
+    }
+
+    setFetched( K3b::Medium::InfoContent );
+}
+
+
+
 K3b::MediumPrivate::MediumPrivate()
-    : device( 0 ),
-      content( K3b::Medium::ContentNone )
+    : device( 0 )
 {
 }
 
@@ -98,13 +386,19 @@ K3b::Device::DiskInfo K3b::Medium::diskInfo() const
 
 K3b::Device::Toc K3b::Medium::toc() const
 {
-    return d->toc;
+    if( d->details )
+        return d->details->toc();
+    else
+        return K3b::Device::Toc();
 }
 
 
 K3b::Device::CdText K3b::Medium::cdText() const
 {
-    return d->cdText;
+    if( d->details )
+        return d->details->cdText();
+    else
+        return K3b::Device::CdText();
 }
 
 
@@ -116,19 +410,29 @@ KCDDB::CDInfo K3b::Medium::cddbInfo() const
 
 QList<int> K3b::Medium::writingSpeeds() const
 {
-    return d->writingSpeeds;
+    if( d->details )
+        return d->details->writingSpeeds();
+    else
+        return QList<int>();
 }
 
 
 K3b::Medium::MediumContents K3b::Medium::content() const
 {
-    return d->content;
+    if( d->details )
+        return d->details->content();
+    else
+        return ContentNone;
 }
 
 
 const K3b::Iso9660SimplePrimaryDescriptor& K3b::Medium::iso9660Descriptor() const
 {
-    return d->isoDesc;
+    static const Iso9660SimplePrimaryDescriptor s_emptyDesc;
+    if( d->details )
+        return d->details->isoDescriptor();
+    else
+        return s_emptyDesc;
 }
 
 
@@ -138,7 +442,7 @@ K3b::Msf K3b::Medium::actuallyUsedCapacity() const
     // change in size. Thus, the remainingSize value from the disk info is of no great value.
     if ( !d->diskInfo.empty() &&
          d->diskInfo.mediaType() & ( Device::MEDIA_DVD_PLUS_RW|Device::MEDIA_DVD_RW_OVWR|Device::MEDIA_BD_RE ) ) {
-        return d->isoDesc.volumeSpaceSize;
+        return iso9660Descriptor().volumeSpaceSize;
     }
     else {
         return d->diskInfo.size();
@@ -152,7 +456,7 @@ K3b::Msf K3b::Medium::actuallyRemainingSize() const
     // change in size. Thus, the remainingSize value from the disk info is of no great value.
     if ( !d->diskInfo.empty() &&
          d->diskInfo.mediaType() & ( Device::MEDIA_DVD_PLUS_RW|Device::MEDIA_DVD_RW_OVWR|Device::MEDIA_BD_RE ) ) {
-        return d->diskInfo.capacity() - d->isoDesc.volumeSpaceSize;
+        return d->diskInfo.capacity() - iso9660Descriptor().volumeSpaceSize;
     }
     else {
         return d->diskInfo.remainingSize();
@@ -163,14 +467,8 @@ K3b::Msf K3b::Medium::actuallyRemainingSize() const
 void K3b::Medium::reset()
 {
     d->diskInfo = K3b::Device::DiskInfo();
-    d->toc.clear();
-    d->cdText.clear();
-    d->writingSpeeds.clear();
-    d->content = ContentNone;
+    d->details.reset();
     d->cddbInfo.clear();
-
-    // clear the desc
-    d->isoDesc = K3b::Iso9660SimplePrimaryDescriptor();
 }
 
 
@@ -191,124 +489,26 @@ void K3b::Medium::update()
             qDebug() << "no medium found";
         }
 
-        if( diskInfo().diskState() == K3b::Device::STATE_COMPLETE ||
-            diskInfo().diskState() == K3b::Device::STATE_INCOMPLETE ) {
-            d->toc = d->device->readToc();
-            if( d->toc.contentType() == K3b::Device::AUDIO ||
-                d->toc.contentType() == K3b::Device::MIXED ) {
-
-                // update CD-Text
-                d->cdText = d->device->readCdText();
-            }
-        }
-
-        if( diskInfo().mediaType() & K3b::Device::MEDIA_WRITABLE ) {
-            d->writingSpeeds = d->device->determineSupportedWriteSpeeds();
-        }
-
-        analyseContent();
+        // everything else is read on demand
+        d->details = new K3b::MediumDetails( d->device, d->diskInfo );
     }
 }
 
 
-void K3b::Medium::analyseContent()
+void K3b::Medium::fetch( Informations info ) const
 {
-    // set basic content types
-    switch( d->toc.contentType() ) {
-    case K3b::Device::AUDIO:
-        d->content = ContentAudio;
-        break;
-    case K3b::Device::DATA:
-        d->content = ContentData;
-        break;
-    case K3b::Device::MIXED:
-        d->content = ContentAudio|ContentData;
-        break;
-    default:
-        d->content = ContentNone;
-    }
-
-    // analyze filesystem
-    if( d->content & ContentData ) {
-        //qDebug() << "(K3b::Medium) Checking file system.";
-
-        unsigned long startSec = 0;
-
-        if( diskInfo().numSessions() > 1 && !d->toc.isEmpty() ) {
-            // We use the last data track
-            // this way we get the latest session on a ms cd
-            for( int i = d->toc.size()-1; i >= 0; --i ) {
-                if( d->toc.at(i).type() == K3b::Device::Track::TYPE_DATA ) {
-                    startSec = d->toc.at(i).firstSector().lba();
-                    break;
-                }
-            }
-        }
-        else if( !d->toc.isEmpty() ) {
-            // use first data track
-            for( int i = 0; i < d->toc.size(); ++i ) {
-                if( d->toc.at(i).type() == K3b::Device::Track::TYPE_DATA ) {
-                    startSec = d->toc.at(i).firstSector().lba();
-                    break;
-                }
-            }
-        }
-        else {
-            qDebug() << "(K3b::Medium) ContentData is set and Toc is empty, disk is probably broken!";
-        }
-
-        //qDebug() << "(K3b::Medium) Checking file system at " << startSec;
-
-        // force the backend since we don't need decryption
-        // which just slows down the whole process
-        K3b::Iso9660 iso( new K3b::Iso9660DeviceBackend( d->device ) );
-        iso.setStartSector( startSec );
-        iso.setPlainIso9660( true );
-        if( iso.open() ) {
-            d->isoDesc = iso.primaryDescriptor();
-            qDebug() << "(K3b::Medium) found volume id from start sector " << startSec
-                     << ": '" << d->isoDesc.volumeId << "'" ;
-
-            if( const Iso9660Directory* firstDirEntry = iso.firstIsoDirEntry() ) {
-                if( Device::isDvdMedia( diskInfo().mediaType() ) ) {
-                    // Every VideoDVD needs to have a VIDEO_TS.IFO file
-                    if( firstDirEntry->entry( "VIDEO_TS/VIDEO_TS.IFO" ) != 0 )
-                        d->content |= ContentVideoDVD;
-                }
-                else {
-                    qDebug() << "(K3b::Medium) checking for VCD.";
-
-                    // check for VCD
-                    const K3b::Iso9660Entry* vcdEntry = firstDirEntry->entry( "VCD/INFO.VCD" );
-                    const K3b::Iso9660Entry* svcdEntry = firstDirEntry->entry( "SVCD/INFO.SVD" );
-                    const K3b::Iso9660File* vcdInfoFile = 0;
-                    if( vcdEntry ) {
-                        qDebug() << "(K3b::Medium) found vcd entry.";
-                        if( vcdEntry->isFile() )
-                            vcdInfoFile = static_cast<const K3b::Iso9660File*>(vcdEntry);
-                    }
-                    if( svcdEntry && !vcdInfoFile ) {
-                        qDebug() << "(K3b::Medium) found svcd entry.";
-                        if( svcdEntry->isFile() )
-                            vcdInfoFile = static_cast<const K3b::Iso9660File*>(svcdEntry);
-                    }
+    if( d->details )
+        d->details->fetch( info );
+}
 
-                    if( vcdInfoFile ) {
-                        char buffer[8];
 
-                        if ( vcdInfoFile->read( 0, buffer, 8 ) == 8 &&
-                            ( !qstrncmp( buffer, "VIDEO_CD", 8 ) ||
-                            !qstrncmp( buffer, "SUPERVCD", 8 ) ||
-                            !qstrncmp( buffer, "HQ-VCD  ", 8 ) ) )
-                            d->content |= ContentVideoCD;
-                    }
-                }
-            }
-            else {
-                qDebug() << "(K3b::Medium) root ISO directory is null, disk is probably broken!";
-            }
-        }  // opened iso9660
-    }
+bool K3b::Medium::isFetched( Informations info ) const
+{
+    // without details there is nothing to read
+    if( d->details )
+        return( ( d->details->fetched() & info ) == info );
+    else
+        return true;
 }
 
 
@@ -316,7 +516,7 @@ QString K3b::Medium::contentTypeString() const
 {
     QString mediaTypeString = K3b::Device::mediaTypeString( diskInfo().mediaType(), true );
 
-    switch( d->toc.contentType() ) {
+    switch( toc().contentType() ) {
     case K3b::Device::AUDIO:
         return i18n("Audio CD");
 
@@ -365,8 +565,9 @@ QString K3b::Medium::shortString( MediumStringFlags flags ) const
     else {
         if( flags & WithContents ) {
             // AUDIO + MIXED
-            if( d->toc.contentType() == K3b::Device::AUDIO ||
-                d->toc.contentType() == K3b::Device::MIXED ) {
+            const K3b::Device::ContentsType contentType = toc().contentType();
+            if( contentType == K3b::Device::AUDIO ||
+                contentType == K3b::Device::MIXED ) {
                 QString title = cdText().title();
                 QString performer = cdText().performer();
                 if ( title.isEmpty() ) {
@@ -380,7 +581,7 @@ QString K3b::Medium::shortString( MediumStringFlags flags ) const
                         .arg( performer )
                         .arg( title );
                 }
-                else if( d->toc.contentType() == K3b::Device::AUDIO ) {
+                else if( contentType == K3b::Device::AUDIO ) {
                     return contentTypeString();
                 }
                 else {
@@ -421,7 +622,7 @@ QString K3b::Medium::longString( MediumStringFlags flags ) const
     if( diskInfo().diskState() == K3b::Device::STATE_COMPLETE ||
         diskInfo().diskState() == K3b::Device::STATE_INCOMPLETE  ) {
         s += "<br/>" + i18np("%2 in %1 track", "%2 in %1 tracks",
-                             d->toc.count(),
+                             toc().count(),
                              KIO::convertSize(diskInfo().size().mode1Bytes()) );
         if( diskInfo().numSessions() > 1 )
             s += i18np(" and %1 session", " and %1 sessions", diskInfo().numSessions() );
@@ -533,6 +734,10 @@ bool K3b::Medium::operator==( const K3b::Medium& other ) const
     if( this->d == other.d )
         return true;
 
+    // the details are only shared by copies of the same medium
+    if( d->details && d->details == other.d->details )
+        return( d->cddbInfo == other.d->cddbInfo );
+
     return( this->device() == other.device() &&
             this->diskInfo() == other.diskInfo() &&
             this->toc() == other.toc() &&
@@ -548,6 +753,9 @@ bool K3b::Medium::operator!=( const K3b::Medium& other ) const
     if( this->d == other.d )
         return false;
 
+    if( d->details && d->details == other.d->details )
+        return( d->cddbInfo != other.d->cddbInfo );
+
     return( this->device() != other.device() ||
             this->diskInfo() != other.diskInfo() ||
             this->toc() != other.toc() ||
@@ -560,7 +768,8 @@ bool K3b::Medium::operator!=( const K3b::Medium& other ) const
 
 bool K3b::Medium::sameMedium( const K3b::Medium& other ) const
 {
-    if( this->d == other.d )
+    if( this->d == other.d ||
+        ( d->details && d->details == other.d->details ) )
         return true;
 
     // here we do ignore cddb info
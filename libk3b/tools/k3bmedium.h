@@ -64,13 +64,49 @@ namespace K3b {
          */
         void reset();
 
+        /**
+         * Parts of the medium information which are read from the device
+         * on first access.
+         */
+        enum Information {
+            InfoToc = 0x1,
+            InfoCdText = 0x2,
+            InfoWritingSpeeds = 0x4,
+            InfoContent = 0x8,      /**< content(), iso9660Descriptor(), and volumeId() */
+            InfoAll = InfoToc|InfoCdText|InfoWritingSpeeds|InfoContent
+        };
+        Q_DECLARE_FLAGS( Informations, Information )
+
         /**
          * Updates the medium information if the device is not null.
          * Do not use this in the GUI thread since it uses blocking
          * K3bdevice methods.
+         *
+         * Only the disk information is read. Everything else is read
+         * from the device on first access or by calling fetch().
          */
         void update();
 
+        /**
+         * Read the given parts of the medium information if that has not
+         * been done yet. The information is shared by all copies of this
+         * medium. Do not use this in the GUI thread since it uses blocking
+         * K3bdevice methods.
+         *
+         * The accessors below never read from the device in the GUI thread.
+         * There they return empty values for parts which have not been
+         * fetched. The media returned by MediaCache are fetched in the
+         * background and MediaCache::mediumChanged() is emitted once
+         * the data is available.
+         */
+        void fetch( Informations info = InfoAll ) const;
+
+        /**
+         * \return true if all parts in \p info have been read already,
+         *         i.e. accessing them does not block.
+         */
+        bool isFetched( Informations info ) const;
+
         Device::Device* device() const;
         Device::DiskInfo diskInfo() const;
         Device::Toc toc() const;
@@ -199,8 +235,6 @@ namespace K3b {
         static QString mediaRequestString( MediumContents content, Device::Device* dev = 0 );
 
     private:
-        void analyseContent();
-
         QSharedDataPointer<MediumPrivate> d;
 
         friend class MediaCache;
@@ -208,6 +242,7 @@ namespace K3b {
 }
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( K3b::Medium::MediumContents )
+Q_DECLARE_OPERATORS_FOR_FLAGS( K3b::Medium::Informations )
 Q_DECLARE_OPERATORS_FOR_FLAGS( K3b::Medium::MediumStringFlags )
 
 #endif
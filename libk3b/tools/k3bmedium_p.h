@@ -22,6 +22,8 @@
 #include "k3bcdtext.h"
 #include "k3biso9660.h"
 
+#include <QExplicitlySharedDataPointer>
+#include <QMutex>
 #include <QSharedData>
 #include <QList>
 
@@ -29,6 +31,81 @@
 
 
 namespace K3b {
+    /**
+     * Internal class used by Medium
+     *
+     * The parts of the medium information which are read from the
+     * device on first access. A MediumDetails object is created by
+     * each Medium::update() and shared by all copies of the Medium
+     * (even detached ones) so every part is read at most once per
+     * medium. Concurrent requests for the same part wait for the
+     * first one to finish instead of sending the commands again.
+     *
+     * In the GUI thread nothing is read from the device. The accessors
+     * return empty values for parts which have not been read yet.
+     */
+    class MediumDetails : public QSharedData
+    {
+    public:
+        MediumDetails( Device::Device* dev, const Device::DiskInfo& info );
+
+        void fetch( Medium::Informations info );
+        Medium::Informations fetched() const;
+
+        Device::Toc toc();
+        Device::CdText cdText();
+        QList<int> writingSpeeds();
+        Medium::MediumContents content();
+        const Iso9660SimplePrimaryDescriptor& isoDescriptor();
+
+        /**
+         * Use \p cdText instead of reading it from the device, used for
+         * CD-Text cached by the MediaCache. Ignored if the CD-Text has been
+         * read already.
+         */
+        void setCdText( const Device::CdText& cdText );
+
+        /**
+         * \return true if CD-Text has been read from the device successfully.
+         *         False for discs without CD-Text, read errors, and CD-Text
+         *         set through setCdText().
+         */
+        bool cdTextRead();
+
+    private:
+        /**
+         * Reads \p info unless called from the GUI thread.
+         * \return true if the value of \p info can be used.
+         */
+        bool available( Medium::Information info );
+
+        void fetchToc();
+        void fetchCdText();
+        void fetchWritingSpeeds();
+        void fetchContent();
+        void setFetched( Medium::Information info );
+
+        Device::Device* m_device;
+        Device::DiskInfo m_diskInfo;
+
+        // one mutex per part so reading the speeds does not block the contents
+        QMutex m_tocMutex;
+        QMutex m_cdTextMutex;
+        QMutex m_writingSpeedsMutex;
+        QMutex m_contentMutex;
+
+        mutable QMutex m_fetchedMutex;
+        Medium::Informations m_fetched;
+
+        Device::Toc m_toc;
+        Device::CdText m_cdText;
+        bool m_cdTextRead;
+        QList<int> m_writingSpeeds;
+        Iso9660SimplePrimaryDescriptor m_isoDesc;
+        Medium::MediumContents m_content;
+    };
+
+
     /**
      * Internal class used by Medium
      */
@@ -39,11 +116,9 @@ namespace K3b {
 
         Device::Device* device;
         Device::DiskInfo diskInfo;
-        Device::Toc toc;
-        Device::CdText cdText;
-        QList<int> writingSpeeds;
-        Iso9660SimplePrimaryDescriptor isoDesc;
-        Medium::MediumContents content;
+
+        // null until the medium has been updated
+        QExplicitlySharedDataPointer<MediumDetails> details;
 
         KCDDB::CDInfo cddbInfo;
     };
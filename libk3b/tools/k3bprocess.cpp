@@ -16,81 +16,18 @@
 
 #include "k3bprocess.h"
 #include "k3bexternalbinmanager.h"
+#include "k3blinesplitter.h"
 
 #include <QByteArray>
 #include <QDebug>
 #include <QStringList>
 
 
-namespace {
-    QStringList splitOutput( const QByteArray& data,
-                             QString& unfinishedLine,
-                             bool suppressEmptyLines )
-    {
-        //
-        // The stderr splitting is mainly used for parsing of messages
-        // That's why we simplify the data before proceeding
-        //
-        int len = data.length();
-
-        QByteArray buffer;
-        for( int i = 0; i < len; i++ ) {
-            if( data[i] == '\b' ) {
-                while( i < len &&
-                       data[i] == '\b' )  // we replace multiple backspaces with a single line feed
-                    i++;
-                buffer += '\n';
-            }
-            if ( i < len ) {
-                if( data[i] == '\r' )
-                    buffer += '\n';
-                else if( data[i] == '\t' )  // replace tabs with a single space
-                    buffer += ' ';
-                else
-                    buffer += data[i];
-            }
-        }
-
-        QStringList lines = QString::fromLocal8Bit( buffer ).split( '\n', suppressEmptyLines ? QString::SkipEmptyParts : QString::KeepEmptyParts );
-
-        // in case we suppress empty lines we need to handle the following separately
-        // to make sure we join unfinished lines correctly
-        if( suppressEmptyLines && buffer.startsWith( '\n' ) )
-            lines.prepend( QString() );
-
-        if( !unfinishedLine.isEmpty() ) {
-            lines.first().prepend( unfinishedLine );
-            unfinishedLine.truncate(0);
-
-            qDebug() << "(K3b::Process)           joined line: '" << (lines.first()) << "'";
-        }
-
-        QStringList::iterator it;
-
-        // check if line ends with a newline
-        // if not save the last line because it is not finished
-        if ( !buffer.isEmpty() ) {
-            QByteRef c = buffer[buffer.length()-1];
-            bool hasUnfinishedLine = ( c != '\n' && c != '\r' && QChar( c ) != QChar(46) );  // What is unicode 46?? It is printed as a point
-            if( hasUnfinishedLine ) {
-                qDebug() << "(K3b::Process) found unfinished line: '" << lines.last() << "'";
-                qDebug() << "(K3b::Process)             last char: '" << buffer.right(1) << "'";
-                unfinishedLine = lines.takeLast();
-            }
-        }
-
-        return lines;
-    }
-}
-
-
 class K3b::Process::Private
 {
 public:
-    QString unfinishedStdoutLine;
-    QString unfinishedStderrLine;
-
-    bool suppressEmptyLines;
+    LineSplitter stdoutSplitter;
+    LineSplitter stderrSplitter;
 
     bool bSplitStdout;
 };
@@ -101,7 +38,6 @@ K3b::Process::Process( QObject* parent )
       d( new Private() )
 {
     setNextOpenMode( ReadWrite|Unbuffered );
-    d->suppressEmptyLines = true;
     d->bSplitStdout = false;
 
     connect( this, SIGNAL(readyReadStandardError()),
@@ -150,40 +86,27 @@ void K3b::Process::setSplitStdout( bool b )
 void K3b::Process::slotReadyReadStandardOutput()
 {
     if( d->bSplitStdout ) {
-        QStringList lines = splitOutput( readAllStandardOutput(), d->unfinishedStdoutLine, d->suppressEmptyLines );
-
-        for( QStringList::iterator it = lines.begin(); it != lines.end(); ++it ) {
-            QString& str = *it;
-
-            // just to be sure since something in splitOutput does not do this right
-            if( d->suppressEmptyLines && str.isEmpty() )
-                continue;
-
-            emit stdoutLine( str );
-        }
+        d->stdoutSplitter.feed( readAllStandardOutput() );
+        QString line;
+        while( d->stdoutSplitter.readLine( line ) )
+            emit stdoutLine( line );
     }
 }
 
 
 void K3b::Process::slotReadyReadStandardError()
 {
-    QStringList lines = splitOutput( readAllStandardError(), d->unfinishedStderrLine, d->suppressEmptyLines );
-
-    for( QStringList::iterator it = lines.begin(); it != lines.end(); ++it ) {
-        QString& str = *it;
-
-        // just to be sure since something in splitOutput does not do this right
-        if( d->suppressEmptyLines && str.isEmpty() )
-            continue;
-
-        emit stderrLine( str );
-    }
+    d->stderrSplitter.feed( readAllStandardError() );
+    QString line;
+    while( d->stderrSplitter.readLine( line ) )
+        emit stderrLine( line );
 }
 
 
 void K3b::Process::setSuppressEmptyLines( bool b )
 {
-    d->suppressEmptyLines = b;
+    d->stdoutSplitter.setSuppressEmptyLines( b );
+    d->stderrSplitter.setSuppressEmptyLines( b );
 }
 
 
@@ -204,6 +127,8 @@ void K3b::Process::close()
 bool K3b::Process::start( KProcess::OutputChannelMode mode )
 {
     qDebug();
+    d->stdoutSplitter.reset();
+    d->stderrSplitter.reset();
     setOutputChannelMode( mode );
     K3bKProcess::start();
     qDebug() << "started";
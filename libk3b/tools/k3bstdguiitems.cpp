@@ -166,8 +166,9 @@ QCheckBox* K3b::StdGuiItems::normalizeCheckBox( QWidget* parent )
                           "to a standard level. This is useful for things like creating mixes, "
                           "where different recording levels on different albums can cause the volume "
                           "to vary greatly from song to song."
-                          "<p><b>Be aware that K3b currently does not support normalizing when writing "
-                          "on the fly.</b>") );
+                          "<p>The loudness of the tracks is measured before writing and the volume "
+                          "is adjusted while decoding. Thus normalizing also works when writing "
+                          "on the fly.") );
     return c;
 }
 
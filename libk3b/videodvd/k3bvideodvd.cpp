@@ -23,6 +23,10 @@
 #include "k3b_i18n.h"
 
 #include <QFile>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include <inttypes.h> // needed by dvdreads headers
 #include <dvdread/dvd_reader.h>
@@ -63,6 +67,50 @@ namespace {
         }
     }
     
+
+    /**
+     * The parsed titles of the Video DVDs opened so far keyed by their disc id.
+     */
+    class TitleCache
+    {
+    public:
+        bool titles( const QString& discId, QVector<K3b::VideoDVD::Title>& titles, QString& volumeId ) const {
+            QMutexLocker locker( &mutex );
+            QHash<QString, Entry>::const_iterator it = cache.constFind( discId );
+            if( it == cache.constEnd() )
+                return false;
+            titles = it->titles;
+            volumeId = it->volumeId;
+            return true;
+        }
+
+        void insert( const QString& discId, const QVector<K3b::VideoDVD::Title>& titles, const QString& volumeId ) {
+            QMutexLocker locker( &mutex );
+            // a handful of discs is all we ever need
+            if( cache.count() >= 16 )
+                cache.clear();
+            Entry& entry = cache[discId];
+            entry.titles = titles;
+            entry.volumeId = volumeId;
+        }
+
+        void clear() {
+            QMutexLocker locker( &mutex );
+            cache.clear();
+        }
+
+    private:
+        struct Entry {
+            QVector<K3b::VideoDVD::Title> titles;
+            QString volumeId;
+        };
+
+        mutable QMutex mutex;
+        QHash<QString, Entry> cache;
+    };
+
+    Q_GLOBAL_STATIC( TitleCache, s_titleCache )
+
 } // namespace
 
 
@@ -87,6 +135,7 @@ bool K3b::VideoDVD::VideoDVD::open( K3b::Device::Device* dev )
 {
     m_device = 0;
     m_titles.clear();
+    m_discId.clear();
 
     //
     // Initialize libdvdread
@@ -113,6 +162,20 @@ bool K3b::VideoDVD::VideoDVD::open( K3b::Device::Device* dev )
         return false;
     }
 
+    //
+    // The disc id is a hash over the IFO files which is much cheaper than parsing them
+    //
+    unsigned char discId[16];
+    if( DVDDiscID( dvdReaderT, discId ) == 0 ) {
+        m_discId = QString::fromLatin1( QByteArray( reinterpret_cast<const char*>( discId ), 16 ).toHex() );
+        if( s_titleCache->titles( m_discId, m_titles, m_volumeIdentifier ) ) {
+            qDebug() << "(K3b::VideoDVD) using cached titles of disc" << m_discId;
+            DVDClose( dvdReaderT );
+            m_device = dev;
+            return true;
+        }
+    }
+
     //
     // Open the VMG info
     //
@@ -123,6 +186,11 @@ bool K3b::VideoDVD::VideoDVD::open( K3b::Device::Device* dev )
         return false;
     }
 
+    //
+    // Many titles share one title set, thus each title set ifo is only opened once
+    //
+    QHash<int, ifo_handle_t*> titleSetIfos;
+
     //
     // parse titles
     //
@@ -144,12 +212,18 @@ bool K3b::VideoDVD::VideoDVD::open( K3b::Device::Device* dev )
         //
         // Open the title set the current title is a part of
         //
-        ifo_handle_t* titleIfo = ifoOpen( dvdReaderT, vmg->tt_srpt->title[i].title_set_nr );
+        ifo_handle_t* titleIfo = titleSetIfos.value( title.title_set_nr );
         if( !titleIfo ) {
-            qDebug() << "(K3b::VideoDVD) Can't open Title ifo.";
-            ifoClose( vmg );
-            DVDClose( dvdReaderT );
-            return false;
+            titleIfo = ifoOpen( dvdReaderT, title.title_set_nr );
+            if( !titleIfo ) {
+                qDebug() << "(K3b::VideoDVD) Can't open Title ifo.";
+                Q_FOREACH( ifo_handle_t* ifo, titleSetIfos )
+                    ifoClose( ifo );
+                ifoClose( vmg );
+                DVDClose( dvdReaderT );
+                return false;
+            }
+            titleSetIfos.insert( title.title_set_nr, titleIfo );
         }
 
         //
@@ -232,10 +306,10 @@ bool K3b::VideoDVD::VideoDVD::open( K3b::Device::Device* dev )
                 m_titles[i].m_ptts[j].m_lastSector = cur_pgc->cell_playback[j].last_sector;
             }
         }
-
-        ifoClose( titleIfo );
     }
 
+    Q_FOREACH( ifo_handle_t* ifo, titleSetIfos )
+        ifoClose( ifo );
     ifoClose( vmg );
     DVDClose( dvdReaderT );
 
@@ -246,6 +320,9 @@ bool K3b::VideoDVD::VideoDVD::open( K3b::Device::Device* dev )
         }
     }
 
+    if( !m_discId.isEmpty() )
+        s_titleCache->insert( m_discId, m_titles, m_volumeIdentifier );
+
     //
     // Setting the device makes this a valid instance
     //
@@ -255,6 +332,12 @@ bool K3b::VideoDVD::VideoDVD::open( K3b::Device::Device* dev )
 }
 
 
+void K3b::VideoDVD::VideoDVD::clearCache()
+{
+    s_titleCache->clear();
+}
+
+
 const K3b::VideoDVD::Title& K3b::VideoDVD::VideoDVD::title( unsigned int num ) const
 {
     return m_titles[num];
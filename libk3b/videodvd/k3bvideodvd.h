@@ -41,6 +41,9 @@ namespace K3b {
      * analysis was successful and the structures are filled.
      *
      * After open() has returned the device has already been closed.
+     *
+     * The parsed titles are cached by the disc id. Opening the same disc again
+     * only needs to read the IFO files for the id instead of parsing them.
      */
     namespace VideoDVD
     {
@@ -66,6 +69,12 @@ namespace K3b {
 
             Device::Device* device() const { return m_device; }
             const QString& volumeIdentifier() const { return m_volumeIdentifier; }
+
+            /**
+             * The libdvdread disc id which is a hash over the IFO files.
+             * May be empty if it could not be determined.
+             */
+            const QString& discId() const { return m_discId; }
             unsigned int numTitles() const { return m_titles.count(); }
 
             /**
@@ -76,10 +85,16 @@ namespace K3b {
 
             void debug() const;
 
+            /**
+             * Forget the cached titles of all discs.
+             */
+            static void clearCache();
+
         private:
             Device::Device* m_device;
             QVector<Title> m_titles;
             QString m_volumeIdentifier;
+            QString m_discId;
         };
 
         LIBK3B_EXPORT QString audioFormatString( int format );
@@ -19,7 +19,9 @@
 
 #include <QDebug>
 #include <QSharedData>
+#include <QStringList>
 #include <QTextCodec>
+#include <QVector>
 
 #include <string.h>
 
@@ -98,16 +100,47 @@ namespace {
         s.replace( '\"', "_" );
     }
 
-    void savePack( cdtext_pack* pack, QByteArray& data, int& dataFill )
+    // the text pack types in the order they are written
+    const int s_textPackTypes[] = { 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x8E };
+    const int s_textPackTypeCount = sizeof(s_textPackTypes)/sizeof(int);
+
+    /**
+     * The packs of one pack type as written the last time together with the
+     * texts they have been created from.
+     */
+    struct PackBlock
     {
-        // create CRC
-        quint16 crc = K3b::Device::calcX25( reinterpret_cast<unsigned char*>(pack), sizeof(cdtext_pack)-2 );
+        PackBlock()
+            : valid( false ) {
+        }
 
+        QStringList texts;
+        QByteArray packs;
+        bool valid;
+    };
+
+    quint16 packCrc( const unsigned char* pack )
+    {
         // invert for Redbook compliance
-        crc ^= 0xffff;
+        return K3b::Device::calcX25( pack, sizeof(cdtext_pack)-2 ) ^ 0xffff;
+    }
 
-        pack->crc[0] = (crc>>8) & 0xff;
-        pack->crc[1] = crc & 0xff;
+    bool packCrcValid( const unsigned char* pack )
+    {
+        const quint16 crc = packCrc( pack );
+        return( pack[16] == ( (crc>>8) & 0xff ) && pack[17] == ( crc & 0xff ) );
+    }
+
+    void setPackCrc( unsigned char* pack )
+    {
+        const quint16 crc = packCrc( pack );
+        pack[16] = (crc>>8) & 0xff;
+        pack[17] = crc & 0xff;
+    }
+
+    void savePack( cdtext_pack* pack, QByteArray& data, int& dataFill )
+    {
+        setPackCrc( reinterpret_cast<unsigned char*>(pack) );
 
 
         // append the pack to data
@@ -134,7 +167,7 @@ namespace {
             *illegalChars = false;
 
         // TODO: do this without QT
-        QTextCodec* codec = QTextCodec::codecForName("ISO8859-1");
+        static QTextCodec* const codec = QTextCodec::codecForName("ISO8859-1");
         if( codec ) {
             QByteArray encoded = codec->fromUnicode( s );
             return encoded;
@@ -343,21 +376,8 @@ bool K3b::Device::TrackCdText::operator!=( const K3b::Device::TrackCdText& other
 class K3b::Device::CdText::Private : public QSharedData
 {
 public:
-    Private() {
-    }
-
-    Private( const Private& other )
-        : QSharedData( other ),
-          title(other.title),
-          performer(other.performer),
-          songwriter(other.songwriter),
-          composer(other.composer),
-          arranger(other.arranger),
-          message(other.message),
-          discId(other.discId),
-          upcEan(other.upcEan),
-          tracks(other.tracks) {
-        // do not copy rawData. it needs to be recreated if the cdtext changes
+    Private()
+        : languageCode( 0x09 ) { // English (from cdrecord)
     }
 
     QString title;
@@ -371,11 +391,28 @@ public:
 
     QList<TrackCdText> tracks;
 
+    int languageCode;
+
+    // the language blocks 1-7 of the parsed data
+    QList<CdText> blocks;
+
+    //
+    // The raw data is valid as long as the texts equal the ones the
+    // pack blocks have been created from. Thus, a changed field only
+    // requires the packs of its pack type to be created again.
+    //
     mutable QByteArray rawData;
+    mutable PackBlock packBlocks[16];
 
     QString textForPackType( int packType, int track ) const;
-    int textLengthForPackType( int packType ) const;
+    QStringList textsForPackType( int packType ) const;
     QByteArray createPackData( int packType, int& ) const;
+
+    /**
+     * Sets the texts from the raw pack data. \p fields contains the texts
+     * of one language block per pack type and track (0 for the disc).
+     */
+    void setTexts( const QVector<QByteArray>* fields );
 };
 
 
@@ -468,6 +505,10 @@ void K3b::Device::CdText::clear()
     d->message.clear();
     d->discId.clear();
     d->upcEan.clear();
+
+    d->languageCode = 0x09;
+    d->blocks.clear();
+    d->rawData.clear();
 }
 
 
@@ -617,32 +658,57 @@ void K3b::Device::CdText::setRawPackData( const unsigned char* data, int len )
         qDebug() << "(K3b::Device::CdText) invalid cdtext size: " << len;
     }
     else if( len-r > 0 ) {
-        debugRawTextPackData( &data[r], len-r );
-
-        cdtext_pack* pack = (cdtext_pack*)&data[r];
-
-
+        //
+        // The texts are collected as bytes per language block, pack type, and
+        // track and only converted once all packs have been read.
+        //
+        QVector<QByteArray> fields[8][16];
+        text_size_block sizeInfo[8];
+        bool blockUsed[8];
+        bool sizeInfoFound[8];
+        ::memset( sizeInfo, 0, sizeof(sizeInfo) );
+        for( int i = 0; i < 8; ++i )
+            blockUsed[i] = sizeInfoFound[i] = false;
+
+        int crcErrors = 0;
+        bool dbcc = false;
+
+        const cdtext_pack* pack = reinterpret_cast<const cdtext_pack*>( &data[r] );
         for( int i = 0; i < (len-r)/18; ++i ) {
 
+            if( !packCrcValid( reinterpret_cast<const unsigned char*>(&pack[i]) ) )
+                ++crcErrors;
+
             if( pack[i].dbcc ) {
-                qDebug() << "(K3b::Device::CdText) Double byte code not supported";
-                return;
+                dbcc = true;
+                continue;
             }
 
-            //
-            // For some reason all crc bits are inverted.
-            //
-            pack[i].crc[0] ^= 0xff;
-            pack[i].crc[1] ^= 0xff;
-
-            quint16 crc = calcX25( reinterpret_cast<unsigned char*>(&pack[i]), 18 );
+            const int block = pack[i].blocknum;
+            const int type = pack[i].id1;
+            if( type < 0x80 || type > 0x8f )
+                continue;
 
-            pack[i].crc[0] ^= 0xff;
-            pack[i].crc[1] ^= 0xff;
+            blockUsed[block] = true;
 
-            if( crc != 0x0000 )
-                qDebug() << "(K3b::Device::CdText) CRC invalid!";
+            //
+            // the size information is spread over three packs
+            //
+            if( type == 0x8f ) {
+                if( pack[i].id2 < 3 ) {
+                    ::memcpy( &reinterpret_cast<char*>(&sizeInfo[block])[pack[i].id2*12], pack[i].data, 12 );
+                    sizeInfoFound[block] = true;
+                }
+                continue;
+            }
 
+            // TODO: support for binary data
+            // 0x87: Genre
+            // 0x88: TOC
+            // 0x89: second TOC
+            // 0x8d: closed information
+            if( type > 0x86 && type != 0x8e )
+                continue;
 
             //
             // pack.data has a length of 12
@@ -650,105 +716,122 @@ void K3b::Device::CdText::setRawPackData( const unsigned char* data, int len )
             // id1 tells us the tracknumber of the data (0 for global)
             // data may contain multiple \0. In that case after every \0 the track number increases 1
             //
-
-            char* nullPos = (char*)pack[i].data - 1;
-
+            QVector<QByteArray>& texts = fields[block][type & 0xf];
             int trackNo = pack[i].id2;
+            int pos = 0;
+            while( pos < 12 ) {
+                const unsigned char* start = &pack[i].data[pos];
+                const unsigned char* end = static_cast<const unsigned char*>( ::memchr( start, '\0', 12-pos ) );
+                const int textLen = ( end ? end - start : 12 - pos );
 
-            while( nullPos ) {
-                char* nextNullPos = (char*)::memchr( nullPos+1, '\0', 11 - (nullPos - (char*)pack[i].data) );
-                QString txtstr;
-                if( nextNullPos ) // take all chars up to the next null
-                    txtstr = QString::fromLatin1( (char*)nullPos+1, nextNullPos - nullPos - 1 );
-                else // take all chars to the end of the pack data (12 bytes)
-                    txtstr = QString::fromLatin1( (char*)nullPos+1, 11 - (nullPos - (char*)pack[i].data) );
+                if( texts.count() <= trackNo )
+                    texts.resize( trackNo+1 );
+                texts[trackNo].append( reinterpret_cast<const char*>(start), textLen );
 
-                //
-                // a tab character means to use the same as for the previous track
-                //
-                if( txtstr == "\t" )
-                    txtstr = d->textForPackType( pack[i].id1, trackNo-1 );
-
-                switch( pack[i].id1 ) {
-                case 0x80: // Title
-                    if( trackNo == 0 )
-                        d->title.append( txtstr );
-                    else
-                        track(trackNo-1).d->title.append( txtstr );
+                if( !end )
                     break;
 
-                case 0x81: // Performer
-                    if( trackNo == 0 )
-                        d->performer.append( txtstr );
-                    else
-                        track(trackNo-1).d->performer.append( txtstr );
-                    break;
+                ++trackNo;
+                pos += textLen + 1;
+            }
+        }
 
-                case 0x82: // Writer
-                    if( trackNo == 0 )
-                        d->songwriter.append( txtstr );
-                    else
-                        track(trackNo-1).d->songwriter.append( txtstr );
-                    break;
+        if( crcErrors > 0 )
+            qDebug() << "(K3b::Device::CdText)" << crcErrors << "packs with invalid CRC!";
+        if( dbcc )
+            qDebug() << "(K3b::Device::CdText) Double byte code not supported";
 
-                case 0x83: // Composer
-                    if( trackNo == 0 )
-                        d->composer.append( txtstr );
-                    else
-                        track(trackNo-1).d->composer.append( txtstr );
-                    break;
+        for( int block = 0; block < 8; ++block ) {
+            if( !blockUsed[block] )
+                continue;
 
-                case 0x84: // Arranger
-                    if( trackNo == 0 )
-                        d->arranger.append( txtstr );
-                    else
-                        track(trackNo-1).d->arranger.append( txtstr );
-                    break;
+            CdText text;
+            text.d->setTexts( fields[block] );
 
-                case 0x85: // Message
-                    if( trackNo == 0 )
-                        d->message.append( txtstr );
-                    else
-                        track(trackNo-1).d->message.append( txtstr );
-                    break;
+            // every block contains the language codes of all blocks
+            if( sizeInfoFound[block] && sizeInfo[block].language_codes[block] )
+                text.d->languageCode = static_cast<unsigned char>( sizeInfo[block].language_codes[block] );
+            else if( sizeInfoFound[0] && sizeInfo[0].language_codes[block] )
+                text.d->languageCode = static_cast<unsigned char>( sizeInfo[0].language_codes[block] );
 
-                case 0x86: // Disc identification
-                    // only global
-                    if( trackNo == 0 )
-                        d->discId.append( txtstr );
-                    break;
+            if( block == 0 )
+                d = text.d;
+            else
+                d->blocks.append( text );
+        }
 
-                case 0x8e: // Upc or isrc
-                    if( trackNo == 0 )
-                        d->upcEan.append( txtstr );
-                    else
-                        track(trackNo-1).d->isrc.append( txtstr );
-                    break;
+        // we preserve the original data for clean 1-to-1 copies
+        d->rawData = QByteArray( reinterpret_cast<const char*>(data), len );
+        for( int i = 0; i < s_textPackTypeCount; ++i ) {
+            PackBlock& block = d->packBlocks[s_textPackTypes[i] & 0xf];
+            block.texts = d->textsForPackType( s_textPackTypes[i] );
+            block.packs.clear();
+            block.valid = false;
+        }
+    }
+    else
+        qDebug() << "(K3b::Device::CdText) zero-sized CD-TEXT: " << len;
+}
 
-                    // TODO: support for binary data
-                    // 0x88: TOC
-                    // 0x89: second TOC
-                    // 0x8f: Size information
 
-                default:
-                    break;
-                }
+void K3b::Device::CdText::Private::setTexts( const QVector<QByteArray>* fields )
+{
+    int trackCount = 0;
+    for( int type = 0; type < 16; ++type )
+        trackCount = qMax( trackCount, fields[type].count()-1 );
 
-                trackNo++;
-                nullPos = nextNullPos;
+    QVector<QString> texts( trackCount+1 );
+    for( int i = 0; i < s_textPackTypeCount; ++i ) {
+        const int type = s_textPackTypes[i] & 0xf;
+        for( int track = 0; track <= trackCount; ++track ) {
+            if( track < fields[type].count() ) {
+                //
+                // a tab character means to use the same as for the previous track
+                //
+                if( track > 0 && fields[type][track] == "\t" )
+                    texts[track] = texts[track-1];
+                else
+                    texts[track] = QString::fromLatin1( fields[type][track] );
+            }
+            else {
+                texts[track].clear();
             }
         }
 
-        // remove empty fields at the end
-        while( !d->tracks.isEmpty() && d->tracks.last().isEmpty() ) {
-            d->tracks.removeLast();
+        switch( s_textPackTypes[i] ) {
+        case 0x80: title = texts[0]; break;
+        case 0x81: performer = texts[0]; break;
+        case 0x82: songwriter = texts[0]; break;
+        case 0x83: composer = texts[0]; break;
+        case 0x84: arranger = texts[0]; break;
+        case 0x85: message = texts[0]; break;
+        case 0x86: discId = texts[0]; break;
+        case 0x8E: upcEan = texts[0]; break;
         }
 
-        // we preserve the original data for clean 1-to-1 copies
-        d->rawData = QByteArray( reinterpret_cast<const char*>(data), len );
+        if( i == 0 ) {
+            for( int track = 1; track <= trackCount; ++track )
+                tracks.append( TrackCdText() );
+        }
+
+        for( int track = 1; track <= trackCount; ++track ) {
+            TrackCdText::Private* t = tracks[track-1].d.data();
+            switch( s_textPackTypes[i] ) {
+            case 0x80: t->title = texts[track]; break;
+            case 0x81: t->performer = texts[track]; break;
+            case 0x82: t->songwriter = texts[track]; break;
+            case 0x83: t->composer = texts[track]; break;
+            case 0x84: t->arranger = texts[track]; break;
+            case 0x85: t->message = texts[track]; break;
+            case 0x8E: t->isrc = texts[track]; break;
+            }
+        }
+    }
+
+    // remove empty fields at the end
+    while( !tracks.isEmpty() && tracks.last().isEmpty() ) {
+        tracks.removeLast();
     }
-    else
-        qDebug() << "(K3b::Device::CdText) zero-sized CD-TEXT: " << len;
 }
 
 
@@ -759,12 +842,25 @@ void K3b::Device::CdText::setRawPackData( const QByteArray& b )
 
 QByteArray K3b::Device::CdText::rawPackData() const
 {
-    if( d->rawData.isEmpty() ) {
+    //
+    // find the pack types which changed since the data has been created
+    //
+    bool changed = d->rawData.isEmpty();
+    for( int i = 0; i < s_textPackTypeCount; ++i ) {
+        PackBlock& block = d->packBlocks[s_textPackTypes[i] & 0xf];
+        QStringList texts = d->textsForPackType( s_textPackTypes[i] );
+        if( texts != block.texts ) {
+            block.texts = texts;
+            block.packs.clear();
+            block.valid = false;
+            changed = true;
+        }
+    }
+
+    if( changed ) {
         // FIXME: every pack block may only consist of up to 255 packs.
 
         int pc = 0;
-        int alreadyCountedPacks = 0;
-
 
         //
         // prepare the size information block
@@ -775,24 +871,41 @@ QByteArray K3b::Device::CdText::rawPackData() const
         tsize.first_track = 1;
         tsize.last_track = count();
         tsize.pack_count[0xF] = 3;
-        tsize.language_codes[0] = 0x09;  // English (from cdrecord)
+        tsize.language_codes[0] = d->languageCode;
 
 
         //
-        // create the CD-Text packs
+        // create the CD-Text packs. Only the packs of changed pack types
+        // are created again, the others only need new sequence numbers.
         //
         QByteArray data;
-        for( int i = 0; i <= 6; ++i ) {
-            if( d->textLengthForPackType( 0x80 | i ) ) {
-                appendByteArray( data, d->createPackData( 0x80 | i, pc ) );
-                tsize.pack_count[i] = pc - alreadyCountedPacks;
-                alreadyCountedPacks = pc;
+        for( int i = 0; i < s_textPackTypeCount; ++i ) {
+            const int packType = s_textPackTypes[i];
+            PackBlock& block = d->packBlocks[packType & 0xf];
+            if( !block.valid ) {
+                bool empty = true;
+                for( int j = 0; j < block.texts.count() && empty; ++j )
+                    empty = encodeCdText( block.texts[j] ).isEmpty();
+
+                int packCount = 0;
+                block.packs = ( empty ? QByteArray() : d->createPackData( packType, packCount ) );
+                block.valid = true;
             }
-        }
-        if( d->textLengthForPackType( 0x8E ) ) {
-            appendByteArray( data, d->createPackData( 0x8E, pc ) );
-            tsize.pack_count[0xE] = pc - alreadyCountedPacks;
-            alreadyCountedPacks = pc;
+
+            const int packs = block.packs.size() / sizeof(cdtext_pack);
+            if( packs == 0 )
+                continue;
+
+            unsigned char* pack = reinterpret_cast<unsigned char*>( block.packs.data() );
+            for( int j = 0; j < packs; ++j, pack += sizeof(cdtext_pack), ++pc ) {
+                if( pack[2] != pc ) {
+                    pack[2] = pc;
+                    setPackCrc( pack );
+                }
+            }
+
+            appendByteArray( data, block.packs );
+            tsize.pack_count[packType & 0xf] = packs;
         }
 
 
@@ -993,13 +1106,40 @@ QString K3b::Device::CdText::Private::textForPackType( int packType, int track )
 }
 
 
-// count the overall length of a certain packtype texts
-int K3b::Device::CdText::Private::textLengthForPackType( int packType ) const
+QStringList K3b::Device::CdText::Private::textsForPackType( int packType ) const
 {
-    int len = 0;
+    QStringList texts;
     for( int i = 0; i <= tracks.count(); ++i )
-        len += encodeCdText( textForPackType( packType, i ) ).length();
-    return len;
+        texts.append( textForPackType( packType, i ) );
+    return texts;
+}
+
+
+int K3b::Device::CdText::languageCode() const
+{
+    return d->languageCode;
+}
+
+
+void K3b::Device::CdText::setLanguageCode( int code )
+{
+    d->languageCode = code;
+    d->rawData.clear();
+}
+
+
+int K3b::Device::CdText::blockCount() const
+{
+    return 1 + d->blocks.count();
+}
+
+
+K3b::Device::CdText K3b::Device::CdText::block( int i ) const
+{
+    if( i > 0 && i <= d->blocks.count() )
+        return d->blocks[i-1];
+    else
+        return *this;
 }
 
 
@@ -1015,7 +1155,8 @@ void K3b::Device::CdText::debug() const
              << "  Arranger:   '" << arranger() << "'" << endl
              << "  Message:    '" << message() << "'" << endl
              << "  Disc ID:    '" << discId() << "'" << endl
-             << "  Upc Ean:    '" << upcEan() << "'" << endl;
+             << "  Upc Ean:    '" << upcEan() << "'" << endl
+             << "  Language:   " << languageCode() << endl;
     for( int i = 0; i < count(); ++i ) {
         qDebug() << "Track " << (i+1) << ":" << endl
                  << "  Title:      '" << d->tracks[i].title() << "'" << endl
@@ -1026,6 +1167,11 @@ void K3b::Device::CdText::debug() const
                  << "  Message:    '" << d->tracks[i].message() << "'" << endl
                  << "  Isrc:       '" << d->tracks[i].isrc() << "'" << endl;
     }
+
+    if( !d->rawData.isEmpty() ) {
+        const int r = d->rawData.size()%18;
+        debugRawTextPackData( reinterpret_cast<const unsigned char*>(d->rawData.constData()) + r, d->rawData.size() - r );
+    }
 }
 
 
@@ -1057,34 +1203,46 @@ bool K3b::Device::CdText::checkCrc( const unsigned char* data, int len )
         return false;
     }
     else {
-        len -= r;
+        for( int i = r; i + 18 <= len; i += 18 ) {
+            if( !packCrcValid( &data[i] ) )
+                return false;
+        }
 
-        // TODO: what if the crc field is not used? All zeros?
+        return true;
+    }
+}
 
-        for( int i = 0; i < (len-r)/18; ++i ) {
-            cdtext_pack* pack = (cdtext_pack*)&data[r];
 
-            //
-            // For some reason all crc bits are inverted.
-            //
-            pack[i].crc[0] ^= 0xff;
-            pack[i].crc[1] ^= 0xff;
+bool K3b::Device::CdText::checkCrc( const QByteArray& rawData )
+{
+    return checkCrc( reinterpret_cast<const unsigned char*>(rawData.data()), rawData.size() );
+}
 
-            int crc = calcX25( reinterpret_cast<unsigned char*>(&pack[i]), 18 );
 
-            pack[i].crc[0] ^= 0xff;
-            pack[i].crc[1] ^= 0xff;
+int K3b::Device::CdText::repairCrc( unsigned char* data, int len )
+{
+    int r = len%18;
+    if( r > 0 && r != 4 ) {
+        qDebug() << "(K3b::Device::CdText) invalid cdtext size: " << len;
+        return -1;
+    }
 
-            if( crc != 0x0000 )
-                return false;
+    int errors = 0;
+    for( int i = r; i + 18 <= len; i += 18 ) {
+        unsigned char* pack = &data[i];
+        if( !packCrcValid( pack ) ) {
+            if( pack[16] == 0 && pack[17] == 0 )
+                setPackCrc( pack );
+            else
+                ++errors;
         }
-
-        return true;
     }
+
+    return errors;
 }
 
 
-bool K3b::Device::CdText::checkCrc( const QByteArray& rawData )
+int K3b::Device::CdText::repairCrc( QByteArray& rawData )
 {
-    return checkCrc( reinterpret_cast<const unsigned char*>(rawData.data()), rawData.size() );
+    return repairCrc( reinterpret_cast<unsigned char*>(rawData.data()), rawData.size() );
 }
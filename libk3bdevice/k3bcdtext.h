@@ -129,6 +129,27 @@ namespace K3b {
             void setDiscId( const QString& s );
             void setUpcEan( const QString& s );
 
+            /**
+             * The language of the texts as used in the size information of the
+             * CD-Text packs. The default is 0x09 (English).
+             */
+            int languageCode() const;
+            void setLanguageCode( int code );
+
+            /**
+             * The number of language blocks found in the raw pack data this
+             * object has been created from. This object represents block 0,
+             * the others are available through block().
+             *
+             * Only block 0 is encoded again once the CD-Text is changed.
+             */
+            int blockCount() const;
+
+            /**
+             * \return The language block \p i. Block 0 is a copy of this object.
+             */
+            CdText block( int i ) const;
+
             void debug() const;
 
             /**
@@ -138,6 +159,16 @@ namespace K3b {
             static bool checkCrc( const unsigned char*, int );
             static bool checkCrc( const QByteArray& );
 
+            /**
+             * Fills in the CRC of all packs which come without one, i.e. with both
+             * CRC bytes set to zero as returned by some drives.
+             *
+             * \return The number of packs with a wrong CRC left or -1 if the data
+             *         has a wrong length.
+             */
+            static int repairCrc( unsigned char*, int );
+            static int repairCrc( QByteArray& );
+
             bool operator==( const CdText& ) const;
             bool operator!=( const CdText& ) const;
 
@@ -16,6 +16,8 @@
 
 #include <QDebug>
 
+#include <string.h>
+
 namespace {
     static const quint16 g_x25Table[1<<8] = {
         0x0000,  0x1021,  0x2042,  0x3063,  0x4084,  0x50a5,  0x60c6,  0x70e7,
@@ -51,11 +53,125 @@ namespace {
         0xef1f,  0xff3e,  0xcf5d,  0xdf7c,  0xaf9b,  0xbfba,  0x8fd9,  0x9ff8,
         0x6e17,  0x7e36,  0x4e55,  0x5e74,  0x2e93,  0x3eb2,  0x0ed1,  0x1ef0,
     };
+
+
+    quint32 fromLe32( const unsigned char* p )
+    {
+        return quint32( p[0] ) | quint32( p[1] )<<8 | quint32( p[2] )<<16 | quint32( p[3] )<<24;
+    }
+
+
+    //
+    // Slice-by-8 tables: table[k][b] is the crc of byte b followed by k zero bytes.
+    // This allows to process 8 bytes with 8 independent table lookups.
+    //
+    class X25Tables
+    {
+    public:
+        X25Tables() {
+            for( int b = 0; b < 256; ++b ) {
+                table[0][b] = g_x25Table[b];
+            }
+            for( int k = 1; k < 8; ++k ) {
+                for( int b = 0; b < 256; ++b ) {
+                    const quint16 prev = table[k-1][b];
+                    table[k][b] = quint16( prev<<8 ) ^ g_x25Table[prev>>8];
+                }
+            }
+        }
+
+        quint16 table[8][256];
+    };
+
+
+    /**
+     * Reflected 32 bit crc with slice-by-8 tables.
+     */
+    class Crc32Tables
+    {
+    public:
+        explicit Crc32Tables( quint32 poly ) {
+            for( quint32 b = 0; b < 256; ++b ) {
+                quint32 c = b;
+                for( int i = 0; i < 8; ++i )
+                    c = ( c & 1 ) ? ( c>>1 ) ^ poly : ( c>>1 );
+                table[0][b] = c;
+            }
+            for( int k = 1; k < 8; ++k ) {
+                for( int b = 0; b < 256; ++b ) {
+                    const quint32 prev = table[k-1][b];
+                    table[k][b] = ( prev>>8 ) ^ table[0][prev&0xff];
+                }
+            }
+        }
+
+        quint32 calc( const unsigned char* data, unsigned int len, quint32 crc ) const {
+            while( len >= 8 ) {
+                const quint32 one = crc ^ fromLe32( data );
+                const quint32 two = fromLe32( data+4 );
+                crc = table[7][one&0xff] ^
+                      table[6][(one>>8)&0xff] ^
+                      table[5][(one>>16)&0xff] ^
+                      table[4][one>>24] ^
+                      table[3][two&0xff] ^
+                      table[2][(two>>8)&0xff] ^
+                      table[1][(two>>16)&0xff] ^
+                      table[0][two>>24];
+                data += 8;
+                len -= 8;
+            }
+            while( len-- ) {
+                crc = ( crc>>8 ) ^ table[0][(crc ^ *data++)&0xff];
+            }
+            return crc;
+        }
+
+        quint32 table[8][256];
+    };
+
+
+    const X25Tables& x25Tables()
+    {
+        static const X25Tables s_tables;
+        return s_tables;
+    }
+
+    // x^32 + x^31 + x^16 + x^15 + x^4 + x^3 + x + 1 (ECMA-130) in reversed notation
+    const Crc32Tables& edcTables()
+    {
+        static const Crc32Tables s_tables( 0xd8018001 );
+        return s_tables;
+    }
+
+    const Crc32Tables& crc32Tables()
+    {
+        static const Crc32Tables s_tables( 0xedb88320 );
+        return s_tables;
+    }
+
+    const unsigned char s_syncPattern[12] = {
+        0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00
+    };
 }
 
 
-quint16 K3b::Device::calcX25( unsigned char* message, unsigned int len, quint16 crc )
+quint16 K3b::Device::calcX25( const unsigned char* message, unsigned int len, quint16 crc )
 {
+    const X25Tables& t = x25Tables();
+
+    while( len >= 8 ) {
+        crc = t.table[7][(crc>>8) ^ message[0]] ^
+              t.table[6][(crc&0xff) ^ message[1]] ^
+              t.table[5][message[2]] ^
+              t.table[4][message[3]] ^
+              t.table[3][message[4]] ^
+              t.table[2][message[5]] ^
+              t.table[1][message[6]] ^
+              t.table[0][message[7]];
+        message += 8;
+        len -= 8;
+    }
+
     while( len-- ) {
         crc = (crc<<8) ^ g_x25Table[(crc>>8) ^ (*message++)];
     }
@@ -64,17 +180,53 @@ quint16 K3b::Device::calcX25( unsigned char* message, unsigned int len, quint16
 }
 
 
-bool K3b::Device::checkQCrc( unsigned char* subdata )
+quint32 K3b::Device::calcEdc( const unsigned char* data, unsigned int len, quint32 start )
+{
+    return edcTables().calc( data, len, start );
+}
+
+
+quint32 K3b::Device::calcCrc32( const unsigned char* data, unsigned int len, quint32 start )
+{
+    return ~crc32Tables().calc( data, len, ~start );
+}
+
+
+bool K3b::Device::checkQCrc( const unsigned char* subdata )
 {
     // Red Book for some reason inverts the CRC bytes
-    subdata[10] ^= 0xff;
-    subdata[11] ^= 0xff;
+    const quint16 crc = calcX25( subdata, 10 );
+    return( crc == quint16( ~( subdata[10]<<8 | subdata[11] ) ) );
+}
+
 
-    quint16 crc = calcX25( subdata, 12 );
+bool K3b::Device::checkRawSectorEdc( const unsigned char* sector )
+{
+    // no sync pattern means audio
+    if( ::memcmp( sector, s_syncPattern, 12 ) )
+        return true;
+
+    switch( sector[15] ) {
+    case 1:
+        // sync, header, and user data
+        return( calcEdc( sector, 2064 ) == fromLe32( sector+2064 ) );
+
+    case 2:
+        // Mode 2 formless does not have the duplicated XA subheader
+        if( ::memcmp( sector+16, sector+20, 4 ) )
+            return true;
 
-    // correct the data
-    subdata[10] ^= 0xff;
-    subdata[11] ^= 0xff;
+        // form 2
+        if( sector[18] & 0x20 ) {
+            const quint32 edc = fromLe32( sector+2348 );
+            return( edc == 0 || calcEdc( sector+16, 2332 ) == edc );
+        }
 
-    return( crc == 0x0000 );
+        // form 1
+        return( calcEdc( sector+16, 2056 ) == fromLe32( sector+2072 ) );
+
+    default:
+        // Mode 0
+        return true;
+    }
 }
@@ -15,6 +15,8 @@
 #ifndef _K3B_CRC_H_
 #define _K3B_CRC_H_
 
+#include "k3bdevice_export.h"
+
 #include <qglobal.h>
 
 namespace K3b {
@@ -24,12 +26,38 @@ namespace K3b {
 
         // bool check( unsigned char* message, unsigned int len, unsigned char* crc, unsigned int crcLen );
 
-        quint16 calcX25( unsigned char* message, unsigned int len, quint16 start = 0x0000 );
+        /**
+         * CRC-16-CCITT as used for the Q sub-channel and CD-Text packs.
+         */
+        LIBK3BDEVICE_EXPORT quint16 calcX25( const unsigned char* message, unsigned int len, quint16 start = 0x0000 );
+
+        /**
+         * The 32 bit error detection code of Mode 1 and Mode 2 Form 1/2 data sectors
+         * (ECMA-130 Annex B). Pass the result of the previous call as @p start to
+         * continue a checksum.
+         */
+        LIBK3BDEVICE_EXPORT quint32 calcEdc( const unsigned char* data, unsigned int len, quint32 start = 0 );
+
+        /**
+         * CRC-32 as used by zlib and the copy CRC of EAC.
+         * Pass the result of the previous call as @p start to continue a checksum.
+         */
+        LIBK3BDEVICE_EXPORT quint32 calcCrc32( const unsigned char* data, unsigned int len, quint32 start = 0 );
 
         /**
          * subdata is 12 bytes in long.
          */
-        bool checkQCrc( unsigned char* subdata );
+        LIBK3BDEVICE_EXPORT bool checkQCrc( const unsigned char* subdata );
+
+        /**
+         * Verify the EDC of a raw 2352 byte sector including the sync pattern
+         * and the header as returned by Device::readSectorsRaw().
+         *
+         * \return false if the EDC does not match the data. Sectors without
+         * an EDC like audio, Mode 0, Mode 2 formless, or Mode 2 Form 2 with an
+         * empty EDC field are always considered valid.
+         */
+        LIBK3BDEVICE_EXPORT bool checkRawSectorEdc( const unsigned char* sector );
     }
 }
 
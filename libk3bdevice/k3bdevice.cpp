@@ -132,6 +132,7 @@ public:
     QString vendor;
     QString description;
     QString version;
+    QString serialNumber;
     int maxReadSpeed;
     int maxWriteSpeed;
     int currentWriteSpeed;
@@ -366,13 +367,17 @@ bool K3b::Device::Device::init( bool bCheckWritingModes )
 {
     qDebug() << "(K3b::Device::Device) " << blockDeviceName() << ": init()";
 
-    //
-    // they all should read CD-ROM.
-    //
-    d->readCapabilities = MEDIA_CD_ROM;
-    d->writeCapabilities = 0;
-    d->supportedProfiles = 0;
+    if( !probeIdentity() )
+        return false;
 
+    probeCapabilities( bCheckWritingModes );
+
+    return furtherInit();
+}
+
+
+bool K3b::Device::Device::probeIdentity()
+{
     if( !open() )
         return false;
 
@@ -404,6 +409,41 @@ bool K3b::Device::Device::init( bool bCheckWritingModes )
     if( d->description.isEmpty() )
         d->description = "UNKNOWN";
 
+    //
+    // The unit serial number vital product data page (0x80) is optional.
+    // We only use it to tell identical drives apart.
+    //
+    unsigned char serial[64];
+    ::memset( serial, 0, sizeof(serial) );
+    cmd.clear();
+    cmd[0] = MMC_INQUIRY;
+    cmd[1] = 0x01; // EVPD
+    cmd[2] = 0x80;
+    cmd[4] = sizeof(serial);
+    cmd[5] = 0;
+    if( !cmd.transport( TR_DIR_READ, serial, sizeof(serial) ) && serial[1] == 0x80 ) {
+        const int len = qMin( (int)serial[3], (int)sizeof(serial)-4 );
+        d->serialNumber = QString::fromLatin1( (char*)&serial[4], len ).trimmed();
+    }
+
+    close();
+
+    return true;
+}
+
+
+void K3b::Device::Device::probeCapabilities( bool bCheckWritingModes )
+{
+    //
+    // they all should read CD-ROM.
+    //
+    d->readCapabilities = MEDIA_CD_ROM;
+    d->writeCapabilities = 0;
+    d->supportedProfiles = 0;
+
+    if( !open() )
+        return;
+
     //
     // We probe all features of the device. Since not all devices support the GET CONFIGURATION command
     // we also query the mode page 2A and use the cdrom.h stuff to get as much information as possible
@@ -443,8 +483,57 @@ bool K3b::Device::Device::init( bool bCheckWritingModes )
     d->readCapabilities |= d->writeCapabilities;
 
     close();
+}
 
-    return furtherInit();
+
+QString K3b::Device::Device::capabilityKey() const
+{
+    return d->vendor + '|' + d->description + '|' + d->version + '|' + d->serialNumber;
+}
+
+
+QMap<QString, QString> K3b::Device::Device::capabilities() const
+{
+    QMap<QString, QString> caps;
+    caps.insert( QLatin1String( "ReadCapabilities" ), QString::number( int( d->readCapabilities ) ) );
+    caps.insert( QLatin1String( "WriteCapabilities" ), QString::number( int( d->writeCapabilities ) ) );
+    caps.insert( QLatin1String( "SupportedProfiles" ), QString::number( int( d->supportedProfiles ) ) );
+    caps.insert( QLatin1String( "WritingModes" ), QString::number( int( d->writeModes ) ) );
+    caps.insert( QLatin1String( "MaxReadSpeed" ), QString::number( d->maxReadSpeed ) );
+    caps.insert( QLatin1String( "MaxWriteSpeed" ), QString::number( d->maxWriteSpeed ) );
+    caps.insert( QLatin1String( "BufferSize" ), QString::number( d->bufferSize ) );
+    caps.insert( QLatin1String( "Burnfree" ), QString::number( d->burnfree ? 1 : 0 ) );
+    caps.insert( QLatin1String( "DvdMinusTestwrite" ), QString::number( d->dvdMinusTestwrite ? 1 : 0 ) );
+    return caps;
+}
+
+
+bool K3b::Device::Device::setCapabilities( const QMap<QString, QString>& caps )
+{
+    static const char* const s_keys[] = {
+        "ReadCapabilities", "WriteCapabilities", "SupportedProfiles", "WritingModes",
+        "MaxReadSpeed", "MaxWriteSpeed", "BufferSize", "Burnfree", "DvdMinusTestwrite"
+    };
+
+    int values[9];
+    for( int i = 0; i < 9; ++i ) {
+        bool ok = false;
+        values[i] = caps.value( QLatin1String( s_keys[i] ) ).toInt( &ok );
+        if( !ok )
+            return false;
+    }
+
+    d->readCapabilities = MediaTypes( QFlag( values[0] ) );
+    d->writeCapabilities = MediaTypes( QFlag( values[1] ) );
+    d->supportedProfiles = MediaTypes( QFlag( values[2] ) );
+    d->writeModes = WritingModes( QFlag( values[3] ) );
+    d->maxReadSpeed = values[4];
+    d->maxWriteSpeed = values[5];
+    d->bufferSize = values[6];
+    d->burnfree = ( values[7] != 0 );
+    d->dvdMinusTestwrite = ( values[8] != 0 );
+
+    return true;
 }
 
 
@@ -23,6 +23,7 @@
 #include "k3bdevice_export.h"
 
 #include <qglobal.h>
+#include <QMap>
 #include <QVarLengthArray>
 
 #if defined(__FreeBSD_kernel__)
@@ -249,6 +250,34 @@ namespace K3b {
              */
             bool testUnitReady() const;
 
+            /**
+             * Media event codes as reported by getMediaEventStatus().
+             */
+            enum MediaEvent {
+                MEDIA_EVENT_NO_CHANGE = 0,
+                MEDIA_EVENT_EJECT_REQUEST = 1,
+                MEDIA_EVENT_NEW_MEDIA = 2,
+                MEDIA_EVENT_MEDIA_REMOVAL = 3,
+                MEDIA_EVENT_MEDIA_CHANGED = 4
+            };
+
+            /**
+             * Query the media event class without waiting for an event.
+             *
+             * Other processes (and the kernel) may consume the events, too.
+             * Thus, \p mediaPresent should be used as the reliable indicator
+             * and \p event only as a hint.
+             *
+             * Refers to the MMC command: GET EVENT STATUS NOTIFICATION (polled)
+             *
+             * \param event The pending event, one of MediaEvent.
+             * \param mediaPresent true if a medium is loaded.
+             *
+             * \return false if the drive does not support the command
+             *         or the media event class.
+             */
+            bool getMediaEventStatus( int& event, bool& mediaPresent ) const;
+
             /**
              * checks if disk is empty, returns @p K3b::Device::State
              */
@@ -585,6 +614,9 @@ namespace K3b {
              *                    \li 001b - RAW P-W Sub-channel (96 bytes)
              *                    \li 010b - Formatted Q Sub-channel (16 bytes)
              *                    \li 100b - Corrected and de-interleaved R-W Sub-channel (96 bytes)
+             *
+             * @param senseKey:   If not 0 it is set to the sense key of a failed command
+             *                    or -1 if it is not known.
              */
             bool readCd( unsigned char* data,
                          unsigned int dataLen,
@@ -598,7 +630,8 @@ namespace K3b {
                          bool userData,
                          bool edcEcc,
                          int c2,
-                         int subChannel ) const;
+                         int subChannel,
+                         int* senseKey = 0 ) const;
 
             bool read10( unsigned char* data,
                          unsigned int dataLen,
@@ -728,6 +761,35 @@ namespace K3b {
              */
             bool init( bool checkWritingModes = true );
 
+            /**
+             * First step of init(): determine vendor, description, firmware
+             * version and serial number.
+             */
+            bool probeIdentity();
+
+            /**
+             * Second step of init(): probe the features of the drive. This
+             * may take a while with some drives.
+             */
+            void probeCapabilities( bool checkWritingModes );
+
+            /**
+             * Identifies a drive including its firmware. Used by the DeviceManager
+             * to cache the probed capabilities between sessions.
+             */
+            QString capabilityKey() const;
+
+            /**
+             * The probed capabilities in a form suitable for storing.
+             */
+            QMap<QString, QString> capabilities() const;
+
+            /**
+             * Restore the capabilities as returned by capabilities().
+             * \return false if @p caps is incomplete. Nothing is changed in that case.
+             */
+            bool setCapabilities( const QMap<QString, QString>& caps );
+
             void searchIndexTransitions( long start, long end, K3b::Device::Track& track ) const;
             void checkWritingModes();
             void checkFeatures();
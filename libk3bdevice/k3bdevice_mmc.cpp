@@ -36,6 +36,35 @@ bool K3b::Device::Device::testUnitReady() const
 }
 
 
+bool K3b::Device::Device::getMediaEventStatus( int& event, bool& mediaPresent ) const
+{
+    unsigned char data[8];
+    ::memset( data, 0, 8 );
+
+    ScsiCommand cmd( this );
+    cmd.enableErrorMessages( false );
+    cmd[0] = MMC_GET_EVENT_STATUS_NOTIFICATION;
+    cmd[1] = 1;      // polled
+    cmd[4] = 0x10;   // media event class
+    cmd[8] = 8;
+    cmd[9] = 0;      // Necessary to set the proper command length
+    if( cmd.transport( TR_DIR_READ, data, 8 ) )
+        return false;
+
+    // NEA: no event of the requested class available, i.e. the class is not supported
+    if( data[2] & 0x80 )
+        return false;
+
+    // the drive has to return the media class we asked for
+    if( ( data[2] & 0x7 ) != 4 || from2Byte( data ) < 6 )
+        return false;
+
+    event = data[4] & 0xf;
+    mediaPresent = ( data[5] & 0x2 );
+    return true;
+}
+
+
 bool K3b::Device::Device::getFeature( UByteArray& data, unsigned int feature ) const
 {
     unsigned char header[2048];
@@ -409,7 +438,8 @@ bool K3b::Device::Device::readCd( unsigned char* data,
                                 bool userData,
                                 bool edcEcc,
                                 int c2,
-                                int subChannel ) const
+                                int subChannel,
+                                int* senseKey ) const
 {
     ::memset( data, 0, dataLen );
 
@@ -432,11 +462,16 @@ bool K3b::Device::Device::readCd( unsigned char* data,
     cmd[10] = subChannel & 0x7;
     cmd[11] = 0;      // Necessary to set the proper command length
 
-    if( cmd.transport( TR_DIR_READ, data, dataLen ) ) {
+    int err = cmd.transport( TR_DIR_READ, data, dataLen );
+    if( err ) {
         qDebug() << "(K3b::Device::Device) " << blockDeviceName() << ": READ CD failed!";
+        if( senseKey )
+            *senseKey = ( err > 1 ? (err>>16) & 0x0F : -1 );
         return false;
     }
     else {
+        if( senseKey )
+            *senseKey = 0;
         return true;
     }
 }
@@ -34,12 +34,16 @@
 #endif
 
 #include <QDebug>
+#include <QHash>
+#include <QSet>
+#include <QStandardPaths>
 #include <QString>
 #include <QStringList>
 #include <QFile>
 #include <QFileInfo>
 #include <QRegExp>
 #include <QTemporaryFile>
+#include <QThread>
 
 #include <iostream>
 #include <limits.h>
@@ -110,9 +114,51 @@ typedef unsigned char u8;
 
 
 
+namespace {
+    // the probed capabilities are stored in the user's cache directory
+    const char s_capabilityCacheFile[] = "k3bdevicecapabilities";
+}
+
+
+/**
+ * Probing a drive can take several seconds. Thus, every drive is
+ * probed in its own thread.
+ */
+class K3b::Device::DeviceManager::ProbeThread : public QThread
+{
+public:
+    ProbeThread( Device* dev, bool checkWritingModes, const CapabilityCache* cache )
+        : device( dev ),
+          success( false ),
+          usedCache( false ),
+          m_checkWritingModes( checkWritingModes ),
+          m_cache( cache ) {
+    }
+
+    Device* device;
+    bool success;
+    bool usedCache;
+
+protected:
+    void run() override {
+        success = DeviceManager::probeDevice( device, m_checkWritingModes, m_cache, usedCache );
+    }
+
+private:
+    bool m_checkWritingModes;
+    const CapabilityCache* m_cache;
+};
+
+
 class K3b::Device::DeviceManager::Private
 {
 public:
+    Private()
+        : checkWritingModes( true ),
+          capabilityCacheLoaded( false ),
+          capabilityCacheDirty( false ) {
+    }
+
     QList<Device*> allDevices;
     QList<Device*> cdReader;
     QList<Device*> cdWriter;
@@ -122,9 +168,38 @@ public:
     QList<Device*> bdWriter;
 
     bool checkWritingModes;
+
+    // devices probed in parallel by scanBus() waiting for addDevice()
+    QHash<QString, Device*> probedDevices;
+    QSet<QString> failedDevices;
+
+    CapabilityCache capabilityCache;
+    bool capabilityCacheLoaded;
+    bool capabilityCacheDirty;
+
+    void addToLists( Device* device );
 };
 
 
+void K3b::Device::DeviceManager::Private::addToLists( Device* device )
+{
+    // not every drive is able to read CDs
+    // there are some 1st generation DVD writer that cannot
+    if( device->type() & K3b::Device::DEVICE_CD_ROM )
+        cdReader.append( device );
+    if( device->readsDvd() )
+        dvdReader.append( device );
+    if( device->writesCd() )
+        cdWriter.append( device );
+    if( device->writesDvd() )
+        dvdWriter.append( device );
+    if( device->readCapabilities() & MEDIA_BD_ALL )
+        bdReader.append( device );
+    if( device->writeCapabilities() & MEDIA_BD_ALL )
+        bdWriter.append( device );
+}
+
+
 
 K3b::Device::DeviceManager::DeviceManager( QObject* parent )
     : QObject( parent ),
@@ -139,6 +214,7 @@ K3b::Device::DeviceManager::DeviceManager( QObject* parent )
 
 K3b::Device::DeviceManager::~DeviceManager()
 {
+    qDeleteAll( d->probedDevices );
     qDeleteAll( d->allDevices );
     delete d;
 }
@@ -235,12 +311,39 @@ int K3b::Device::DeviceManager::scanBus()
     int cnt = 0;
 
     QList<Solid::Device> dl = Solid::Device::listFromType( Solid::DeviceInterface::OpticalDrive );
+
+    //
+    // Probe all new drives at once. addDevice() picks up the results.
+    //
+    QList<Device*> newDevices;
+    Q_FOREACH( const Solid::Device& solidDev, dl ) {
+        if ( solidDev.is<Solid::OpticalDrive>() && solidDev.is<Solid::Block>() ) {
+            Device* dev = new Device( solidDev );
+            if ( findDevice( dev->blockDeviceName() ) )
+                delete dev;
+            else
+                newDevices.append( dev );
+        }
+    }
+    Q_FOREACH( Device* dev, newDevices ) {
+        d->failedDevices.insert( dev->solidDevice().udi() );
+    }
+    Q_FOREACH( Device* dev, probeDevices( newDevices ) ) {
+        d->failedDevices.remove( dev->solidDevice().udi() );
+        d->probedDevices.insert( dev->solidDevice().udi(), dev );
+    }
+
     Q_FOREACH( const Solid::Device& solidDev, dl ) {
         if ( checkDevice( solidDev ) ) {
             ++cnt;
         }
     }
 
+    // in case a subclass decided not to use some of them
+    qDeleteAll( d->probedDevices );
+    d->probedDevices.clear();
+    d->failedDevices.clear();
+
     return cnt;
 }
 
@@ -362,7 +465,20 @@ K3b::Device::Device* K3b::Device::DeviceManager::addDevice( const Solid::Device&
 #else
         if( !findDevice( solidDevice.as<Solid::GenericInterface>()->propertyExists("block.netbsd.raw_device") ? solidDevice.as<Solid::GenericInterface>()->property("block.netbsd.raw_device").toString() : blockDevice->device() ) )
 #endif
-            return addDevice( new K3b::Device::Device( solidDevice ) );
+        {
+            Device* device = d->probedDevices.take( solidDevice.udi() );
+            if( !device ) {
+                if( d->failedDevices.contains( solidDevice.udi() ) )
+                    return 0;
+
+                // hotplugged device
+                QList<Device*> probed = probeDevices( QList<Device*>() << new Device( solidDevice ) );
+                if( probed.isEmpty() )
+                    return 0;
+                device = probed.first();
+            }
+            return addDevice( device );
+        }
         else
             qDebug() << "(K3b::Device::DeviceManager) dev " << blockDevice->device()  << " already found";
     }
@@ -372,31 +488,9 @@ K3b::Device::Device* K3b::Device::DeviceManager::addDevice( const Solid::Device&
 
 K3b::Device::Device* K3b::Device::DeviceManager::addDevice( K3b::Device::Device* device )
 {
-    const QString devicename = device->blockDeviceName();
-
-    if( !device->init() ) {
-        qDebug() << "Could not initialize device " << devicename;
-        delete device;
-        return 0;
-    }
-
     if( device ) {
         d->allDevices.append( device );
-
-        // not every drive is able to read CDs
-        // there are some 1st generation DVD writer that cannot
-        if( device->type() & K3b::Device::DEVICE_CD_ROM )
-            d->cdReader.append( device );
-        if( device->readsDvd() )
-            d->dvdReader.append( device );
-        if( device->writesCd() )
-            d->cdWriter.append( device );
-        if( device->writesDvd() )
-            d->dvdWriter.append( device );
-        if( device->readCapabilities() & MEDIA_BD_ALL )
-            d->bdReader.append( device );
-        if( device->writeCapabilities() & MEDIA_BD_ALL )
-            d->bdWriter.append( device );
+        d->addToLists( device );
 
         if( device->writesCd() ) {
             // default to max write speed
@@ -435,6 +529,105 @@ void K3b::Device::DeviceManager::removeDevice( const Solid::Device& dev )
 }
 
 
+QList<K3b::Device::Device*> K3b::Device::DeviceManager::probeDevices( const QList<Device*>& devices )
+{
+    if( devices.isEmpty() )
+        return devices;
+
+    loadCapabilityCache();
+
+    QList<ProbeThread*> threads;
+    Q_FOREACH( Device* dev, devices ) {
+        ProbeThread* thread = new ProbeThread( dev, d->checkWritingModes, &d->capabilityCache );
+        thread->start();
+        threads.append( thread );
+    }
+
+    QList<Device*> probed;
+    Q_FOREACH( ProbeThread* thread, threads ) {
+        thread->wait();
+
+        if( !thread->success ) {
+            qDebug() << "Could not initialize device " << thread->device->blockDeviceName();
+            delete thread->device;
+        }
+        else {
+            if( !thread->usedCache ) {
+                QMap<QString, QString> caps = thread->device->capabilities();
+                caps.insert( QLatin1String( "WritingModesChecked" ), QString::number( int( d->checkWritingModes ) ) );
+                d->capabilityCache.insert( thread->device->capabilityKey(), caps );
+                d->capabilityCacheDirty = true;
+            }
+            probed.append( thread->device );
+        }
+
+        delete thread;
+    }
+
+    saveCapabilityCache();
+
+    return probed;
+}
+
+
+bool K3b::Device::DeviceManager::probeDevice( Device* dev, bool checkWritingModes, const CapabilityCache* cache, bool& usedCache )
+{
+    qDebug() << "(K3b::Device::DeviceManager) probing" << dev->blockDeviceName();
+
+    usedCache = false;
+
+    if( !dev->probeIdentity() )
+        return false;
+
+    if( cache ) {
+        // entries probed without the writing mode check do not help if it is requested now
+        CapabilityCache::const_iterator it = cache->constFind( dev->capabilityKey() );
+        if( it != cache->constEnd() &&
+            ( !checkWritingModes || it->value( QLatin1String( "WritingModesChecked" ) ) == QLatin1String( "1" ) ) &&
+            dev->setCapabilities( *it ) ) {
+            qDebug() << "(K3b::Device::DeviceManager) using cached capabilities for" << dev->capabilityKey();
+            usedCache = true;
+        }
+    }
+
+    if( !usedCache )
+        dev->probeCapabilities( checkWritingModes );
+
+    return dev->furtherInit();
+}
+
+
+void K3b::Device::DeviceManager::loadCapabilityCache()
+{
+    if( d->capabilityCacheLoaded )
+        return;
+    d->capabilityCacheLoaded = true;
+
+    KConfig c( QLatin1String( s_capabilityCacheFile ), KConfig::SimpleConfig, QStandardPaths::GenericCacheLocation );
+    Q_FOREACH( const QString& key, c.groupList() ) {
+        d->capabilityCache.insert( key, c.group( key ).entryMap() );
+    }
+}
+
+
+void K3b::Device::DeviceManager::saveCapabilityCache()
+{
+    if( !d->capabilityCacheDirty )
+        return;
+    d->capabilityCacheDirty = false;
+
+    KConfig c( QLatin1String( s_capabilityCacheFile ), KConfig::SimpleConfig, QStandardPaths::GenericCacheLocation );
+    for( CapabilityCache::const_iterator it = d->capabilityCache.constBegin();
+         it != d->capabilityCache.constEnd(); ++it ) {
+        KConfigGroup group = c.group( it.key() );
+        for( QMap<QString, QString>::const_iterator entry = it->constBegin(); entry != it->constEnd(); ++entry ) {
+            group.writeEntry( entry.key(), entry.value() );
+        }
+    }
+    c.sync();
+}
+
+
 void K3b::Device::DeviceManager::slotSolidDeviceAdded( const QString& udi )
 {
     qDebug() << udi;
@@ -19,6 +19,8 @@
 #include "k3bdevice_export.h"
 
 #include <QDebug>
+#include <QHash>
+#include <QMap>
 #include <QObject>
 #include <QString>
 
@@ -214,10 +216,25 @@ namespace K3b {
             class Private;
             Private* const d;
 
+            class ProbeThread;
+            typedef QHash<QString, QMap<QString, QString> > CapabilityCache;
+
             /**
-             * Add a device to the managers device lists and initialize the device.
+             * Add an initialized device to the managers device lists.
              */
             Device *addDevice( Device* );
+
+            /**
+             * Probes all devices in parallel, one thread per device. Capabilities
+             * found in the cache are used as is. The cache key contains vendor, model,
+             * firmware version and serial number, so a changed drive is probed again.
+             *
+             * \return The devices which could be initialized. The others are deleted.
+             */
+            QList<Device*> probeDevices( const QList<Device*>& devices );
+            static bool probeDevice( Device* dev, bool checkWritingModes, const CapabilityCache* cache, bool& usedCache );
+            void loadCapabilityCache();
+            void saveCapabilityCache();
         };
     }
 }
@@ -165,10 +165,10 @@ int K3b::Device::ScsiCommand::transport( TransportDirection dir,
                     d->sense.ascq );
 
         int errCode =
-            ((d->sense.error_code<<24) & 0xF000) |
-            ((d->sense.sense_key<<16)  & 0x0F00) |
-            ((d->sense.asc<<8)         & 0x00F0) |
-            ((d->sense.ascq)           & 0x000F);
+            ((d->sense.error_code & 0x7F)<<24) |
+            ((d->sense.sense_key  & 0x0F)<<16) |
+            ((d->sense.asc        & 0xFF)<<8)  |
+            ((d->sense.ascq)      & 0xFF);
 
         return( errCode != 0 ? errCode : 1 );
     }
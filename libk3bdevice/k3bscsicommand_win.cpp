@@ -106,10 +106,10 @@ int K3b::Device::ScsiCommand::transport( TransportDirection dir,
             d->m_senseData.SD_ASCQ );
 
         int errCode =
-            (d->m_senseData.SD_Error << 24)    & 0xF000 |
-            (d->m_senseData.SD_SenseKey << 16) & 0x0F00 |
-            (d->m_senseData.SD_ASC << 8)       & 0x00F0 |
-            (d->m_senseData.SD_ASCQ)           & 0x000F;
+            ((d->m_senseData.SD_Error & 0x7F)    << 24) |
+            ((d->m_senseData.SD_SenseKey & 0x0F) << 16) |
+            ((d->m_senseData.SD_ASC & 0xFF)      << 8)  |
+            ((d->m_senseData.SD_ASCQ)            & 0xFF);
 
         return ( errCode != 0 ? errCode : 1 );
     }
@@ -23,6 +23,7 @@
 #include "k3bcuefileparser.h"
 #include "k3bdatadoc.h"
 #include "k3bdataview.h"
+#include "k3bdevicemanager.h"
 #include "k3bdeviceselectiondialog.h"
 #include "k3bdirview.h"
 #include "k3bexternalbinmanager.h"
@@ -31,6 +32,7 @@
 #include "k3binterface.h"
 #include "k3biso9660.h"
 #include "k3bjob.h"
+#include "k3bjobprogressdialog.h"
 #include "k3bmediacache.h"
 #include "k3bmediaselectiondialog.h"
 #include "k3bmedium.h"
@@ -60,6 +62,7 @@
 #include "misc/k3bimagewritingdialog.h"
 #include "misc/k3bmediacopydialog.h"
 #include "misc/k3bmediaformattingdialog.h"
+#include "rip/k3bbatchaudioripjob.h"
 #include "option/k3boptiondialog.h"
 #include "projects/k3bdatamultisessionimportdialog.h"
 
@@ -423,6 +426,12 @@ void K3b::MainWindow::initActions()
     actionCollection()->addAction( "tools_cdda_rip", actionToolsCddaRip );
     connect( actionToolsCddaRip, SIGNAL(triggered(bool)), this, SLOT(slotCddaRip()) );
 
+    QAction* actionToolsCddaBatchRip = new QAction( QIcon::fromTheme( "tools-rip-audio-cd" ), i18n("Rip Audio CDs in All Drives..."), this );
+    actionToolsCddaBatchRip->setToolTip( i18n("Rip the audio CDs inserted into all drives at the same time") );
+    actionToolsCddaBatchRip->setStatusTip( actionToolsCddaBatchRip->toolTip() );
+    actionCollection()->addAction( "tools_cdda_batch_rip", actionToolsCddaBatchRip );
+    connect( actionToolsCddaBatchRip, SIGNAL(triggered(bool)), this, SLOT(slotCddaBatchRip()) );
+
     QAction* actionToolsVideoDvdRip = new QAction( QIcon::fromTheme( "tools-rip-video-dvd" ), i18n("Rip Video DVD..."), this );
     actionToolsVideoDvdRip->setToolTip( i18n("Transcode Video DVD titles") );
     actionToolsVideoDvdRip->setStatusTip( actionToolsVideoDvdRip->toolTip() );
@@ -1484,6 +1493,29 @@ void K3b::MainWindow::cddaRip( K3b::Device::Device* dev )
 }
 
 
+void K3b::MainWindow::slotCddaBatchRip()
+{
+    QList<K3b::Device::Device*> devices;
+    Q_FOREACH( K3b::Device::Device* dev, k3bcore->deviceManager()->cdReader() ) {
+        if( !k3bappcore->mediaCache()->isBlocked( dev ) )
+            devices.append( dev );
+    }
+
+    if( devices.isEmpty() ) {
+        KMessageBox::sorry( this, i18n("No CD drive is available.") );
+        return;
+    }
+
+    // the batch uses the settings last used in the ripping dialog
+    K3b::JobProgressDialog ripDialog( this, "Ripping" );
+    K3b::BatchAudioRipJob job( &ripDialog, this );
+    job.setDevices( devices );
+    job.setContinuous( true );
+    job.loadSettings( KConfigGroup( config(), "Audio Ripping" ) );
+    ripDialog.startJob( &job );
+}
+
+
 void K3b::MainWindow::videoDvdRip( K3b::Device::Device* dev )
 {
     if( !dev ||
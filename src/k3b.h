@@ -92,6 +92,7 @@ namespace K3b {
         void slotMediaCopy();
         void cddaRip( K3b::Device::Device* );
         void slotCddaRip();
+        void slotCddaBatchRip();
         void videoDvdRip( K3b::Device::Device* );
         void slotVideoDvdRip();
         void videoCdRip( K3b::Device::Device* );
@@ -0,0 +1,68 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bappjobqueuefactory.h"
+#include "k3bapplication.h"
+#include "k3bprojectmanager.h"
+#include "rip/k3bbatchaudioripjob.h"
+
+#include "k3bcore.h"
+#include "k3bdevicemanager.h"
+#include "k3bdoc.h"
+#include "k3bjob.h"
+
+#include <KConfigCore/KConfigGroup>
+#include <KConfigCore/KSharedConfig>
+
+#include <QDebug>
+#include <QUrl>
+
+
+K3b::Job* K3b::AppJobQueueFactory::createJob( QueuedJob& entry, const QString& device, JobHandler* handler, QObject* parent )
+{
+    Device::Device* dev = k3bcore->deviceManager()->findDevice( device );
+    if( !dev )
+        return 0;
+
+    if( entry.type == QueuedJob::Burn &&
+        entry.source.endsWith( QLatin1String( ".k3b" ), Qt::CaseInsensitive ) ) {
+        Doc* doc = k3bappcore->projectManager()->loadProject( QUrl::fromLocalFile( entry.source ) );
+        if( !doc ) {
+            qDebug() << "(K3b::AppJobQueueFactory) could not load" << entry.source;
+            return 0;
+        }
+
+        doc->setBurner( dev );
+        if( entry.options.contains( QLatin1String( "speed" ) ) )
+            doc->setSpeed( entry.options.value( QLatin1String( "speed" ) ).toInt() );
+        if( entry.options.contains( QLatin1String( "simulate" ) ) )
+            doc->setDummy( entry.options.value( QLatin1String( "simulate" ) ) == QLatin1String( "true" ) );
+
+        if( entry.size <= 0 )
+            entry.size = doc->burningSize();
+
+        BurnJob* job = doc->newBurnJob( handler, parent );
+
+        // the project lives as long as its job
+        QObject::connect( job, SIGNAL(destroyed()), doc, SLOT(deleteLater()) );
+        return job;
+    }
+    else if( entry.type == QueuedJob::Rip ) {
+        BatchAudioRipJob* job = new BatchAudioRipJob( handler, parent );
+        job->setDevices( QList<Device::Device*>() << dev );
+        job->setContinuous( false );
+        job->loadSettings( KConfigGroup( KSharedConfig::openConfig(), "Audio Ripping" ) );
+        return job;
+    }
+
+    return JobQueueFactory::defaultFactory()->createJob( entry, device, handler, parent );
+}
@@ -0,0 +1,35 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_APP_JOB_QUEUE_FACTORY_H_
+#define _K3B_APP_JOB_QUEUE_FACTORY_H_
+
+#include "k3bjobqueue.h"
+
+
+namespace K3b {
+    /**
+     * Adds project files and audio CD ripping to the default
+     * job queue factory.
+     *
+     * Projects are loaded without being shown and are burned with the
+     * settings saved in the project file. Ripping uses the settings last
+     * used in the ripping dialog.
+     */
+    class AppJobQueueFactory : public JobQueueFactory
+    {
+    public:
+        Job* createJob( QueuedJob& entry, const QString& device, JobHandler* handler, QObject* parent );
+    };
+}
+
+#endif
@@ -19,12 +19,13 @@
 #include "k3bsplash.h"
 #include "k3bprojectmanager.h"
 #include "k3bappdevicemanager.h"
+#include "k3bappjobqueuefactory.h"
 #include "k3blsofwrapperdialog.h"
 #include "config-k3b.h"
 
 #include "k3bcore.h"
 #include "k3bdevicemanager.h"
-#include "k3bthread.h"
+#include "k3bworkerpool.h"
 #ifdef ENABLE_HAL_SUPPORT
 #include "k3bhalconnection.h"
 #endif
@@ -40,6 +41,7 @@
 #include "k3bmovixprogram.h"
 #include "k3bview.h"
 #include "k3bjob.h"
+#include "k3bjobqueue.h"
 #include "k3bmediacache.h"
 
 #include <KConfigCore/KConfig>
@@ -212,6 +214,17 @@ void K3b::Application::processCmdLineArgs()
         m_mainWindow->videoCdRip( m_core->deviceManager()->findDeviceByUdi(  m_cmdLine->value( "videocdrip" ) ) );
     }
 
+    // queued jobs run without any dialogs
+    if( m_cmdLine->isSet( "queue" ) ) {
+        JobQueue* queue = m_core->jobQueue();
+        Q_FOREACH( const QString& url, m_cmdLine->values( "queue" ) ) {
+            const QString path = QUrl::fromUserInput( url ).toLocalFile();
+            if( !path.isEmpty() )
+                queue->submit( QueuedJob( QueuedJob::Burn, path ) );
+        }
+        queue->start();
+    }
+
     if( !dialogOpen && m_cmdLine->isSet( "burn" ) ) {
         if( m_core->projectManager()->activeDoc() ) {
             dialogOpen = true;
@@ -226,7 +239,7 @@ void K3b::Application::processCmdLineArgs()
 void K3b::Application::slotShutDown()
 {
     k3bcore->mediaCache()->clearDeviceList();
-    Thread::waitUntilFinished();
+    WorkerPool::instance()->waitForDone();
 }
 
 
@@ -237,6 +250,7 @@ K3b::Application::Core::Core( QObject* parent )
     s_k3bAppCore = this;
     m_themeManager = new ThemeManager( this );
     m_projectManager = new ProjectManager( this );
+    m_jobQueueFactory = new AppJobQueueFactory();
     // we need the themes on startup (loading them is fast anyway :)
     m_themeManager->loadThemes();
 }
@@ -244,6 +258,7 @@ K3b::Application::Core::Core( QObject* parent )
 
 K3b::Application::Core::~Core()
 {
+    delete m_jobQueueFactory;
 }
 
 
@@ -254,7 +269,6 @@ void K3b::Application::Core::init()
     // the default programs handled by K3b::Core
     //
     externalBinManager()->addProgram( new MovixProgram() );
-    externalBinManager()->addProgram( new NormalizeProgram() );
     addTranscodePrograms( externalBinManager() );
     addVcdimagerPrograms( externalBinManager() );
 
@@ -264,6 +278,9 @@ void K3b::Application::Core::init()
              mediaCache(), SLOT(buildDeviceList(K3b::Device::DeviceManager*)) );
     // FIXME: move this to libk3b
     appDeviceManager()->setMediaCache( mediaCache() );
+
+    // the queue handles projects and ripping through the application
+    jobQueue()->setJobFactory( m_jobQueueFactory );
 }
 
 
@@ -32,6 +32,7 @@ namespace K3b {
     class ThemeManager;
     class ProjectManager;
     class AppDeviceManager;
+    class AppJobQueueFactory;
 
     class Application : public QApplication
     {
@@ -109,6 +110,7 @@ namespace K3b {
         ThemeManager* m_themeManager;
         MainWindow* m_mainWindow;
         ProjectManager* m_projectManager;
+        AppJobQueueFactory* m_jobQueueFactory;
 
         QMap<Device::Device*, int> m_deviceBlockMap;
 
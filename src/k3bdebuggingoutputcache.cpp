@@ -25,25 +25,158 @@
 #include <KLocalizedString>
 #include <kcoreaddons_version.h>
 
+#include <QDateTime>
+#include <QList>
+#include <QVector>
+
+#include <string.h>
+
+
+namespace {
+    const qint64 s_defaultMemoryLimit = 10*1024*1024; // 10 MB max cache size
+    const int s_chunkSize = 64*1024;
+
+    class Entry
+    {
+    public:
+        qint64 time;
+        int offset;
+        int length;
+        int repeated;
+    };
+
+    class Chunk
+    {
+    public:
+        QByteArray data;
+        QVector<Entry> entries;
+
+        qint64 memoryUsage() const {
+            return data.capacity() + entries.capacity()*sizeof(Entry);
+        }
+    };
+
+    class Group
+    {
+    public:
+        Group()
+            : droppedLines( 0 ) {
+        }
+
+        QList<Chunk> chunks;
+        qint64 droppedLines;
+    };
+}
 
-static const int s_maxCache = 10*1024*1024; // 10 MB max cache size
 
 class K3b::DebuggingOutputCache::Private
 {
 public:
     Private()
         : stderrEnabled( false ),
-          cacheSize( 0 ) {
+          memoryLimit( s_defaultMemoryLimit ),
+          memoryUsage( 0 ) {
     }
 
+    bool isRepetition( const Group& group, const QByteArray& line ) const;
+    void append( Group& group, const QByteArray& line );
+    void dropOldest( Group& group );
+    void enforceLimit( Group& current );
+    QString formatGroup( const Group& group ) const;
+
     bool stderrEnabled;
-    QMap<QString, QString> groups;
-    QMap<QString, QString> lastMessages;
-    QMap<QString, int> lastMessageCount;
-    int cacheSize;
+    QMap<QString, Group> groups;
+    qint64 memoryLimit;
+    qint64 memoryUsage;
 };
 
 
+bool K3b::DebuggingOutputCache::Private::isRepetition( const Group& group, const QByteArray& line ) const
+{
+    if( group.chunks.isEmpty() || group.chunks.last().entries.isEmpty() )
+        return false;
+
+    const Chunk& chunk = group.chunks.last();
+    const Entry& last = chunk.entries.last();
+    return( last.length == line.length() &&
+            ::memcmp( chunk.data.constData() + last.offset, line.constData(), line.length() ) == 0 );
+}
+
+
+void K3b::DebuggingOutputCache::Private::append( Group& group, const QByteArray& line )
+{
+    if( group.chunks.isEmpty() ||
+        group.chunks.last().data.size() + line.size() > s_chunkSize ) {
+        group.chunks.append( Chunk() );
+        group.chunks.last().data.reserve( qMax( s_chunkSize, line.size() ) );
+    }
+
+    Chunk& chunk = group.chunks.last();
+    const qint64 oldUsage = chunk.memoryUsage();
+
+    Entry e;
+    e.time = QDateTime::currentMSecsSinceEpoch();
+    e.offset = chunk.data.size();
+    e.length = line.size();
+    e.repeated = 1;
+    chunk.data.append( line );
+    chunk.entries.append( e );
+
+    memoryUsage += chunk.memoryUsage() - oldUsage;
+}
+
+
+void K3b::DebuggingOutputCache::Private::dropOldest( Group& group )
+{
+    const Chunk& chunk = group.chunks.first();
+    memoryUsage -= chunk.memoryUsage();
+    group.droppedLines += chunk.entries.count();
+    group.chunks.removeFirst();
+}
+
+
+void K3b::DebuggingOutputCache::Private::enforceLimit( Group& current )
+{
+    while( memoryUsage > memoryLimit ) {
+        // the group which produces the output pays for it. Its last
+        // chunk is always kept.
+        if( current.chunks.count() > 1 ) {
+            dropOldest( current );
+            continue;
+        }
+
+        // otherwise take from the biggest group
+        Group* biggest = 0;
+        for( QMap<QString, Group>::iterator it = groups.begin(); it != groups.end(); ++it ) {
+            if( it->chunks.count() > 1 && ( !biggest || it->chunks.count() > biggest->chunks.count() ) )
+                biggest = &it.value();
+        }
+        if( !biggest )
+            break;
+        dropOldest( *biggest );
+    }
+}
+
+
+QString K3b::DebuggingOutputCache::Private::formatGroup( const Group& group ) const
+{
+    QString s;
+    if( group.droppedLines > 0 )
+        s.append( QString( "=== K3b debugging output cache overflow: %1 older lines dropped ===\n" ).arg( group.droppedLines ) );
+
+    Q_FOREACH( const Chunk& chunk, group.chunks ) {
+        Q_FOREACH( const Entry& e, chunk.entries ) {
+            s.append( QDateTime::fromMSecsSinceEpoch( e.time ).toString( "hh:mm:ss.zzz " ) );
+            s.append( QString::fromUtf8( chunk.data.constData() + e.offset, e.length ) );
+            s.append( '\n' );
+            if( e.repeated > 1 )
+                s.append( QString( "=== last message repeated %1 times. ===\n" ).arg( e.repeated ) );
+        }
+    }
+    return s;
+}
+
+
 K3b::DebuggingOutputCache::DebuggingOutputCache()
     : d( new Private() )
 {
@@ -59,9 +192,7 @@ K3b::DebuggingOutputCache::~DebuggingOutputCache()
 void K3b::DebuggingOutputCache::clear()
 {
     d->groups.clear();
-    d->lastMessages.clear();
-    d->lastMessageCount.clear();
-    d->cacheSize = 0;
+    d->memoryUsage = 0;
 
     if (k3bcore == Q_NULLPTR)
        return; 
@@ -89,25 +220,15 @@ void K3b::DebuggingOutputCache::clear()
 
 void K3b::DebuggingOutputCache::addOutput( const QString& group, const QString& line )
 {
-    if ( d->lastMessages[group] == line ) {
-        d->lastMessageCount[group]++;
+    Group& g = d->groups[group];
+    const QByteArray utf8 = line.toUtf8();
+
+    if( d->isRepetition( g, utf8 ) ) {
+        g.chunks.last().entries.last().repeated++;
     }
     else {
-        if ( d->lastMessageCount.contains( group ) &&
-             d->lastMessageCount[group] > 1 ) {
-            d->groups[group].append( QString( "=== last message repeated %1 times. ===\n" ).arg( d->lastMessageCount[group]   ) );
-        }
-        d->lastMessageCount[group] = 1;
-        d->lastMessages[group] = line;
-
-        d->cacheSize += line.length();
-        if ( d->cacheSize > s_maxCache &&
-            d->cacheSize - ( int )line.length() <= s_maxCache ) {
-            d->groups[defaultGroup()].append( "=== K3b debugging output cache overflow ===\n" );
-        }
-        else if ( d->cacheSize <= s_maxCache ) {
-            d->groups[group].append( line + '\n' );
-        }
+        d->append( g, utf8 );
+        d->enforceLimit( g );
     }
 }
 
@@ -122,13 +243,13 @@ K3b::DebuggingOutputCache& K3b::DebuggingOutputCache::operator<<( const QString&
 QString K3b::DebuggingOutputCache::toString() const
 {
     QString s;
-    for ( QMap<QString, QString>::const_iterator it = d->groups.constBegin();
+    for ( QMap<QString, Group>::const_iterator it = d->groups.constBegin();
           it != d->groups.constEnd(); ++it ) {
         if ( !s.isEmpty() )
             s.append( '\n' );
         s.append( it.key() + '\n' );
         s.append( "-----------------------\n" );
-        s.append( *it );
+        s.append( d->formatGroup( *it ) );
     }
     return s;
 }
@@ -136,7 +257,12 @@ QString K3b::DebuggingOutputCache::toString() const
 
 QMap<QString, QString> K3b::DebuggingOutputCache::toGroups() const
 {
-    return d->groups;
+    QMap<QString, QString> groups;
+    for ( QMap<QString, Group>::const_iterator it = d->groups.constBegin();
+          it != d->groups.constEnd(); ++it ) {
+        groups.insert( it.key(), d->formatGroup( *it ) );
+    }
+    return groups;
 }
 
 
@@ -152,6 +278,24 @@ void K3b::DebuggingOutputCache::enableStderr( bool b )
 }
 
 
+void K3b::DebuggingOutputCache::setMemoryLimit( qint64 bytes )
+{
+    d->memoryLimit = bytes;
+}
+
+
+qint64 K3b::DebuggingOutputCache::memoryLimit() const
+{
+    return d->memoryLimit;
+}
+
+
+qint64 K3b::DebuggingOutputCache::memoryUsage() const
+{
+    return d->memoryUsage;
+}
+
+
 QString K3b::DebuggingOutputCache::defaultGroup()
 {
     return "Misc";
@@ -25,6 +25,11 @@ namespace K3b {
      * Class to cache the debug output and make sure we do not eat all the
      * memory by restricting the memory used and ignoring multiple identical
      * messages.
+     *
+     * Each group keeps its lines UTF-8 encoded in chunks. Once the memory
+     * limit is reached the oldest chunks are dropped, so the cache always
+     * contains the most recent output. Timestamps, repetition counts and
+     * group headers are only formatted when the output is requested.
      */
     class DebuggingOutputCache
     {
@@ -44,6 +49,14 @@ namespace K3b {
         bool stderrEnabled() const;
         void enableStderr( bool b );
 
+        /**
+         * The maximum number of bytes used to store the output.
+         * Default is 10 MB.
+         */
+        void setMemoryLimit( qint64 bytes );
+        qint64 memoryLimit() const;
+        qint64 memoryUsage() const;
+
         static QString defaultGroup();
 
     private:
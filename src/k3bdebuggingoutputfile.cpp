@@ -23,9 +23,9 @@
 
 #include <kcoreaddons_version.h>
 
+#include <QDateTime>
 #include <QDir>
 #include <QStandardPaths>
-#include <QTextStream>
 
 
 namespace
@@ -44,6 +44,12 @@ K3b::DebuggingOutputFile::DebuggingOutputFile()
 }
 
 
+K3b::DebuggingOutputFile::~DebuggingOutputFile()
+{
+    close();
+}
+
+
 bool K3b::DebuggingOutputFile::open( OpenMode mode )
 {
     if( !QFile::open( mode|WriteOnly|Unbuffered ) )
@@ -74,9 +80,15 @@ void K3b::DebuggingOutputFile::addOutput( const QString& app, const QString& msg
     if( !isOpen() )
         open();
 
-    QTextStream s( this );
-    s << "[" << app << "] " << msg << endl;
-    flush();
-}
+    // one write per line so the output right before a crash is not lost
+    m_line.resize( 0 );
+    m_line += QDateTime::currentDateTime().toString( "hh:mm:ss.zzz " ).toLatin1();
+    m_line += '[';
+    m_line += app.toUtf8();
+    m_line += "] ";
+    m_line += msg.toUtf8();
+    m_line += '\n';
 
+    write( m_line );
+}
 
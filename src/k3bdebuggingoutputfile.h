@@ -19,12 +19,17 @@
 #include <QObject>
 
 namespace K3b {
+    /**
+     * The debugging output is streamed to the file. Every line is written
+     * right away so the log is complete even if K3b crashes.
+     */
     class DebuggingOutputFile : public QFile
     {
         Q_OBJECT
 
     public:
         DebuggingOutputFile();
+        ~DebuggingOutputFile() override;
 
         /**
          * Open the default output file and write some system information.
@@ -33,6 +38,10 @@ namespace K3b {
 
     public Q_SLOTS:
         void addOutput( const QString&, const QString& );
+
+    private:
+        // reused for every line
+        QByteArray m_line;
     };
 }
 
@@ -351,7 +351,8 @@ QString K3b::DiskInfoView::createMediaInfoItems( const K3b::Medium& medium )
 
     if( info.mediaType() & K3b::Device::MEDIA_WRITABLE ) {
         QString speedStr;
-        if( medium.writingSpeeds().isEmpty() ) {
+        // the speeds are determined in the background, we are updated once they are known
+        if( !medium.isFetched( K3b::Medium::InfoWritingSpeeds ) || medium.writingSpeeds().isEmpty() ) {
             speedStr = '-';
         }
         else {
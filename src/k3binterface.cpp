@@ -22,6 +22,7 @@
 #include "k3bdevicemanager.h"
 #include "k3bdoc.h"
 #include "k3bglobals.h"
+#include "k3bjobqueue.h"
 #include "k3bprojectmanager.h"
 #include "k3bview.h"
 
@@ -212,6 +213,66 @@ bool Interface::blocked() const
     return k3bcore->jobsRunning();
 }
 
+
+QString Interface::queueBurn( const QString& url, int priority )
+{
+    QueuedJob entry( QueuedJob::Burn, QUrl::fromUserInput( url ).toLocalFile() );
+    entry.priority = priority;
+    return k3bcore->jobQueue()->submit( entry );
+}
+
+
+QString Interface::queueCopy( const QString& sourceDev, int priority )
+{
+    QueuedJob entry( QueuedJob::Copy, sourceDev );
+    entry.priority = priority;
+    return k3bcore->jobQueue()->submit( entry );
+}
+
+
+QString Interface::queueRip( const QString& dev, int priority )
+{
+    QueuedJob entry( QueuedJob::Rip, QString() );
+    entry.priority = priority;
+    if( !dev.isEmpty() )
+        entry.devices << dev;
+    return k3bcore->jobQueue()->submit( entry );
+}
+
+
+QString Interface::queueFormat( const QString& dev, int priority )
+{
+    QueuedJob entry( QueuedJob::Format, QString() );
+    entry.priority = priority;
+    if( !dev.isEmpty() )
+        entry.devices << dev;
+    return k3bcore->jobQueue()->submit( entry );
+}
+
+
+void Interface::startQueue()
+{
+    k3bcore->jobQueue()->start();
+}
+
+
+void Interface::pauseQueue()
+{
+    k3bcore->jobQueue()->pause();
+}
+
+
+int Interface::queueDepth() const
+{
+    return k3bcore->jobQueue()->queueDepth();
+}
+
+
+double Interface::queueThroughput() const
+{
+    return k3bcore->jobQueue()->throughput();
+}
+
 } // namespace K3b
 
 
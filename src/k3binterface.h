@@ -81,6 +81,32 @@ namespace K3b {
         */
         bool blocked() const;
 
+        /**
+        * Add an entry to the job queue. Queued jobs run without any dialogs.
+        * Devices are given by their block device name.
+        * @return The id of the new entry.
+        */
+        QString queueBurn( const QString& url, int priority );
+        QString queueCopy( const QString& sourceDev, int priority );
+        QString queueRip( const QString& dev, int priority );
+        QString queueFormat( const QString& dev, int priority );
+
+        /**
+        * Start or pause processing the job queue.
+        */
+        void startQueue();
+        void pauseQueue();
+
+        /**
+        * @return the number of entries waiting for a device.
+        */
+        int queueDepth() const;
+
+        /**
+        * @return bytes per second processed by the queue during the last hour.
+        */
+        double queueThroughput() const;
+
     private:
         MainWindow* m_main;
     };
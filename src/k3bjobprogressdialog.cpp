@@ -22,6 +22,7 @@
 #include "k3bthemedlabel.h"
 #include "k3b.h"
 #include "k3bjob.h"
+#include "k3bjobtelemetry.h"
 #include "k3bdevice.h"
 #include "k3bdevicemanager.h"
 #include "k3bdeviceglobals.h"
@@ -44,6 +45,7 @@
 
 #include <QDebug>
 #include <QDateTime>
+#include <QDir>
 #include <QString>
 #include <QCloseEvent>
 #include <QIcon>
@@ -57,6 +59,7 @@
 #include <QProgressBar>
 #include <QPushButton>
 #include <QScrollBar>
+#include <QStandardPaths>
 #include <QTreeWidget>
 #include <QVBoxLayout>
 
@@ -69,6 +72,8 @@ public:
     QFrame* headerFrame;
     QFrame* progressHeaderFrame;
     QTreeWidget* viewInfo;
+
+    JobTelemetry* telemetry;
 };
 
 
@@ -78,6 +83,7 @@ K3b::JobProgressDialog::JobProgressDialog( QWidget* parent,
     : QDialog( parent )
 {
     d = new Private;
+    d->telemetry = new JobTelemetry( this );
     setupGUI();
 
     if( !showSubProgress ) {
@@ -369,6 +375,14 @@ void K3b::JobProgressDialog::slotFinished( bool success )
 
     m_logFile.close();
 
+    // keep the buffer and speed timeline of the last burn next to the log file
+    if( d->telemetry->hasData() ) {
+        QString dirPath = QStandardPaths::writableLocation( QStandardPaths::DataLocation );
+        QDir().mkpath( dirPath );
+        d->telemetry->save( dirPath + "/lastburn.telemetry.json" );
+        d->telemetry->save( dirPath + "/lastburn.telemetry.csv" );
+    }
+
     const KColorScheme colorScheme( QPalette::Normal, KColorScheme::Window );
     QPalette taskPalette( m_labelTask->palette() );
 
@@ -450,6 +464,7 @@ void K3b::JobProgressDialog::setJob( K3b::Job* job )
     if( m_job )
         disconnect( m_job );
     m_job = job;
+    d->telemetry->setJob( job );
 
     if( job ) {
         qDebug() << "connecting";
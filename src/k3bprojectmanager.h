@@ -48,6 +48,13 @@ namespace K3b {
          */
         Doc* openProject( const QUrl &url );
 
+        /**
+         * Loads a K3b project without adding it to the open projects.
+         * The caller takes ownership of the returned project.
+         * \return 0 if url does not point to a valid k3b project file.
+         */
+        Doc* loadProject( const QUrl &url );
+
         /**
          * saves the document under filename and format.
          */
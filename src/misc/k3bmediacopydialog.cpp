@@ -110,9 +110,11 @@ K3b::MediaCopyDialog::MediaCopyDialog( QWidget *parent )
     pixLabel->setScaledContents( false );
     m_spinCopies = new QSpinBox( groupCopies );
     m_spinCopies->setRange( 1, 999 );
-    QHBoxLayout* groupCopiesLayout = new QHBoxLayout( groupCopies );
-    groupCopiesLayout->addWidget( pixLabel );
-    groupCopiesLayout->addWidget( m_spinCopies );
+    m_checkAllWriters = new QCheckBox( i18n("Write to all writers"), groupCopies );
+    QGridLayout* groupCopiesLayout = new QGridLayout( groupCopies );
+    groupCopiesLayout->addWidget( pixLabel, 0, 0 );
+    groupCopiesLayout->addWidget( m_spinCopies, 0, 1 );
+    groupCopiesLayout->addWidget( m_checkAllWriters, 1, 0, 1, 2 );
 
     QGroupBox* groupOptions = new QGroupBox( i18n("Settings"), optionTab );
     m_checkSimulate = K3b::StdGuiItems::simulateCheckbox( groupOptions );
@@ -207,10 +209,12 @@ K3b::MediaCopyDialog::MediaCopyDialog( QWidget *parent )
     connect( m_checkOnlyCreateImage, SIGNAL(toggled(bool)), this, SLOT(slotToggleAll()) );
     connect( m_comboCopyMode, SIGNAL(activated(int)), this, SLOT(slotToggleAll()) );
     connect( m_checkReadCdText, SIGNAL(toggled(bool)), this, SLOT(slotToggleAll()) );
+    connect( m_checkAllWriters, SIGNAL(toggled(bool)), this, SLOT(slotToggleAll()) );
 
     m_checkIgnoreDataReadErrors->setToolTip( i18n("Skip unreadable data sectors") );
     m_checkNoCorrection->setToolTip( i18n("Disable the source drive's error correction") );
     m_checkReadCdText->setToolTip( i18n("Copy CD-Text from the source CD if available.") );
+    m_checkAllWriters->setToolTip( i18n("Write each copy to all writers containing an empty medium at the same time") );
 
     m_checkNoCorrection->setWhatsThis( i18n("<p>If this option is checked K3b will disable the "
                                             "source drive's ECC/EDC error correction. This way sectors "
@@ -222,6 +226,10 @@ K3b::MediaCopyDialog::MediaCopyDialog( QWidget *parent )
                                           "to stick to CDDB info.") );
     m_checkIgnoreDataReadErrors->setWhatsThis( i18n("<p>If this option is checked and K3b is not able to read a data sector from the "
                                                     "source medium it will be replaced with zeros on the resulting copy.") );
+    m_checkAllWriters->setWhatsThis( i18n("<p>If this option is checked K3b writes each copy to the selected writer and "
+                                          "to all other writers which contain a suitable empty medium at the same time. "
+                                          "The source medium is read into an image once."
+                                          "<p>Of CDs only single session data CDs can be copied this way.") );
 
     m_comboCopyMode->setWhatsThis(
         "<p><b>" + i18n("Normal Copy") + "</b>"
@@ -345,6 +353,8 @@ void K3b::MediaCopyDialog::slotStartClicked()
         job->setIgnoreAudioReadErrors( m_checkIgnoreAudioReadErrors->isChecked() );
         job->setNoCorrection( m_checkNoCorrection->isChecked() );
         job->setWritingMode( m_writingModeWidget->writingMode() );
+        if( m_checkAllWriters->isEnabled() && m_checkAllWriters->isChecked() )
+            job->setAdditionalWriterDevices( additionalWriters() );
 
         burnJob = job;
     }
@@ -364,6 +374,8 @@ void K3b::MediaCopyDialog::slotStartClicked()
         job->setIgnoreReadErrors( m_checkIgnoreDataReadErrors->isChecked() );
         job->setReadRetries( m_spinDataRetries->value() );
         job->setVerifyData( m_checkVerifyData->isChecked() );
+        if( m_checkAllWriters->isEnabled() && m_checkAllWriters->isChecked() )
+            job->setAdditionalWriterDevices( additionalWriters() );
 
         burnJob = job;
     }
@@ -504,6 +516,19 @@ void K3b::MediaCopyDialog::toggleAll()
         }
     }
 
+    // of CDs we can only write single session data CDs to several writers at once
+    m_checkAllWriters->setEnabled( !m_checkOnlyCreateImage->isChecked() &&
+                                   m_comboCopyMode->currentIndex() == 0 &&
+                                   ( !K3b::Device::isCdMedia( sourceMedium.diskInfo().mediaType() ) ||
+                                     ( sourceMedium.toc().contentType() == K3b::Device::DATA &&
+                                       sourceMedium.toc().sessions() == 1 ) ) );
+
+    // the source is read into an image once
+    if( m_checkAllWriters->isEnabled() && m_checkAllWriters->isChecked() ) {
+        m_checkCacheImage->setChecked(true);
+        m_checkCacheImage->setEnabled(false);
+    }
+
     m_tempDirSelectionWidget->setNeededSize( neededSize() );
 
     if( sourceMedium.toc().contentType() == K3b::Device::DATA &&
@@ -567,6 +592,7 @@ void K3b::MediaCopyDialog::loadSettings( const KConfigGroup& c )
     m_checkVerifyData->setChecked( c.readEntry( "verify data", false ) );
 
     m_spinCopies->setValue( c.readEntry( "copies", 1 ) );
+    m_checkAllWriters->setChecked( c.readEntry( "all writers", false ) );
 
     m_tempDirSelectionWidget->readConfig( c );
 
@@ -596,6 +622,7 @@ void K3b::MediaCopyDialog::saveSettings( KConfigGroup c )
     c.writeEntry( "only_create_image", m_checkOnlyCreateImage->isChecked() );
     c.writeEntry( "paranoia_mode", m_comboParanoiaMode->currentText().toInt() );
     c.writeEntry( "copies", m_spinCopies->value() );
+    c.writeEntry( "all writers", m_checkAllWriters->isChecked() );
     c.writeEntry( "verify data", m_checkVerifyData->isChecked() );
 
     m_writerSelectionWidget->saveConfig( c );
@@ -634,3 +661,22 @@ KIO::filesize_t K3b::MediaCopyDialog::neededSize() const
 }
 
 
+QList<K3b::Device::Device*> K3b::MediaCopyDialog::additionalWriters() const
+{
+    K3b::Device::Device* readDev = m_comboSourceDevice->selectedDevice();
+    K3b::Device::Device* burnDev = m_writerSelectionWidget->writerDevice();
+
+    QList<K3b::Device::Device*> writers;
+    Q_FOREACH( K3b::Device::Device* dev, k3bcore->deviceManager()->burningDevices() ) {
+        if( dev == readDev || dev == burnDev )
+            continue;
+
+        K3b::Medium medium = k3bappcore->mediaCache()->medium( dev );
+        if( medium.diskInfo().diskState() == K3b::Device::STATE_EMPTY &&
+            medium.diskInfo().mediaType() & m_writerSelectionWidget->wantedMediumType() )
+            writers.append( dev );
+    }
+    return writers;
+}
+
+
@@ -58,6 +58,11 @@ namespace K3b {
 
         KIO::filesize_t neededSize() const;
 
+        /**
+         * The writers besides the selected one which contain a suitable empty medium.
+         */
+        QList<Device::Device*> additionalWriters() const;
+
         WriterSelectionWidget* m_writerSelectionWidget;
         TempDirSelectionWidget* m_tempDirSelectionWidget;
         QCheckBox* m_checkSimulate;
@@ -69,6 +74,7 @@ namespace K3b {
         QCheckBox* m_checkIgnoreAudioReadErrors;
         QCheckBox* m_checkNoCorrection;
         QCheckBox* m_checkVerifyData;
+        QCheckBox* m_checkAllWriters;
         MediaSelectionComboBox* m_comboSourceDevice;
         QComboBox* m_comboParanoiaMode;
         QSpinBox* m_spinCopies;
@@ -30,7 +30,6 @@
 
 #include <KLocalizedString>
 #include <KConfigCore/KConfig>
-#include <KWidgetsAddons/KMessageBox>
 
 #include <QPoint>
 #include <QStringList>
@@ -106,9 +105,6 @@ K3b::AudioBurnDialog::AudioBurnDialog(K3b::AudioDoc* _doc, QWidget *parent )
 
     addPage( advancedTab, i18n("Advanced") );
 
-    connect( m_checkNormalize, SIGNAL(toggled(bool)), this, SLOT(slotNormalizeToggled(bool)) );
-    connect( m_checkCacheImage, SIGNAL(toggled(bool)), this, SLOT(slotCacheImageToggled(bool)) );
-
     // ToolTips
     // -------------------------------------------------------------------------
     m_checkHideFirstTrack->setToolTip( i18n("Hide the first track in the first pregap") );
@@ -282,51 +278,3 @@ void K3b::AudioBurnDialog::showEvent( QShowEvent* e )
 
     K3b::ProjectBurnDialog::showEvent(e);
 }
-
-
-void K3b::AudioBurnDialog::slotNormalizeToggled( bool on )
-{
-    if( on ) {
-        // we are not able to normalize in on-the-fly mode
-        if( !k3bcore->externalBinManager()->foundBin( "normalize" ) ) {
-            KMessageBox::sorry( this, i18n("<p><b>External program <em>normalize</em> is not installed.</b>"
-                                           "<p>K3b uses <em>normalize</em> (http://normalize.nongnu.org/) "
-                                           "to normalize audio tracks. In order to "
-                                           "use this functionality, please install it first.") );
-            m_checkNormalize->setChecked( false );
-        }
-        else if( !m_checkCacheImage->isChecked() && !m_checkOnlyCreateImage->isChecked() ) {
-            if( KMessageBox::warningYesNo( this, i18n("<p>K3b is not able to normalize audio tracks when burning on-the-fly. "
-                                                      "The external program used for this task only supports normalizing a set "
-                                                      "of audio files."),
-                                           QString(),
-                                           KGuiItem( i18n("Disable normalization") ),
-                                           KGuiItem( i18n("Disable on-the-fly burning") ),
-                                           "audioProjectNormalizeOrOnTheFly" ) == KMessageBox::Yes )
-                m_checkNormalize->setChecked( false );
-            else
-                m_checkCacheImage->setChecked( true );
-        }
-    }
-}
-
-
-void K3b::AudioBurnDialog::slotCacheImageToggled( bool on )
-{
-    if( !on ) {
-        if( m_checkNormalize->isChecked() ) {
-            if( KMessageBox::warningYesNo( this, i18n("<p>K3b is not able to normalize audio tracks when burning on-the-fly. "
-                                                      "The external program used for this task only supports normalizing a set "
-                                                      "of audio files."),
-                                           QString(),
-                                           KGuiItem( i18n("Disable normalization") ),
-                                           KGuiItem( i18n("Disable on-the-fly burning") ),
-                                           "audioProjectNormalizeOrOnTheFly" ) == KMessageBox::Yes )
-                m_checkNormalize->setChecked( false );
-            else
-                m_checkCacheImage->setChecked( true );
-        }
-    }
-}
-
-
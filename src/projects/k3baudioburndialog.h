@@ -60,8 +60,6 @@ namespace K3b {
          * Reimplemented for internal reasons (shut down the audio player)
          */
         void slotStartClicked();
-        void slotCacheImageToggled( bool on );
-        void slotNormalizeToggled( bool on );
 
     private:
         /**
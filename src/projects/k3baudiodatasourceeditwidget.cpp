@@ -14,6 +14,7 @@
 
 #include "k3baudiodatasourceeditwidget.h"
 #include "k3baudioeditorwidget.h"
+#include "k3baudiopeakextractor.h"
 #include "k3bmsfedit.h"
 
 #include "k3baudiodatasource.h"
@@ -58,6 +59,9 @@ K3b::AudioDataSourceEditWidget::AudioDataSourceEditWidget( QWidget* parent )
     connect( m_editEndOffset, SIGNAL(valueChanged(K3b::Msf)),
              this, SLOT(slotEndOffsetEdited(K3b::Msf)) );
 
+    connect( K3b::AudioPeakExtractor::instance(), SIGNAL(peaksReady(QString)),
+             this, SLOT(slotLoadPeaks()) );
+
     m_editor->setToolTip( i18n("Drag the edges of the highlighted area to define the portion of the "
                                "audio source you want to include in the Audio CD track. "
                                "You can also use the input windows to fine-tune your selection.") );
@@ -92,6 +96,8 @@ void K3b::AudioDataSourceEditWidget::loadSource( K3b::AudioDataSource* source )
     // the source's end offset points after the last sector while
     // the editor widget returns the last used sector
     m_editor->setLength( source->originalLength() );
+    m_editor->setPeaks( K3b::AudioPeaks() );
+    slotLoadPeaks();
     m_rangeId = m_editor->addRange( source->startOffset(),
                                     source->endOffset() == 0
                                     ? source->originalLength()-1
@@ -154,6 +160,13 @@ void K3b::AudioDataSourceEditWidget::slotStartOffsetEdited( const K3b::Msf& msf
 }
 
 
+void K3b::AudioDataSourceEditWidget::slotLoadPeaks()
+{
+    if( m_source && m_editor->peaks().isNull() )
+        m_editor->setPeaks( K3b::AudioPeakExtractor::instance()->sourcePeaks( m_source ) );
+}
+
+
 void K3b::AudioDataSourceEditWidget::slotEndOffsetEdited( const K3b::Msf& msf )
 {
     if( m_source ) {
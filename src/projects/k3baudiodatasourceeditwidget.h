@@ -64,6 +64,7 @@ namespace K3b {
         void slotRangeModified( int, const K3b::Msf&, const K3b::Msf& );
         void slotStartOffsetEdited( const K3b::Msf& );
         void slotEndOffsetEdited( const K3b::Msf& );
+        void slotLoadPeaks();
 
     private:
         AudioDataSource* m_source;
@@ -142,6 +142,7 @@ public:
 
     int maxMarkers;
     K3b::Msf length;
+    K3b::AudioPeaks peaks;
     int idCnt;
     bool mouseAt;
 
@@ -182,8 +183,9 @@ QSize K3b::AudioEditorWidget::minimumSizeHint() const
 
     int maxWidth = QApplication::desktop()->width()*2/3;
     int wantedWidth = 2*d->margin + 2*frameWidth() + (d->length.totalFrames()/75/60 + 1) * fontMetrics().width( "000" );
+    int waveformHeight = ( d->peaks.isNull() ? 0 : 48 );
     return QSize( qMin( maxWidth, wantedWidth ),
-                  2*d->margin + 12 + 6 /*12 for the tickmarks and 6 for the markers */ + fontMetrics().height() + 2*frameWidth() );
+                  2*d->margin + 12 + 6 /*12 for the tickmarks and 6 for the markers */ + fontMetrics().height() + 2*frameWidth() + waveformHeight );
 }
 
 
@@ -208,6 +210,22 @@ const K3b::Msf K3b::AudioEditorWidget::length() const
 }
 
 
+void K3b::AudioEditorWidget::setPeaks( const K3b::AudioPeaks& peaks )
+{
+    const bool sizeChanged = ( peaks.isNull() != d->peaks.isNull() );
+    d->peaks = peaks;
+    if( sizeChanged )
+        updateGeometry();
+    update();
+}
+
+
+K3b::AudioPeaks K3b::AudioEditorWidget::peaks() const
+{
+    return d->peaks;
+}
+
+
 void K3b::AudioEditorWidget::setSelectedRangeBrush( const QBrush& b )
 {
     d->selectedRangeBrush = b;
@@ -491,6 +509,8 @@ void K3b::AudioEditorWidget::drawAll( QPainter* p, const QRect& drawRect )
     if( Range* selectedRange = getRange( d->selectedRangeId ) )
         drawRange( p, drawRect, *selectedRange );
 
+    drawWaveform( p, drawRect );
+
     for( Marker::List::const_iterator it = d->markers.constBegin(); it != d->markers.constEnd(); ++it )
         drawMarker( p, drawRect, *it );
 
@@ -543,6 +563,46 @@ void K3b::AudioEditorWidget::drawAll( QPainter* p, const QRect& drawRect )
 }
 
 
+void K3b::AudioEditorWidget::drawWaveform( QPainter* p, const QRect& drawRect )
+{
+    if( d->peaks.isNull() || d->length <= 1 )
+        return;
+
+    // keep clear of the marker heads and the minute labels
+    int top = drawRect.top() + 6 + 1;
+    int bottom = drawRect.bottom() - fontMetrics().height() - 6;
+    if( bottom - top < 4 )
+        return;
+
+    int center = ( top + bottom ) / 2;
+    double scale = double( bottom - top ) / 2.0 / 32768.0;
+
+    QColor peakColor = palette().text().color();
+    peakColor.setAlpha( 96 );
+    QColor rmsColor = palette().text().color();
+    rmsColor.setAlpha( 192 );
+
+    p->save();
+
+    // the peaks are taken from the pyramid level matching the zoom
+    // thus every column costs the same regardless of the length
+    int firstX = msfToPos( 0 );
+    int lastX = msfToPos( d->length-1 );
+    for( int x = firstX; x <= lastX; ++x ) {
+        K3b::Msf first = posToMsf( x );
+        K3b::Msf last = qMax( first, posToMsf( x+1 )-1 );
+        K3b::AudioPeaks::Peak peak = d->peaks.peak( first, last );
+
+        p->setPen( peakColor );
+        p->drawLine( x, center - (int)( peak.max*scale ), x, center - (int)( peak.min*scale ) );
+        p->setPen( rmsColor );
+        p->drawLine( x, center - (int)( peak.rms*scale ), x, center + (int)( peak.rms*scale ) );
+    }
+
+    p->restore();
+}
+
+
 void K3b::AudioEditorWidget::drawRange( QPainter* p, const QRect& drawRect, const K3b::AudioEditorWidget::Range& r )
 {
     p->save();
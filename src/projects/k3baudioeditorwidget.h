@@ -17,6 +17,7 @@
 #define _K3B_AUDIO_EDITOR_WIDGET_H_
 
 #include "k3bmsf.h"
+#include "k3baudiopeaks.h"
 
 #include <QList>
 #include <QMouseEvent>
@@ -45,6 +46,13 @@ public:
 
     const K3b::Msf length() const;
 
+    /**
+     * Set the waveform to draw below the ranges. It has to cover length().
+     * A null object disables the waveform.
+     */
+    void setPeaks( const K3b::AudioPeaks& peaks );
+    K3b::AudioPeaks peaks() const;
+
     /**
      * Add a user editable range.
      * @param startFixed if true the range's start cannot be changed by the user, only with modifyRange
@@ -187,6 +195,7 @@ private:
     Private* d;
 
     void drawAll( QPainter*, const QRect& );
+    void drawWaveform( QPainter* p, const QRect& );
     void drawRange( QPainter* p, const QRect&, const Range& r );
     void drawMarker( QPainter* p, const QRect&, const Marker& m );
 
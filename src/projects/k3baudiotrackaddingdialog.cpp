@@ -109,6 +109,15 @@ void K3b::AudioTrackAddingDialog::addUrls( const QList<QUrl>& urls,
 {
     if( !urls.isEmpty() )
     {
+        // parse all cue files at once, slotAddUrls() then finds them in the cache
+        QStringList cueFiles;
+        Q_FOREACH( const QUrl& url, urls ) {
+            if( url.isLocalFile() && url.toLocalFile().right(3).toLower() == "cue" )
+                cueFiles << url.toLocalFile();
+        }
+        if( cueFiles.count() > 1 )
+            K3b::CueFileParser::validateFiles( cueFiles );
+
         K3b::AudioTrackAddingDialog* dlg = new K3b::AudioTrackAddingDialog(
             urls, doc, afterTrack, parentTrack, afterSource, parent );
         dlg->setAttribute( Qt::WA_DeleteOnClose );
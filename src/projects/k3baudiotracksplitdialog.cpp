@@ -15,11 +15,13 @@
 #include "k3baudiotracksplitdialog.h"
 #include "k3baudiotrack.h"
 #include "k3baudioeditorwidget.h"
+#include "k3baudiopeakextractor.h"
 
 #include "k3bmsf.h"
 #include "k3bmsfedit.h"
 
 #include <KLocalizedString>
+#include <KWidgetsAddons/KMessageBox>
 #include <KXmlGui/KActionCollection>
 
 #include <QEvent>
@@ -69,6 +71,8 @@ K3b::AudioTrackSplitDialog::AudioTrackSplitDialog( K3b::AudioTrack* track, QWidg
              this, SLOT(slotMsfEditChanged(K3b::Msf)) );
     connect( m_msfEditEnd, SIGNAL(valueChanged(K3b::Msf)),
              this, SLOT(slotMsfEditChanged(K3b::Msf)) );
+    connect( K3b::AudioPeakExtractor::instance(), SIGNAL(peaksReady(QString)),
+             this, SLOT(slotLoadPeaks()) );
 
     setupActions();
 
@@ -80,6 +84,9 @@ K3b::AudioTrackSplitDialog::AudioTrackSplitDialog( K3b::AudioTrack* track, QWidg
     m_editorWidget->addRange( 0, mid-1 );
     m_editorWidget->addRange( mid, m_track->length()-1 );
 
+    // the waveform may have to be extracted first
+    slotLoadPeaks();
+
     QDialogButtonBox* buttonBox = new QDialogButtonBox( QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this );
     connect( buttonBox, SIGNAL(accepted()), SLOT(accept()) );
     connect( buttonBox, SIGNAL(rejected()), SLOT(reject()) );
@@ -106,8 +113,46 @@ void K3b::AudioTrackSplitDialog::setupActions()
     actionRemoveRange->setText( i18n("Remove part") );
     connect( actionRemoveRange, SIGNAL(triggered()), this, SLOT(slotRemoveRange()) );
 
+    m_actionSplitAtSilences = new QAction( this );
+    m_actionSplitAtSilences->setText( i18n("Split at Silences") );
+    m_actionSplitAtSilences->setToolTip( i18n("Split the track wherever a pause of at least one second begins a new part") );
+    connect( m_actionSplitAtSilences, SIGNAL(triggered()), this, SLOT(slotSplitAtSilences()) );
+
     m_popupMenu->addAction( actionSplitHere );
     m_popupMenu->addAction( actionRemoveRange );
+    m_popupMenu->addSeparator();
+    m_popupMenu->addAction( m_actionSplitAtSilences );
+}
+
+
+void K3b::AudioTrackSplitDialog::slotLoadPeaks()
+{
+    if( m_editorWidget->peaks().isNull() ) {
+        m_editorWidget->setPeaks( K3b::AudioPeakExtractor::instance()->trackPeaks( m_track ) );
+        m_actionSplitAtSilences->setEnabled( !m_editorWidget->peaks().isNull() );
+    }
+}
+
+
+void K3b::AudioTrackSplitDialog::slotSplitAtSilences()
+{
+    QList<K3b::Msf> splitPoints = m_editorWidget->peaks().silenceSplitPoints();
+    if( splitPoints.isEmpty() ) {
+        KMessageBox::information( this, i18n("No silence found to split the track at.") );
+        return;
+    }
+
+    Q_FOREACH( int id, m_editorWidget->allRanges() )
+        m_editorWidget->removeRange( id );
+
+    K3b::Msf start = 0;
+    Q_FOREACH( const K3b::Msf& pos, splitPoints ) {
+        m_editorWidget->addRange( start, pos-1 );
+        start = pos;
+    }
+    m_editorWidget->addRange( start, m_track->length()-1 );
+
+    slotRangeSelectionChanged( m_editorWidget->selectedRange() );
 }
 
 
@@ -18,6 +18,7 @@
 #include <QDialog>
 #include <QEvent>
 
+class QAction;
 class QMenu;
 
 
@@ -52,6 +53,8 @@ private Q_SLOTS:
     void slotRangeSelectionChanged( int );
     void slotSplitHere();
     void slotRemoveRange();
+    void slotSplitAtSilences();
+    void slotLoadPeaks();
     void splitAt( const QPoint& p );
 
 private:
@@ -62,6 +65,7 @@ private:
     MsfEdit* m_msfEditEnd;
     AudioTrack* m_track;
     QMenu* m_popupMenu;
+    QAction* m_actionSplitAtSilences;
     QPoint m_lastClickPosition;
 };
 }
@@ -29,7 +29,6 @@
 #include "k3biso9660.h"
 #include "k3bdirsizejob.h"
 #include "k3binteractiondialog.h"
-#include "k3bthread.h"
 #include "k3bsignalwaiter.h"
 #include "k3bexternalbinmanager.h"
 
@@ -36,7 +36,6 @@
 
 #include <KConfigCore/KConfig>
 #include <KLocalizedString>
-#include <KWidgetsAddons/KMessageBox>
 
 #include <QDebug>
 #include <QVariant>
@@ -78,8 +77,6 @@ K3b::MixedBurnDialog::MixedBurnDialog( K3b::MixedDoc* doc, QWidget *parent )
     QSpacerItem* spacer = new QSpacerItem( 20, 20, QSizePolicy::Minimum, QSizePolicy::Expanding );
     m_optionGroupLayout->addItem( spacer );
 
-    connect( m_checkNormalize, SIGNAL(toggled(bool)), this, SLOT(slotNormalizeToggled(bool)) );
-    connect( m_checkCacheImage, SIGNAL(toggled(bool)), this, SLOT(slotCacheImageToggled(bool)) );
     connect( m_writerSelectionWidget, SIGNAL(writingAppChanged(K3b::WritingApp)), this, SLOT(slotToggleAll()) );
     connect( m_writingModeWidget, SIGNAL(writingModeChanged(WritingMode)), this, SLOT(slotToggleAll()) );
 }
@@ -277,53 +274,3 @@ void K3b::MixedBurnDialog::toggleAll()
     if( !cdText || m_writingModeWidget->writingMode() == K3b::WritingModeTao  )
         m_cdtextWidget->setChecked( false );
 }
-
-
-void K3b::MixedBurnDialog::slotNormalizeToggled( bool on )
-{
-    if( on ) {
-        // we are not able to normalize in on-the-fly mode
-        if( !k3bcore->externalBinManager()->foundBin( "normalize" ) ) {
-            KMessageBox::sorry( this, i18n("<p><b>External program <em>normalize</em> is not installed.</b>"
-                                           "<p>K3b uses <em>normalize</em> (http://normalize.nongnu.org/) "
-                                           "to normalize audio tracks. In order to "
-                                           "use this functionality, please install it first.") );
-            m_checkNormalize->setChecked( false );
-        }
-        else if( !m_checkCacheImage->isChecked() && !m_checkOnlyCreateImage->isChecked() ) {
-            if( KMessageBox::warningYesNo( this, i18n("<p>K3b is not able to normalize audio tracks when burning on-the-fly. "
-                                                      "The external program used for this task only supports normalizing a set "
-                                                      "of audio files."),
-                                           QString(),
-                                           KGuiItem( i18n("Disable normalization") ),
-                                           KGuiItem( i18n("Disable on-the-fly burning") ),
-                                           "audioProjectNormalizeOrOnTheFly" ) == KMessageBox::Yes )
-                m_checkNormalize->setChecked( false );
-            else
-                m_checkCacheImage->setChecked( true );
-        }
-    }
-}
-
-
-void K3b::MixedBurnDialog::slotCacheImageToggled( bool on )
-{
-    if( on ) {
-        if( m_checkNormalize->isChecked() ) {
-            if( KMessageBox::warningYesNo( this, i18n("<p>K3b is not able to normalize audio tracks when burning on-the-fly. "
-                                                      "The external program used for this task only supports normalizing a set "
-                                                      "of audio files."),
-                                           QString(),
-                                           KGuiItem( i18n("Disable normalization") ),
-                                           KGuiItem( i18n("Disable on-the-fly burning") ),
-                                           "audioProjectNormalizeOrOnTheFly" ) == KMessageBox::Yes )
-                m_checkNormalize->setChecked( false );
-            else
-                m_checkCacheImage->setChecked( true );
-        }
-    }
-}
-
-
-
-
@@ -54,9 +54,6 @@ namespace K3b {
         void saveSettingsToProject();
         void readSettingsFromProject();
 
-        void slotCacheImageToggled( bool on );
-        void slotNormalizeToggled( bool on );
-
     private:
         void setupSettingsPage();
         MixedDoc* m_doc;
@@ -0,0 +1,96 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baudioencoderpool.h"
+#include "k3baudioencoder.h"
+#include "k3bcore.h"
+#include "k3bpluginmanager.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QHash>
+#include <QList>
+#include <QThread>
+
+
+namespace {
+    K3b::AudioEncoderPool* s_instance = 0;
+}
+
+
+class K3b::AudioEncoderPool::Private
+{
+public:
+    // all instances per plugin name, the plugin itself is not part of the pool
+    QHash<QString, QList<AudioEncoder*> > instances;
+    QList<AudioEncoder*> idle;
+};
+
+
+K3b::AudioEncoderPool::AudioEncoderPool()
+    : QObject( QCoreApplication::instance() ),
+      d( new Private() )
+{
+}
+
+
+K3b::AudioEncoderPool::~AudioEncoderPool()
+{
+    s_instance = 0;
+    delete d;
+}
+
+
+K3b::AudioEncoderPool* K3b::AudioEncoderPool::instance()
+{
+    if( !s_instance )
+        s_instance = new AudioEncoderPool();
+    return s_instance;
+}
+
+
+int K3b::AudioEncoderPool::maxInstances() const
+{
+    return qMax( 1, QThread::idealThreadCount() );
+}
+
+
+K3b::AudioEncoder* K3b::AudioEncoderPool::acquire( AudioEncoder* encoder )
+{
+    const QString name = encoder->pluginInfo().pluginName();
+    QList<AudioEncoder*>& instances = d->instances[name];
+
+    Q_FOREACH( AudioEncoder* instance, instances ) {
+        if( d->idle.removeOne( instance ) )
+            return instance;
+    }
+
+    if( instances.count() >= maxInstances() )
+        return 0;
+
+    // the instances are deleted with the pool
+    AudioEncoder* instance = qobject_cast<AudioEncoder*>( k3bcore->pluginManager()->createPluginInstance( encoder, this ) );
+    if( instance ) {
+        qDebug() << "(K3b::AudioEncoderPool) created instance" << instances.count()+1 << "of" << name;
+        instances.append( instance );
+    }
+    return instance;
+}
+
+
+void K3b::AudioEncoderPool::release( AudioEncoder* encoder )
+{
+    if( encoder && !d->idle.contains( encoder ) ) {
+        d->idle.append( encoder );
+        emit released();
+    }
+}
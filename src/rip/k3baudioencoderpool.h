@@ -0,0 +1,67 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_AUDIO_ENCODER_POOL_H_
+#define _K3B_AUDIO_ENCODER_POOL_H_
+
+#include <QObject>
+
+namespace K3b {
+    class AudioEncoder;
+
+    /**
+     * Hands out private instances of the AudioEncoder plugins.
+     *
+     * An encoder can only encode one file at a time. Jobs which run
+     * concurrently, like the drives of a BatchAudioRipJob, acquire
+     * their own instance here and release it once they are done so
+     * it can be reused by the next job.
+     *
+     * All methods have to be called from the GUI thread.
+     */
+    class AudioEncoderPool : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        ~AudioEncoderPool();
+
+        static AudioEncoderPool* instance();
+
+        /**
+         * The number of instances per plugin, one per core.
+         */
+        int maxInstances() const;
+
+        /**
+         * \return An unused instance of the plugin \p encoder belongs to
+         *         or 0 if maxInstances() are in use already.
+         */
+        AudioEncoder* acquire( AudioEncoder* encoder );
+
+        void release( AudioEncoder* encoder );
+
+    Q_SIGNALS:
+        /**
+         * Emitted when an instance becomes available again.
+         */
+        void released();
+
+    private:
+        AudioEncoderPool();
+
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
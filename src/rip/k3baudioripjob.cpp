@@ -16,6 +16,7 @@
 
 #include "k3baudioripjob.h"
 
+#include "k3baccuraterip.h"
 #include "k3bcdparanoialib.h"
 #include "k3bcore.h"
 #include "k3bdevice.h"
@@ -26,6 +27,8 @@
 
 #include <KLocalizedString>
 
+#include <QStandardPaths>
+
 
 namespace K3b {
 
@@ -37,24 +40,34 @@ public:
         : paranoiaRetries(5),
           neverSkip(false),
           paranoiaLib(0),
+          accurateRip(0),
           device(0),
-          useIndex0(false) {
+          useIndex0(false),
+          fastFirstPass(false) {
     }
     int paranoiaMode;
     int paranoiaRetries;
     int neverSkip;
 
     CdparanoiaLib* paranoiaLib;
+    AccurateRip* accurateRip;
 
     Device::Toc toc;
     Device::Device* device;
 
     bool useIndex0;
+    bool fastFirstPass;
 };
 
 
 namespace {
 
+QString checksumToString( quint32 crc )
+{
+    return QString().sprintf( "%08X", crc );
+}
+
+
 class AudioCdReader : public QIODevice
 {
 public:
@@ -92,6 +105,8 @@ bool AudioCdReader::open( OpenMode mode )
                         : tt.lastSector().lba() );
 
         if( d->paranoiaLib->initReading( tt.firstSector().lba(), endSec ) ) {
+            if( d->accurateRip )
+                d->accurateRip->beginTrack( m_trackIndex );
             return QIODevice::open( mode );
         }
         else {
@@ -133,6 +148,8 @@ qint64 AudioCdReader::readData( char* data, qint64 /*maxlen*/ )
         }
         else {
             ::memcpy( data, buf, CD_FRAMESIZE_RAW );
+            if( d->accurateRip )
+                d->accurateRip->process( data, CD_FRAMESIZE_RAW );
             return CD_FRAMESIZE_RAW;
         }
     }
@@ -154,6 +171,7 @@ AudioRipJob::AudioRipJob( JobHandler* hdl, QObject* parent )
 
 AudioRipJob::~AudioRipJob()
 {
+    delete d->accurateRip;
     delete d->paranoiaLib;
 }
 
@@ -182,6 +200,12 @@ void AudioRipJob::setUseIndex0( bool b )
 }
 
 
+void AudioRipJob::setFastFirstPass( bool b )
+{
+    d->fastFirstPass = b;
+}
+
+
 void AudioRipJob::setDevice( Device::Device* device )
 {
     d->device = device;
@@ -255,6 +279,7 @@ bool AudioRipJob::init()
     d->paranoiaLib->setParanoiaMode( d->paranoiaMode );
     d->paranoiaLib->setNeverSkip( d->neverSkip );
     d->paranoiaLib->setMaxRetries( d->paranoiaRetries );
+    d->paranoiaLib->setFastFirstPass( d->fastFirstPass );
 
 
     if( d->useIndex0 ) {
@@ -262,6 +287,12 @@ bool AudioRipJob::init()
         d->device->indexScan( d->toc );
     }
 
+    // the checksums cover the complete tracks which we do not rip without the pregaps
+    delete d->accurateRip;
+    d->accurateRip = 0;
+    if( !d->useIndex0 )
+        d->accurateRip = new AccurateRip( d->toc );
+
     emit infoMessage( i18n("Starting digital audio extraction (ripping)."), Job::MessageInfo );
     return true;
 }
@@ -269,6 +300,9 @@ bool AudioRipJob::init()
 
 void AudioRipJob::cleanup()
 {
+    if( d->accurateRip && !canceled() )
+        checkAccurateRip();
+
     d->paranoiaLib->close();
     d->device->block(false);
 }
@@ -305,6 +339,87 @@ void AudioRipJob::trackStarted(int trackIndex)
 void AudioRipJob::trackFinished( int trackIndex, const QString& filename )
 {
     emit infoMessage( i18n("Successfully ripped track %1 to %2.", trackIndex, filename), Job::MessageInfo );
+    if( d->fastFirstPass && d->paranoiaMode > 0 && d->paranoiaLib->suspiciousSectors() > 0 )
+        emit infoMessage( i18np("1 sector of track %2 was verified with paranoia.",
+                                "%1 sectors of track %2 were verified with paranoia.",
+                                d->paranoiaLib->suspiciousSectors(), trackIndex ), Job::MessageInfo );
+
+    if( d->accurateRip ) {
+        d->accurateRip->endTrack();
+        const AccurateRip::TrackResult r = d->accurateRip->result( trackIndex );
+        if( r.valid )
+            emit infoMessage( i18n("Track %1: AccurateRip v1 %2, v2 %3, CRC32 %4",
+                                   trackIndex,
+                                   checksumToString( r.v1 ),
+                                   checksumToString( r.v2 ),
+                                   checksumToString( r.crc32 ) ), Job::MessageInfo );
+    }
+}
+
+
+QStringList AudioRipJob::discComments() const
+{
+    QStringList comments;
+    if( d->accurateRip )
+        comments << QLatin1String( "ACCURATERIPID " ) + d->accurateRip->discId();
+    return comments;
+}
+
+
+QStringList AudioRipJob::trackComments( int trackIndex ) const
+{
+    QStringList comments;
+    if( d->accurateRip ) {
+        const AccurateRip::TrackResult r = d->accurateRip->result( trackIndex );
+        if( r.valid ) {
+            comments << QLatin1String( "ACCURATERIPV1 " ) + checksumToString( r.v1 )
+                     << QLatin1String( "ACCURATERIPV2 " ) + checksumToString( r.v2 )
+                     << QLatin1String( "CRC32 " ) + checksumToString( r.crc32 );
+        }
+    }
+    return comments;
+}
+
+
+void AudioRipJob::checkAccurateRip()
+{
+    // the database files are downloaded by the user, we never go online
+    const QString filename = QStandardPaths::locate( QStandardPaths::GenericDataLocation,
+                                                     QLatin1String( "k3b/accuraterip/" ) + d->accurateRip->databaseFilename() );
+    if( filename.isEmpty() ) {
+        emit infoMessage( i18n("No AccurateRip database file %1 found to verify the tracks.",
+                               d->accurateRip->databaseFilename() ), Job::MessageInfo );
+        return;
+    }
+
+    const QList<QList<AccurateRip::DatabaseEntry> > database = d->accurateRip->loadDatabase( filename );
+    if( database.isEmpty() ) {
+        emit infoMessage( i18n("Unable to read AccurateRip database file %1.", filename), Job::MessageWarning );
+        return;
+    }
+
+    // the database lists the audio tracks only
+    int audioTrack = 0;
+    for( int i = 0; i < d->toc.count(); ++i ) {
+        if( d->toc[i].type() != Device::Track::TYPE_AUDIO )
+            continue;
+
+        const int trackIndex = i+1;
+        if( d->accurateRip->result( trackIndex ).valid && audioTrack < database.count() ) {
+            const AccurateRip::Match m = d->accurateRip->match( trackIndex, database[audioTrack] );
+            if( m.confidence == 0 )
+                emit infoMessage( i18n("Track %1 does not match the AccurateRip database.", trackIndex),
+                                  Job::MessageWarning );
+            else if( m.offset == 0 )
+                emit infoMessage( i18n("Track %1 accurately ripped (confidence %2).", trackIndex, m.confidence),
+                                  Job::MessageSuccess );
+            else
+                emit infoMessage( i18n("Track %1 accurately ripped with a read offset of %2 samples (confidence %3).",
+                                       trackIndex, m.offset, m.confidence ),
+                                  Job::MessageSuccess );
+        }
+        ++audioTrack;
+    }
 }
 
 
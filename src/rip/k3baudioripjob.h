@@ -41,6 +41,11 @@ namespace K3b {
         void setNeverSkip( bool b );
         void setUseIndex0( bool b );
 
+        /**
+         * \see CdparanoiaLib::setFastFirstPass()
+         */
+        void setFastFirstPass( bool b );
+
         void setDevice( Device::Device* device );
 
         virtual QString jobDescription() const;
@@ -66,6 +71,16 @@ namespace K3b {
 
         virtual void trackFinished( int trackIndex, const QString& filename );
 
+        virtual QStringList discComments() const;
+
+        virtual QStringList trackComments( int trackIndex ) const;
+
+        /**
+         * Compares the AccurateRip checksums of the ripped tracks with
+         * the database file of the disc if there is one.
+         */
+        void checkAccurateRip();
+
     private:
         QScopedPointer<Private> d;
     };
@@ -0,0 +1,589 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bbatchaudioripjob.h"
+#include "k3baudioencoderpool.h"
+#include "k3baudioripjob.h"
+#include "k3bpatternparser.h"
+
+#include "k3baudioencoder.h"
+#include "k3bcore.h"
+#include "k3bdevice.h"
+#include "k3bdevicehandler.h"
+#include "k3bfilesysteminfo.h"
+#include "k3bglobals.h"
+#include "k3bmediacache.h"
+#include "k3bmedium.h"
+#include "k3bpluginmanager.h"
+#include "k3btoc.h"
+#include "k3btrack.h"
+
+#include <KConfigCore/KConfigGroup>
+#include <KCddb/Cdinfo>
+#include <KLocalizedString>
+#include <KIOCore/KIO/Global>
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+
+
+class K3b::BatchAudioRipJob::Drive
+{
+public:
+    Drive( Device::Device* dev )
+        : device( dev ),
+          job( 0 ),
+          encoder( 0 ),
+          waitingForDisc( false ),
+          bytes( 0 ),
+          percent( 0 ) {
+    }
+
+    QString name() const {
+        return device->vendor() + ' ' + device->description();
+    }
+
+    Device::Device* device;
+    AudioRipJob* job;
+    AudioEncoder* encoder;
+
+    // the last disc handled, to not rip it again before it is removed
+    Medium lastMedium;
+
+    // the disc we requested a CDDB lookup for
+    Medium cddbRequested;
+
+    bool waitingForDisc;
+
+    QString logFilename;
+    QStringList log;
+    qint64 bytes;
+    int percent;
+};
+
+
+class K3b::BatchAudioRipJob::Private
+{
+public:
+    Private()
+        : continuous( false ),
+          encoder( 0 ),
+          paranoiaMode( 0 ),
+          paranoiaRetries( 5 ),
+          neverSkip( true ),
+          useIndex0( false ),
+          fastFirstPass( false ),
+          singleFile( false ),
+          writeCueFile( false ),
+          writePlaylist( false ),
+          relativePlaylistPaths( false ),
+          replaceBlanks( false ),
+          running( false ),
+          canceled( false ),
+          discsDone( 0 ),
+          discsFailed( 0 ),
+          discsSkipped( 0 ),
+          bytesDone( 0 ),
+          lastBytes( 0 ),
+          bytesPerSecond( 0.0 ) {
+    }
+
+    ~Private() {
+        qDeleteAll( drives );
+    }
+
+    QList<Drive*> drives;
+    bool continuous;
+
+    AudioEncoder* encoder;
+    QString fileType;
+    QString baseDir;
+    int paranoiaMode;
+    int paranoiaRetries;
+    bool neverSkip;
+    bool useIndex0;
+    bool fastFirstPass;
+    bool singleFile;
+    bool writeCueFile;
+    bool writePlaylist;
+    bool relativePlaylistPaths;
+    QString filenamePattern;
+    QString playlistPattern;
+    bool replaceBlanks;
+    QString blankReplaceString;
+
+    bool running;
+    bool canceled;
+    int discsDone;
+    int discsFailed;
+    int discsSkipped;
+
+    // bytes of the finished discs
+    qint64 bytesDone;
+    qint64 lastBytes;
+    double bytesPerSecond;
+    QElapsedTimer rateTimer;
+    QTimer statusTimer;
+
+    Drive* driveForJob( QObject* job ) const {
+        Q_FOREACH( Drive* drive, drives )
+            if( drive->job == job )
+                return drive;
+        return 0;
+    }
+
+    int ripping() const {
+        int n = 0;
+        Q_FOREACH( Drive* drive, drives )
+            if( drive->job )
+                ++n;
+        return n;
+    }
+
+    QString parse( const KCDDB::CDInfo& cddb, int track, const QString& ext, const QString& pattern ) const {
+        return PatternParser::parsePattern( cddb, track, ext, pattern, replaceBlanks, blankReplaceString );
+    }
+};
+
+
+K3b::BatchAudioRipJob::BatchAudioRipJob( JobHandler* hdl, QObject* parent )
+    : Job( hdl, parent ),
+      d( new Private() )
+{
+    d->statusTimer.setInterval( 1000 );
+    connect( &d->statusTimer, SIGNAL(timeout()), this, SLOT(slotUpdateStatus()) );
+}
+
+
+K3b::BatchAudioRipJob::~BatchAudioRipJob()
+{
+    delete d;
+}
+
+
+void K3b::BatchAudioRipJob::setDevices( const QList<Device::Device*>& devices )
+{
+    qDeleteAll( d->drives );
+    d->drives.clear();
+    Q_FOREACH( Device::Device* dev, devices )
+        d->drives.append( new Drive( dev ) );
+}
+
+
+void K3b::BatchAudioRipJob::setContinuous( bool b )
+{
+    d->continuous = b;
+}
+
+
+void K3b::BatchAudioRipJob::loadSettings( const KConfigGroup& c )
+{
+    d->paranoiaMode = c.readEntry( "paranoia_mode", 0 );
+    d->paranoiaRetries = c.readEntry( "read_retries", 5 );
+    d->neverSkip = c.readEntry( "never_skip", true );
+    d->useIndex0 = c.readEntry( "use_index0", false );
+    d->fastFirstPass = c.readEntry( "fast_first_pass", false );
+
+    d->baseDir = c.readEntry( "last ripping directory", QStandardPaths::writableLocation( QStandardPaths::MusicLocation ) );
+    d->singleFile = c.readEntry( "single_file", false );
+    d->writeCueFile = c.readEntry( "write_cue_file", false );
+    d->writePlaylist = c.readEntry( "create_playlist", false );
+    d->relativePlaylistPaths = c.readEntry( "relative_path_in_playlist", false );
+
+    // same defaults as the CddbPatternWidget
+    d->filenamePattern = c.readEntry( "filename pattern",
+                                      i18nc("Please do NOT modify/translate the quotes, they are part of the pattern!", "%A - %T/%n - !a='%A'{%a - }%t") );
+    d->playlistPattern = c.readEntry( "playlist pattern", i18n( "%{albumartist} - %{albumtitle}" ) );
+    d->replaceBlanks = c.readEntry( "replace blanks", false );
+    d->blankReplaceString = c.readEntry( "blank replace string", "_" );
+
+    // an empty plugin name means wave files
+    d->encoder = 0;
+    d->fileType = c.readEntry( "filetype", "wav" );
+    const QString encoderName = c.readEntry( "encoder" );
+    if( !encoderName.isEmpty() ) {
+        Q_FOREACH( Plugin* plugin, k3bcore->pluginManager()->plugins( "AudioEncoder" ) ) {
+            if( plugin->pluginInfo().pluginName() == encoderName )
+                d->encoder = qobject_cast<AudioEncoder*>( plugin );
+        }
+        if( !d->encoder ) {
+            qDebug() << "(K3b::BatchAudioRipJob) encoder" << encoderName << "not found, creating wave files.";
+            d->fileType = QLatin1String( "wav" );
+        }
+    }
+}
+
+
+QString K3b::BatchAudioRipJob::jobDescription() const
+{
+    return i18n( "Ripping Audio CDs" );
+}
+
+
+QString K3b::BatchAudioRipJob::jobDetails() const
+{
+    if( d->encoder )
+        return i18np( "1 drive (encoding to %2)",
+                      "%1 drives (encoding to %2)",
+                      d->drives.count(),
+                      d->encoder->fileTypeComment( d->fileType ) );
+    else
+        return i18np( "1 drive", "%1 drives", d->drives.count() );
+}
+
+
+void K3b::BatchAudioRipJob::start()
+{
+    jobStarted();
+
+    d->running = true;
+    d->canceled = false;
+    d->discsDone = d->discsFailed = d->discsSkipped = 0;
+    d->bytesDone = d->lastBytes = 0;
+    d->bytesPerSecond = 0.0;
+
+    emit newTask( i18n( "Ripping Audio CDs" ) );
+
+    connect( k3bcore->mediaCache(), SIGNAL(mediumChanged(K3b::Device::Device*)),
+             this, SLOT(slotMediumChanged(K3b::Device::Device*)) );
+    connect( AudioEncoderPool::instance(), SIGNAL(released()),
+             this, SLOT(slotEncoderReleased()) );
+
+    d->rateTimer.start();
+    d->statusTimer.start();
+
+    Q_FOREACH( Drive* drive, d->drives )
+        checkDrive( drive );
+
+    slotUpdateStatus();
+    finishIfDone();
+}
+
+
+void K3b::BatchAudioRipJob::cancel()
+{
+    if( !d->running )
+        return;
+
+    d->canceled = true;
+    emit canceled();
+
+    // the jobs report back via slotRipFinished()
+    Q_FOREACH( Drive* drive, d->drives )
+        if( drive->job )
+            drive->job->cancel();
+
+    finishIfDone();
+}
+
+
+void K3b::BatchAudioRipJob::slotMediumChanged( K3b::Device::Device* dev )
+{
+    Q_FOREACH( Drive* drive, d->drives )
+        if( drive->device == dev )
+            checkDrive( drive );
+    finishIfDone();
+}
+
+
+void K3b::BatchAudioRipJob::slotEncoderReleased()
+{
+    Q_FOREACH( Drive* drive, d->drives )
+        checkDrive( drive );
+    finishIfDone();
+}
+
+
+void K3b::BatchAudioRipJob::checkDrive( Drive* drive )
+{
+    if( !d->running || d->canceled || drive->job )
+        return;
+
+    // the MediaCache does not update blocked devices
+    if( k3bcore->mediaCache()->isBlocked( drive->device ) )
+        return;
+
+    const Medium medium = k3bcore->mediaCache()->medium( drive->device );
+    if( !( medium.content() & Medium::ContentAudio ) ) {
+        drive->lastMedium = Medium();
+        if( d->continuous && !drive->waitingForDisc ) {
+            drive->waitingForDisc = true;
+            emit infoMessage( i18n( "%1: Waiting for an audio CD.", drive->name() ), MessageInfo );
+        }
+        return;
+    }
+
+    if( medium.sameMedium( drive->lastMedium ) )
+        return;
+
+    // the cache looks up every new disc, only retry failed lookups once
+    if( medium.cddbInfo().get( KCDDB::Title ).toString().isEmpty() &&
+        !medium.sameMedium( drive->cddbRequested ) ) {
+        drive->cddbRequested = medium;
+        k3bcore->mediaCache()->lookupCddb( drive->device );
+        return;
+    }
+
+    if( startRipping( drive ) )
+        drive->waitingForDisc = false;
+}
+
+
+bool K3b::BatchAudioRipJob::startRipping( Drive* drive )
+{
+    AudioEncoder* encoder = 0;
+    if( d->encoder ) {
+        encoder = AudioEncoderPool::instance()->acquire( d->encoder );
+        if( !encoder ) {
+            // try again once another drive is done
+            return false;
+        }
+    }
+
+    const Medium medium = k3bcore->mediaCache()->medium( drive->device );
+    const KCDDB::CDInfo cddb = medium.cddbInfo();
+    const Device::Toc toc = medium.toc();
+    drive->lastMedium = medium;
+
+    const QString baseDir = prepareDir( d->baseDir );
+    FileSystemInfo fsInfo( baseDir );
+    const QString extension = encoder ? d->fileType : QString::fromLatin1( "wav" );
+
+    // same naming as the AudioRippingDialog
+    AudioRipJob::Tracks tracks;
+    QStringList filenames;
+    qint64 bytes = 0;
+    if( d->singleFile ) {
+        const QString filename = baseDir + fsInfo.fixupPath( d->parse( cddb, 1, extension, d->playlistPattern ) );
+        // QMultiMap returns the values most recently inserted first
+        for( int i = toc.count()-1; i >= 0; --i ) {
+            if( toc[i].type() == Device::Track::TYPE_AUDIO ) {
+                tracks.insert( filename, i+1 );
+                bytes += ( d->useIndex0 ? toc[i].realAudioLength() : toc[i].length() ).audioBytes();
+            }
+        }
+        filenames.append( filename );
+    }
+    else {
+        for( int i = 0; i < toc.count(); ++i ) {
+            if( toc[i].type() != Device::Track::TYPE_AUDIO )
+                continue;
+
+            QString filename = d->parse( cddb, i+1, extension, d->filenamePattern );
+            if( filename.isEmpty() )
+                filename = i18n( "Track%1", QString::number( i+1 ).rightJustified( 2, '0' ) ) + '.' + extension;
+            filename = baseDir + fsInfo.fixupPath( filename );
+
+            tracks.insert( filename, i+1 );
+            filenames.append( filename );
+            bytes += ( d->useIndex0 ? toc[i].realAudioLength() : toc[i].length() ).audioBytes();
+        }
+    }
+
+    const QString playlistFilename = fsInfo.fixupPath( baseDir + '/' + d->parse( cddb, 1, QLatin1String( "m3u" ), d->playlistPattern ) );
+    drive->logFilename = fsInfo.fixupPath( baseDir + '/' + d->parse( cddb, 1, QLatin1String( "log" ), d->playlistPattern ) );
+
+    const QString title = cddb.get( KCDDB::Title ).toString().isEmpty()
+                          ? i18n( "Unknown disc" )
+                          : cddb.get( KCDDB::Artist ).toString() + QLatin1String( " - " ) + cddb.get( KCDDB::Title ).toString();
+
+    // never overwrite anything without asking, there is nobody to ask
+    QString problem;
+    if( filenames.toSet().count() != filenames.count() ) {
+        problem = i18n( "The naming pattern does not result in unique filenames." );
+    }
+    else {
+        Q_FOREACH( const QString& filename, filenames ) {
+            if( QFile::exists( filename ) ) {
+                problem = i18n( "File %1 exists already.", filename );
+                break;
+            }
+        }
+    }
+    if( filenames.isEmpty() )
+        problem = i18n( "The disc does not contain any audio tracks." );
+
+    if( !problem.isEmpty() ) {
+        emit infoMessage( i18n( "%1: Skipping '%2'. %3", drive->name(), title, problem ), MessageWarning );
+        ++d->discsSkipped;
+        AudioEncoderPool::instance()->release( encoder );
+        Device::eject( drive->device );
+        return true;
+    }
+
+    emit infoMessage( i18n( "%1: Ripping '%2' to %3.", drive->name(), title, QFileInfo( filenames.first() ).absolutePath() ), MessageInfo );
+
+    drive->encoder = encoder;
+    drive->bytes = bytes;
+    drive->percent = 0;
+    drive->log.clear();
+    drive->log << QDateTime::currentDateTime().toString( Qt::ISODate )
+               << drive->name()
+               << title;
+
+    drive->job = new AudioRipJob( this, this );
+    drive->job->setDevice( drive->device );
+    drive->job->setCddbEntry( cddb );
+    drive->job->setTrackList( tracks );
+    drive->job->setParanoiaMode( d->paranoiaMode );
+    drive->job->setMaxRetries( d->paranoiaRetries );
+    drive->job->setNeverSkip( d->neverSkip );
+    drive->job->setEncoder( encoder );
+    drive->job->setUseIndex0( d->useIndex0 );
+    drive->job->setFastFirstPass( d->fastFirstPass );
+    drive->job->setWriteCueFile( d->singleFile && d->writeCueFile );
+    if( d->writePlaylist )
+        drive->job->setWritePlaylist( playlistFilename, d->relativePlaylistPaths );
+    if( encoder )
+        drive->job->setFileType( d->fileType );
+
+    connect( drive->job, SIGNAL(infoMessage(QString,int)), this, SLOT(slotRipInfoMessage(QString,int)) );
+    connect( drive->job, SIGNAL(percent(int)), this, SLOT(slotRipPercent(int)) );
+    connect( drive->job, SIGNAL(finished(bool)), this, SLOT(slotRipFinished(bool)) );
+    connect( drive->job, SIGNAL(debuggingOutput(QString,QString)), this, SIGNAL(debuggingOutput(QString,QString)) );
+
+    drive->job->start();
+    return true;
+}
+
+
+void K3b::BatchAudioRipJob::slotRipInfoMessage( const QString& message, int type )
+{
+    if( Drive* drive = d->driveForJob( sender() ) ) {
+        drive->log.append( message );
+        emit infoMessage( i18n( "%1: %2", drive->name(), message ), type );
+    }
+}
+
+
+void K3b::BatchAudioRipJob::slotRipPercent( int p )
+{
+    if( Drive* drive = d->driveForJob( sender() ) )
+        drive->percent = p;
+}
+
+
+void K3b::BatchAudioRipJob::slotRipFinished( bool success )
+{
+    Drive* drive = d->driveForJob( sender() );
+    if( !drive )
+        return;
+
+    if( success ) {
+        ++d->discsDone;
+        d->bytesDone += drive->bytes;
+        drive->log.append( i18n( "Successfully ripped the disc." ) );
+    }
+    else {
+        ++d->discsFailed;
+        drive->log.append( drive->job->hasBeenCanceled() ? i18n( "Canceled." ) : i18n( "Ripping failed." ) );
+    }
+
+    QDir().mkpath( QFileInfo( drive->logFilename ).absolutePath() );
+    QFile f( drive->logFilename );
+    if( f.open( QIODevice::WriteOnly ) ) {
+        QTextStream t( &f );
+        Q_FOREACH( const QString& line, drive->log )
+            t << line << endl;
+    }
+    else {
+        emit infoMessage( i18n( "Unable to open '%1' for writing.", drive->logFilename ), MessageWarning );
+    }
+
+    drive->job->deleteLater();
+    drive->job = 0;
+    drive->percent = 0;
+    drive->bytes = 0;
+
+    if( !d->canceled )
+        Device::eject( drive->device );
+
+    // hand the encoder to a waiting drive
+    AudioEncoderPool::instance()->release( drive->encoder );
+    drive->encoder = 0;
+
+    finishIfDone();
+}
+
+
+void K3b::BatchAudioRipJob::slotUpdateStatus()
+{
+    qint64 bytes = d->bytesDone;
+    int percentSum = 0;
+    Q_FOREACH( Drive* drive, d->drives ) {
+        if( drive->job ) {
+            bytes += drive->bytes * drive->percent / 100;
+            percentSum += drive->percent;
+        }
+    }
+
+    const int ripping = d->ripping();
+    if( ripping > 0 )
+        emit percent( percentSum / ripping );
+
+    // smooth the rate a bit since the drives report in large steps
+    const qint64 elapsed = d->rateTimer.restart();
+    if( elapsed > 0 ) {
+        const double rate = double( bytes - d->lastBytes ) * 1000.0 / double( elapsed );
+        d->bytesPerSecond = ( d->bytesPerSecond > 0.0 ? 0.7*d->bytesPerSecond + 0.3*rate : rate );
+    }
+    d->lastBytes = bytes;
+
+    // 1x audio CD speed is 75 frames per second
+    const double speed = d->bytesPerSecond / double( 75*2352 );
+    emit newSubTask( i18np( "1 disc in progress, %2 done (%3/s, %4x)",
+                            "%1 discs in progress, %2 done (%3/s, %4x)",
+                            ripping,
+                            d->discsDone,
+                            KIO::convertSize( static_cast<KIO::filesize_t>( d->bytesPerSecond ) ),
+                            QString::number( speed, 'f', 1 ) ) );
+}
+
+
+void K3b::BatchAudioRipJob::finishIfDone()
+{
+    if( !d->running || d->ripping() > 0 )
+        return;
+
+    if( !d->canceled ) {
+        if( d->continuous )
+            return;
+
+        // wait for drives which wait for an encoder
+        Q_FOREACH( Drive* drive, d->drives ) {
+            const Medium medium = k3bcore->mediaCache()->medium( drive->device );
+            if( ( medium.content() & Medium::ContentAudio ) &&
+                !medium.sameMedium( drive->lastMedium ) &&
+                !k3bcore->mediaCache()->isBlocked( drive->device ) )
+                return;
+        }
+    }
+
+    d->running = false;
+    d->statusTimer.stop();
+    disconnect( k3bcore->mediaCache(), 0, this, 0 );
+    disconnect( AudioEncoderPool::instance(), 0, this, 0 );
+
+    if( d->discsDone + d->discsFailed + d->discsSkipped == 0 && !d->canceled )
+        emit infoMessage( i18n( "No audio CD found." ), MessageError );
+    else
+        emit infoMessage( i18np( "Ripped 1 disc.", "Ripped %1 discs.", d->discsDone ), MessageInfo );
+
+    jobFinished( !d->canceled && d->discsFailed == 0 && d->discsDone > 0 );
+}
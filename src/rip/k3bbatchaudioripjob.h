@@ -0,0 +1,86 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef _K3B_BATCH_AUDIO_RIP_JOB_H_
+#define _K3B_BATCH_AUDIO_RIP_JOB_H_
+
+#include "k3bjob.h"
+
+#include <QList>
+
+class KConfigGroup;
+
+namespace K3b {
+    namespace Device {
+        class Device;
+    }
+
+    /**
+     * Rips the audio CDs in several drives at the same time.
+     *
+     * Each drive is handled by its own AudioRipJob as soon as an audio CD
+     * is inserted and its CDDB lookup done by the MediaCache is finished.
+     * The encoders are shared via the AudioEncoderPool. Ripped discs are
+     * ejected, in continuous mode the job then waits for the next disc
+     * until it is canceled.
+     *
+     * The files are named like in the AudioRippingDialog. Discs for which
+     * one of the files exists already are skipped. A log of every disc is
+     * written next to its playlist.
+     */
+    class BatchAudioRipJob : public Job
+    {
+        Q_OBJECT
+
+    public:
+        BatchAudioRipJob( JobHandler* hdl, QObject* parent = 0 );
+        ~BatchAudioRipJob();
+
+        void setDevices( const QList<Device::Device*>& devices );
+
+        /**
+         * Keep waiting for new discs once all inserted discs are ripped.
+         */
+        void setContinuous( bool b );
+
+        /**
+         * Reads the settings of the AudioRippingDialog.
+         */
+        void loadSettings( const KConfigGroup& c );
+
+        virtual QString jobDescription() const;
+        virtual QString jobDetails() const;
+
+    public Q_SLOTS:
+        virtual void start();
+        virtual void cancel();
+
+    private Q_SLOTS:
+        void slotMediumChanged( K3b::Device::Device* dev );
+        void slotEncoderReleased();
+        void slotRipInfoMessage( const QString& message, int type );
+        void slotRipPercent( int p );
+        void slotRipFinished( bool success );
+        void slotUpdateStatus();
+
+    private:
+        class Drive;
+        class Private;
+        Private* const d;
+
+        void checkDrive( Drive* drive );
+        bool startRipping( Drive* drive );
+        void finishIfDone();
+    };
+}
+
+#endif
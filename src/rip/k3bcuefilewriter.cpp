@@ -48,6 +48,10 @@ bool K3b::CueFileWriter::save( QTextStream& t )
     t << "REM Cue file written by K3b " << k3bcore->version() << endl
       << endl;
 
+    Q_FOREACH( const QString& comment, m_comments ) {
+        t << "REM " << comment << endl;
+    }
+
     if( !m_cdText.isEmpty() ) {
         t << "PERFORMER \"" << m_cdText.performer() << "\"" << endl;
         t << "TITLE \"" << m_cdText.title() << "\"" << endl;
@@ -69,6 +73,10 @@ bool K3b::CueFileWriter::save( QTextStream& t )
             t << "    TITLE \"" << m_cdText[i].title() << "\"" << endl;
         }
 
+        Q_FOREACH( const QString& comment, m_trackComments.value( i ) ) {
+            t << "    REM " << comment << endl;
+        }
+
         //
         // the pregap is part of the current track like in toc files
         // and not part of the last track as on the CD
@@ -15,6 +15,8 @@
 #ifndef _K3B_CUE_FILE_WRITER_H_
 #define _K3B_CUE_FILE_WRITER_H_
 
+#include <QMap>
+#include <QStringList>
 #include <QTextStream>
 
 #include "k3btoc.h"
@@ -39,11 +41,24 @@ public:
     void setCdText( const Device::CdText& text ) { m_cdText = text; }
     void setImage( const QString& name, const QString& type ) { m_image = name; m_dataType = type; }
 
+    /**
+     * Additional REM lines for the disc like "ACCURATERIPID ...".
+     * The "REM " prefix is added by the writer.
+     */
+    void setComments( const QStringList& comments ) { m_comments = comments; }
+
+    /**
+     * Additional REM lines for the track with the 0-based index \p track.
+     */
+    void setTrackComments( int track, const QStringList& comments ) { m_trackComments[track] = comments; }
+
 private:
     Device::Toc m_toc;
     Device::CdText m_cdText;
     QString m_image;
     QString m_dataType;
+    QStringList m_comments;
+    QMap<int, QStringList> m_trackComments;
 };
 }
 
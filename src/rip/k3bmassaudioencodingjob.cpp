@@ -16,6 +16,7 @@
 #include "k3baudioencoder.h"
 #include "k3bcuefilewriter.h"
 #include "k3bwavefilewriter.h"
+#include "k3bworkerpool.h"
 
 #include <KLocalizedString>
 #include <KCddb/Cdinfo>
@@ -24,7 +25,11 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QIODevice>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
 #include <QTextStream>
+#include <QWaitCondition>
 
 #include <vector>
 #include <algorithm>
@@ -70,6 +75,83 @@ namespace
         MassAudioEncodingJob::Tracks::const_iterator track;
     };
 
+    // chunks of 10 KB read ahead of the encoder
+    const int s_maxQueuedChunks = 16;
+
+    /**
+     * Hands the read data over to the EncodingTask so the
+     * encoder does not have to wait for the source and vice versa.
+     */
+    struct EncodingQueue
+    {
+        EncodingQueue()
+            : closed( false ),
+              running( false ),
+              failed( false ) {
+        }
+
+        QMutex mutex;
+        QWaitCondition changed;
+        QQueue<QByteArray> chunks;
+        bool closed;
+        bool running;
+        bool failed;
+    };
+
+    class EncodingTask : public WorkerPool::Task
+    {
+    public:
+        EncodingTask( EncodingQueue* q, AudioEncoder* enc, WaveFileWriter* writer, bool be )
+            : queue( q ),
+              encoder( enc ),
+              waveFileWriter( writer ),
+              bigEndian( be ) {
+        }
+
+        void run() {
+            bool success = true;
+            QMutexLocker locker( &queue->mutex );
+            while( success ) {
+                while( queue->chunks.isEmpty() && !queue->closed )
+                    queue->changed.wait( &queue->mutex );
+                if( queue->chunks.isEmpty() )
+                    break;
+
+                QByteArray chunk = queue->chunks.dequeue();
+                queue->changed.wakeAll();
+                locker.unlock();
+
+                if( encoder ) {
+                    success = ( encoder->encode( chunk.constData(), chunk.size() ) >= 0 );
+                }
+                else {
+                    waveFileWriter->write( chunk.constData(),
+                                           chunk.size(),
+                                           bigEndian ? WaveFileWriter::BigEndian : WaveFileWriter::LittleEndian );
+                }
+
+                locker.relock();
+            }
+
+            if( !success ) {
+                queue->failed = true;
+                queue->chunks.clear();
+            }
+            queue->running = false;
+            queue->changed.wakeAll();
+            locker.unlock();
+
+            // the queue is not touched anymore, the job may go on
+            delete this;
+        }
+
+    private:
+        EncodingQueue* queue;
+        AudioEncoder* encoder;
+        WaveFileWriter* waveFileWriter;
+        bool bigEndian;
+    };
+
 } // namespace
 
 
@@ -101,9 +183,68 @@ public:
     QString playlistFilename;
     bool relativePathInPlaylist;
     bool writeCueFile;
+
+    EncodingQueue queue;
+
+    void startEncoding();
+
+    /**
+     * Blocks while the encoder is busy with enough data already.
+     * \return false if encoding failed.
+     */
+    bool enqueue( const QByteArray& chunk );
+
+    /**
+     * Waits for the encoder to process all queued data or,
+     * if \p discard is true, drops it.
+     * \return false if encoding failed.
+     */
+    bool finishEncoding( bool discard );
 };
 
 
+void MassAudioEncodingJob::Private::startEncoding()
+{
+    queue.closed = false;
+    queue.running = true;
+    queue.failed = false;
+    WorkerPool::instance()->submit( new EncodingTask( &queue, encoder, waveFileWriter, bigEndian ) );
+}
+
+
+bool MassAudioEncodingJob::Private::enqueue( const QByteArray& chunk )
+{
+    QMutexLocker locker( &queue.mutex );
+    if( queue.chunks.count() >= s_maxQueuedChunks && !queue.failed ) {
+        WorkerPool::BlockingSection blocking;
+        while( queue.chunks.count() >= s_maxQueuedChunks && !queue.failed )
+            queue.changed.wait( &queue.mutex );
+    }
+    if( queue.failed )
+        return false;
+
+    queue.chunks.enqueue( chunk );
+    queue.changed.wakeAll();
+    return true;
+}
+
+
+bool MassAudioEncodingJob::Private::finishEncoding( bool discard )
+{
+    QMutexLocker locker( &queue.mutex );
+    if( discard )
+        queue.chunks.clear();
+    queue.closed = true;
+    queue.changed.wakeAll();
+    if( queue.running ) {
+        WorkerPool::BlockingSection blocking;
+        while( queue.running )
+            queue.changed.wait( &queue.mutex );
+    }
+    return !queue.failed;
+}
+
+
 MassAudioEncodingJob::MassAudioEncodingJob( bool bigEndian, JobHandler* jobHandler, QObject* parent )
     : ThreadJob( jobHandler, parent ),
       d( new Private( bigEndian ) )
@@ -212,6 +353,18 @@ void MassAudioEncodingJob::cleanup()
 }
 
 
+QStringList MassAudioEncodingJob::discComments() const
+{
+    return QStringList();
+}
+
+
+QStringList MassAudioEncodingJob::trackComments( int ) const
+{
+    return QStringList();
+}
+
+
 bool MassAudioEncodingJob::run()
 {
     if ( !init() )
@@ -324,7 +477,7 @@ bool K3b::MassAudioEncodingJob::encodeTrack( int trackIndex, const QString& file
 
             isOpen = d->encoder->openFile( d->fileType, filename, d->lengths[ filename ], metaData );
             if( !isOpen )
-                emit infoMessage( d->encoder->lastErrorString(), K3b::Job::MessageError );
+                emit infoMessage( d->encoder ? d->encoder->lastErrorString() : i18n("Unable to open '%1' for writing.",filename), K3b::Job::MessageError );
         }
         else {
             isOpen = d->waveFileWriter->open( filename );
@@ -351,33 +504,27 @@ bool K3b::MassAudioEncodingJob::encodeTrack( int trackIndex, const QString& file
         return false;
     }
 
-    while( !canceled() && !source->atEnd() && ( readLength = source->read( buffer, bufferLength ) ) > 0 ) {
-
-        if( d->encoder ) {
+    // the encoder runs in its own task while we read the next chunks
+    d->startEncoding();
+    bool encoded = true;
 
-            if( d->bigEndian ) {
-                // the tracks produce big endian samples
-                // and encoder encoder consumes little endian
-                // so we need to swap the bytes here
-                char b;
-                for( qint64 i = 0; i < bufferLength-1; i+=2 ) {
-                    b = buffer[i];
-                    buffer[i] = buffer[i+1];
-                    buffer[i+1] = b;
-                }
-            }
+    while( !canceled() && !source->atEnd() && ( readLength = source->read( buffer, bufferLength ) ) > 0 ) {
 
-            if( d->encoder->encode( buffer, readLength ) < 0 ) {
-                qDebug() << "error while encoding.";
-                emit infoMessage( d->encoder->lastErrorString(), K3b::Job::MessageError );
-                emit infoMessage( i18n("Error while encoding track %1.",trackIndex), K3b::Job::MessageError );
-                return false;
+        if( d->encoder && d->bigEndian ) {
+            // the tracks produce big endian samples
+            // and encoder encoder consumes little endian
+            // so we need to swap the bytes here
+            char b;
+            for( qint64 i = 0; i < readLength-1; i+=2 ) {
+                b = buffer[i];
+                buffer[i] = buffer[i+1];
+                buffer[i+1] = b;
             }
         }
-        else {
-            d->waveFileWriter->write( buffer,
-                                      readLength,
-                                      d->bigEndian ? WaveFileWriter::BigEndian : WaveFileWriter::LittleEndian );
+
+        if( !d->enqueue( QByteArray( buffer, readLength ) ) ) {
+            encoded = false;
+            break;
         }
 
         d->overallBytesRead += readLength;
@@ -386,6 +533,14 @@ bool K3b::MassAudioEncodingJob::encodeTrack( int trackIndex, const QString& file
         emit percent( 100LL*d->overallBytesRead/d->overallBytesToRead );
     }
 
+    encoded = d->finishEncoding( !encoded || canceled() ) && encoded;
+    if( !encoded ) {
+        qDebug() << "error while encoding.";
+        emit infoMessage( d->encoder ? d->encoder->lastErrorString() : i18n("Unable to write to '%1'.",filename), K3b::Job::MessageError );
+        emit infoMessage( i18n("Error while encoding track %1.",trackIndex), K3b::Job::MessageError );
+        return false;
+    }
+
     if( !canceled() && !source->atEnd() ) {
         emit infoMessage( source->errorString(), Job::MessageError );
         return false;
@@ -485,12 +640,14 @@ bool MassAudioEncodingJob::writeCueFile()
 
             text.track(i).setPerformer( d->cddbEntry.track( trackNum-1 ).get( KCDDB::Artist ).toString() );
             text.track(i).setTitle( d->cddbEntry.track( trackNum-1 ).get( KCDDB::Title ).toString() );
+            cueWriter.setTrackComments( i, trackComments( trackNum ) );
             
             currentSector += length;
         }
 
         cueWriter.setData( toc );
         cueWriter.setCdText( text );
+        cueWriter.setComments( discComments() );
         
         QFileInfo fileInfo( filename );
 
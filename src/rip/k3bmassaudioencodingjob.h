@@ -22,6 +22,7 @@
 #include <QMultiMap>
 #include <QScopedPointer>
 #include <QString>
+#include <QStringList>
 
 class QIODevice;
 
@@ -120,6 +121,17 @@ namespace K3b {
          * Prints information about previously processed track
          */
         virtual void trackFinished( int trackIndex, const QString& filename ) = 0;
+
+        /**
+         * Additional REM lines for the cue file. By default there are none.
+         */
+        virtual QStringList discComments() const;
+
+        /**
+         * Additional REM lines for a track in the cue file. By default there are none.
+         * @param trackIndex 1-based track index
+         */
+        virtual QStringList trackComments( int trackIndex ) const;
         
     private:
         virtual bool run();
@@ -0,0 +1,189 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+#include "k3baccurateriptest.h"
+#include "k3baccuraterip.h"
+#include "k3bcrc.h"
+#include "k3btoc.h"
+#include "k3btrack.h"
+
+#include <QDataStream>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QTest>
+
+QTEST_GUILESS_MAIN( AccurateRipTest )
+
+namespace {
+    const int s_window = 300;
+    const int s_starts[] = { 0, 20, 35, 60 };
+
+    K3b::Device::Toc createToc()
+    {
+        K3b::Device::Toc toc;
+        for( int i = 0; i < 3; ++i )
+            toc.append( K3b::Device::Track( s_starts[i], s_starts[i+1]-1, K3b::Device::Track::TYPE_AUDIO ) );
+        return toc;
+    }
+
+    QVector<quint32> createSamples()
+    {
+        QVector<quint32> samples( s_starts[3]*588 );
+        quint32 x = 1;
+        for( int i = 0; i < samples.count(); ++i ) {
+            x = x*1664525 + 1013904223;
+            samples[i] = x;
+        }
+        return samples;
+    }
+
+    // feeds the tracks in odd chunks to test samples split between calls
+    void processDisc( K3b::AccurateRip& ar, const QVector<quint32>& samples )
+    {
+        for( int t = 0; t < 3; ++t ) {
+            ar.beginTrack( t+1 );
+            const char* data = reinterpret_cast<const char*>( samples.constData() + s_starts[t]*588 );
+            const qint64 len = qint64( s_starts[t+1] - s_starts[t] ) * 2352;
+            qint64 pos = 0;
+            int chunk = 7;
+            while( pos < len ) {
+                const qint64 n = qMin<qint64>( chunk, len - pos );
+                ar.process( data + pos, n );
+                pos += n;
+                chunk = ( chunk*13 + 5 ) % 5000 + 1;
+            }
+            ar.endTrack();
+        }
+    }
+
+    // the straight-forward definition of the AccurateRip checksum
+    quint32 checksum( const QVector<quint32>& samples, int track, int offset, bool v2 )
+    {
+        const qint64 n = qint64( s_starts[track+1] - s_starts[track] ) * 588;
+        const qint64 first = ( track == 0 ? 5*588 : 1 );
+        const qint64 last = ( track == 2 ? n - 5*588 : n );
+        const qint64 base = qint64( s_starts[track] ) * 588 - 1 + offset;
+        quint32 c = 0;
+        for( qint64 i = first; i <= last; ++i ) {
+            const quint64 product = quint64( samples[base+i] ) * quint64( i );
+            c += quint32( product );
+            if( v2 )
+                c += quint32( product >> 32 );
+        }
+        return c;
+    }
+}
+
+
+AccurateRipTest::AccurateRipTest()
+{
+}
+
+
+void AccurateRipTest::testChecksums()
+{
+    const QVector<quint32> samples = createSamples();
+    K3b::AccurateRip ar( createToc(), s_window );
+    processDisc( ar, samples );
+
+    for( int t = 0; t < 3; ++t ) {
+        const K3b::AccurateRip::TrackResult r = ar.result( t+1 );
+        QVERIFY( r.valid );
+        QCOMPARE( r.v1, checksum( samples, t, 0, false ) );
+        QCOMPARE( r.v2, checksum( samples, t, 0, true ) );
+
+        const int offset = s_starts[t]*588;
+        const int length = ( s_starts[t+1] - s_starts[t] ) * 588;
+        QCOMPARE( r.crc32, K3b::Device::calcCrc32( reinterpret_cast<const unsigned char*>( samples.constData() + offset ),
+                                                   length*4 ) );
+    }
+
+    // a track which was not processed
+    K3b::AccurateRip ar2( createToc(), s_window );
+    QVERIFY( !ar2.result( 2 ).valid );
+}
+
+
+void AccurateRipTest::testOffsets()
+{
+    const QVector<quint32> samples = createSamples();
+    K3b::AccurateRip ar( createToc(), s_window );
+    QCOMPARE( ar.offsetWindow(), s_window );
+    processDisc( ar, samples );
+
+    for( int t = 0; t < 3; ++t ) {
+        const K3b::AccurateRip::TrackResult r = ar.result( t+1 );
+        QCOMPARE( r.offsetV1.count(), 2*s_window+1 );
+        for( int k = -s_window; k <= s_window; k += 37 )
+            QCOMPARE( r.offsetV1[s_window+k], checksum( samples, t, k, false ) );
+        QCOMPARE( r.offsetV1[0], checksum( samples, t, -s_window, false ) );
+        QCOMPARE( r.offsetV1[2*s_window], checksum( samples, t, s_window, false ) );
+
+        QList<K3b::AccurateRip::DatabaseEntry> entries;
+        entries << K3b::AccurateRip::DatabaseEntry{ 3, r.offsetV1[s_window+123] };
+        K3b::AccurateRip::Match m = ar.match( t+1, entries );
+        QCOMPARE( m.confidence, 3 );
+        QCOMPARE( m.offset, 123 );
+
+        // the unshifted checksum wins
+        entries << K3b::AccurateRip::DatabaseEntry{ 2, r.v2 };
+        m = ar.match( t+1, entries );
+        QCOMPARE( m.confidence, 2 );
+        QCOMPARE( m.offset, 0 );
+        QVERIFY( m.v2 );
+    }
+}
+
+
+void AccurateRipTest::testDatabase()
+{
+    const QVector<quint32> samples = createSamples();
+    K3b::AccurateRip ar( createToc(), s_window );
+    processDisc( ar, samples );
+
+    // offsets 0 + 20 + 35, lead-out 60
+    const QStringList ids = ar.discId().split( '-' );
+    QCOMPARE( ids.count(), 4 );
+    QCOMPARE( ids[0], QString( "003" ) );
+    QCOMPARE( ids[1], QString( "00000073" ) );
+    QCOMPARE( ids[2], QString( "00000182" ) );
+    QCOMPARE( ar.databaseFilename(), QString( "dBAR-" ) + ar.discId() + ".bin" );
+
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+    QDataStream s( &file );
+    s.setByteOrder( QDataStream::LittleEndian );
+    // two pressings
+    for( int pressing = 0; pressing < 2; ++pressing ) {
+        s << quint8( 3 ) << ids[1].toUInt( 0, 16 ) << ids[2].toUInt( 0, 16 ) << ids[3].toUInt( 0, 16 );
+        for( int t = 0; t < 3; ++t ) {
+            const quint32 crc = ( pressing == 0 ? ar.result( t+1 ).v1 : 0xdeadbeef );
+            s << quint8( 10+t ) << crc << quint32( 0 );
+        }
+    }
+    file.close();
+
+    const QList<QList<K3b::AccurateRip::DatabaseEntry> > database = ar.loadDatabase( file.fileName() );
+    QCOMPARE( database.count(), 3 );
+    for( int t = 0; t < 3; ++t ) {
+        QCOMPARE( database[t].count(), 2 );
+        const K3b::AccurateRip::Match m = ar.match( t+1, database[t] );
+        QCOMPARE( m.confidence, 10+t );
+        QCOMPARE( m.offset, 0 );
+        QVERIFY( !m.v2 );
+    }
+
+    // a database of another disc
+    K3b::Device::Toc other = createToc();
+    other.removeLast();
+    K3b::AccurateRip ar2( other );
+    QVERIFY( ar2.loadDatabase( file.fileName() ).isEmpty() );
+}
@@ -0,0 +1,165 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baudiodoctest.h"
+#include "k3baudiodoc.h"
+#include "k3baudiotrack.h"
+#include "k3baudiozerodata.h"
+
+#include <QList>
+#include <QTest>
+
+QTEST_GUILESS_MAIN( AudioDocTest )
+
+namespace {
+    /**
+     * A doc with one track of silence per entry of \p lengths.
+     */
+    QList<K3b::AudioTrack*> fillDoc( K3b::AudioDoc& doc, const QList<int>& lengths )
+    {
+        QList<K3b::AudioTrack*> tracks;
+        Q_FOREACH( int length, lengths ) {
+            K3b::AudioTrack* track = new K3b::AudioTrack();
+            track->addSource( new K3b::AudioZeroData( length ) );
+            doc.addTrack( track, doc.numOfTracks() );
+            tracks.append( track );
+        }
+        return tracks;
+    }
+
+    /**
+     * Compares the cached values of the doc with the linked list and
+     * the expected track lengths.
+     */
+    void checkDoc( K3b::AudioDoc& doc, const QList<K3b::AudioTrack*>& tracks, const QList<int>& lengths )
+    {
+        QCOMPARE( doc.numOfTracks(), tracks.count() );
+
+        K3b::AudioTrack* track = doc.firstTrack();
+        int total = 0;
+        for( int i = 0; i < tracks.count(); ++i ) {
+            QCOMPARE( track, tracks[i] );
+            QCOMPARE( doc.getTrack( i+1 ), tracks[i] );
+            QCOMPARE( int( tracks[i]->trackNumber() ), i+1 );
+            QCOMPARE( tracks[i]->length().lba(), lengths[i] );
+            total += lengths[i];
+            track = track->next();
+        }
+        QVERIFY( track == 0 );
+        QCOMPARE( doc.lastTrack(), tracks.isEmpty() ? static_cast<K3b::AudioTrack*>( 0 ) : tracks.last() );
+        QCOMPARE( doc.getTrack( tracks.count()+1 ), static_cast<K3b::AudioTrack*>( 0 ) );
+        QCOMPARE( doc.length().lba(), total );
+    }
+}
+
+
+AudioDocTest::AudioDocTest()
+{
+}
+
+
+void AudioDocTest::testTake()
+{
+    K3b::AudioDoc doc;
+    QList<K3b::AudioTrack*> tracks = fillDoc( doc, QList<int>() << 100 << 200 << 300 << 400 );
+    checkDoc( doc, tracks, QList<int>() << 100 << 200 << 300 << 400 );
+
+    K3b::AudioTrack* taken = tracks.takeAt( 1 )->take();
+    checkDoc( doc, tracks, QList<int>() << 100 << 300 << 400 );
+
+    // the taken track is not part of the doc anymore
+    QCOMPARE( taken->trackNumber(), 1U );
+    QCOMPARE( taken->length().lba(), 200 );
+    delete taken;
+
+    delete tracks.takeLast()->take();
+    checkDoc( doc, tracks, QList<int>() << 100 << 300 );
+
+    delete tracks.takeFirst()->take();
+    checkDoc( doc, tracks, QList<int>() << 300 );
+}
+
+
+void AudioDocTest::testMoveAfter()
+{
+    K3b::AudioDoc doc;
+    QList<K3b::AudioTrack*> tracks = fillDoc( doc, QList<int>() << 100 << 200 << 300 << 400 );
+    checkDoc( doc, tracks, QList<int>() << 100 << 200 << 300 << 400 );
+
+    // the first track behind the third one
+    tracks[0]->moveAfter( tracks[2] );
+    tracks.move( 0, 2 );
+    checkDoc( doc, tracks, QList<int>() << 200 << 300 << 100 << 400 );
+
+    // the last track to the front
+    tracks[3]->moveAhead( tracks[0] );
+    tracks.move( 3, 0 );
+    checkDoc( doc, tracks, QList<int>() << 400 << 200 << 300 << 100 );
+
+    // the second track to the end
+    tracks[1]->moveAfter( 0 );
+    tracks.move( 1, 3 );
+    checkDoc( doc, tracks, QList<int>() << 400 << 300 << 100 << 200 );
+}
+
+
+void AudioDocTest::testMerge()
+{
+    K3b::AudioDoc doc;
+    QList<K3b::AudioTrack*> tracks = fillDoc( doc, QList<int>() << 100 << 200 << 300 << 400 );
+    checkDoc( doc, tracks, QList<int>() << 100 << 200 << 300 << 400 );
+
+    // merge deletes the merged track
+    tracks[1]->merge( tracks[2], tracks[1]->lastSource() );
+    tracks.removeAt( 2 );
+    checkDoc( doc, tracks, QList<int>() << 100 << 500 << 400 );
+
+    tracks[0]->merge( tracks[2], tracks[0]->lastSource() );
+    tracks.removeAt( 2 );
+    checkDoc( doc, tracks, QList<int>() << 500 << 500 );
+}
+
+
+void AudioDocTest::testSplit()
+{
+    K3b::AudioDoc doc;
+    QList<K3b::AudioTrack*> tracks = fillDoc( doc, QList<int>() << 100 << 200 << 300 << 400 );
+    checkDoc( doc, tracks, QList<int>() << 100 << 200 << 300 << 400 );
+
+    K3b::AudioTrack* split = tracks[2]->split( 120 );
+    QVERIFY( split != 0 );
+    tracks.insert( 3, split );
+    checkDoc( doc, tracks, QList<int>() << 100 << 200 << 120 << 180 << 400 );
+
+    split = tracks[0]->split( 50 );
+    QVERIFY( split != 0 );
+    tracks.insert( 1, split );
+    checkDoc( doc, tracks, QList<int>() << 50 << 50 << 200 << 120 << 180 << 400 );
+
+    // splitting at the end does nothing
+    QVERIFY( tracks[5]->split( 400 ) == 0 );
+    checkDoc( doc, tracks, QList<int>() << 50 << 50 << 200 << 120 << 180 << 400 );
+}
+
+
+void AudioDocTest::testSourceLength()
+{
+    K3b::AudioDoc doc;
+    QList<K3b::AudioTrack*> tracks = fillDoc( doc, QList<int>() << 100 << 200 << 300 );
+    checkDoc( doc, tracks, QList<int>() << 100 << 200 << 300 );
+
+    static_cast<K3b::AudioZeroData*>( tracks[1]->firstSource() )->setLength( 250 );
+    checkDoc( doc, tracks, QList<int>() << 100 << 250 << 300 );
+
+    tracks[0]->addSource( new K3b::AudioZeroData( 10 ) );
+    checkDoc( doc, tracks, QList<int>() << 110 << 250 << 300 );
+}
@@ -0,0 +1,92 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baudioloudnesstest.h"
+#include "k3baudioloudness.h"
+
+#include <QByteArray>
+#include <QTest>
+
+#include <cmath>
+
+QTEST_GUILESS_MAIN( AudioLoudnessTest )
+
+namespace {
+    // a 1 kHz sine in both channels as 16 bit big endian samples
+    QByteArray sine( double amplitudeDb, int seconds )
+    {
+        const int frames = 44100 * seconds;
+        const double amplitude = 32767.0 * ::pow( 10.0, amplitudeDb / 20.0 );
+        QByteArray data( frames * 4, 0 );
+        for( int i = 0; i < frames; ++i ) {
+            const int s = static_cast<int>( ::lround( amplitude * ::sin( 2.0 * M_PI * 1000.0 * i / 44100.0 ) ) );
+            for( int c = 0; c < 2; ++c ) {
+                data[4*i+2*c] = static_cast<char>( ( s >> 8 ) & 0xff );
+                data[4*i+2*c+1] = static_cast<char>( s & 0xff );
+            }
+        }
+        return data;
+    }
+}
+
+
+AudioLoudnessTest::AudioLoudnessTest()
+{
+}
+
+
+void AudioLoudnessTest::testSine()
+{
+    // EBU Tech 3341: a stereo 1 kHz sine at -23 dBFS reads -23 LUFS
+    const QByteArray data = sine( -23.0, 5 );
+
+    K3b::AudioLoudnessMeter meter;
+    // odd chunks must not matter
+    for( int i = 0; i < data.size(); i += 777 )
+        meter.process( data.constData() + i, qMin( 777, data.size() - i ) );
+
+    QVERIFY( qAbs( meter.integratedLoudness() + 23.0 ) < 0.1 );
+    QVERIFY( qAbs( meter.samplePeak() - ::pow( 10.0, -23.0/20.0 ) ) < 0.001 );
+
+    meter.reset();
+    meter.process( data.constData(), data.size() );
+    QVERIFY( qAbs( meter.integratedLoudness() + 23.0 ) < 0.1 );
+}
+
+
+void AudioLoudnessTest::testSilence()
+{
+    const QByteArray data( 44100 * 4 * 2, 0 );
+    K3b::AudioLoudnessMeter meter;
+    meter.process( data.constData(), data.size() );
+    QVERIFY( std::isinf( meter.integratedLoudness() ) );
+    QCOMPARE( K3b::AudioLoudnessMeter::gain( meter.integratedLoudness(), meter.samplePeak() ), 1.0 );
+}
+
+
+void AudioLoudnessTest::testGain()
+{
+    // -23 LUFS is brought up by 5 dB
+    QVERIFY( qAbs( K3b::AudioLoudnessMeter::gain( -23.0, 0.1 ) - ::pow( 10.0, 5.0/20.0 ) ) < 0.0001 );
+
+    // but never beyond full scale
+    QCOMPARE( K3b::AudioLoudnessMeter::gain( -30.0, 0.5 ), 2.0 );
+
+    char samples[] = { 0x40, 0x00, char(0xc0), 0x00, 0x01, 0x00 };
+    K3b::AudioLoudnessMeter::applyGain( samples, sizeof(samples), 3.0 );
+    QCOMPARE( samples[0], char(0x7f) );
+    QCOMPARE( samples[1], char(0xff) );
+    QCOMPARE( samples[2], char(0x80) );
+    QCOMPARE( samples[3], char(0x00) );
+    QCOMPARE( samples[4], char(0x03) );
+    QCOMPARE( samples[5], char(0x00) );
+}
@@ -0,0 +1,107 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3baudiopeakstest.h"
+#include "k3baudiopeaks.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QTest>
+
+QTEST_GUILESS_MAIN( AudioPeaksTest )
+
+namespace {
+    K3b::AudioPeaks::Peak makePeak( qint16 amplitude )
+    {
+        K3b::AudioPeaks::Peak p;
+        p.min = -amplitude;
+        p.max = amplitude;
+        p.rms = amplitude/2;
+        return p;
+    }
+}
+
+
+AudioPeaksTest::AudioPeaksTest()
+{
+}
+
+
+void AudioPeaksTest::testPeak()
+{
+    QVector<K3b::AudioPeaks::Peak> frames( 1000, makePeak( 100 ) );
+    frames[700] = makePeak( 20000 );
+    K3b::AudioPeaks peaks( frames );
+
+    QCOMPARE( peaks.length().lba(), 1000 );
+    QCOMPARE( peaks.peak( 0, 999 ).max, qint16( 20000 ) );
+    QCOMPARE( peaks.peak( 0, 999 ).min, qint16( -20000 ) );
+    QCOMPARE( peaks.peak( 700, 700 ).max, qint16( 20000 ) );
+    QCOMPARE( peaks.peak( 0, 511 ).max, qint16( 100 ) );
+    QCOMPARE( peaks.peak( 701, 999 ).max, qint16( 100 ) );
+
+    // out of range values are clamped
+    QCOMPARE( peaks.peak( 990, 5000 ).max, qint16( 100 ) );
+
+    QVERIFY( K3b::AudioPeaks().isNull() );
+    QCOMPARE( K3b::AudioPeaks().peak( 0, 10 ).max, qint16( 0 ) );
+}
+
+
+void AudioPeaksTest::testSilenceSplitPoints()
+{
+    // sound - 2 seconds silence - sound - short pause - sound - silence
+    QVector<K3b::AudioPeaks::Peak> frames;
+    frames += QVector<K3b::AudioPeaks::Peak>( 750, makePeak( 10000 ) );
+    frames += QVector<K3b::AudioPeaks::Peak>( 150, makePeak( 10 ) );
+    frames += QVector<K3b::AudioPeaks::Peak>( 750, makePeak( 10000 ) );
+    frames += QVector<K3b::AudioPeaks::Peak>( 10, makePeak( 0 ) );
+    frames += QVector<K3b::AudioPeaks::Peak>( 750, makePeak( 10000 ) );
+    frames += QVector<K3b::AudioPeaks::Peak>( 300, makePeak( 0 ) );
+
+    QList<K3b::Msf> points = K3b::AudioPeaks( frames ).silenceSplitPoints();
+    QCOMPARE( points.count(), 1 );
+    QCOMPARE( points.first().lba(), 900 );
+
+    points = K3b::AudioPeaks( frames ).silenceSplitPoints( -50.0, 5 );
+    QCOMPARE( points.count(), 2 );
+    QCOMPARE( points.last().lba(), 1660 );
+}
+
+
+void AudioPeaksTest::testSaveLoad()
+{
+    QVector<K3b::AudioPeaks::Peak> frames;
+    for( int i = 0; i < 777; ++i )
+        frames.append( makePeak( i*10 ) );
+    K3b::AudioPeaks peaks( frames );
+
+    QBuffer buffer;
+    buffer.open( QIODevice::ReadWrite );
+    QDataStream out( &buffer );
+    peaks.save( out );
+
+    buffer.seek( 0 );
+    QDataStream in( &buffer );
+    K3b::AudioPeaks loaded = K3b::AudioPeaks::load( in );
+    QVERIFY( !loaded.isNull() );
+    QCOMPARE( loaded.length(), peaks.length() );
+    QCOMPARE( loaded.peak( 100, 400 ).max, peaks.peak( 100, 400 ).max );
+    QCOMPARE( loaded.peak( 100, 400 ).rms, peaks.peak( 100, 400 ).rms );
+
+    // truncated data is rejected
+    QBuffer truncated;
+    truncated.setData( buffer.data().left( buffer.size()/2 ) );
+    truncated.open( QIODevice::ReadOnly );
+    QDataStream in2( &truncated );
+    QVERIFY( K3b::AudioPeaks::load( in2 ).isNull() );
+}
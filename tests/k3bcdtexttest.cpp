@@ -0,0 +1,131 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bcdtexttest.h"
+#include "k3bcdtext.h"
+
+#include <QTest>
+
+QTEST_GUILESS_MAIN( CdTextTest )
+
+using K3b::Device::CdText;
+
+namespace {
+    CdText createCdText( const QString& title, int tracks )
+    {
+        CdText text;
+        text.setTitle( title );
+        text.setPerformer( "Some Performer" );
+        for( int i = 0; i < tracks; ++i ) {
+            text.track( i ).setTitle( QString( "Track number %1 of %2" ).arg( i+1 ).arg( title ) );
+            text.track( i ).setPerformer( "Some Performer" );
+        }
+        return text;
+    }
+}
+
+
+CdTextTest::CdTextTest()
+{
+}
+
+
+void CdTextTest::testRoundTrip()
+{
+    CdText text = createCdText( "An Album With A Long Title", 12 );
+    text.track( 3 ).setIsrc( "USABC0100001" );
+
+    const QByteArray raw = text.rawPackData();
+    QCOMPARE( raw.size() % 18, 4 );
+    QVERIFY( CdText::checkCrc( raw ) );
+
+    CdText parsed( raw );
+    QVERIFY( parsed == text );
+    QCOMPARE( parsed.count(), 12 );
+    QCOMPARE( parsed.track( 3 ).isrc(), QString( "USABC0100001" ) );
+    QCOMPARE( parsed.blockCount(), 1 );
+    QCOMPARE( parsed.languageCode(), 0x09 );
+
+    // the original data is kept
+    QCOMPARE( parsed.rawPackData(), raw );
+}
+
+
+void CdTextTest::testIncrementalEncoding()
+{
+    CdText text = createCdText( "An Album", 10 );
+    const QByteArray before = text.rawPackData();
+
+    text.track( 4 ).setTitle( "A title which needs more packs than the old one" );
+    const QByteArray after = text.rawPackData();
+    QVERIFY( after != before );
+
+    CdText expected = createCdText( "An Album", 10 );
+    expected.track( 4 ).setTitle( "A title which needs more packs than the old one" );
+    QCOMPARE( after, expected.rawPackData() );
+
+    // changes to parsed CD-Text are encoded, too
+    CdText parsed( before );
+    parsed.track( 4 ).setTitle( "A title which needs more packs than the old one" );
+    QCOMPARE( parsed.rawPackData(), after );
+}
+
+
+void CdTextTest::testRepairCrc()
+{
+    const QByteArray raw = createCdText( "An Album", 5 ).rawPackData();
+
+    // missing crc in the second pack
+    QByteArray data = raw;
+    data[4+18+16] = 0;
+    data[4+18+17] = 0;
+    QVERIFY( !CdText::checkCrc( data ) );
+    QCOMPARE( CdText::repairCrc( data ), 0 );
+    QCOMPARE( data, raw );
+
+    // broken data cannot be repaired
+    data[4+18+5] = data[4+18+5] ^ 0x1;
+    QCOMPARE( CdText::repairCrc( data ), 1 );
+
+    data.chop( 1 );
+    QCOMPARE( CdText::repairCrc( data ), -1 );
+}
+
+
+void CdTextTest::testLanguageBlocks()
+{
+    QByteArray english = createCdText( "An Album", 3 ).rawPackData();
+    CdText germanText = createCdText( "Ein Album", 3 );
+    germanText.setLanguageCode( 0x08 );
+    QByteArray german = germanText.rawPackData();
+
+    // move the german packs to block 1 which uses language_codes[1]
+    for( int i = 4; i < german.size(); i += 18 ) {
+        german[i+3] = german[i+3] | 0x10;
+        if( static_cast<unsigned char>( german[i] ) == 0x8f && german[i+1] == char( 2 ) )
+            german[i+4+5] = 0x08;
+        german[i+16] = german[i+17] = 0;
+    }
+    QCOMPARE( CdText::repairCrc( german ), 0 );
+
+    QByteArray raw = english + german.mid( 4 );
+    raw[0] = ( raw.size()-2 ) >> 8;
+    raw[1] = ( raw.size()-2 ) & 0xff;
+
+    CdText parsed( raw );
+    QCOMPARE( parsed.blockCount(), 2 );
+    QCOMPARE( parsed.title(), QString( "An Album" ) );
+    QCOMPARE( parsed.languageCode(), 0x09 );
+    QCOMPARE( parsed.block( 1 ).title(), QString( "Ein Album" ) );
+    QCOMPARE( parsed.block( 1 ).track( 2 ).title(), QString( "Track number 3 of Ein Album" ) );
+    QCOMPARE( parsed.block( 1 ).languageCode(), 0x08 );
+}
@@ -0,0 +1,204 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bclonereadertest.h"
+#include "k3bclonereader.h"
+#include "k3bcrc.h"
+
+#include <QHash>
+#include <QTest>
+
+#include <string.h>
+
+QTEST_GUILESS_MAIN( CloneReaderTest )
+
+namespace {
+    const int s_sectorSize = 2448;
+
+    void setLe32( unsigned char* p, quint32 v )
+    {
+        for( int i = 0; i < 4; ++i )
+            p[i] = ( v >> (8*i) ) & 0xff;
+    }
+
+    // a mode 1 sector with valid EDC followed by raw P-W with a valid Q CRC
+    void makeSector( unsigned char* sector, int lba )
+    {
+        for( int i = 0; i < 2352; ++i )
+            sector[i] = ( i*7 + lba ) & 0xff;
+        sector[0] = sector[11] = 0x00;
+        ::memset( sector+1, 0xff, 10 );
+        sector[15] = 1;
+        setLe32( sector+2064, K3b::Device::calcEdc( sector, 2064 ) );
+
+        unsigned char q[12] = { 0x41, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+        q[9] = lba & 0xff;
+        const quint16 crc = ~K3b::Device::calcX25( q, 10 );
+        q[10] = crc >> 8;
+        q[11] = crc & 0xff;
+
+        unsigned char* pw = sector + 2352;
+        for( int i = 0; i < 96; ++i )
+            pw[i] = ( ( q[i/8] >> ( 7 - i%8 ) ) & 0x1 ) << 6;
+    }
+
+    /**
+     * A drive with a limited transfer size and sectors which fail
+     * or come back broken a number of times.
+     */
+    class FakeReader : public K3b::CloneReader
+    {
+    public:
+        explicit FakeReader( int maxTransfer )
+            : K3b::CloneReader( 0 ),
+              reads( 0 ),
+              m_maxTransfer( maxTransfer ) {
+        }
+
+        bool readSectors( unsigned char* buffer, int start, int count ) {
+            ++reads;
+            if( count > m_maxTransfer )
+                return false;
+            for( int i = start; i < start + count; ++i ) {
+                if( unreadable.contains( i ) )
+                    return false;
+            }
+            for( int i = start; i < start + count; ++i ) {
+                unsigned char* sector = buffer + ( i - start )*s_sectorSize;
+                makeSector( sector, i );
+                if( brokenEdc.value( i ) != 0 ) {
+                    sector[1000] ^= 0x80;
+                    if( brokenEdc[i] > 0 )
+                        --brokenEdc[i];
+                }
+                if( brokenSubchannel.value( i ) != 0 ) {
+                    sector[2352+40] ^= 0x40;
+                    if( brokenSubchannel[i] > 0 )
+                        --brokenSubchannel[i];
+                }
+            }
+            return true;
+        }
+
+        int probe( int sectors ) { return probeTransferSize( sectors ); }
+
+        bool verify( int sector ) {
+            unsigned char buffer[s_sectorSize];
+            readSectors( buffer, sector, 1 );
+            reads = 0;
+            return verifySector( buffer, sector );
+        }
+
+        QList<int> unreadable;
+
+        // the number of reads which return broken data, -1 for all
+        QHash<int, int> brokenEdc;
+        QHash<int, int> brokenSubchannel;
+
+        int reads;
+
+    private:
+        int m_maxTransfer;
+    };
+}
+
+
+CloneReaderTest::CloneReaderTest()
+{
+}
+
+void CloneReaderTest::testProbeTransferSize()
+{
+    FakeReader reader( 24 );
+    QCOMPARE( reader.probe( 1000 ), 16 );
+
+    FakeReader fast( 1000 );
+    QCOMPARE( fast.probe( 1000 ), 64 );
+
+    // a disc shorter than the maximum
+    QCOMPARE( fast.probe( 10 ), 10 );
+}
+
+void CloneReaderTest::testProbeBadFirstSector()
+{
+    // only failing at lba 0 must not make the whole disc being read sector by sector
+    FakeReader reader( 1000 );
+    reader.unreadable << 0;
+    QCOMPARE( reader.probe( 1000 ), 64 );
+
+    // a bad sector in the first half of the probed range
+    FakeReader limited( 32 );
+    limited.unreadable << 20;
+    QCOMPARE( limited.probe( 1000 ), 32 );
+}
+
+void CloneReaderTest::testProbeUnreadable()
+{
+    FakeReader reader( 1000 );
+    for( int i = 0; i < 100; ++i )
+        reader.unreadable << i;
+    QCOMPARE( reader.probe( 100 ), 1 );
+}
+
+void CloneReaderTest::testVerifyRecovered()
+{
+    FakeReader reader( 64 );
+    reader.brokenEdc.insert( 5, 3 );
+    QVERIFY( reader.verify( 5 ) );
+    QCOMPARE( reader.reads, 3 );
+
+    QCOMPARE( reader.errorMap().count(), 1 );
+    QCOMPARE( reader.errorMap().first().first, 5 );
+    QCOMPARE( reader.errorMap().first().type, K3b::CloneReader::ERROR_RECOVERED );
+}
+
+void CloneReaderTest::testVerifyBrokenEdc()
+{
+    FakeReader reader( 64 );
+    reader.setRetries( 10 );
+    for( int i = 10; i < 13; ++i )
+        reader.brokenEdc.insert( i, -1 );
+
+    for( int i = 10; i < 13; ++i )
+        QVERIFY( !reader.verify( i ) );
+    QCOMPARE( reader.reads, 10 );
+
+    // consecutive sectors are combined
+    QCOMPARE( reader.errorMap().count(), 1 );
+    QCOMPARE( reader.errorMap().first().first, 10 );
+    QCOMPARE( reader.errorMap().first().last, 12 );
+    QCOMPARE( reader.errorMap().first().type, K3b::CloneReader::ERROR_EDC );
+}
+
+void CloneReaderTest::testVerifyNoCorrection()
+{
+    FakeReader reader( 64 );
+    reader.setNoCorrection( true );
+    reader.brokenEdc.insert( 7, -1 );
+
+    QVERIFY( !reader.verify( 7 ) );
+    QCOMPARE( reader.reads, 0 );
+    QCOMPARE( reader.errorMap().count(), 1 );
+    QCOMPARE( reader.errorMap().first().type, K3b::CloneReader::ERROR_EDC );
+}
+
+void CloneReaderTest::testVerifyBrokenSubchannel()
+{
+    FakeReader reader( 64 );
+    reader.brokenSubchannel.insert( 3, -1 );
+
+    // broken Q data is part of some copy protections, thus fewer retries
+    QVERIFY( !reader.verify( 3 ) );
+    QCOMPARE( reader.reads, 8 );
+    QCOMPARE( reader.errorMap().count(), 1 );
+    QCOMPARE( reader.errorMap().first().type, K3b::CloneReader::ERROR_SUBCHANNEL );
+}
@@ -0,0 +1,33 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef K3B_CLONE_READER_TEST_H
+#define K3B_CLONE_READER_TEST_H
+
+#include <QObject>
+
+class CloneReaderTest : public QObject
+{
+    Q_OBJECT
+public:
+    CloneReaderTest();
+private slots:
+    void testProbeTransferSize();
+    void testProbeBadFirstSector();
+    void testProbeUnreadable();
+    void testVerifyRecovered();
+    void testVerifyBrokenEdc();
+    void testVerifyNoCorrection();
+    void testVerifyBrokenSubchannel();
+};
+
+#endif // K3B_CLONE_READER_TEST_H
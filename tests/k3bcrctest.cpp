@@ -0,0 +1,141 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bcrctest.h"
+#include "k3bcrc.h"
+
+#include <QTest>
+
+#include <string.h>
+
+QTEST_GUILESS_MAIN( CrcTest )
+
+namespace {
+    const unsigned char* s_checkString = reinterpret_cast<const unsigned char*>( "123456789" );
+
+    quint16 bitwiseX25( const unsigned char* data, unsigned int len, quint16 crc )
+    {
+        while( len-- ) {
+            crc ^= quint16( *data++ ) << 8;
+            for( int i = 0; i < 8; ++i )
+                crc = ( crc & 0x8000 ) ? quint16( crc<<1 ) ^ 0x1021 : quint16( crc<<1 );
+        }
+        return crc;
+    }
+
+    quint32 bitwiseReflected( const unsigned char* data, unsigned int len, quint32 crc, quint32 poly )
+    {
+        while( len-- ) {
+            crc ^= *data++;
+            for( int i = 0; i < 8; ++i )
+                crc = ( crc & 1 ) ? ( crc>>1 ) ^ poly : ( crc>>1 );
+        }
+        return crc;
+    }
+
+    void setLe32( unsigned char* p, quint32 v )
+    {
+        for( int i = 0; i < 4; ++i )
+            p[i] = ( v >> (8*i) ) & 0xff;
+    }
+
+    void makeSector( unsigned char* sector, int mode )
+    {
+        for( int i = 0; i < 2352; ++i )
+            sector[i] = ( i*7 + 3 ) & 0xff;
+        sector[0] = sector[11] = 0x00;
+        ::memset( sector+1, 0xff, 10 );
+        sector[15] = mode;
+    }
+}
+
+
+CrcTest::CrcTest()
+{
+}
+
+void CrcTest::testCheckValues()
+{
+    QCOMPARE( K3b::Device::calcX25( s_checkString, 9 ), quint16( 0x31c3 ) );
+    QCOMPARE( K3b::Device::calcCrc32( s_checkString, 9 ), quint32( 0xcbf43926 ) );
+}
+
+void CrcTest::testAgainstBitwise()
+{
+    unsigned char data[512];
+    for( int i = 0; i < 512; ++i )
+        data[i] = ( i*131 + 17 ) & 0xff;
+
+    // all lengths and alignments around the 8 byte slices
+    for( unsigned int len = 0; len < 100; ++len ) {
+        for( int offset = 0; offset < 8; ++offset ) {
+            QCOMPARE( K3b::Device::calcX25( data+offset, len, 0x1d0f ),
+                      bitwiseX25( data+offset, len, 0x1d0f ) );
+            QCOMPARE( K3b::Device::calcEdc( data+offset, len ),
+                      bitwiseReflected( data+offset, len, 0, 0xd8018001 ) );
+            QCOMPARE( K3b::Device::calcCrc32( data+offset, len ),
+                      ~bitwiseReflected( data+offset, len, 0xffffffff, 0xedb88320 ) );
+        }
+    }
+
+    // continuing a checksum
+    QCOMPARE( K3b::Device::calcCrc32( data+100, 300, K3b::Device::calcCrc32( data, 100 ) ),
+              K3b::Device::calcCrc32( data, 400 ) );
+    QCOMPARE( K3b::Device::calcEdc( data+100, 300, K3b::Device::calcEdc( data, 100 ) ),
+              K3b::Device::calcEdc( data, 400 ) );
+}
+
+void CrcTest::testQCrc()
+{
+    unsigned char q[12] = { 0x41, 0x01, 0x01, 0x00, 0x02, 0x10, 0x00, 0x00, 0x04, 0x10, 0x00, 0x00 };
+    const quint16 crc = ~K3b::Device::calcX25( q, 10 );
+    q[10] = crc >> 8;
+    q[11] = crc & 0xff;
+    QVERIFY( K3b::Device::checkQCrc( q ) );
+    q[5] ^= 0x01;
+    QVERIFY( !K3b::Device::checkQCrc( q ) );
+}
+
+void CrcTest::testRawSectorEdc()
+{
+    unsigned char sector[2352];
+
+    makeSector( sector, 1 );
+    setLe32( sector+2064, K3b::Device::calcEdc( sector, 2064 ) );
+    QVERIFY( K3b::Device::checkRawSectorEdc( sector ) );
+    sector[1000] ^= 0x80;
+    QVERIFY( !K3b::Device::checkRawSectorEdc( sector ) );
+
+    // Mode 2 Form 1
+    makeSector( sector, 2 );
+    ::memset( sector+16, 0, 8 );
+    setLe32( sector+2072, K3b::Device::calcEdc( sector+16, 2056 ) );
+    QVERIFY( K3b::Device::checkRawSectorEdc( sector ) );
+    sector[2071] ^= 0x01;
+    QVERIFY( !K3b::Device::checkRawSectorEdc( sector ) );
+
+    // Mode 2 Form 2 with and without EDC
+    makeSector( sector, 2 );
+    ::memset( sector+16, 0, 8 );
+    sector[18] = sector[22] = 0x20;
+    setLe32( sector+2348, 0 );
+    QVERIFY( K3b::Device::checkRawSectorEdc( sector ) );
+    setLe32( sector+2348, K3b::Device::calcEdc( sector+16, 2332 ) );
+    QVERIFY( K3b::Device::checkRawSectorEdc( sector ) );
+    sector[30] ^= 0x01;
+    QVERIFY( !K3b::Device::checkRawSectorEdc( sector ) );
+
+    // audio
+    for( int i = 0; i < 2352; ++i )
+        sector[i] = i & 0xff;
+    QVERIFY( K3b::Device::checkRawSectorEdc( sector ) );
+}
@@ -0,0 +1,166 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+#include "k3bcuefileparsertest.h"
+#include "k3bcuefileparser.h"
+#include "k3btrack.h"
+
+#include <QFile>
+#include <QTest>
+
+QTEST_GUILESS_MAIN( CueFileParserTest )
+
+namespace {
+    const char s_header[] =
+        "FILE \"image file.bin\" BINARY\n";
+
+    const char s_audioCue[] =
+        "\xef\xbb\xbfREM GENRE Rock\r\n"
+        "CATALOG 0123456789012\r\n"
+        "PERFORMER \"Some Band\"\r\n"
+        "TITLE \"The Album\"\r\n"
+        "FILE \"image file.bin\" BINARY\r\n"
+        "  TRACK 01 AUDIO\r\n"
+        "    TITLE \"First\"\r\n"
+        "    ISRC ABCDE1234567\r\n"
+        "    FLAGS DCP PRE\r\n"
+        "    INDEX 01 00:00:00\r\n"
+        "  TRACK 02 AUDIO\r\n"
+        "    TITLE Second\r\n"
+        "    SONGWRITER \"Someone\"\r\n"
+        "    INDEX 00 03:10:00\r\n"
+        "    INDEX 01 03:12:00\r\n"
+        "  TRACK 03 AUDIO\r\n"
+        "    INDEX  01\t05:00:74\r\n";
+}
+
+
+CueFileParserTest::CueFileParserTest()
+{
+}
+
+
+QString CueFileParserTest::writeFile( const QString& name, const QByteArray& content )
+{
+    const QString path = m_dir.path() + '/' + name;
+    QFile f( path );
+    if( f.open( QIODevice::WriteOnly ) )
+        f.write( content );
+    return path;
+}
+
+
+void CueFileParserTest::initTestCase()
+{
+    QVERIFY( m_dir.isValid() );
+    writeFile( "image file.bin", QByteArray( 2352*100, '\0' ) );
+}
+
+
+void CueFileParserTest::testParse()
+{
+    const QString cue = writeFile( "audio.cue", s_audioCue );
+
+    // the second time the result comes from the cache
+    for( int i = 0; i < 2; ++i ) {
+        K3b::CueFileParser parser( cue );
+        QVERIFY( parser.isValid() );
+        QVERIFY( parser.imageFilenameInCue() );
+        QCOMPARE( parser.imageFilename(), m_dir.path() + "/image file.bin" );
+        QCOMPARE( parser.imageFileType(), QString( "binary" ) );
+
+        const K3b::Device::Toc toc = parser.toc();
+        QCOMPARE( toc.count(), 3 );
+        QCOMPARE( toc.contentType(), K3b::Device::AUDIO );
+        QCOMPARE( toc[0].firstSector().lba(), 0 );
+        QCOMPARE( toc[0].lastSector().lba(), K3b::Msf( 3, 12, 0 ).lba()-1 );
+        QCOMPARE( toc[0].index0().lba(), K3b::Msf( 3, 10, 0 ).lba() );
+        QCOMPARE( toc[1].firstSector().lba(), K3b::Msf( 3, 12, 0 ).lba() );
+        QCOMPARE( toc[2].firstSector().lba(), K3b::Msf( 5, 0, 74 ).lba() );
+
+        const K3b::Device::CdText text = parser.cdText();
+        QCOMPARE( text.performer(), QString( "Some Band" ) );
+        QCOMPARE( text.title(), QString( "The Album" ) );
+        QCOMPARE( text[0].title(), QString( "First" ) );
+        QCOMPARE( text[1].title(), QString( "Second" ) );
+        QCOMPARE( text[1].songwriter(), QString( "Someone" ) );
+    }
+}
+
+
+void CueFileParserTest::testInvalidLines_data()
+{
+    QTest::addColumn<QByteArray>( "line" );
+
+    QTest::newRow( "unknown keyword" ) << QByteArray( "TRACKS 02 AUDIO" );
+    QTest::newRow( "track number" ) << QByteArray( "TRACK 100 AUDIO" );
+    QTest::newRow( "track type" ) << QByteArray( "TRACK 02 VIDEO" );
+    QTest::newRow( "index seconds" ) << QByteArray( "INDEX 01 01:60:00" );
+    QTest::newRow( "index frames" ) << QByteArray( "INDEX 01 01:00:75" );
+    QTest::newRow( "index format" ) << QByteArray( "INDEX 01 01:00" );
+    QTest::newRow( "flag" ) << QByteArray( "FLAGS DCP FOO" );
+    QTest::newRow( "isrc" ) << QByteArray( "ISRC ABCDE12345X7" );
+    QTest::newRow( "title quote" ) << QByteArray( "TITLE \"a\"b\"" );
+    QTest::newRow( "title length" ) << ( "TITLE " + QByteArray( 81, 'a' ) );
+    QTest::newRow( "second file" ) << QByteArray( s_header );
+}
+
+
+void CueFileParserTest::testInvalidLines()
+{
+    QFETCH( QByteArray, line );
+
+    const QByteArray valid = QByteArray( s_header ) + "TRACK 01 AUDIO\nINDEX 01 00:00:00\n";
+    K3b::CueFileParser parser( writeFile( "valid.cue", valid ) );
+    QVERIFY( parser.isValid() );
+
+    K3b::CueFileParser invalid( writeFile( "invalid.cue", valid + line + '\n' ) );
+    QVERIFY( !invalid.isValid() );
+}
+
+
+void CueFileParserTest::testImageLookup()
+{
+    // a file named like the cue file is used if the one in the cue does not exist
+    writeFile( "other.bin", QByteArray( 2352, '\0' ) );
+    K3b::CueFileParser parser( writeFile( "other.bin.cue", "FILE \"missing.bin\" BINARY\nTRACK 01 MODE1/2352\nINDEX 01 00:00:00\n" ) );
+    QVERIFY( parser.isValid() );
+    QVERIFY( !parser.imageFilenameInCue() );
+    QCOMPARE( parser.imageFilename(), m_dir.path() + "/other.bin" );
+    QCOMPARE( parser.toc().contentType(), K3b::Device::DATA );
+
+    // an unquoted file name with spaces and the image being found ignoring the case
+    K3b::CueFileParser parser2( writeFile( "case.cue", "FILE IMAGE FILE.BIN BINARY\nTRACK 01 AUDIO\nINDEX 01 00:00:00\n" ) );
+    QVERIFY( parser2.isValid() );
+    QCOMPARE( parser2.imageFilename(), m_dir.path() + "/image file.bin" );
+
+    K3b::CueFileParser parser3( writeFile( "nothing.cue", "FILE \"missing.bin\" BINARY\nTRACK 01 AUDIO\nINDEX 01 00:00:00\n" ) );
+    QVERIFY( !parser3.isValid() );
+}
+
+
+void CueFileParserTest::testValidateFiles()
+{
+    QStringList files;
+    for( int i = 0; i < 20; ++i )
+        files << writeFile( QString( "batch%1.cue" ).arg( i ), s_audioCue );
+    files << m_dir.path() + "/doesnotexist.cue";
+    files << writeFile( "broken.cue", "FILE \"image file.bin\" BINARY\nTRACK 01\n" );
+
+    const QVector<bool> results = K3b::CueFileParser::validateFiles( files );
+    QCOMPARE( results.count(), files.count() );
+    for( int i = 0; i < 20; ++i )
+        QVERIFY( results[i] );
+    QVERIFY( !results[20] );
+    QVERIFY( !results[21] );
+
+    QVERIFY( K3b::CueFileParser::validateFiles( QStringList() ).isEmpty() );
+}
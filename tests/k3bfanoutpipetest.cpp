@@ -0,0 +1,155 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bfanoutpipetest.h"
+#include "k3bfanoutpipe.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+
+QTEST_GUILESS_MAIN( FanOutPipeTest )
+
+namespace {
+    QByteArray testData()
+    {
+        // not a multiple of the chunk size to test the last partial chunk
+        QByteArray data( 3*1024*1024 + 1234, Qt::Uninitialized );
+        quint32 x = 42;
+        for( int i = 0; i < data.size(); ++i ) {
+            x = x*1103515245 + 12345;
+            data[i] = char( x >> 16 );
+        }
+        return data;
+    }
+
+
+    /**
+     * Accepts @p limit bytes and fails after that.
+     */
+    class FailingDevice : public QIODevice
+    {
+    public:
+        explicit FailingDevice( qint64 limit )
+            : m_limit( limit ),
+              m_written( 0 ) {
+        }
+
+    protected:
+        qint64 readData( char*, qint64 ) { return -1; }
+        qint64 writeData( const char*, qint64 len ) {
+            if( m_written >= m_limit )
+                return -1;
+            len = qMin( len, m_limit - m_written );
+            m_written += len;
+            return len;
+        }
+
+    private:
+        qint64 m_limit;
+        qint64 m_written;
+    };
+
+
+    class SlowBuffer : public QBuffer
+    {
+    protected:
+        qint64 writeData( const char* data, qint64 len ) {
+            QThread::msleep( 2 );
+            return QBuffer::writeData( data, len );
+        }
+    };
+}
+
+
+FanOutPipeTest::FanOutPipeTest()
+{
+}
+
+
+void FanOutPipeTest::testAllSinksGetTheData()
+{
+    QByteArray data = testData();
+    QBuffer source( &data );
+    QBuffer sinks[3];
+
+    K3b::FanOutPipe pipe;
+    QSignalSpy finishedSpy( &pipe, SIGNAL(finished()) );
+    pipe.readFrom( &source, true );
+    for( int i = 0; i < 3; ++i )
+        QCOMPARE( pipe.addSink( &sinks[i], true ), i );
+
+    QVERIFY( pipe.open() );
+    QVERIFY( finishedSpy.wait( 30000 ) );
+
+    QVERIFY( !pipe.readError() );
+    QCOMPARE( pipe.bytesRead(), quint64( data.size() ) );
+    for( int i = 0; i < 3; ++i ) {
+        QVERIFY( !pipe.isSinkFailed( i ) );
+        QVERIFY( !sinks[i].isOpen() );
+        QCOMPARE( pipe.bytesWritten( i ), quint64( data.size() ) );
+        QVERIFY( sinks[i].data() == data );
+    }
+    QCOMPARE( pipe.checksum(), QCryptographicHash::hash( data, QCryptographicHash::Md5 ).toHex() );
+}
+
+
+void FanOutPipeTest::testFailingSink()
+{
+    QByteArray data = testData();
+    QBuffer source( &data );
+    QBuffer good;
+    FailingDevice bad( 100*1024 );
+    bad.open( QIODevice::WriteOnly );
+
+    K3b::FanOutPipe pipe;
+    pipe.setBufferSize( 4 );
+    QSignalSpy failedSpy( &pipe, SIGNAL(sinkFailed(int)) );
+    QSignalSpy finishedSpy( &pipe, SIGNAL(finished()) );
+    pipe.readFrom( &source );
+    pipe.addSink( &good );
+    pipe.addSink( &bad );
+
+    QVERIFY( pipe.open() );
+    QVERIFY( finishedSpy.wait( 30000 ) );
+
+    QCOMPARE( failedSpy.count(), 1 );
+    QCOMPARE( failedSpy.first().first().toInt(), 1 );
+    QVERIFY( pipe.isSinkFailed( 1 ) );
+    QVERIFY( !pipe.isSinkFailed( 0 ) );
+    QVERIFY( good.data() == data );
+}
+
+
+void FanOutPipeTest::testSlowSink()
+{
+    QByteArray data = testData();
+    QBuffer source( &data );
+    QBuffer fast;
+    SlowBuffer slow;
+
+    K3b::FanOutPipe pipe;
+    // a small ring forces the fast sink to wait for the slow one
+    pipe.setBufferSize( 2, 4096 );
+    QSignalSpy finishedSpy( &pipe, SIGNAL(finished()) );
+    pipe.readFrom( &source );
+    pipe.addSink( &fast );
+    pipe.addSink( &slow );
+
+    QVERIFY( pipe.open() );
+    QVERIFY( finishedSpy.wait( 60000 ) );
+
+    QVERIFY( fast.data() == data );
+    QVERIFY( slow.data() == data );
+}
@@ -0,0 +1,298 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bjobqueuetest.h"
+#include "k3bjobqueue.h"
+#include "k3bjob.h"
+
+#include <QMap>
+#include <QSet>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+
+QTEST_GUILESS_MAIN( JobQueueTest )
+
+namespace {
+    /**
+     * Drives without hardware. Ejecting removes the medium.
+     */
+    class StubDevices : public K3b::JobQueueDevices
+    {
+    public:
+        struct Drive
+        {
+            K3b::Device::MediaType type;
+            K3b::Device::MediaState state;
+            qint64 freeSpace;
+            qint64 usedSpace;
+        };
+
+        void insert( const QString& dev, K3b::Device::MediaType type, K3b::Device::MediaState state = K3b::Device::STATE_EMPTY, qint64 freeSpace = -1, qint64 usedSpace = -1 ) {
+            Drive drive = { type, state, freeSpace, usedSpace };
+            m_drives[dev] = drive;
+            emit changed();
+        }
+
+        void setReadOnly( const QString& dev ) { m_readers.insert( dev ); }
+
+        QStringList devices() const { return m_drives.keys(); }
+        bool isAvailable( const QString& ) const { return true; }
+        bool canWrite( const QString& dev ) const { return !m_readers.contains( dev ); }
+        K3b::Device::MediaType mediaType( const QString& dev ) const { return m_drives.value( dev ).type; }
+        K3b::Device::MediaState mediaState( const QString& dev ) const { return m_drives.value( dev ).state; }
+        qint64 freeSpace( const QString& dev ) const { return m_drives.value( dev ).freeSpace; }
+        qint64 usedSpace( const QString& dev ) const { return m_drives.value( dev ).usedSpace; }
+
+        void eject( const QString& dev ) {
+            m_drives[dev].type = K3b::Device::MEDIA_NONE;
+            m_drives[dev].state = K3b::Device::STATE_NO_MEDIA;
+        }
+
+    private:
+        QMap<QString, Drive> m_drives;
+        QSet<QString> m_readers;
+    };
+
+
+    /**
+     * Finishes after the number of milliseconds given in the "duration" option.
+     */
+    class FakeJob : public K3b::Job
+    {
+    public:
+        FakeJob( int duration, K3b::JobHandler* hdl, QObject* parent )
+            : K3b::Job( hdl, parent ),
+              m_duration( duration ) {
+        }
+
+        void start() {
+            if( m_duration >= 0 )
+                QTimer::singleShot( m_duration, this, [this]() { emit finished( true ); } );
+        }
+
+        void cancel() {
+            emit canceled();
+            emit finished( false );
+        }
+
+    private:
+        int m_duration;
+    };
+
+
+    class FakeFactory : public K3b::JobQueueFactory
+    {
+    public:
+        K3b::Job* createJob( K3b::QueuedJob& entry, const QString&, K3b::JobHandler* handler, QObject* parent ) {
+            return new FakeJob( entry.options.value( "duration", "0" ).toInt(), handler, parent );
+        }
+    };
+
+
+    K3b::QueuedJob burnEntry( K3b::Device::MediaTypes types, int priority = 0, int duration = 0 )
+    {
+        K3b::QueuedJob e( K3b::QueuedJob::Burn, "image.iso" );
+        e.mediaTypes = types;
+        e.priority = priority;
+        e.size = 1000;
+        e.options.insert( "duration", QString::number( duration ) );
+        return e;
+    }
+}
+
+
+JobQueueTest::JobQueueTest()
+{
+}
+
+
+void JobQueueTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled( true );
+}
+
+
+void JobQueueTest::testScheduling()
+{
+    QTemporaryDir dir;
+    StubDevices devices;
+    FakeFactory factory;
+    K3b::JobQueue queue;
+    queue.setQueueFile( dir.path() + "/queue" );
+    queue.setDevices( &devices );
+    queue.setJobFactory( &factory );
+
+    devices.insert( "/dev/sr0", K3b::Device::MEDIA_CD_R );
+    devices.insert( "/dev/sr1", K3b::Device::MEDIA_DVD_R );
+
+    const QString dvd = queue.submit( burnEntry( K3b::Device::MEDIA_WRITABLE_DVD, 0, 50 ) );
+    const QString cdLow = queue.submit( burnEntry( K3b::Device::MEDIA_WRITABLE_CD, 0, 50 ) );
+    const QString cdHigh = queue.submit( burnEntry( K3b::Device::MEDIA_WRITABLE_CD, 10, 50 ) );
+
+    // nothing happens before start()
+    QCOMPARE( queue.queueDepth(), 3 );
+
+    queue.start();
+    QCOMPARE( queue.runningCount(), 2 );
+    QCOMPARE( queue.entry( cdHigh ).state, K3b::QueuedJob::Running );
+    QCOMPARE( queue.entry( cdHigh ).device, QString( "/dev/sr0" ) );
+    QCOMPARE( queue.entry( dvd ).device, QString( "/dev/sr1" ) );
+    QCOMPARE( queue.entry( cdLow ).state, K3b::QueuedJob::Pending );
+
+    // the medium is ejected afterwards, thus the next entry waits for a new one
+    QTRY_COMPARE( queue.runningCount(), 0 );
+    QCOMPARE( queue.entry( cdHigh ).state, K3b::QueuedJob::Finished );
+    QCOMPARE( queue.entry( cdLow ).state, K3b::QueuedJob::Pending );
+
+    devices.insert( "/dev/sr0", K3b::Device::MEDIA_CD_RW );
+    QCOMPARE( queue.entry( cdLow ).state, K3b::QueuedJob::Running );
+    QTRY_COMPARE( queue.entry( cdLow ).state, K3b::QueuedJob::Finished );
+    QCOMPARE( queue.queueDepth(), 0 );
+}
+
+
+void JobQueueTest::testMediumSize()
+{
+    QTemporaryDir dir;
+    StubDevices devices;
+    FakeFactory factory;
+    K3b::JobQueue queue;
+    queue.setQueueFile( dir.path() + "/queue" );
+    queue.setDevices( &devices );
+    queue.setJobFactory( &factory );
+
+    devices.insert( "/dev/sr0", K3b::Device::MEDIA_CD_R, K3b::Device::STATE_EMPTY, 500 );
+    devices.insert( "/dev/sr1", K3b::Device::MEDIA_CD_R, K3b::Device::STATE_EMPTY, 2000 );
+
+    // burnEntry() writes 1000 bytes
+    const QString first = queue.submit( burnEntry( K3b::Device::MEDIA_WRITABLE_CD, 0, -1 ) );
+    const QString second = queue.submit( burnEntry( K3b::Device::MEDIA_WRITABLE_CD, 0, -1 ) );
+
+    queue.start();
+    QCOMPARE( queue.entry( first ).device, QString( "/dev/sr1" ) );
+    QCOMPARE( queue.entry( second ).state, K3b::QueuedJob::Pending );
+
+    devices.insert( "/dev/sr0", K3b::Device::MEDIA_CD_R, K3b::Device::STATE_EMPTY, 1000 );
+    QCOMPARE( queue.entry( second ).device, QString( "/dev/sr0" ) );
+}
+
+
+void JobQueueTest::testPersistence()
+{
+    QTemporaryDir dir;
+    const QString file = dir.path() + "/queue";
+    StubDevices devices;
+    FakeFactory factory;
+    devices.insert( "/dev/sr0", K3b::Device::MEDIA_CD_R );
+
+    QString running, pending;
+    {
+        K3b::JobQueue queue;
+        queue.setQueueFile( file );
+        queue.setDevices( &devices );
+        queue.setJobFactory( &factory );
+
+        // never finishes
+        running = queue.submit( burnEntry( K3b::Device::MEDIA_WRITABLE_CD, 5, -1 ) );
+        K3b::QueuedJob e = burnEntry( K3b::Device::MEDIA_WRITABLE_DVD, 3 );
+        e.devices << "/dev/sr1";
+        e.options.insert( "speed", "8" );
+        pending = queue.submit( e );
+
+        queue.start();
+        QCOMPARE( queue.entry( running ).state, K3b::QueuedJob::Running );
+    }
+
+    K3b::JobQueue queue;
+    queue.setQueueFile( file );
+    QCOMPARE( queue.entries().count(), 2 );
+    QCOMPARE( queue.entries().at( 0 ).id, running );
+
+    // interrupted entries are queued again
+    QCOMPARE( queue.entry( running ).state, K3b::QueuedJob::Pending );
+    QVERIFY( queue.entry( running ).device.isEmpty() );
+
+    const K3b::QueuedJob e = queue.entry( pending );
+    QCOMPARE( e.priority, 3 );
+    QCOMPARE( e.mediaTypes, K3b::Device::MediaTypes( K3b::Device::MEDIA_WRITABLE_DVD ) );
+    QCOMPARE( e.devices, QStringList() << "/dev/sr1" );
+    QCOMPARE( e.options.value( "speed" ), QString( "8" ) );
+    QVERIFY( e.submitted.isValid() );
+}
+
+
+void JobQueueTest::testStatistics()
+{
+    QTemporaryDir dir;
+    StubDevices devices;
+    FakeFactory factory;
+    K3b::JobQueue queue;
+    queue.setQueueFile( dir.path() + "/queue" );
+    queue.setDevices( &devices );
+    queue.setJobFactory( &factory );
+    QSignalSpy spy( &queue, SIGNAL(statisticsChanged()) );
+
+    for( int i = 0; i < 10; ++i )
+        devices.insert( QString( "/dev/sr%1" ).arg( i ), K3b::Device::MEDIA_DVD_PLUS_R );
+    for( int i = 0; i < 12; ++i )
+        queue.submit( burnEntry( K3b::Device::MEDIA_WRITABLE_DVD, 0, 20 ) );
+
+    queue.start();
+    QCOMPARE( queue.runningCount(), 10 );
+    QCOMPARE( queue.queueDepth(), 2 );
+
+    QTRY_COMPARE( queue.runningCount(), 0 );
+    QCOMPARE( queue.finishedLastHour(), 10 );
+    QVERIFY( queue.throughput() > 0.0 );
+    QVERIFY( spy.count() > 0 );
+
+    queue.clearFinished();
+    QCOMPARE( queue.entries().count(), 2 );
+}
+
+
+void JobQueueTest::testReadingEntries()
+{
+    QTemporaryDir dir;
+    StubDevices devices;
+    FakeFactory factory;
+    K3b::JobQueue queue;
+    queue.setQueueFile( dir.path() + "/queue" );
+    queue.setDevices( &devices );
+    queue.setJobFactory( &factory );
+
+    devices.insert( "/dev/sr0", K3b::Device::MEDIA_CD_ROM, K3b::Device::STATE_COMPLETE, 0, 700000 );
+    devices.insert( "/dev/sr1", K3b::Device::MEDIA_CD_R, K3b::Device::STATE_EMPTY, 800000 );
+    devices.insert( "/dev/sr2", K3b::Device::MEDIA_CD_ROM, K3b::Device::STATE_COMPLETE, 0, 600000 );
+    devices.setReadOnly( "/dev/sr2" );
+
+    K3b::QueuedJob copy( K3b::QueuedJob::Copy, "/dev/sr0" );
+    copy.options.insert( "duration", "-1" );
+    const QString copyId = queue.submit( copy );
+
+    // ripping does not need a writer
+    K3b::QueuedJob rip( K3b::QueuedJob::Rip, QString() );
+    rip.devices << "/dev/sr2";
+    rip.options.insert( "duration", "-1" );
+    const QString ripId = queue.submit( rip );
+
+    queue.start();
+    QCOMPARE( queue.entry( copyId ).device, QString( "/dev/sr1" ) );
+    QCOMPARE( queue.entry( ripId ).device, QString( "/dev/sr2" ) );
+
+    // the sizes of the read media are recorded for the statistics
+    QCOMPARE( queue.entry( copyId ).size, qint64( 700000 ) );
+    QCOMPARE( queue.entry( ripId ).size, qint64( 600000 ) );
+}
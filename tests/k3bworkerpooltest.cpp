@@ -0,0 +1,324 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bworkerpooltest.h"
+#include "k3bworkerpool.h"
+#include "k3btaskgroup.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QSignalSpy>
+#include <QStringList>
+#include <QTest>
+
+QTEST_GUILESS_MAIN( WorkerPoolTest )
+
+namespace {
+    /**
+     * Blocks until the gate is opened and records its name.
+     */
+    class GateTask : public K3b::WorkerPool::Task
+    {
+    public:
+        GateTask( const QString& name, QStringList* log, QMutex* logMutex, QSemaphore* gate = 0 )
+            : m_name( name ),
+              m_log( log ),
+              m_logMutex( logMutex ),
+              m_gate( gate ) {
+        }
+
+        void run() {
+            if( m_gate )
+                m_gate->acquire();
+            QMutexLocker locker( m_logMutex );
+            m_log->append( m_name );
+        }
+
+    private:
+        QString m_name;
+        QStringList* m_log;
+        QMutex* m_logMutex;
+        QSemaphore* m_gate;
+    };
+
+
+    /**
+     * Counts the tasks running at the same time.
+     */
+    class CountingTask : public K3b::WorkerPool::Task
+    {
+    public:
+        CountingTask( QAtomicInt* running, QAtomicInt* maxRunning, QSemaphore* gate )
+            : m_running( running ),
+              m_maxRunning( maxRunning ),
+              m_gate( gate ) {
+        }
+
+        void run() {
+            const int now = m_running->fetchAndAddOrdered( 1 ) + 1;
+            int max = m_maxRunning->loadAcquire();
+            while( now > max && !m_maxRunning->testAndSetOrdered( max, now ) )
+                max = m_maxRunning->loadAcquire();
+            m_gate->acquire();
+            m_running->fetchAndAddOrdered( -1 );
+        }
+
+    private:
+        QAtomicInt* m_running;
+        QAtomicInt* m_maxRunning;
+        QSemaphore* m_gate;
+    };
+
+
+    /**
+     * Waits for another task inside a BlockingSection, like a ThreadJob
+     * waiting for the GUI thread.
+     */
+    class WaitingTask : public K3b::WorkerPool::Task
+    {
+    public:
+        explicit WaitingTask( QSemaphore* done )
+            : m_done( done ),
+              m_success( false ) {
+        }
+
+        void run() {
+            K3b::WorkerPool::BlockingSection blocking;
+            m_success = m_done->tryAcquire( 1, 10000 );
+        }
+
+        bool success() const { return m_success; }
+
+    private:
+        QSemaphore* m_done;
+        bool m_success;
+    };
+
+
+    class ReleasingTask : public K3b::WorkerPool::Task
+    {
+    public:
+        explicit ReleasingTask( QSemaphore* done )
+            : m_done( done ) {
+        }
+
+        void run() {
+            m_done->release();
+        }
+
+    private:
+        QSemaphore* m_done;
+    };
+
+
+    /**
+     * Blocks until the gate is opened and counts its deletion.
+     */
+    class GroupTask : public K3b::TaskGroup::Task
+    {
+    public:
+        GroupTask( QSemaphore* gate, QAtomicInt* deleted )
+            : m_gate( gate ),
+              m_deleted( deleted ) {
+        }
+
+        ~GroupTask() {
+            m_deleted->fetchAndAddOrdered( 1 );
+        }
+
+    protected:
+        void runTask() {
+            if( m_gate )
+                m_gate->acquire();
+        }
+
+    private:
+        QSemaphore* m_gate;
+        QAtomicInt* m_deleted;
+    };
+}
+
+
+WorkerPoolTest::WorkerPoolTest()
+{
+}
+
+
+void WorkerPoolTest::testPriorityOrder()
+{
+    K3b::WorkerPool pool( 1 );
+    QStringList log;
+    QMutex logMutex;
+    QSemaphore gate;
+
+    // occupies the only worker while the others are queued
+    GateTask blocker( "blocker", &log, &logMutex, &gate );
+    GateTask background1( "background1", &log, &logMutex );
+    GateTask background2( "background2", &log, &logMutex );
+    GateTask interactive( "interactive", &log, &logMutex );
+
+    pool.submit( &blocker, K3b::WorkerPool::Interactive );
+    QTRY_COMPARE( pool.statistics().busyWorkers, 1 );
+
+    pool.submit( &background1, K3b::WorkerPool::Background );
+    pool.submit( &background2, K3b::WorkerPool::Background );
+    pool.submit( &interactive, K3b::WorkerPool::Interactive );
+
+    QCOMPARE( pool.statistics().queued[K3b::WorkerPool::Background], 2 );
+    QCOMPARE( pool.statistics().queued[K3b::WorkerPool::Interactive], 1 );
+
+    gate.release();
+    pool.waitForDone();
+
+    QCOMPARE( log, QStringList() << "blocker" << "interactive" << "background1" << "background2" );
+
+    const K3b::WorkerPool::Statistics stats = pool.statistics();
+    QCOMPARE( stats.completed, quint64( 4 ) );
+    QCOMPARE( stats.workers, 0 );
+    QCOMPARE( stats.busyWorkers, 0 );
+}
+
+
+void WorkerPoolTest::testBound()
+{
+    K3b::WorkerPool pool( 2 );
+    QAtomicInt running( 0 );
+    QAtomicInt maxRunning( 0 );
+    QSemaphore gate;
+
+    QList<CountingTask*> tasks;
+    for( int i = 0; i < 6; ++i ) {
+        tasks.append( new CountingTask( &running, &maxRunning, &gate ) );
+        pool.submit( tasks.last(), K3b::WorkerPool::Background );
+    }
+
+    QTRY_COMPARE( pool.statistics().busyWorkers, 2 );
+    QCOMPARE( pool.statistics().workers, 2 );
+
+    gate.release( 6 );
+    pool.waitForDone();
+
+    QCOMPARE( maxRunning.loadAcquire(), 2 );
+    QCOMPARE( pool.statistics().completed, quint64( 6 ) );
+    qDeleteAll( tasks );
+}
+
+
+void WorkerPoolTest::testRealtimeExceedsBound()
+{
+    K3b::WorkerPool pool( 1 );
+    QAtomicInt running( 0 );
+    QAtomicInt maxRunning( 0 );
+    QSemaphore gate;
+
+    CountingTask background( &running, &maxRunning, &gate );
+    CountingTask realtime( &running, &maxRunning, &gate );
+
+    pool.submit( &background, K3b::WorkerPool::Background );
+    QTRY_COMPARE( pool.statistics().busyWorkers, 1 );
+
+    // a reader feeding a writer must not wait for a background task
+    pool.submit( &realtime, K3b::WorkerPool::Realtime );
+    QTRY_COMPARE( pool.statistics().busyWorkers, 2 );
+
+    gate.release( 2 );
+    pool.waitForDone();
+    QCOMPARE( maxRunning.loadAcquire(), 2 );
+}
+
+
+void WorkerPoolTest::testBlockingSection()
+{
+    K3b::WorkerPool pool( 1 );
+    QSemaphore done;
+
+    // without the BlockingSection the second task would never be started
+    WaitingTask waiting( &done );
+    ReleasingTask releasing( &done );
+
+    pool.submit( &waiting );
+    QTRY_COMPARE( pool.statistics().blockedWorkers, 1 );
+    pool.submit( &releasing );
+    pool.waitForDone();
+
+    QVERIFY( waiting.success() );
+    QCOMPARE( pool.statistics().blockedWorkers, 0 );
+}
+
+
+void WorkerPoolTest::testCancel()
+{
+    K3b::WorkerPool pool( 1 );
+    QStringList log;
+    QMutex logMutex;
+    QSemaphore gate;
+
+    GateTask blocker( "blocker", &log, &logMutex, &gate );
+    GateTask queued( "queued", &log, &logMutex );
+
+    pool.submit( &blocker );
+    pool.submit( &queued );
+    QTRY_COMPARE( pool.statistics().busyWorkers, 1 );
+
+    QVERIFY( !pool.cancel( &blocker ) );
+    QVERIFY( pool.cancel( &queued ) );
+    QVERIFY( !pool.cancel( &queued ) );
+
+    gate.release();
+    pool.waitForDone();
+
+    QCOMPARE( log, QStringList() << "blocker" );
+}
+
+
+void WorkerPoolTest::testTaskGroup()
+{
+    K3b::WorkerPool pool( 1 );
+    QSemaphore gate;
+    QAtomicInt deleted( 0 );
+
+    {
+        K3b::TaskGroup group( &pool );
+        QSignalSpy spy( &group, SIGNAL(taskFinished()) );
+
+        GroupTask* running = new GroupTask( &gate, &deleted );
+        GroupTask* queued = new GroupTask( 0, &deleted );
+        GroupTask* left = new GroupTask( &gate, &deleted );
+        group.submit( running );
+        QTRY_COMPARE( pool.statistics().busyWorkers, 1 );
+        group.submit( queued );
+
+        // a queued task is deleted right away, a running one only flagged
+        QVERIFY( group.cancel( queued ) );
+        QCOMPARE( deleted.load(), 1 );
+        QVERIFY( !group.cancel( running ) );
+        QVERIFY( running->isCanceled() );
+
+        gate.release();
+        QTRY_COMPARE( spy.count(), 1 );
+        const QList<K3b::TaskGroup::Task*> finished = group.takeFinished();
+        QCOMPARE( finished.count(), 1 );
+        QCOMPARE( finished.first(), static_cast<K3b::TaskGroup::Task*>( running ) );
+        QVERIFY( group.takeFinished().isEmpty() );
+        qDeleteAll( finished );
+        QCOMPARE( deleted.load(), 2 );
+
+        // destroying the group waits for the running task and deletes it
+        group.submit( left );
+        QTRY_COMPARE( pool.statistics().busyWorkers, 1 );
+        gate.release();
+    }
+
+    QCOMPARE( deleted.load(), 3 );
+}
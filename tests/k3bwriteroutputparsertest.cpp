@@ -0,0 +1,265 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#include "k3bwriteroutputparsertest.h"
+#include "k3blinesplitter.h"
+#include "k3bwriteroutputparser.h"
+
+#include <QTest>
+
+QTEST_GUILESS_MAIN( WriterOutputParserTest )
+
+namespace {
+    // Synthetic output modeled on the format of wodim and growisofs. The
+    // progress lines are repeated to get the volume of a real burn.
+    const char s_cdrecordHeader[] =
+        "Starting to write CD/DVD at speed 16.0 in real TAO mode for single session.\n"
+        "Last chance to quit, starting real write in    0 seconds. Operation starts.\n"
+        "Waiting for reader process to fill input buffer ... input buffer ready.\n"
+        "BURN-Free is ON.\n"
+        "Performing OPC...\n"
+        "Starting new track at sector: 0\n";
+    const char s_cdrecordProgress[] =
+        "\rTrack 01:  %1 of  680 MB written (fifo 100%) [buf  99%]  16.1x.";
+    const char s_cdrecordFooter[] =
+        "\nTrack 01: Total bytes read/written: 713031680/713031680 (348160 sectors).\n"
+        "Writing  time:  311.521s\n"
+        "Average write speed  15.0x.\n"
+        "Min drive buffer fill was 93%\n"
+        "Fixating...\n"
+        "Fixating time:   14.003s\n"
+        "BURN-Free was 0 times used.\n"
+        "wodim: fifo had 11228 puts and 11228 gets.\n"
+        "wodim: fifo was 0 times empty and 10983 times full, min fill was 96%.\n";
+
+    const char s_growisofsHeader[] =
+        "Executing 'builtin_dd if=/dev/fd/0 of=/dev/sr0 obs=32k seek=0'\n"
+        "/dev/sr0: \"Current Write Speed\" is 8.2x1352KBps.\n";
+    const char s_growisofsProgress[] =
+        "  %1/4590534656 ( %2%) @8.0x, remaining 6:51 RBU 100.0% UBU  98.5%\n";
+    const char s_growisofsFooter[] =
+        "builtin_dd: 2241472*2KB out @ average 7.9x1352KBps\n"
+        "/dev/sr0: flushing cache\n"
+        "/dev/sr0: closing track\n"
+        "/dev/sr0: closing disc\n";
+
+    QByteArray cdrecordLog()
+    {
+        QByteArray log( s_cdrecordHeader );
+        for( int i = 0; i < 3; ++i ) {
+            for( int mb = 0; mb <= 680; ++mb )
+                log += QString::fromLatin1( s_cdrecordProgress ).arg( mb, 4 ).toLatin1();
+        }
+        log += s_cdrecordFooter;
+        return log;
+    }
+
+    QByteArray growisofsLog()
+    {
+        QByteArray log( s_growisofsHeader );
+        const qint64 size = 4590534656LL;
+        for( qint64 written = 0; written < size; written += 2*1024*1024 ) {
+            log += QString::fromLatin1( s_growisofsProgress )
+                   .arg( written, 10 )
+                   .arg( 100.0*double(written)/double(size), 4, 'f', 1 )
+                   .toLatin1();
+        }
+        log += s_growisofsFooter;
+        return log;
+    }
+
+    // feed the log in pipe sized chunks like Process does
+    template<typename Handler>
+    void replay( const QByteArray& log, Handler& handler )
+    {
+        K3b::LineSplitter splitter;
+        QString line;
+        for( int pos = 0; pos < log.size(); pos += 4096 ) {
+            splitter.feed( log.constData() + pos, qMin( 4096, log.size() - pos ) );
+            while( splitter.readLine( line ) )
+                handler( line );
+        }
+    }
+
+    struct CdrecordHandler
+    {
+        CdrecordHandler() : progressLines( 0 ), lastWritten( -1 ), burnfree( -1 ) {}
+        void operator()( const QString& line ) {
+            K3b::WriterOutput::CdrecordProgress progress;
+            if( K3b::WriterOutput::parseCdrecordProgress( line, progress ) ) {
+                ++progressLines;
+                lastWritten = progress.written;
+            }
+            else
+                K3b::WriterOutput::parseBurnfreeCounter( line, burnfree );
+        }
+        int progressLines;
+        int lastWritten;
+        int burnfree;
+    };
+
+    struct GrowisofsHandler
+    {
+        GrowisofsHandler() : progressLines( 0 ), minDeviceBuffer( 100.0 ) {}
+        void operator()( const QString& line ) {
+            double ring = 0.0, device = 0.0;
+            if( K3b::WriterOutput::parseGrowisofsBuffers( line, ring, device ) ) {
+                ++progressLines;
+                minDeviceBuffer = qMin( minDeviceBuffer, device );
+            }
+        }
+        int progressLines;
+        double minDeviceBuffer;
+    };
+}
+
+
+WriterOutputParserTest::WriterOutputParserTest()
+{
+}
+
+void WriterOutputParserTest::testLineSplitter()
+{
+    K3b::LineSplitter splitter;
+    QString line;
+
+    splitter.feed( QByteArray( "first\r\nsecond\tvalue\b\b\b\bthird." ) );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString( "first" ) );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString( "second value" ) );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString( "third." ) );
+    QVERIFY( !splitter.readLine( line ) );
+    QVERIFY( !splitter.hasUnfinishedLine() );
+
+    splitter.reset();
+    splitter.setSuppressEmptyLines( false );
+    splitter.feed( QByteArray( "a\n\nb\n" ) );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString( "a" ) );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString() );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString( "b" ) );
+}
+
+void WriterOutputParserTest::testLineSplitterChunks()
+{
+    K3b::LineSplitter splitter;
+    QString line;
+
+    splitter.feed( QByteArray( "Track 01:   1 of" ) );
+    QVERIFY( !splitter.readLine( line ) );
+    QVERIFY( splitter.hasUnfinishedLine() );
+
+    // a backspace run split across two chunks still ends only one line
+    splitter.feed( QByteArray( " 680 MB\b\b" ) );
+    splitter.feed( QByteArray( "\b\bnext\n" ) );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString( "Track 01:   1 of 680 MB" ) );
+    QVERIFY( splitter.readLine( line ) );
+    QCOMPARE( line, QString( "next" ) );
+    QVERIFY( !splitter.readLine( line ) );
+    QVERIFY( !splitter.hasUnfinishedLine() );
+}
+
+void WriterOutputParserTest::testCdrecordProgress()
+{
+    K3b::WriterOutput::CdrecordProgress p;
+
+    QVERIFY( K3b::WriterOutput::parseCdrecordProgress( "Track 01:   12 of  700 MB written (fifo 100%) [buf  99%]  16.0x.", p ) );
+    QCOMPARE( p.track, 1 );
+    QCOMPARE( p.written, 12 );
+    QCOMPARE( p.size, 700 );
+    QCOMPARE( p.fifo, 100 );
+    QCOMPARE( p.buffer, 99 );
+
+    // no fifo and no buffer as printed by some patched versions
+    QVERIFY( K3b::WriterOutput::parseCdrecordProgress( "Track 02:    0 of   45 MB written.", p ) );
+    QCOMPARE( p.track, 2 );
+    QCOMPARE( p.written, 0 );
+    QCOMPARE( p.size, 45 );
+    QCOMPARE( p.fifo, -1 );
+    QCOMPARE( p.buffer, -1 );
+
+    QVERIFY( !K3b::WriterOutput::parseCdrecordProgress( "Track 01: Total bytes read/written: 713031680/713031680 (348160 sectors).", p ) );
+    QVERIFY( !K3b::WriterOutput::parseCdrecordProgress( "Track 1:   12 of  700 MB written.", p ) );
+}
+
+void WriterOutputParserTest::testCdrecordCounters()
+{
+    int count = -1;
+    QVERIFY( K3b::WriterOutput::parseBurnfreeCounter( "BURN-Free was 3 times used.", count ) );
+    QCOMPARE( count, 3 );
+    QVERIFY( !K3b::WriterOutput::parseBurnfreeCounter( "BURN-Free is ON.", count ) );
+
+    QVERIFY( K3b::WriterOutput::parsePredictedUnderruns( "Total of 2  possible buffer underruns predicted.", count ) );
+    QCOMPARE( count, 2 );
+
+    QCOMPARE( K3b::WriterOutput::indexOfDigit( "Fixating time:   14.003s", 10 ), 17 );
+    QCOMPARE( K3b::WriterOutput::indexOfDigit( "no digits here" ), -1 );
+    QCOMPARE( K3b::WriterOutput::indexOfNonDigit( "12345 of", 0 ), 5 );
+}
+
+void WriterOutputParserTest::testGrowisofsBuffers()
+{
+    double ring = 0.0, device = 0.0;
+
+    QVERIFY( K3b::WriterOutput::parseGrowisofsBuffers( "  1234567/4567890 (27.0%) @2.4x, remaining 5:12 RBU 100.0% UBU  98.5%", ring, device ) );
+    QCOMPARE( ring, 100.0 );
+    QCOMPARE( device, 98.5 );
+
+    // growisofs 6.x does not print the drive buffer
+    QVERIFY( K3b::WriterOutput::parseGrowisofsBuffers( "  1234567/4567890 (27.0%) @2.4x, remaining 5:12 RBU  87.0%", ring, device ) );
+    QCOMPARE( ring, 87.0 );
+    QCOMPARE( device, -1.0 );
+
+    QVERIFY( !K3b::WriterOutput::parseGrowisofsBuffers( "/dev/sr0: flushing cache", ring, device ) );
+
+    // a malformed value is rejected instead of read as 0
+    QVERIFY( !K3b::WriterOutput::parseGrowisofsBuffers( "  1234567/4567890 (27.0%) @2.4x, remaining 5:12 RBU --.-%", ring, device ) );
+}
+
+void WriterOutputParserTest::testCdrdaoWrote()
+{
+    int written = 0, size = 0;
+    QVERIFY( K3b::WriterOutput::parseCdrdaoWrote( "Wrote 12 of 700 MB (Buffers 100%  96%).", written, size ) );
+    QCOMPARE( written, 12 );
+    QCOMPARE( size, 700 );
+    QVERIFY( !K3b::WriterOutput::parseCdrdaoWrote( "Wrote of 700 MB", written, size ) );
+}
+
+void WriterOutputParserTest::benchmarkCdrecordLog()
+{
+    const QByteArray log = cdrecordLog();
+    CdrecordHandler handler;
+    QBENCHMARK {
+        handler = CdrecordHandler();
+        replay( log, handler );
+    }
+    QCOMPARE( handler.progressLines, 3*681 );
+    QCOMPARE( handler.lastWritten, 680 );
+    QCOMPARE( handler.burnfree, 0 );
+}
+
+void WriterOutputParserTest::benchmarkGrowisofsLog()
+{
+    const QByteArray log = growisofsLog();
+    GrowisofsHandler handler;
+    QBENCHMARK {
+        handler = GrowisofsHandler();
+        replay( log, handler );
+    }
+    QVERIFY( handler.progressLines > 2000 );
+    QCOMPARE( handler.minDeviceBuffer, 98.5 );
+}
@@ -0,0 +1,34 @@
+/*
+ *
+ * This file is part of the K3b project.
+ * Copyright (C) 1998-2019 Sebastian Trueg <trueg@k3b.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * See the file "COPYING" for the exact licensing terms.
+ */
+
+#ifndef K3B_WRITER_OUTPUT_PARSER_TEST_H
+#define K3B_WRITER_OUTPUT_PARSER_TEST_H
+
+#include <QObject>
+
+class WriterOutputParserTest : public QObject
+{
+    Q_OBJECT
+public:
+    WriterOutputParserTest();
+private slots:
+    void testLineSplitter();
+    void testLineSplitterChunks();
+    void testCdrecordProgress();
+    void testCdrecordCounters();
+    void testGrowisofsBuffers();
+    void testCdrdaoWrote();
+    void benchmarkCdrecordLog();
+    void benchmarkGrowisofsLog();
+};
+
+#endif // K3B_WRITER_OUTPUT_PARSER_TEST_H